@@ -0,0 +1,206 @@
+#ifndef GLUTILS_BRICK_CACHE_HPP
+#define GLUTILS_BRICK_CACHE_HPP
+
+#include "mapped_file.hpp"
+#include "texture.hpp"
+#include "tile_residency.hpp"
+
+#include "glm/fwd.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GL {
+
+/// Streams the visible parts of a volume too large for memory into a pool of fixed size bricks on the GPU.
+/**
+ * The volume and each of its mip levels is split into cubic bricks:
+ * - Resident bricks occupy the slots of the brick pool, a single 3D texture. Each slot holds a brick plus a border
+ *   of voxels duplicated from its neighbours, so that trilinear filtering is seamless across bricks.
+ * - An rgba8ui indirection volume, a mipmapped 3D texture with one texel per brick, holds the slot of every brick.
+ *   Bricks that aren't resident map to their closest resident ancestor, so sampling always finds something, at a
+ *   lower resolution while the brick is loading.
+ * - update() walks the brick hierarchy from the coarsest level, skips bricks outside the view frustum and refines
+ *   those closer to the eye than their level allows. Missing bricks are copied out of the memory-mapped volume file
+ *   by worker threads, coarse levels first, and uploaded through a TileResidency. Least recently used bricks are
+ *   evicted to make room.
+ *
+ * The volume file holds the levels one after the other, starting at Options::file_offset, finest first. Level l is
+ * max(1, width >> l) x max(1, height >> l) x max(1, depth >> l) voxels of Options::data_format and
+ * Options::data_type, x varying fastest, with no padding. getFileSize() gives the expected size.
+ *
+ * The bricks of the coarsest level are loaded first and, unless they would take more than half of the pool, never
+ * evicted.
+ */
+class BrickCache
+{
+public:
+    /// A brick of the volume: level and position in bricks within that level.
+    struct BrickId
+    {
+        GLint level{0};
+        GLint x{0};
+        GLint y{0};
+        GLint z{0};
+    };
+
+    struct Options
+    {
+        /// Size of level 0 of the volume, in voxels.
+        GLsizei width{512};
+        GLsizei height{512};
+        GLsizei depth{512};
+        /// Number of levels stored in the file. Levels coarser than a single brick are ignored.
+        GLsizei levels{1};
+        /// Offset of level 0 in the file, e.g. to skip a header.
+        std::size_t file_offset{0};
+
+        /// Voxels per side of a brick, excluding the border. Must be a power of two.
+        GLsizei brick_size{32};
+        /// Voxels duplicated from the neighbouring bricks on each side.
+        GLsizei border{1};
+
+        /// Slots per row, column and slice of the brick pool. At most 256 each.
+        GLsizei pool_bricks_x{16};
+        GLsizei pool_bricks_y{16};
+        GLsizei pool_bricks_z{8};
+
+        TextureHandle::SizedInternalFormat format{TextureHandle::SizedInternalFormat::r8};
+        /// Layout of the voxels in the file.
+        TextureHandle::DataFormat data_format{TextureHandle::DataFormat::red};
+        TextureHandle::DataType data_type{TextureHandle::DataType::ubyte};
+
+        /// Bricks closer to the eye than this many level 0 voxels use level 0; every doubling of the distance
+        /// selects the next coarser level.
+        float lod_distance{256.f};
+
+        /// Size of the staging ring bricks are uploaded through. Must hold at least one brick with its border.
+        GLsizeiptr staging_size{32 << 20};
+        /// Maximum number of bricks started loading per update().
+        GLsizei max_requests_per_frame{64};
+        unsigned int loader_threads{2};
+
+        /// Texture units used by bind() and by the shader source.
+        GLuint indirection_unit{0};
+        GLuint pool_unit{1};
+    };
+
+    struct Stats
+    {
+        /// Bricks currently in the pool.
+        std::size_t resident_bricks{0};
+        /// Bricks being loaded or uploaded.
+        std::size_t loading_bricks{0};
+        /// Visible bricks at the level of detail selected by the last update().
+        std::size_t requested_bricks{0};
+        /// Fraction of the requested bricks that were resident.
+        float hit_rate{1.f};
+        /// Bricks that finished uploading during the last update().
+        std::size_t uploaded_bricks{0};
+        /// Bricks evicted during the last update().
+        std::size_t evicted_bricks{0};
+        /// Bytes of voxel data uploaded during the last update().
+        GLsizeiptr bytes_streamed{0};
+    };
+
+    /// Stream bricks from @p file, which must hold the levels described by @p options.
+    BrickCache(MappedFile file, const Options &options);
+
+    /// Stops the loader threads. Must be called on the GL thread.
+    ~BrickCache() = default;
+
+    BrickCache(const BrickCache &) = delete;
+
+    BrickCache &operator=(const BrickCache &) = delete;
+
+    /// Bind the indirection volume and the brick pool to the units given in the options.
+    void bind() const;
+
+    /// Select the visible bricks, schedule loads for the missing ones, issue finished uploads and update the
+    /// indirection volume.
+    /**
+     * Call once per frame, before drawing the volume. Never waits for the GPU or for the loader threads.
+     *
+     * @param volume_to_clip Transformation from normalized volume coordinates, [0, 1] along each axis, to clip space.
+     * @param eye Position of the eye in normalized volume coordinates.
+     */
+    void update(const glm::mat4 &volume_to_clip, const glm::vec3 &eye);
+
+    /// GLSL defining "vec4 sampleBrickVolume(vec3 uvw, int level)" and "int getBrickVolumeLevel(vec3 uvw, vec3 eye)".
+    /**
+     * Paste after the #version line (4.50). getBrickVolumeLevel() applies the same level of detail rule as update(),
+     * with both positions in normalized volume coordinates. sampleBrickVolume() filters trilinearly within the best
+     * resident brick at or above @p level, and returns zero where nothing is resident.
+     */
+    [[nodiscard]]
+    static auto getShaderSource(const Options &options) -> std::string;
+
+    /// Size in bytes of a file holding the levels described by @p options, including the offset.
+    [[nodiscard]]
+    static auto getFileSize(const Options &options) -> std::size_t;
+
+    /// Number of levels bricks are streamed from.
+    [[nodiscard]]
+    auto getLevelCount() const -> GLsizei
+    { return GLsizei(m_levels.size()); }
+
+    [[nodiscard]]
+    auto getIndirectionTexture() const -> TextureHandle
+    { return m_indirection; }
+
+    [[nodiscard]]
+    auto getPoolTexture() const -> TextureHandle
+    { return m_pool; }
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+    [[nodiscard]]
+    auto getOptions() const -> const Options &
+    { return m_options; }
+
+private:
+    struct Level
+    {
+        // voxels in the file
+        GLsizei width, height, depth;
+        const std::byte *data;
+        // bricks covering the level
+        GLsizei bricks_x, bricks_y, bricks_z;
+    };
+
+    struct Candidate
+    {
+        BrickId brick;
+        float distance;
+    };
+
+    static auto s_key(const BrickId &brick) -> std::uint64_t;
+
+    void selectBricks(const BrickId &brick, const float *volume_to_clip, const float *eye,
+                      std::unordered_map<std::uint64_t, Candidate> &missing);
+
+    void copyBrick(const BrickId &brick, std::byte *destination, GLsizeiptr row_stride) const;
+
+    Options m_options;
+    MappedFile m_file;
+    GLsizeiptr m_voxel_size;
+    std::vector<Level> m_levels;
+
+    Texture m_pool;
+    Texture m_indirection;
+
+    std::size_t m_visible_hits{0};
+    Stats m_stats;
+
+    // last, so that the loader threads stop before what they read is destroyed
+    std::optional<TileResidency> m_residency;
+};
+
+} // GL
+
+#endif //GLUTILS_BRICK_CACHE_HPP
@@ -262,6 +262,30 @@ public:
      */
     void unmap() const;
 
+    enum class Target : GLenum
+    {
+        array = 0x8892,
+        atomic_counter = 0x92C0,
+        copy_read = 0x8F36,
+        copy_write = 0x8F37,
+        dispatch_indirect = 0x90EE,
+        draw_indirect = 0x8F3F,
+        element_array = 0x8893,
+        pixel_pack = 0x88EB,
+        pixel_unpack = 0x88EC,
+        query = 0x9192,
+        shader_storage = 0x90D2,
+        texture = 0x8C2A,
+        transform_feedback = 0x8C8E,
+        uniform = 0x8A11
+    };
+
+    /// glBindBuffer — bind a named buffer object. https://registry.khronos.org/OpenGL-Refpages/gl4/html/glBindBuffer.xhtml
+    void bind(Target target) const;
+
+    /// Bind buffer zero to @p target, i.e. break any existing binding.
+    static void unbind(Target target);
+
     enum class IndexedTarget : GLenum
     {
         atomic_counter = 0x92C0,
@@ -0,0 +1,70 @@
+#ifndef GLUTILS_CALL_STATS_HPP
+#define GLUTILS_CALL_STATS_HPP
+
+#include "gl.hpp"
+
+#if GLUTILS_CALL_STATS
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace GL {
+
+constexpr std::size_t call_histogram_buckets = 16;
+
+/// Number of calls made to a GL entry point, and the CPU time they took.
+struct CallStats
+{
+    /// The entry point, e.g. "glBindBufferRange".
+    const char *name;
+    std::uint64_t calls{0};
+    std::chrono::nanoseconds time{0};
+    std::chrono::nanoseconds max_time{0};
+    /// Calls by duration: bucket 0 counts calls under 128 ns, bucket i those from 64 << i ns up to twice that, and
+    /// the last one every longer call.
+    std::array<std::uint64_t, call_histogram_buckets> histogram{};
+};
+
+/// Start or stop counting and timing the GL calls made from the calling thread.
+/**
+ * Every GL call goes through the pre and post callbacks of glad's debug loader, which loadContext() installs when
+ * glutils is built with the GLUTILS_CALL_STATS CMake option, in any configuration. It's off by default, since it
+ * slows every call down in debug builds too. Calls cost a branch each while stats are disabled, and two clock reads and a hash lookup while
+ * they're enabled; the time measured includes the latter.
+ */
+void enableCallStats(bool enabled = true);
+
+[[nodiscard]]
+auto isCallStatsEnabled() -> bool;
+
+/// Close the current frame: its stats become those of getFrameCallStats() and are added to getTotalCallStats().
+void endCallStatsFrame();
+
+/// Stats of the frame last closed with endCallStatsFrame(), by decreasing time.
+[[nodiscard]]
+auto getFrameCallStats() -> std::vector<CallStats>;
+
+/// Stats of every frame closed since the last resetCallStats(), by decreasing time.
+[[nodiscard]]
+auto getTotalCallStats() -> std::vector<CallStats>;
+
+/// Clear the stats of the calling thread.
+void resetCallStats();
+
+/// Write @p stats as a table, one entry point per row, with its share of the total time and its histogram.
+void writeCallStats(std::ostream &out, const std::vector<CallStats> &stats, std::size_t max_rows = 30);
+
+/// Called by the callbacks loadContext() installs, around every GL call.
+void beginCallStats();
+
+void endCallStats(const char *name);
+
+} // GL
+
+#endif // GLUTILS_CALL_STATS
+
+#endif //GLUTILS_CALL_STATS_HPP
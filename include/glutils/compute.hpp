@@ -0,0 +1,24 @@
+#ifndef GLUTILS_COMPUTE_HPP
+#define GLUTILS_COMPUTE_HPP
+
+#include "gl_types.hpp"
+
+namespace GL {
+
+/// glDispatchCompute — launch one or more compute work groups, using the currently bound program.
+/**
+ * https://registry.khronos.org/OpenGL-Refpages/gl4/html/glDispatchCompute.xhtml
+ */
+void dispatchCompute(GLuint num_groups_x, GLuint num_groups_y = 1, GLuint num_groups_z = 1);
+
+/// glDispatchComputeIndirect — launch compute work groups, reading their count from the bound dispatch indirect buffer.
+/**
+ * https://registry.khronos.org/OpenGL-Refpages/gl4/html/glDispatchComputeIndirect.xhtml
+ * @param indirect Byte offset of the dispatch parameters into the buffer bound to
+ * BufferHandle::Target::dispatch_indirect.
+ */
+void dispatchComputeIndirect(GLintptr indirect);
+
+} // GL
+
+#endif //GLUTILS_COMPUTE_HPP
@@ -0,0 +1,129 @@
+#ifndef GLUTILS_COMPUTE_DOWNSAMPLE_HPP
+#define GLUTILS_COMPUTE_DOWNSAMPLE_HPP
+
+#include "program.hpp"
+#include "texture.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace GL {
+
+/// Generates mipmaps with a compute shader, for reductions and formats that glGenerateTextureMipmap can't handle.
+/**
+ * Each level is written with image stores. Up to four levels are produced per dispatch: every work group reduces a
+ * 16x16 block of the source level through shared memory, as long as the intermediate levels have even dimensions.
+ *
+ * Destination texels at the right or bottom edge of a level with an odd size also cover the last row or column of
+ * the source level, so min and max reductions are conservative (no source texel is skipped), as required for
+ * hierarchical depth buffers. Depth textures can't be bound as images, so those should first be copied into an
+ * r32f texture.
+ */
+class ComputeDownsampler
+{
+public:
+    enum class Reduction
+    {
+        /// Mean of the source texels. Integer formats use integer division.
+        average,
+        minimum,
+        maximum,
+        /// User supplied GLSL, see Options::custom_combine.
+        custom
+    };
+
+    struct Options
+    {
+        Reduction reduction{Reduction::average};
+
+        /// Format of the textures this downsampler will be used with. Must be usable with image load/store.
+        TextureHandle::SizedInternalFormat format{TextureHandle::SizedInternalFormat::rgba8};
+
+        /// For Reduction::custom: GLSL code defining "VEC combine(VEC a, VEC b)", where VEC is vec4, ivec4 or
+        /// uvec4 depending on the format. The operation should be associative and commutative.
+        std::string custom_combine;
+    };
+
+    explicit ComputeDownsampler(const Options &options);
+
+    /// Fill levels @p base_level + 1 up to @p base_level + @p level_count - 1 of a 2D texture from @p base_level.
+    /**
+     * Inserts the memory barriers needed between the dispatches, and a final barrier for sampling the result
+     * (MemoryBarrierBits::texture_fetch | MemoryBarrierBits::shader_image_access).
+     *
+     * @param texture A 2D texture with storage of the format given in the options.
+     * @param width Width of @p base_level.
+     * @param height Height of @p base_level.
+     * @param base_level Level to read from.
+     * @param level_count Number of levels, including @p base_level. Zero means all levels down to 1x1.
+     */
+    void generate(TextureHandle texture, GLsizei width, GLsizei height, GLint base_level = 0,
+                  GLsizei level_count = 0) const;
+
+    /// Number of dispatches generate() would issue for the given size and level count.
+    [[nodiscard]]
+    static auto getDispatchCount(GLsizei width, GLsizei height, GLsizei level_count = 0) -> GLsizei;
+
+    /// The GLSL source of the compute shader used for the given options.
+    [[nodiscard]]
+    static auto getShaderSource(const Options &options) -> std::string;
+
+    [[nodiscard]]
+    auto getProgram() const -> ProgramHandle
+    { return m_program; }
+
+    /// Result of verify().
+    struct Verification
+    {
+        /// Largest absolute difference between a component written by the GPU and the CPU reference.
+        double max_error{0.};
+        /// Level where max_error was found; -1 if every level matched exactly.
+        GLint worst_level{-1};
+        /// Whether max_error is within the tolerance.
+        bool passed{true};
+    };
+
+    /// Run generate() and compare every level it writes with the CPU reference.
+    /**
+     * Meant for checking the shader on a given driver, e.g. a software renderer like llvmpipe in CI. Each level is
+     * compared with reduceReference() applied to the level above it as read back from the GPU, so errors don't
+     * accumulate down the chain. Reads the texture back with glGetTextureImage, so it waits for the GPU; with no pixel
+     * pack buffer bound and the default pack layout.
+     *
+     * @param tolerance Largest absolute difference accepted. Float formats should match to rounding, e.g. 1e-6;
+     * normalized formats need one unit in the last place, e.g. 1/255 for rgba8; integer formats should use zero.
+     * @throws GL::Error for custom reductions, which have no CPU reference.
+     */
+    [[nodiscard]]
+    auto verify(TextureHandle texture, GLsizei width, GLsizei height, GLint base_level = 0, GLsizei level_count = 0,
+                double tolerance = 0.) const -> Verification;
+
+    /// CPU reference for a single level of a float format. @p source holds four components per texel.
+    /**
+     * Chaining these calls reproduces generate() for float formats. For normalized formats, generate() keeps the
+     * intermediate levels of a dispatch at full precision, so results should be compared with a tolerance of one
+     * unit in the last place of the format.
+     */
+    [[nodiscard]]
+    static auto reduceReference(const std::vector<float> &source, GLsizei width, GLsizei height,
+                                Reduction reduction) -> std::vector<float>;
+
+    /// CPU reference for a single level of a signed integer format.
+    [[nodiscard]]
+    static auto reduceReference(const std::vector<std::int32_t> &source, GLsizei width, GLsizei height,
+                                Reduction reduction) -> std::vector<std::int32_t>;
+
+    /// CPU reference for a single level of an unsigned integer format.
+    [[nodiscard]]
+    static auto reduceReference(const std::vector<std::uint32_t> &source, GLsizei width, GLsizei height,
+                                Reduction reduction) -> std::vector<std::uint32_t>;
+
+private:
+    Options m_options;
+    Program m_program;
+};
+
+} // GL
+
+#endif //GLUTILS_COMPUTE_DOWNSAMPLE_HPP
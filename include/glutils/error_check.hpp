@@ -0,0 +1,102 @@
+#ifndef GLUTILS_ERROR_CHECK_HPP
+#define GLUTILS_ERROR_CHECK_HPP
+
+#include "gl.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace GL {
+
+/// A GL error found by checkErrors() or by the sampling error checker.
+struct ErrorReport
+{
+    /// The glGetError() code, e.g. GL_INVALID_OPERATION.
+    GLenum error;
+    /// The call that raised the error, when it was found while checking every call; null otherwise.
+    const char *call;
+    /// The checkpoint passed to checkErrors() that found the error; null if it was found by sampling.
+    const char *checkpoint;
+    /// Calls made since the previous check, oldest first, as far back as the history reaches. The error was raised by
+    /// one of them. Without GLUTILS_CALL_STATS, only calls to the hooked entry points are recorded.
+    std::vector<const char *> recent_calls;
+};
+
+struct ErrorCheckOptions
+{
+    /// Fraction of the time between two sampled checks that checking may take: glGetError() plus the bookkeeping of
+    /// every call made in between. The number of calls between checks is adjusted to stay within it, as far as
+    /// glGetError() is concerned; the bookkeeping costs the same whatever the interval.
+    double overhead_budget{0.001};
+    std::uint32_t min_interval{64};
+    std::uint32_t max_interval{1u << 20};
+    /// Number of calls remembered for ErrorReport::recent_calls.
+    std::size_t history_size{64};
+    /// Once sampling finds an error, check after every call for this many calls to find the one raising it.
+    std::uint64_t bisect_calls{100'000};
+    /// Called for every error found. If empty, errors are thrown as GL::Error.
+    std::function<void(const ErrorReport &)> handler;
+};
+
+struct ErrorCheckStats
+{
+    std::uint64_t calls{0};
+    std::uint64_t checks{0};
+    std::uint64_t errors{0};
+    /// Calls between sampled checks at the moment.
+    std::uint32_t interval{0};
+    /// Fraction of the time spent checking over the last sampling period, bookkeeping of every call included.
+    double overhead{0.};
+};
+
+/// Check for GL errors in release builds, without a debug context.
+/**
+ * GL calls made from the calling thread are counted and recorded in a small history ring, and glGetError() is
+ * sampled every ErrorCheckStats::interval calls. The interval adapts to keep the cost of checking within the overhead
+ * budget; the per-call bookkeeping is measured once when checks are enabled and counted against it too. When a sample
+ * finds an error, every call is checked for the next bisect_calls calls, so an error that recurs, as most do from
+ * frame to frame, is pinned to the call raising it.
+ *
+ * In builds with GLUTILS_CALL_STATS every call is seen, through the callbacks of glad's debug loader. Other builds
+ * hook the entry points glutils itself uses: draws, dispatches, clears, copies, uploads, object creation, binding and
+ * the common state changes. The first call to enableErrorChecks() swaps glad's pointers to those for thin wrappers,
+ * which cost an indirect call and a thread-local branch while checks are disabled. Calls to other entry points
+ * aren't counted, so an error they raise is reported at the next hooked call or checkpoint, and a bisected report
+ * names the hooked call that followed it. Enable checks before other threads make GL calls, since the pointers are
+ * shared; loadContext() hooks the entry points it loads again.
+ */
+void enableErrorChecks();
+
+void enableErrorChecks(const ErrorCheckOptions &options);
+
+void disableErrorChecks();
+
+[[nodiscard]]
+auto areErrorChecksEnabled() -> bool;
+
+/// Report any error raised since the last check, naming @p checkpoint, e.g. a string literal like "after shadows".
+/**
+ * Works whether or not error checks are enabled; when they aren't, errors are thrown.
+ */
+void checkErrors(const char *checkpoint);
+
+[[nodiscard]]
+auto getErrorCheckStats() -> ErrorCheckStats;
+
+#if GLUTILS_CALL_STATS
+
+/// Called by the callbacks loadContext() installs, after every GL call.
+void checkErrorsAfterCall(const char *name);
+
+#else
+
+/// Called by loadContext(), to hook the entry points it loaded if error checks were ever enabled.
+void hookErrorCheckCalls();
+
+#endif // GLUTILS_CALL_STATS
+
+} // GL
+
+#endif //GLUTILS_ERROR_CHECK_HPP
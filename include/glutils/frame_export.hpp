@@ -0,0 +1,206 @@
+#ifndef GLUTILS_FRAME_EXPORT_HPP
+#define GLUTILS_FRAME_EXPORT_HPP
+
+#include "framebuffer.hpp"
+#include "readback.hpp"
+#include "texture.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__linux__)
+
+namespace GL {
+
+/// Layout of the shared memory written by FrameExporter and read by SharedFrameReader.
+/**
+ * The memory starts with a Header, followed by Header::slot_count Slot descriptions and then the pixel data of each
+ * slot, Header::slot_size bytes apart from Header::data_offset. Frames are published in order, in slot
+ * sequence % slot_count. The exporter never writes a slot the consumer hasn't released, so frames are dropped
+ * instead of overwritten when the consumer falls behind.
+ */
+namespace SharedFrameRing {
+
+constexpr std::uint32_t magic = 0x58454C47; // "GLEX"
+constexpr std::uint32_t version = 1;
+
+struct Header
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t slot_count;
+    std::uint32_t reserved;
+    std::uint64_t slot_size;
+    std::uint64_t data_offset;
+    /// Number of frames published. The consumer waits on this word with a futex; the exporter wakes it.
+    std::atomic<std::uint32_t> published;
+    /// Number of frames released by the consumer.
+    std::atomic<std::uint32_t> consumed;
+};
+
+struct Slot
+{
+    std::uint64_t sequence;
+    /// CLOCK_MONOTONIC times, in nanoseconds, of the export request and of the frame becoming readable.
+    std::int64_t request_time;
+    std::int64_t publish_time;
+    std::int32_t width;
+    std::int32_t height;
+    /// A ReadbackRing::Conversion.
+    std::uint32_t conversion;
+    /// For Conversion::none, the DataFormat and DataType of the pixels.
+    std::uint32_t format;
+    std::uint32_t type;
+    std::uint32_t reserved;
+    std::uint64_t size;
+    std::uint64_t row_stride;
+    std::uint64_t chroma_offset;
+    std::uint64_t chroma_row_stride;
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+} // SharedFrameRing
+
+/// Exports rendered frames to another local process through a ring of frames in shared memory.
+/**
+ * Frames are read back asynchronously with a ReadbackRing, and once their fence has signaled, copied from the mapped
+ * pack buffer into the next free slot of a memfd-backed ring and published. The consumer maps the same memory with
+ * SharedFrameReader and reads frames in place, so the only CPU copy per frame is the one into shared memory, which the
+ * GL can't write to directly. A consumer waiting for frames is woken through a futex in the shared header.
+ *
+ * Pass getFd() to the consumer process, e.g. over a Unix socket with SCM_RIGHTS, or let it open /proc/<pid>/fd/<fd>.
+ * Only use from the thread that owns the GL context; frames are published from poll().
+ */
+class FrameExporter
+{
+public:
+    struct Options
+    {
+        GLsizei width{0};
+        GLsizei height{0};
+        /// GPU-side conversion; nv12 is what most encoders take, at 1.5 bytes per pixel.
+        ReadbackRing::Conversion conversion{ReadbackRing::Conversion::nv12};
+        /// Pixel format read when conversion is none.
+        TextureHandle::DataFormat format{TextureHandle::DataFormat::rgba};
+        TextureHandle::DataType type{TextureHandle::DataType::ubyte};
+        /// Frames in shared memory.
+        std::uint32_t slot_count{4};
+        /// Frames that can be in flight on the GPU at once.
+        std::uint32_t readback_frames{3};
+    };
+
+    struct Stats
+    {
+        std::size_t exported{0};
+        /// Frames dropped because the consumer hadn't released enough slots, or the readback ring was full.
+        std::size_t dropped{0};
+        std::size_t bytes_copied{0};
+        /// CPU copies made per exported frame; the consumer makes none.
+        std::size_t copies_per_frame{1};
+        /// Time from an export request to its frame being published, for the last frame and on average.
+        std::chrono::nanoseconds last_latency{0};
+        std::chrono::nanoseconds average_latency{0};
+    };
+
+    /// Create the shared memory ring. Throws GL::Error if it can't be created or mapped.
+    explicit FrameExporter(const Options &options);
+
+    ~FrameExporter();
+
+    FrameExporter(const FrameExporter &) = delete;
+
+    FrameExporter &operator=(const FrameExporter &) = delete;
+
+    /// Queue the readback of level 0 of a texture of the exporter's size.
+    /**
+     * @return false if the frame was dropped.
+     */
+    auto exportTexture(TextureHandle texture) -> bool;
+
+    /// Queue the readback of the read buffer of a framebuffer. Only valid for Conversion::none.
+    auto exportFramebuffer(FramebufferHandle framebuffer) -> bool;
+
+    /// Publish the frames whose readback has completed. Never waits; call once per frame.
+    void poll();
+
+    /// The memfd holding the ring; owned by the exporter.
+    [[nodiscard]]
+    auto getFd() const -> int
+    { return m_fd; }
+
+    /// Size in bytes of the shared memory, as the consumer maps it.
+    [[nodiscard]]
+    auto getSharedSize() const -> std::size_t
+    { return m_shared_size; }
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+private:
+    auto hasFreeSlot() -> bool;
+
+    void publish(const ReadbackRing::Result &result, std::int64_t request_time);
+
+    Options m_options;
+    int m_fd{-1};
+    std::size_t m_shared_size{0};
+    std::byte *m_shared{nullptr};
+    SharedFrameRing::Header *m_header{nullptr};
+    ReadbackRing m_readback;
+    std::uint32_t m_next_sequence{0};
+    std::chrono::nanoseconds m_total_latency{0};
+    Stats m_stats;
+};
+
+/// Reads frames published by a FrameExporter in another process, in place.
+class SharedFrameReader
+{
+public:
+    struct Frame
+    {
+        const SharedFrameRing::Slot *slot{nullptr};
+        const void *data{nullptr};
+
+        [[nodiscard]] explicit operator bool() const
+        { return data; }
+    };
+
+    /// Map the ring of an exporter from its memfd. The fd may be closed afterwards.
+    explicit SharedFrameReader(int fd);
+
+    ~SharedFrameReader();
+
+    SharedFrameReader(const SharedFrameReader &) = delete;
+
+    SharedFrameReader &operator=(const SharedFrameReader &) = delete;
+
+    /// Get the next frame, waiting up to @p timeout for it to be published.
+    /**
+     * The frame stays valid, and its slot reserved, until release(). Returns an empty Frame on timeout.
+     */
+    [[nodiscard]]
+    auto acquire(std::chrono::nanoseconds timeout) -> Frame;
+
+    /// Give the slot of the frame returned by acquire() back to the exporter.
+    void release();
+
+    /// Time elapsed since the export of @p frame was requested.
+    [[nodiscard]]
+    static auto getLatency(const Frame &frame) -> std::chrono::nanoseconds;
+
+private:
+    std::size_t m_size{0};
+    std::byte *m_shared{nullptr};
+    SharedFrameRing::Header *m_header{nullptr};
+    bool m_acquired{false};
+};
+
+} // GL
+
+#endif
+
+#endif //GLUTILS_FRAME_EXPORT_HPP
@@ -0,0 +1,145 @@
+#ifndef GLUTILS_FRAMEBUFFER_HPP
+#define GLUTILS_FRAMEBUFFER_HPP
+
+#include "handle.hpp"
+#include "object.hpp"
+#include "texture.hpp"
+
+namespace GL {
+
+/// Wraps renderbuffer objects: images that can only be rendered to, not sampled.
+class RenderbufferHandle : public Handle
+{
+    using Handle::Handle;
+public:
+    static auto create() -> RenderbufferHandle;
+
+    static void destroy(RenderbufferHandle renderbuffer);
+
+    /// glNamedRenderbufferStorage
+    void setStorage(TextureHandle::SizedInternalFormat internal_format, GLsizei width, GLsizei height) const;
+
+    /// glNamedRenderbufferStorageMultisample
+    void setStorageMultisample(GLsizei samples, TextureHandle::SizedInternalFormat internal_format, GLsizei width,
+                               GLsizei height) const;
+};
+
+using Renderbuffer = Object<RenderbufferHandle>;
+
+/// Wraps framebuffer objects. An empty handle refers to the default framebuffer, where the GL allows it.
+class FramebufferHandle : public Handle
+{
+    using Handle::Handle;
+public:
+    static auto create() -> FramebufferHandle;
+
+    static void destroy(FramebufferHandle framebuffer);
+
+    enum class Target : GLenum
+    {
+        framebuffer = 0x8D40,
+        read = 0x8CA8,
+        draw = 0x8CA9
+    };
+
+    enum class Attachment : GLenum
+    {
+        none = 0,
+        color0 = 0x8CE0,
+        depth = 0x8D00,
+        stencil = 0x8D20,
+        depth_stencil = 0x821A,
+        // buffers of the default framebuffer
+        front_left = 0x0400,
+        front_right = 0x0401,
+        back_left = 0x0402,
+        back_right = 0x0403,
+        color = 0x1800,
+        depth_buffer = 0x1801,
+        stencil_buffer = 0x1802
+    };
+
+    /// The color attachment @p index, i.e. color0 + index.
+    static constexpr auto color(GLuint index) -> Attachment
+    { return Attachment(GLenum(Attachment::color0) + index); }
+
+    enum class Status : GLenum
+    {
+        complete = 0x8CD5,
+        undefined = 0x8219,
+        incomplete_attachment = 0x8CD6,
+        incomplete_missing_attachment = 0x8CD7,
+        incomplete_draw_buffer = 0x8CDB,
+        incomplete_read_buffer = 0x8CDC,
+        unsupported = 0x8CDD,
+        incomplete_multisample = 0x8D56,
+        incomplete_layer_targets = 0x8DA8
+    };
+
+    /// Bits of glBlitNamedFramebuffer's mask.
+    enum class BufferBits : GLbitfield
+    {
+        color = 0x4000,
+        depth = 0x0100,
+        stencil = 0x0400
+    };
+
+    /// glBindFramebuffer
+    void bind(Target target) const;
+
+    /// Bind the default framebuffer to @p target.
+    static void unbind(Target target);
+
+    /// glNamedFramebufferTexture — attach a level of a texture, with all of its layers if it has any.
+    void attachTexture(Attachment attachment, TextureHandle texture, GLint level = 0) const;
+
+    /// glNamedFramebufferTextureLayer — attach a single layer (or cube map face) of a level of a texture.
+    void attachTextureLayer(Attachment attachment, TextureHandle texture, GLint level, GLint layer) const;
+
+    /// glNamedFramebufferRenderbuffer
+    void attachRenderbuffer(Attachment attachment, RenderbufferHandle renderbuffer) const;
+
+    /// Remove whatever is attached to @p attachment.
+    void detach(Attachment attachment) const;
+
+    /// glNamedFramebufferDrawBuffers — select the attachments fragment outputs 0 to @p count - 1 are written to.
+    void setDrawBuffers(GLsizei count, const Attachment *attachments) const;
+
+    /// glNamedFramebufferDrawBuffer
+    void setDrawBuffer(Attachment attachment) const;
+
+    /// glNamedFramebufferReadBuffer — select the attachment read by glReadPixels and blits.
+    void setReadBuffer(Attachment attachment) const;
+
+    /// glCheckNamedFramebufferStatus
+    [[nodiscard]]
+    auto checkStatus(Target target = Target::draw) const -> Status;
+
+    /// glInvalidateNamedFramebufferData — declare the content of some attachments dead.
+    /**
+     * The GL may then skip loading them at the start of the next pass, or writing them back to memory at the end of
+     * the current one, which saves bandwidth, especially on tiled GPUs.
+     */
+    void invalidate(GLsizei count, const Attachment *attachments) const;
+
+    /// glInvalidateNamedFramebufferSubData — invalidate a region of some attachments.
+    void invalidate(GLsizei count, const Attachment *attachments, GLint x, GLint y, GLsizei width,
+                    GLsizei height) const;
+
+    /// glBlitNamedFramebuffer — copy a rectangle from the read buffer of @p source to the draw buffers of
+    /// @p destination, e.g. to resolve a multisample image.
+    /**
+     * @param linear Filter linearly when the rectangles differ in size; only valid for color.
+     */
+    static void blit(FramebufferHandle source, FramebufferHandle destination, GLint src_x0, GLint src_y0,
+                     GLint src_x1, GLint src_y1, GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1,
+                     BufferBits mask, bool linear = false);
+};
+
+using Framebuffer = Object<FramebufferHandle>;
+
+auto operator|(FramebufferHandle::BufferBits l, FramebufferHandle::BufferBits r) -> FramebufferHandle::BufferBits;
+
+} // GL
+
+#endif //GLUTILS_FRAMEBUFFER_HPP
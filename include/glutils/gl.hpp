@@ -7,6 +7,15 @@
 #define GLUTILS_DEBUG 0
 #endif // GLUTILS_DEBUG
 
+// Count and time GL calls through glad's debug loader; see call_stats.hpp. Off unless asked for, debug builds included.
+#ifndef GLUTILS_CALL_STATS
+#define GLUTILS_CALL_STATS 0
+#endif // GLUTILS_CALL_STATS
+
+#if GLUTILS_CALL_STATS && !defined(GLAD_OPTION_GL_DEBUG)
+#error "GLUTILS_CALL_STATS requires the glad debug loader (include-debug)"
+#endif
+
 #if GLUTILS_DEBUG
 
 #include <iostream>
@@ -27,6 +36,33 @@ int loadContext(GLADloadfunc loader);
  */
 void enableDebugMessages(std::ostream *out = &std::cout, std::ostream *err = &std::cerr);
 
+enum class DebugOutputMode
+{
+    /// Messages are written from the debug callback with GL_DEBUG_OUTPUT_SYNCHRONOUS enabled, and GL errors are thrown
+    /// as GL::Error from the call that raised them.
+    synchronous,
+    /// The default. The callback copies messages to a lock-free ring, and a background thread writes them out,
+    /// collapsing repeats of the same message into a count. Errors are thrown as GL::Error from the next GL call that
+    /// returns after the driver reports them, or from flushDebugMessages(), whether or not a stream is set.
+    asynchronous
+};
+
+/// Choose how debug messages are delivered. Applies to the current context and to those loaded afterwards.
+/**
+ * Asynchronous output, the default, costs the driver a copy per message. Synchronous output stalls the driver on every
+ * message and formats it inside the GL call; switch to it to get exceptions at the faulting call.
+ */
+void setDebugOutputMode(DebugOutputMode mode);
+
+[[nodiscard]]
+auto getDebugOutputMode() -> DebugOutputMode;
+
+/// Wait until every message queued in asynchronous mode has been written.
+/**
+ * @throws GL::Error if the driver reported an error in asynchronous mode that no GL call has thrown yet.
+ */
+void flushDebugMessages();
+
 #endif // GLUTILS_DEBUG
 
 } // GL
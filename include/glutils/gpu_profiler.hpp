@@ -0,0 +1,206 @@
+#ifndef GLUTILS_GPU_PROFILER_HPP
+#define GLUTILS_GPU_PROFILER_HPP
+
+#include "buffer.hpp"
+#include "query.hpp"
+#include "sync.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace GL {
+
+/// Measures where GPU time goes with timestamp queries around scoped zones.
+/**
+ * A Zone records a GPU timestamp with glQueryCounter when it's constructed and another when it's destroyed, along
+ * with the CPU time of both, and labels the commands in between with glPushDebugGroup so captures in external tools
+ * show the same nesting. Queries come from a pool and are recycled once read.
+ *
+ * Results are collected by endFrame() a few frames later, without ever waiting for the GPU: either by checking
+ * GL_QUERY_RESULT_AVAILABLE, or by having the GPU write the results into a persistently mapped buffer and checking a
+ * fence. A frame whose results are still pending when max_frames_in_flight frames are is not recorded.
+ *
+ * GPU times are converted to the CPU clock with a pair of timestamps taken at the start of every frame, so GPU and CPU
+ * zones line up in the trace written by writeChromeTrace(). Only use from the thread that owns the GL context.
+ *
+ * @code
+ * GL::GpuProfiler profiler;
+ * while (running)
+ * {
+ *     {
+ *         auto zone = profiler.zone("shadows");
+ *         renderShadows();
+ *     }
+ *     swapBuffers();
+ *     profiler.endFrame();
+ * }
+ * std::ofstream file("trace.json");
+ * profiler.writeChromeTrace(file);
+ * @endcode
+ */
+class GpuProfiler
+{
+public:
+    enum class Collection
+    {
+        /// Read each query once glGetQueryObjectiv(GL_QUERY_RESULT_AVAILABLE) says it's done.
+        query_available,
+        /// Write results to a mapped buffer with glGetQueryBufferObjectui64v and read them once a fence signals.
+        query_buffer
+    };
+
+    struct Options
+    {
+        Collection collection{Collection::query_available};
+        /// Frames whose results can be pending at once.
+        std::uint32_t max_frames_in_flight{4};
+        /// Zones recorded per frame; later zones are only labelled.
+        std::uint32_t max_zones_per_frame{256};
+        /// Frames of results kept for getZones() and writeChromeTrace().
+        std::size_t history_frames{300};
+        /// Wrap zones in glPushDebugGroup / glPopDebugGroup.
+        bool debug_groups{true};
+    };
+
+    /// A measured zone. Times are relative to the construction of the profiler, on the CPU clock.
+    struct ZoneRecord
+    {
+        const char *name;
+        std::uint64_t frame;
+        /// Number of enclosing zones.
+        std::uint32_t depth;
+        std::chrono::nanoseconds cpu_begin;
+        std::chrono::nanoseconds cpu_end;
+        std::chrono::nanoseconds gpu_begin;
+        std::chrono::nanoseconds gpu_end;
+    };
+
+    struct Stats
+    {
+        /// Frames whose results have been collected.
+        std::size_t frames{0};
+        std::size_t zones{0};
+        /// Frames not recorded because too many were pending, and zones over max_zones_per_frame.
+        std::size_t dropped_frames{0};
+        std::size_t dropped_zones{0};
+        /// Query objects in the pool.
+        std::size_t queries{0};
+        /// GPU time from the start of the first zone to the end of the last one, in the last collected frame.
+        std::chrono::nanoseconds last_frame_gpu_time{0};
+    };
+
+    /// Measures from its construction to its destruction. Zones must nest and end within the frame they began.
+    class Zone
+    {
+    public:
+        Zone(GpuProfiler &profiler, const char *name);
+
+        ~Zone();
+
+        Zone(const Zone &) = delete;
+
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        GpuProfiler &m_profiler;
+        std::uint64_t m_frame;
+        std::size_t m_index;
+    };
+
+    GpuProfiler();
+
+    explicit GpuProfiler(const Options &options);
+
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler &) = delete;
+
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    /// Begin a zone. @p name must outlive the profiler; string literals are the intended use.
+    [[nodiscard]]
+    auto zone(const char *name) -> Zone
+    { return {*this, name}; }
+
+    /// Close the current frame, start the next, and collect the results of earlier frames that are ready.
+    /**
+     * Call once per frame, outside any zone. Never waits for the GPU.
+     */
+    void endFrame();
+
+    /// Results of the last Options::history_frames collected frames, in order.
+    [[nodiscard]]
+    auto getZones() const -> const std::deque<ZoneRecord> &
+    { return m_zones; }
+
+    /// Write the zones of getZones() as Chrome trace event JSON, viewable in chrome://tracing or Perfetto.
+    /**
+     * CPU and GPU zones are written as complete events of two threads of the same process.
+     */
+    void writeChromeTrace(std::ostream &out) const;
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+private:
+    struct PendingZone
+    {
+        const char *name;
+        std::uint32_t depth;
+        // indices into m_queries
+        std::uint32_t begin_query;
+        std::uint32_t end_query;
+        std::chrono::nanoseconds cpu_begin;
+        std::chrono::nanoseconds cpu_end;
+    };
+
+    struct Frame
+    {
+        std::uint64_t number{0};
+        bool recording{false};
+        std::vector<PendingZone> zones;
+        // a CPU time and the GPU time at that moment, to convert GPU timestamps with
+        std::chrono::nanoseconds cpu_calibration{0};
+        GLint64 gpu_calibration{0};
+        // for Collection::query_buffer: the frame's section of m_results, and the fence after its last query
+        std::size_t slot{0};
+        std::optional<Sync> fence;
+    };
+
+    auto beginZone(const char *name) -> std::size_t;
+
+    void endZone(std::uint64_t frame, std::size_t index);
+
+    auto acquireQuery() -> std::uint32_t;
+
+    void startFrame();
+
+    auto isReady(const Frame &frame) const -> bool;
+
+    void collect(const Frame &frame);
+
+    auto getCpuTime() const -> std::chrono::nanoseconds;
+
+    Options m_options;
+    std::chrono::steady_clock::time_point m_epoch;
+    std::vector<Query> m_queries;
+    std::vector<std::uint32_t> m_free_queries;
+    Buffer m_results{BufferHandle()};
+    const GLuint64 *m_results_mapping{nullptr};
+    std::vector<bool> m_free_slots;
+    std::deque<Frame> m_pending;
+    Frame m_frame;
+    std::uint32_t m_depth{0};
+    std::deque<ZoneRecord> m_zones;
+    Stats m_stats;
+};
+
+} // GL
+
+#endif //GLUTILS_GPU_PROFILER_HPP
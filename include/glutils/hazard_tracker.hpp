@@ -0,0 +1,143 @@
+#ifndef GLUTILS_HAZARD_TRACKER_HPP
+#define GLUTILS_HAZARD_TRACKER_HPP
+
+#include "buffer.hpp"
+#include "memory_barrier.hpp"
+#include "texture.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace GL {
+
+/// Tracks shader writes to buffers and images, and issues only the memory barriers later commands need.
+/**
+ * Image stores, shader storage writes and atomic counter operations aren't automatically visible to later commands:
+ * a glMemoryBarrier with the bits for the ways the data will be consumed has to come in between. Issuing
+ * MemoryBarrierBits::all after every pass that writes is always correct, but it makes the GL wait for, and flush,
+ * far more than necessary.
+ *
+ * The tracker mirrors the image, texture and indexed buffer bindings made through it, and knows which of the bound
+ * resources are written by shaders. barrier(), called before each draw or dispatch, compares the ways the resources
+ * bound for it (plus those declared with use()) are consumed with the writes that haven't been made visible yet, and
+ * issues only those bits, or nothing at all.
+ *
+ * Resources are tracked as a whole: a write to any part of a buffer or texture makes every part of it pending.
+ * Bindings made without the tracker aren't seen by it.
+ */
+class HazardTracker
+{
+public:
+    struct Stats
+    {
+        /// Calls to barrier(), i.e. draws and dispatches.
+        std::size_t passes{0};
+        /// glMemoryBarrier calls issued.
+        std::size_t barriers{0};
+        /// Sum of the number of bits of every barrier issued.
+        std::size_t issued_bits{0};
+        /// Bits that issuing MemoryBarrierBits::all after every pass that writes would have issued in addition.
+        /**
+         * Each writing pass is counted once, at the next barrier() or reset(), rather than for as long as its writes
+         * are pending.
+         */
+        std::size_t avoided_bits{0};
+    };
+
+    /// TextureHandle::bindImage(), recording a read, a write or both, depending on @p access.
+    void bindImage(GLuint unit, TextureHandle texture, GLint level, bool layered, GLint layer,
+                   TextureHandle::ImageAccess access, TextureHandle::SizedInternalFormat format);
+
+    /// Break the binding of an image unit.
+    void unbindImage(GLuint unit);
+
+    /// TextureHandle::bindTextureUnit(), recording texture fetches from @p texture. An empty handle unbinds the unit.
+    void bindTexture(GLuint unit, TextureHandle texture);
+
+    /// BufferHandle::bindBase().
+    /**
+     * @param shader_writes Whether shaders write to the buffer through this binding. Only meaningful for
+     * shader_storage and atomic_counter bindings; transform feedback writes are ordered without barriers.
+     */
+    void bindBase(BufferHandle buffer, BufferHandle::IndexedTarget target, GLuint index, bool shader_writes = false);
+
+    /// BufferHandle::bindRange(). The whole buffer is tracked, not only the range.
+    void bindRange(BufferHandle buffer, BufferHandle::IndexedTarget target, GLuint index, GLintptr offset,
+                   GLsizeiptr size, bool shader_writes = false);
+
+    /// Record that the next command consumes @p buffer other than through an indexed binding.
+    /**
+     * E.g. vertex_attrib_array or element_array for vertex and index buffers, command for indirect draws and
+     * dispatches, pixel_buffer for pixel transfers, buffer_update for copies and glBufferSubData, client_mapped_buffer
+     * before reading a persistent mapping.
+     */
+    void use(BufferHandle buffer, MemoryBarrierBits usage);
+
+    /// Record that the next command consumes @p texture other than through a binding, e.g. texture_update for uploads
+    /// and copies, or framebuffer when it's attached to the framebuffer that's drawn to.
+    void use(TextureHandle texture, MemoryBarrierBits usage);
+
+    /// Issue the barrier the next draw or dispatch needs, and record the writes it will make.
+    /**
+     * @return the bits issued; none if no barrier was needed.
+     */
+    auto barrier() -> MemoryBarrierBits;
+
+    /// barrier(), then dispatchCompute().
+    void dispatchCompute(GLuint num_groups_x, GLuint num_groups_y = 1, GLuint num_groups_z = 1);
+
+    /// barrier(), then dispatchComputeIndirect(). @p indirect_buffer is recorded as a command source.
+    void dispatchComputeIndirect(BufferHandle indirect_buffer, GLintptr indirect);
+
+    /// Forget every binding and pending write, e.g. at the start of a frame after a full barrier.
+    void reset();
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+    void resetStats()
+    { m_stats = {}; }
+
+private:
+    enum class BindingPoint : std::uint64_t
+    {
+        image,
+        texture,
+        uniform_buffer,
+        storage_buffer,
+        atomic_counter_buffer,
+        transform_feedback_buffer
+    };
+
+    struct Binding
+    {
+        std::uint64_t resource;
+        MemoryBarrierBits usage;
+        bool writes;
+    };
+
+    static auto s_key(BufferHandle buffer) -> std::uint64_t;
+
+    static auto s_key(TextureHandle texture) -> std::uint64_t;
+
+    void setBinding(BindingPoint point, GLuint index, std::uint64_t resource, MemoryBarrierBits usage, bool writes);
+
+    void setBufferBinding(BufferHandle buffer, BufferHandle::IndexedTarget target, GLuint index, bool shader_writes);
+
+    // current bindings, by binding point << 32 | index
+    std::unordered_map<std::uint64_t, Binding> m_bindings;
+    // resources consumed by the next command only
+    std::vector<std::pair<std::uint64_t, MemoryBarrierBits>> m_uses;
+    // barrier bits each written resource still needs before it can be consumed that way
+    std::unordered_map<std::uint64_t, GLbitfield> m_pending;
+    // whether the last barrier() recorded any writes, i.e. a full barrier would follow it
+    bool m_last_pass_writes{false};
+    Stats m_stats;
+};
+
+} // GL
+
+#endif //GLUTILS_HAZARD_TRACKER_HPP
@@ -0,0 +1,48 @@
+#ifndef GLUTILS_MAPPED_FILE_HPP
+#define GLUTILS_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace GL {
+
+/// A read-only mapping of a whole file into the address space of the process.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    /// Map the file at @p path. Throws GL::Error if the file can't be opened or mapped.
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    [[nodiscard]]
+    auto getData() const -> const std::byte *
+    { return m_data; }
+
+    [[nodiscard]]
+    auto getSize() const -> std::size_t
+    { return m_size; }
+
+    [[nodiscard]] explicit operator bool() const
+    { return m_data; }
+
+private:
+    void unmap();
+
+    const std::byte *m_data{nullptr};
+    std::size_t m_size{0};
+};
+
+} // GL
+
+#endif //GLUTILS_MAPPED_FILE_HPP
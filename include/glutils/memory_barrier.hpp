@@ -0,0 +1,42 @@
+#ifndef GLUTILS_MEMORY_BARRIER_HPP
+#define GLUTILS_MEMORY_BARRIER_HPP
+
+#include "gl_types.hpp"
+
+namespace GL {
+
+/// Bits for glMemoryBarrier. Each bit names the way data written by shaders will be consumed after the barrier.
+enum class MemoryBarrierBits : GLbitfield
+{
+    none = 0x0000,
+    vertex_attrib_array = 0x0001,
+    element_array = 0x0002,
+    uniform = 0x0004,
+    texture_fetch = 0x0008,
+    shader_image_access = 0x0020,
+    command = 0x0040,
+    pixel_buffer = 0x0080,
+    texture_update = 0x0100,
+    buffer_update = 0x0200,
+    framebuffer = 0x0400,
+    transform_feedback = 0x0800,
+    atomic_counter = 0x1000,
+    shader_storage = 0x2000,
+    client_mapped_buffer = 0x4000,
+    query_buffer = 0x8000,
+    all = 0xFFFFFFFF
+};
+
+auto operator|(MemoryBarrierBits l, MemoryBarrierBits r) -> MemoryBarrierBits;
+
+auto operator&(MemoryBarrierBits l, MemoryBarrierBits r) -> MemoryBarrierBits;
+
+/// glMemoryBarrier — defines a barrier ordering memory transactions. https://registry.khronos.org/OpenGL-Refpages/gl4/html/glMemoryBarrier.xhtml
+void memoryBarrier(MemoryBarrierBits barriers);
+
+/// glMemoryBarrierByRegion — like memoryBarrier(), but only orders accesses within the same framebuffer region.
+void memoryBarrierByRegion(MemoryBarrierBits barriers);
+
+} // GL
+
+#endif //GLUTILS_MEMORY_BARRIER_HPP
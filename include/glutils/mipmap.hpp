@@ -0,0 +1,86 @@
+#ifndef GLUTILS_MIPMAP_HPP
+#define GLUTILS_MIPMAP_HPP
+
+#include "texture.hpp"
+
+#include <cstddef>
+#include <future>
+#include <vector>
+
+namespace GL {
+
+/// Options for building mipmap chains on the CPU.
+struct MipmapOptions
+{
+    enum class Filter
+    {
+        /// Average of each 2x2 block (for odd sizes, a box of the exact footprint of the destination texel).
+        box,
+        /// Kaiser-windowed sinc, three texel radius. Sharper than box, with little ringing.
+        kaiser,
+        /// Lanczos (a = 3). Sharpest, may ring around hard edges.
+        lanczos
+    };
+
+    Filter filter{Filter::box};
+
+    /// Treat color components as sRGB encoded: convert them to linear before filtering and back afterwards. The
+    /// alpha component is always filtered as linear. Only meaningful for unsigned byte data.
+    bool srgb{false};
+
+    /// Total number of levels, including the base level, as passed to TextureHandle::setStorage2D(). Zero builds the
+    /// complete chain down to 1x1.
+    GLsizei levels{0};
+
+    /// Number of threads to filter each level with. Zero uses std::thread::hardware_concurrency().
+    unsigned int thread_count{0};
+};
+
+/// A single level of a mipmap chain, tightly packed (rows aligned to one byte).
+struct MipLevel
+{
+    GLsizei width{0};
+    GLsizei height{0};
+    std::vector<std::byte> data;
+};
+
+/// Number of levels in a complete mipmap chain for a base level of the given size.
+[[nodiscard]]
+auto getMipLevelCount(GLsizei width, GLsizei height) -> GLsizei;
+
+/// Build levels 1 and up of a mipmap chain from a tightly packed base level.
+/**
+ * Supports the unsigned byte, unsigned short, half float and float data types, with one to four components. Filtering
+ * is done in single precision, with rows processed in parallel and vectorized. Each level is computed from the one
+ * before it.
+ *
+ * @param pixels Base level data, rows aligned to one byte.
+ * @param width Width of the base level.
+ * @param height Height of the base level.
+ * @param format Component layout of @p pixels; the output levels use the same format and type.
+ * @param type Component type of @p pixels.
+ * @param options Filter and level count.
+ * @return the levels below the base level, starting with level 1.
+ */
+[[nodiscard]]
+auto buildMipChain(const void *pixels, GLsizei width, GLsizei height, TextureHandle::DataFormat format,
+                   TextureHandle::DataType type, const MipmapOptions &options = {}) -> std::vector<MipLevel>;
+
+/// Call buildMipChain() on a separate thread. @p pixels must stay valid until the returned future is ready.
+[[nodiscard]]
+auto buildMipChainAsync(const void *pixels, GLsizei width, GLsizei height, TextureHandle::DataFormat format,
+                        TextureHandle::DataType type,
+                        const MipmapOptions &options = {}) -> std::future<std::vector<MipLevel>>;
+
+/// Upload levels produced by buildMipChain() into a texture with storage for them.
+/**
+ * @param texture A 2D texture with immutable storage of sufficient levels (see TextureHandle::setStorage2D()).
+ * @param levels The mip chain, with levels[0] being uploaded to @p first_level.
+ * @param first_level Level to upload levels[0] to.
+ */
+void uploadMipChain(TextureHandle texture, const std::vector<MipLevel> &levels, TextureHandle::DataFormat format,
+                    TextureHandle::DataType type, GLint first_level = 1);
+
+} // GL
+
+#endif //GLUTILS_MIPMAP_HPP
@@ -0,0 +1,85 @@
+#ifndef GLUTILS_PIXEL_CONVERT_HPP
+#define GLUTILS_PIXEL_CONVERT_HPP
+
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GL {
+
+/// Convert a float to half precision, rounding to nearest even. Values too large for a half become infinity.
+[[nodiscard]]
+auto floatToHalf(float value) -> std::uint16_t;
+
+/// Convert a half precision value to float.
+[[nodiscard]]
+auto halfToFloat(std::uint16_t value) -> float;
+
+/// Expand 3 byte RGB pixels to 4 byte RGBA, setting alpha to @p alpha.
+void expandRGBToRGBA(const std::uint8_t *source, std::uint8_t *destination, std::size_t pixel_count,
+                     std::uint8_t alpha = 255);
+
+/// Swap the first and third byte of every 4 byte pixel, converting BGRA to RGBA and back. May be done in place.
+void swizzleBGRA(const std::uint8_t *source, std::uint8_t *destination, std::size_t pixel_count);
+
+/// Convert floats to half precision, with the same rounding as floatToHalf().
+void convertFloatToHalf(const float *source, std::uint16_t *destination, std::size_t count);
+
+/// Encode linear float components in [0, 1] as 8 bit sRGB.
+/**
+ * With @p component_count 2 or 4, the last component of each pixel is treated as alpha and stored linearly.
+ */
+void convertLinearToSRGB(const float *source, std::uint8_t *destination, std::size_t pixel_count,
+                         int component_count);
+
+/// Pack float RGB into the layout of DataType::uint_10f_11f_11f_rev.
+/**
+ * Negative values and NaN become zero, values larger than the largest representable one are clamped to it. Rounds to
+ * nearest even.
+ *
+ * @param component_count Components per source pixel, 3 or 4. The fourth one is ignored.
+ */
+void packR11G11B10F(const float *source, std::uint32_t *destination, std::size_t pixel_count,
+                    int component_count = 3);
+
+/// Pack float RGB into the shared exponent layout of DataType::uint_5_9_9_9_rev.
+/**
+ * Values are clamped like packR11G11B10F() does.
+ *
+ * @param component_count Components per source pixel, 3 or 4. The fourth one is ignored.
+ */
+void packRGB9E5(const float *source, std::uint32_t *destination, std::size_t pixel_count, int component_count = 3);
+
+/// Upload tightly packed pixels into a texture, converting them to the native layout of its format first.
+/**
+ * glTextureSubImage2D converts client data that doesn't match the internal format on the CPU, often a row at a time
+ * and without vectorization. This function does the conversion itself, for these cases:
+ *
+ * | Internal format                  | Source                      | Uploaded as                   |
+ * |----------------------------------|-----------------------------|-------------------------------|
+ * | rgba8, srgb8_alpha8              | rgb, ubyte                  | rgba, ubyte                   |
+ * | rgba8, srgb8_alpha8              | bgra, ubyte                 | rgba, ubyte                   |
+ * | r16f, rg16f, rgb16f, rgba16f     | any, float                  | same format, half_float       |
+ * | srgb8, srgb8_alpha8              | rgb or rgba, float (linear) | same format, ubyte (sRGB)     |
+ * | r11f_g11f_b10f                   | rgb or rgba, float          | rgb, uint_10f_11f_11f_rev     |
+ * | rgb9_e5                          | rgb or rgba, float          | rgb, uint_5_9_9_9_rev         |
+ *
+ * The sRGB conversion is only done with @p encode_srgb. Like glTextureSubImage2D, the default stores float values
+ * in sRGB textures without encoding them, as if they already were sRGB.
+ *
+ * Anything else is passed to glTextureSubImage2D unchanged. Conversion is done in bands of rows that fit in the CPU
+ * cache, with each band uploaded as soon as it is converted.
+ *
+ * @param texture Texture with storage of @p internal_format.
+ * @param internal_format The format the texture's storage was allocated with.
+ * @param pixels Source data, rows aligned to one byte.
+ * @param encode_srgb Treat float data uploaded to srgb8 and srgb8_alpha8 textures as linear, and encode it.
+ */
+void uploadImage2D(TextureHandle texture, TextureHandle::SizedInternalFormat internal_format, GLint level,
+                   GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, TextureHandle::DataFormat format,
+                   TextureHandle::DataType type, const void *pixels, bool encode_srgb = false);
+
+} // GL
+
+#endif //GLUTILS_PIXEL_CONVERT_HPP
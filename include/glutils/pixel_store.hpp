@@ -0,0 +1,73 @@
+#ifndef GLUTILS_PIXEL_STORE_HPP
+#define GLUTILS_PIXEL_STORE_HPP
+
+#include "gl_types.hpp"
+
+namespace GL {
+
+/// Describes how pixel data is laid out in client memory (or a pixel unpack buffer) for texture uploads.
+/**
+ * Corresponds to the GL_UNPACK_* pixel store parameters. Default values match the initial state of a context.
+ */
+struct PixelUnpackLayout
+{
+    /// Pixels per row of the source image; zero means the same as the width of the uploaded region.
+    GLint row_length{0};
+    /// Rows per image of the source, for three-dimensional uploads; zero means the height of the uploaded region.
+    GLint image_height{0};
+    /// Pixels to skip at the start of each row.
+    GLint skip_pixels{0};
+    /// Rows to skip at the start of each image.
+    GLint skip_rows{0};
+    /// Images to skip at the start, for three-dimensional uploads.
+    GLint skip_images{0};
+    /// Alignment of the start of each row: 1, 2, 4 or 8.
+    GLint alignment{4};
+
+    /// Layout to upload the @p x, @p y corner of an image that is @p image_width pixels wide, straight from its memory.
+    /**
+     * The pointer passed to the upload should point at the first pixel of the whole image, not of the sub-rectangle.
+     */
+    static constexpr auto subImage(GLint image_width, GLint x, GLint y, GLint alignment = 1) -> PixelUnpackLayout
+    {
+        PixelUnpackLayout layout;
+        layout.row_length = image_width;
+        layout.skip_pixels = x;
+        layout.skip_rows = y;
+        layout.alignment = alignment;
+        return layout;
+    }
+};
+
+constexpr bool operator==(const PixelUnpackLayout &l, const PixelUnpackLayout &r)
+{
+    return l.row_length == r.row_length && l.image_height == r.image_height && l.skip_pixels == r.skip_pixels
+           && l.skip_rows == r.skip_rows && l.skip_images == r.skip_images && l.alignment == r.alignment;
+}
+
+constexpr bool operator!=(const PixelUnpackLayout &l, const PixelUnpackLayout &r)
+{
+    return !(l == r);
+}
+
+/// glPixelStorei — set the GL_UNPACK_* parameters of the context current on the calling thread.
+/**
+ * The last values set are cached per thread, and only the parameters that differ from them are passed to
+ * glPixelStorei, so setting the same layout for consecutive uploads costs no GL calls.
+ */
+void setPixelUnpackLayout(const PixelUnpackLayout &layout);
+
+/// Get the layout last set with setPixelUnpackLayout() on the calling thread.
+[[nodiscard]]
+auto getPixelUnpackLayout() -> PixelUnpackLayout;
+
+/// Forget the cached unpack state, so that the next setPixelUnpackLayout() sets every parameter.
+/**
+ * Call this after changing GL_UNPACK_* parameters without setPixelUnpackLayout(), or after making a different
+ * context current. loadContext() calls it automatically.
+ */
+void resetPixelUnpackCache();
+
+} // GL
+
+#endif //GLUTILS_PIXEL_STORE_HPP
@@ -7,7 +7,10 @@
 
 #include "glm/gtc/type_ptr.hpp"
 
+#include <initializer_list>
+#include <string>
 #include <type_traits>
+#include <utility>
 
 namespace GL {
 
@@ -259,6 +262,13 @@ constexpr auto ProgramHandle::s_glProgramUniformv<glm::vec<N, T, Q>> =
 
 using Program = Object<ProgramHandle>;
 
+/// Compile each of the given shader sources and link them into a new program.
+/**
+ * Throws GL::Error containing the info log if any of the shaders fails to compile, or if linking fails.
+ */
+[[nodiscard]]
+auto buildProgram(std::initializer_list<std::pair<ShaderHandle::Type, std::string>> sources) -> Program;
+
 } // GL
 
 
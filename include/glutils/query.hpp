@@ -0,0 +1,63 @@
+#ifndef GLUTILS_QUERY_HPP
+#define GLUTILS_QUERY_HPP
+
+#include "buffer.hpp"
+#include "handle.hpp"
+#include "object.hpp"
+
+namespace GL {
+
+/// Wraps query objects, which measure the GPU asynchronously.
+class QueryHandle : public Handle
+{
+    using Handle::Handle;
+public:
+    enum class Target : GLenum
+    {
+        samples_passed = 0x8914,
+        any_samples_passed = 0x8C2F,
+        any_samples_passed_conservative = 0x8D6A,
+        primitives_generated = 0x8C87,
+        transform_feedback_primitives_written = 0x8C88,
+        time_elapsed = 0x88BF,
+        timestamp = 0x8E28
+    };
+
+    /// glCreateQueries
+    static auto create(Target target) -> QueryHandle;
+
+    static void destroy(QueryHandle query);
+
+    /// glBeginQuery. Not valid for Target::timestamp.
+    void begin(Target target) const;
+
+    /// glEndQuery
+    static void end(Target target);
+
+    /// glQueryCounter — record the GPU time once every previous command has completed. Target must be timestamp.
+    void queryCounter() const;
+
+    /// glGetQueryObjectiv(GL_QUERY_RESULT_AVAILABLE). Never waits.
+    [[nodiscard]]
+    auto isResultAvailable() const -> bool;
+
+    /// glGetQueryObjectui64v(GL_QUERY_RESULT). Waits for the result if it isn't available yet.
+    [[nodiscard]]
+    auto getResult() const -> GLuint64;
+
+    /// glGetQueryBufferObjectui64v(GL_QUERY_RESULT) — have the GPU write the result to @p buffer once it's available.
+    /**
+     * The client never waits; the 8 byte result is written at @p offset when the query completes.
+     */
+    void writeResult(BufferHandle buffer, GLintptr offset) const;
+
+    /// glGetInteger64v(GL_TIMESTAMP) — the current GPU time, in nanoseconds, once every previous command is issued.
+    [[nodiscard]]
+    static auto getTimestamp() -> GLint64;
+};
+
+using Query = Object<QueryHandle>;
+
+} // GL
+
+#endif //GLUTILS_QUERY_HPP
@@ -0,0 +1,159 @@
+#ifndef GLUTILS_READBACK_HPP
+#define GLUTILS_READBACK_HPP
+
+#include "buffer.hpp"
+#include "framebuffer.hpp"
+#include "program.hpp"
+#include "sync.hpp"
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace GL {
+
+/// Reads textures and framebuffers back to the host through a persistently mapped pixel pack buffer.
+/**
+ * glGetTextureImage and glReadPixels into client memory wait for every command that renders the image to finish, and
+ * then for the copy itself. Reading into a buffer object instead only queues the copy. The ring fences each request,
+ * and poll(), called once per frame, hands the mapped data of the requests whose fence has signaled to their callbacks.
+ * With a ring large enough for the frames in flight, no call ever waits for the GPU.
+ *
+ * Requests can optionally be converted by a compute shader before they're read, which writes straight into the ring:
+ * rgba8 packs float images to a quarter or half of their size, and nv12 produces the planar YUV 4:2:0 most video
+ * encoders take, at 1.5 bytes per pixel.
+ *
+ * Only use from the thread that owns the GL context. Callbacks are called from poll() and finish(), in request order.
+ */
+class ReadbackRing
+{
+public:
+    enum class Conversion
+    {
+        /// Read the pixels as they are, in the requested format and type.
+        none,
+        /// Normalized RGBA, 8 bits per component.
+        rgba8,
+        /// BT.709 limited range Y plane, followed by a half resolution plane of interleaved U and V.
+        nv12
+    };
+
+    /// Data passed to a readback callback. Only valid for the duration of the call.
+    struct Result
+    {
+        /// Value returned by the read call that made the request.
+        std::uint64_t id;
+        const void *data;
+        GLsizeiptr size;
+        GLsizei width;
+        GLsizei height;
+        /// Distance in bytes between the start of consecutive rows. Rows are aligned to 4 bytes.
+        GLsizeiptr row_stride;
+        /// For nv12: offset in bytes of the UV plane, and distance between its rows. Zero otherwise.
+        GLsizeiptr chroma_offset;
+        GLsizeiptr chroma_row_stride;
+    };
+
+    using Callback = std::function<void(const Result &)>;
+
+    struct Stats
+    {
+        std::size_t requested{0};
+        std::size_t completed{0};
+        /// Requests refused because the ring was full.
+        std::size_t dropped{0};
+        std::size_t bytes_read{0};
+    };
+
+    /// Create and persistently map a ring of @p size bytes.
+    explicit ReadbackRing(GLsizeiptr size);
+
+    /// Unmaps the buffer. Pending requests are discarded without calling their callbacks.
+    ~ReadbackRing();
+
+    ReadbackRing(const ReadbackRing &) = delete;
+
+    ReadbackRing &operator=(const ReadbackRing &) = delete;
+
+    /// Read a region of a texture level with glGetTextureSubImage.
+    /**
+     * @param z Layer, cube map face or slice to read; only one is read per request.
+     * @return an id passed back in Result, or 0 if the ring was full and the request was dropped.
+     */
+    auto readTexture(TextureHandle texture, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height,
+                     TextureHandle::DataFormat format, TextureHandle::DataType type, Callback callback)
+                     -> std::uint64_t;
+
+    /// Read a region of the read buffer of a framebuffer with glReadPixels.
+    /**
+     * Binds @p framebuffer as the read framebuffer, and binds the default framebuffer back afterwards.
+     *
+     * @param framebuffer An empty handle reads from the default framebuffer.
+     * @return an id passed back in Result, or 0 if the ring was full and the request was dropped.
+     */
+    auto readFramebuffer(FramebufferHandle framebuffer, GLint x, GLint y, GLsizei width, GLsizei height,
+                         TextureHandle::DataFormat format, TextureHandle::DataType type, Callback callback)
+                         -> std::uint64_t;
+
+    /// Convert a region of a texture level on the GPU and read the result.
+    /**
+     * The texture is bound to texture unit 0 and sampled with texelFetch, so it must be a complete 2D texture with a
+     * normalized or float format. @p conversion must not be Conversion::none.
+     *
+     * @return an id passed back in Result, or 0 if the ring was full and the request was dropped.
+     */
+    auto readConverted(TextureHandle texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                       Conversion conversion, Callback callback) -> std::uint64_t;
+
+    /// Call the callbacks of the requests that have completed, and recycle their memory. Never waits.
+    void poll();
+
+    /// Wait for every pending request and call its callback.
+    void finish();
+
+    /// Number of requests whose callback hasn't been called yet.
+    [[nodiscard]]
+    auto getPendingCount() const -> std::size_t
+    { return m_requests.size(); }
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+    [[nodiscard]]
+    auto getSize() const -> GLsizeiptr
+    { return m_size; }
+
+private:
+    struct Request
+    {
+        Result result;
+        GLintptr begin; // includes padding skipped at the end of the ring
+        GLintptr end;
+        Callback callback;
+        Sync fence;
+    };
+
+    auto allocate(GLsizeiptr size, GLintptr &offset) -> bool;
+
+    auto submit(GLintptr offset, Result result, Callback callback) -> std::uint64_t;
+
+    void complete();
+
+    auto getConvertProgram(Conversion conversion) -> ProgramHandle;
+
+    Buffer m_buffer;
+    GLsizeiptr m_size;
+    std::byte *m_mapping{nullptr};
+    GLintptr m_head{0};
+    std::deque<Request> m_requests;
+    std::uint64_t m_next_id{1};
+    Program m_convert_programs[2]{Program(ProgramHandle()), Program(ProgramHandle())};
+    Stats m_stats;
+};
+
+} // GL
+
+#endif //GLUTILS_READBACK_HPP
@@ -0,0 +1,231 @@
+#ifndef GLUTILS_RENDER_GRAPH_HPP
+#define GLUTILS_RENDER_GRAPH_HPP
+
+#include "buffer.hpp"
+#include "memory_barrier.hpp"
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace GL {
+
+/// Orders the passes of a frame, culls those nobody needs, inserts memory barriers and shares transient storage.
+/**
+ * A frame is described anew every frame: create or import the resources it uses, add passes declaring how they read
+ * and write them, then compile() and execute(). Passes run in the order they were added, minus those culled.
+ *
+ * Accesses are declared with the MemoryBarrierBits naming the path the data takes: e.g. texture_fetch for sampling,
+ * shader_image_access for image loads and stores, shader_storage for SSBOs, framebuffer for attachments, command for
+ * indirect buffers. Image stores, SSBO writes and atomic counter writes aren't visible to later commands until a
+ * barrier; the graph issues one before the passes that consume them, with only the bits those passes need.
+ *
+ * A pass is culled unless it has side effects, writes an imported resource, or writes something a pass that isn't
+ * culled reads.
+ *
+ * Transient resources are created by the graph and only live within the frame. OpenGL can't place resources in
+ * shared memory, so aliasing is done at the object level: a transient texture reuses the texture of an earlier one
+ * with the same description whose last pass has run, and a transient buffer reuses any earlier buffer at least as
+ * large. The objects are kept from frame to frame, so a steady frame allocates nothing. A transient's content is
+ * undefined at its first pass and invalidated after its last.
+ */
+class RenderGraph
+{
+public:
+    using ResourceId = GLuint;
+
+    /// Storage of a transient texture, as passed to TextureHandle::setStorage*().
+    /**
+     * For two-dimensional array textures, depth is the number of layers. Supported types are _2d, _2d_array, _3d,
+     * cube_map and _2d_multisample.
+     */
+    struct TextureDescription
+    {
+        TextureHandle::Type type{TextureHandle::Type::_2d};
+        TextureHandle::SizedInternalFormat format{TextureHandle::SizedInternalFormat::rgba8};
+        GLsizei width{1};
+        GLsizei height{1};
+        GLsizei depth{1};
+        GLsizei levels{1};
+        /// Sample count of _2d_multisample textures.
+        GLsizei samples{0};
+    };
+
+    struct BufferDescription
+    {
+        GLsizeiptr size{0};
+    };
+
+    /// Called by execute() to record a pass's GL commands. Resources are looked up with getTexture() and getBuffer().
+    using Execute = std::function<void(const RenderGraph &graph)>;
+
+    /// Declares the accesses of a pass; returned by addPass().
+    class PassBuilder
+    {
+    public:
+        /// The pass reads @p resource through @p usage.
+        auto read(ResourceId resource, MemoryBarrierBits usage) -> PassBuilder &;
+
+        /// The pass writes @p resource through @p usage. Declare both for read-modify-write access.
+        auto write(ResourceId resource, MemoryBarrierBits usage) -> PassBuilder &;
+
+        /// Never cull the pass, e.g. because it draws to the default framebuffer.
+        auto setSideEffects() -> PassBuilder &;
+
+    private:
+        friend class RenderGraph;
+
+        PassBuilder(RenderGraph &graph, std::size_t pass) : m_graph(graph), m_pass(pass)
+        {}
+
+        RenderGraph &m_graph;
+        std::size_t m_pass;
+    };
+
+    struct Options
+    {
+        /// Textures and buffers unused for this many frames are deleted.
+        std::uint64_t evict_after_frames{3};
+    };
+
+    /// Per frame statistics, filled in by compile() and execute().
+    struct Stats
+    {
+        std::size_t passes{0};
+        std::size_t culled_passes{0};
+        /// glMemoryBarrier calls, and the sum of the number of bits they were given.
+        std::size_t barriers{0};
+        std::size_t barrier_bits{0};
+        std::size_t transient_textures{0};
+        std::size_t transient_buffers{0};
+        /// Texture and buffer objects backing the transients.
+        std::size_t physical_textures{0};
+        std::size_t physical_buffers{0};
+        /// Largest number of bytes of transient storage in use at once.
+        std::size_t peak_bytes{0};
+        /// Bytes of transient storage used by the frame, with and without sharing.
+        std::size_t aliased_bytes{0};
+        std::size_t unaliased_bytes{0};
+    };
+
+    RenderGraph();
+
+    explicit RenderGraph(const Options &options);
+
+    /// Declare a transient texture.
+    auto createTexture(std::string name, const TextureDescription &description) -> ResourceId;
+
+    /// Declare a transient buffer.
+    auto createBuffer(std::string name, const BufferDescription &description) -> ResourceId;
+
+    /// Use a texture owned elsewhere. Passes writing it are never culled.
+    auto importTexture(std::string name, TextureHandle texture) -> ResourceId;
+
+    /// Use a buffer owned elsewhere. Passes writing it are never culled.
+    auto importBuffer(std::string name, BufferHandle buffer) -> ResourceId;
+
+    /// Add a pass and declare its accesses through the returned builder.
+    auto addPass(std::string name, Execute execute) -> PassBuilder;
+
+    /// Cull passes, assign storage to the transients and compute the barriers.
+    void compile();
+
+    /// Run the passes that weren't culled, with their barriers. compile() must be called first.
+    void execute();
+
+    /// Forget every pass and resource to describe the next frame. Storage is kept for reuse.
+    void reset();
+
+    /// The texture backing @p resource. Transients only have one between compile() and reset().
+    [[nodiscard]]
+    auto getTexture(ResourceId resource) const -> TextureHandle;
+
+    /// The buffer backing @p resource. Transients only have one between compile() and reset().
+    [[nodiscard]]
+    auto getBuffer(ResourceId resource) const -> BufferHandle;
+
+    /// Whether the pass added as the @p index-th of the frame will run.
+    [[nodiscard]]
+    auto isPassCulled(std::size_t index) const -> bool;
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+private:
+    struct Access
+    {
+        ResourceId resource;
+        MemoryBarrierBits usage;
+        bool write;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        Execute execute;
+        std::vector<Access> accesses;
+        bool side_effects{false};
+        bool culled{false};
+        // transients whose last pass this is
+        std::vector<ResourceId> released;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        bool is_texture;
+        bool imported;
+        TextureDescription texture_description;
+        GLsizeiptr buffer_size;
+        // index into m_textures or m_buffers, for transients that are used
+        std::size_t physical;
+        TextureHandle texture;
+        BufferHandle buffer;
+    };
+
+    struct PhysicalTexture
+    {
+        Texture texture;
+        TextureDescription description;
+        std::size_t bytes;
+        std::uint64_t last_used;
+        bool in_use;
+    };
+
+    struct PhysicalBuffer
+    {
+        Buffer buffer;
+        GLsizeiptr size;
+        std::uint64_t last_used;
+        bool in_use;
+    };
+
+    auto addResource(Resource resource) -> ResourceId;
+
+    auto getResource(ResourceId resource) const -> const Resource &;
+
+    void cull();
+
+    auto acquireTexture(const TextureDescription &description) -> std::size_t;
+
+    auto acquireBuffer(GLsizeiptr size) -> std::size_t;
+
+    void evictUnused();
+
+    Options m_options;
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<PhysicalTexture> m_textures;
+    std::vector<PhysicalBuffer> m_buffers;
+    std::uint64_t m_frame{0};
+    bool m_compiled{false};
+    Stats m_stats;
+};
+
+} // GL
+
+#endif //GLUTILS_RENDER_GRAPH_HPP
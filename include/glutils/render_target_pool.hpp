@@ -0,0 +1,148 @@
+#ifndef GLUTILS_RENDER_TARGET_POOL_HPP
+#define GLUTILS_RENDER_TARGET_POOL_HPP
+
+#include "framebuffer.hpp"
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace GL {
+
+/// Reuses render target textures, and the framebuffers they're attached to, across passes and frames.
+/**
+ * Offscreen passes need intermediate images that live for a pass or two. Creating them for every pass costs a storage
+ * allocation each time, and often a driver-side clear or validation; the pool instead hands out a texture of the
+ * requested size, format and sample count that nobody is using, and only creates one when there's none.
+ *
+ * release() declares a texture's content dead: it's invalidated, through glInvalidateNamedFramebufferData on a
+ * framebuffer it's attached to, so the GL doesn't have to write it back to memory or preserve it, and the texture
+ * goes back to the pool. Framebuffers are cached by their attachments, so drawing to the same combination of targets
+ * again doesn't create a new one. Textures that haven't been used for a few frames are deleted by endFrame().
+ *
+ * The content of an acquired texture is undefined.
+ */
+class RenderTargetPool
+{
+public:
+    struct Description
+    {
+        GLsizei width{0};
+        GLsizei height{0};
+        TextureHandle::SizedInternalFormat format{TextureHandle::SizedInternalFormat::rgba8};
+        /// 0 for a regular 2D texture; otherwise the sample count of a 2D multisample texture.
+        GLsizei samples{0};
+    };
+
+    struct DescriptionHash
+    {
+        auto operator()(const Description &description) const noexcept -> std::size_t;
+    };
+
+    struct Options
+    {
+        /// Free textures unused for this many frames are deleted by endFrame().
+        std::uint64_t evict_after_frames{3};
+    };
+
+    struct Stats
+    {
+        /// Textures created since the pool was, or since resetStats().
+        std::size_t created{0};
+        /// Acquisitions served by an existing texture.
+        std::size_t reused{0};
+        std::size_t deleted{0};
+        std::size_t invalidations{0};
+        std::size_t framebuffers_created{0};
+        /// Textures currently acquired, and free.
+        std::size_t in_use{0};
+        std::size_t free{0};
+        /// Bytes of all textures in the pool, in use or free.
+        std::size_t bytes{0};
+    };
+
+    RenderTargetPool();
+
+    explicit RenderTargetPool(const Options &options);
+
+    /// Get a texture matching @p description that isn't in use, creating it if there is none.
+    [[nodiscard]]
+    auto acquire(const Description &description) -> TextureHandle;
+
+    /// acquire() a single-sampled texture.
+    [[nodiscard]]
+    auto acquire(GLsizei width, GLsizei height, TextureHandle::SizedInternalFormat format) -> TextureHandle
+    { return acquire({width, height, format, 0}); }
+
+    /// Give back a texture obtained from acquire(), whose content is no longer needed, and invalidate it.
+    /**
+     * The texture stays attached to the framebuffers returned by getFramebuffer(), and can be acquired again by the
+     * next acquire() of the same description.
+     */
+    void release(TextureHandle texture);
+
+    /// Get a framebuffer with @p colors attached to the color attachments, in order, and @p depth to the depth, or
+    /// depth-stencil, attachment.
+    /**
+     * Framebuffers are cached by their attachments and deleted together with the pool textures they use. Any of the
+     * textures may come from elsewhere, but then the framebuffer must not outlive them. The draw buffers are set to
+     * the color attachments, in order.
+     */
+    [[nodiscard]]
+    auto getFramebuffer(std::initializer_list<TextureHandle> colors, TextureHandle depth = {}) -> FramebufferHandle;
+
+    /// Delete free textures that haven't been acquired for Options::evict_after_frames, and start a new frame.
+    void endFrame();
+
+    /// Delete every free texture, and the framebuffers they are attached to.
+    void trim();
+
+    [[nodiscard]]
+    auto getStats() const -> Stats;
+
+    void resetStats();
+
+private:
+    struct Target
+    {
+        Texture texture;
+        Description description;
+        std::uint64_t last_used;
+    };
+
+    struct CachedFramebuffer
+    {
+        Framebuffer framebuffer;
+        FramebufferHandle::Attachment depth_attachment;
+    };
+
+    auto createTarget(const Description &description) -> Target;
+
+    void destroyTarget(Target &target);
+
+    // free textures by description, most recently released last
+    std::unordered_map<Description, std::vector<Target>, DescriptionHash> m_free;
+    // acquired textures by name
+    std::unordered_map<GLuint, Target> m_in_use;
+    // framebuffers by the names of their depth attachment followed by their color attachments
+    std::map<std::vector<GLuint>, CachedFramebuffer> m_framebuffers;
+    Options m_options;
+    std::uint64_t m_frame{0};
+    std::size_t m_bytes{0};
+    Stats m_stats;
+};
+
+bool operator==(const RenderTargetPool::Description &l, const RenderTargetPool::Description &r);
+
+inline bool operator!=(const RenderTargetPool::Description &l, const RenderTargetPool::Description &r)
+{
+    return !(l == r);
+}
+
+} // GL
+
+#endif //GLUTILS_RENDER_TARGET_POOL_HPP
@@ -0,0 +1,158 @@
+#ifndef GLUTILS_SAMPLER_HPP
+#define GLUTILS_SAMPLER_HPP
+
+#include "handle.hpp"
+#include "object.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+
+namespace GL {
+
+/// Wraps sampler objects, which hold sampling state separately from textures.
+class SamplerHandle : public Handle
+{
+    using Handle::Handle;
+public:
+    static auto create() -> SamplerHandle;
+
+    static void destroy(SamplerHandle sampler);
+
+    enum class Filter : GLenum
+    {
+        nearest = 0x2600,
+        linear = 0x2601,
+        nearest_mipmap_nearest = 0x2700,
+        linear_mipmap_nearest = 0x2701,
+        nearest_mipmap_linear = 0x2702,
+        linear_mipmap_linear = 0x2703
+    };
+
+    enum class Wrap : GLenum
+    {
+        repeat = 0x2901,
+        mirrored_repeat = 0x8370,
+        clamp_to_edge = 0x812F,
+        clamp_to_border = 0x812D,
+        mirror_clamp_to_edge = 0x8743
+    };
+
+    enum class CompareFunc : GLenum
+    {
+        never = 0x0200,
+        less = 0x0201,
+        equal = 0x0202,
+        lequal = 0x0203,
+        greater = 0x0204,
+        notequal = 0x0205,
+        gequal = 0x0206,
+        always = 0x0207
+    };
+
+    /// glSamplerParameteri(GL_TEXTURE_MIN_FILTER)
+    void setMinFilter(Filter filter) const;
+
+    /// glSamplerParameteri(GL_TEXTURE_MAG_FILTER). Only nearest and linear are valid.
+    void setMagFilter(Filter filter) const;
+
+    /// glSamplerParameteri(GL_TEXTURE_WRAP_S/T/R)
+    void setWrap(Wrap s, Wrap t, Wrap r) const;
+
+    /// glSamplerParameterf(GL_TEXTURE_MAX_ANISOTROPY). Requires OpenGL 4.6 or ARB_texture_filter_anisotropic.
+    void setMaxAnisotropy(float max_anisotropy) const;
+
+    /// glSamplerParameterf(GL_TEXTURE_LOD_BIAS)
+    void setLodBias(float bias) const;
+
+    /// glSamplerParameterf(GL_TEXTURE_MIN_LOD) and glSamplerParameterf(GL_TEXTURE_MAX_LOD)
+    void setLodRange(float min_lod, float max_lod) const;
+
+    /// glSamplerParameteri(GL_TEXTURE_COMPARE_MODE) and glSamplerParameteri(GL_TEXTURE_COMPARE_FUNC)
+    /**
+     * @param enabled Compare depth texture lookups against the reference value, for shadow samplers.
+     */
+    void setCompare(bool enabled, CompareFunc func = CompareFunc::lequal) const;
+
+    /// glSamplerParameterfv(GL_TEXTURE_BORDER_COLOR)
+    void setBorderColor(const float (&color)[4]) const;
+};
+
+using Sampler = Object<SamplerHandle>;
+
+/// Complete sampling state, used as the key of a SamplerCache.
+struct SamplerDescriptor
+{
+    SamplerHandle::Filter min_filter{SamplerHandle::Filter::linear_mipmap_linear};
+    SamplerHandle::Filter mag_filter{SamplerHandle::Filter::linear};
+    SamplerHandle::Wrap wrap_s{SamplerHandle::Wrap::repeat};
+    SamplerHandle::Wrap wrap_t{SamplerHandle::Wrap::repeat};
+    SamplerHandle::Wrap wrap_r{SamplerHandle::Wrap::repeat};
+    /// Values above 1 enable anisotropic filtering.
+    float max_anisotropy{1.f};
+    float lod_bias{0.f};
+    float min_lod{-1000.f};
+    float max_lod{1000.f};
+    bool compare{false};
+    SamplerHandle::CompareFunc compare_func{SamplerHandle::CompareFunc::lequal};
+    float border_color[4]{0.f, 0.f, 0.f, 0.f};
+};
+
+bool operator==(const SamplerDescriptor &l, const SamplerDescriptor &r);
+
+inline bool operator!=(const SamplerDescriptor &l, const SamplerDescriptor &r)
+{
+    return !(l == r);
+}
+
+struct SamplerDescriptorHash
+{
+    auto operator()(const SamplerDescriptor &descriptor) const noexcept -> std::size_t;
+};
+
+/// Creates one sampler object per distinct SamplerDescriptor and shares it among all its users.
+/**
+ * Materials can describe their sampling state and get() a sampler for it whenever they're bound, instead of setting
+ * texture parameters: descriptors are hashed, so looking up an existing sampler costs no GL calls.
+ */
+class SamplerCache
+{
+public:
+    /// Get the sampler for @p descriptor, creating it the first time the descriptor is seen.
+    [[nodiscard]]
+    auto get(const SamplerDescriptor &descriptor) -> SamplerHandle;
+
+    /// Number of distinct samplers created.
+    [[nodiscard]]
+    auto getSize() const -> std::size_t
+    { return m_samplers.size(); }
+
+    /// Delete every sampler. Handles obtained from get() become invalid.
+    /**
+     * Also resets the bindSamplers() cache of the calling thread.
+     */
+    void clear();
+
+private:
+    std::unordered_map<SamplerDescriptor, Sampler, SamplerDescriptorHash> m_samplers;
+};
+
+/// glBindSamplers — bind samplers to @p count consecutive texture units starting at @p first.
+/**
+ * The samplers last bound to each unit are cached per thread, and only the range of units whose sampler differs is
+ * passed to glBindSamplers, so rebinding the same samplers costs no GL calls. An empty handle unbinds the unit.
+ */
+void bindSamplers(GLuint first, GLsizei count, const SamplerHandle *samplers);
+
+/// Bind a sampler to a single texture unit, through the same cache as bindSamplers().
+void bindSampler(GLuint unit, SamplerHandle sampler);
+
+/// Forget the cached sampler bindings, so that the next bindSamplers() binds every unit it's given.
+/**
+ * Call this after binding samplers without bindSamplers(), or after making a different context current.
+ * loadContext() calls it automatically.
+ */
+void resetSamplerBindingCache();
+
+} // GL
+
+#endif //GLUTILS_SAMPLER_HPP
@@ -3,6 +3,7 @@
 
 #include "handle.hpp"
 #include "object.hpp"
+#include "pixel_store.hpp"
 
 namespace GL {
 
@@ -21,7 +22,8 @@ public:
         cube_map = 0x8513,
         buffer = 0x8C2A,
         _2d_multisample = 0x9100,
-        _2d_multisample_array = 0x9102
+        _2d_multisample_array = 0x9102,
+        cube_map_array = 0x9009
     };
 
     static TextureHandle create(Type type);
@@ -53,7 +55,7 @@ public:
         rgba8_snorm = 0x8F97,
         rgb10_a2 = 0x8059,
         rgb10_a2ui = 0x906F,
-        rgba12 = 0x8D70,
+        rgba12 = 0x805A,
         rgba16 = 0x805B,
         srgb8 = 0x8C41,
         srgb8_alpha8 = 0x8C43,
@@ -89,13 +91,166 @@ public:
         rgba8ui = 0x8D7C,
         rgba16i = 0x8D88,
         rgba16ui = 0x8D76,
-        rgba32i = 0x8D76,
+        rgba32i = 0x8D82,
         rgba32ui = 0x8D70,
+        // depth and stencil
+        depth_component16 = 0x81A5,
+        depth_component24 = 0x81A6,
+        depth_component32f = 0x8CAC,
+        depth24_stencil8 = 0x88F0,
+        depth32f_stencil8 = 0x8CAD,
+        stencil_index8 = 0x8D48,
+        // RGTC (BC4, BC5)
+        compressed_red_rgtc1 = 0x8DBB,
+        compressed_signed_red_rgtc1 = 0x8DBC,
+        compressed_rg_rgtc2 = 0x8DBD,
+        compressed_signed_rg_rgtc2 = 0x8DBE,
+        // BPTC (BC6H, BC7)
+        compressed_rgba_bptc_unorm = 0x8E8C,
+        compressed_srgb_alpha_bptc_unorm = 0x8E8D,
+        compressed_rgb_bptc_signed_float = 0x8E8E,
+        compressed_rgb_bptc_unsigned_float = 0x8E8F,
+        // S3TC (BC1, BC2, BC3); requires EXT_texture_compression_s3tc, and EXT_texture_sRGB for sRGB variants
+        compressed_rgb_s3tc_dxt1 = 0x83F0,
+        compressed_rgba_s3tc_dxt1 = 0x83F1,
+        compressed_rgba_s3tc_dxt3 = 0x83F2,
+        compressed_rgba_s3tc_dxt5 = 0x83F3,
+        compressed_srgb_s3tc_dxt1 = 0x8C4C,
+        compressed_srgb_alpha_s3tc_dxt1 = 0x8C4D,
+        compressed_srgb_alpha_s3tc_dxt3 = 0x8C4E,
+        compressed_srgb_alpha_s3tc_dxt5 = 0x8C4F,
+        // ETC2 / EAC
+        compressed_r11_eac = 0x9270,
+        compressed_signed_r11_eac = 0x9271,
+        compressed_rg11_eac = 0x9272,
+        compressed_signed_rg11_eac = 0x9273,
+        compressed_rgb8_etc2 = 0x9274,
+        compressed_srgb8_etc2 = 0x9275,
+        compressed_rgb8_punchthrough_alpha1_etc2 = 0x9276,
+        compressed_srgb8_punchthrough_alpha1_etc2 = 0x9277,
+        compressed_rgba8_etc2_eac = 0x9278,
+        compressed_srgb8_alpha8_etc2_eac = 0x9279,
+        // ASTC; requires KHR_texture_compression_astc_ldr
+        compressed_rgba_astc_4x4 = 0x93B0,
+        compressed_rgba_astc_5x4 = 0x93B1,
+        compressed_rgba_astc_5x5 = 0x93B2,
+        compressed_rgba_astc_6x5 = 0x93B3,
+        compressed_rgba_astc_6x6 = 0x93B4,
+        compressed_rgba_astc_8x5 = 0x93B5,
+        compressed_rgba_astc_8x6 = 0x93B6,
+        compressed_rgba_astc_8x8 = 0x93B7,
+        compressed_rgba_astc_10x5 = 0x93B8,
+        compressed_rgba_astc_10x6 = 0x93B9,
+        compressed_rgba_astc_10x8 = 0x93BA,
+        compressed_rgba_astc_10x10 = 0x93BB,
+        compressed_rgba_astc_12x10 = 0x93BC,
+        compressed_rgba_astc_12x12 = 0x93BD,
+        compressed_srgb8_alpha8_astc_4x4 = 0x93D0,
+        compressed_srgb8_alpha8_astc_5x4 = 0x93D1,
+        compressed_srgb8_alpha8_astc_5x5 = 0x93D2,
+        compressed_srgb8_alpha8_astc_6x5 = 0x93D3,
+        compressed_srgb8_alpha8_astc_6x6 = 0x93D4,
+        compressed_srgb8_alpha8_astc_8x5 = 0x93D5,
+        compressed_srgb8_alpha8_astc_8x6 = 0x93D6,
+        compressed_srgb8_alpha8_astc_8x8 = 0x93D7,
+        compressed_srgb8_alpha8_astc_10x5 = 0x93D8,
+        compressed_srgb8_alpha8_astc_10x6 = 0x93D9,
+        compressed_srgb8_alpha8_astc_10x8 = 0x93DA,
+        compressed_srgb8_alpha8_astc_10x10 = 0x93DB,
+        compressed_srgb8_alpha8_astc_12x10 = 0x93DC,
+        compressed_srgb8_alpha8_astc_12x12 = 0x93DD,
     };
 
+    /// glTextureView — create a texture that shares the storage of @p original.
+    /**
+     * https://registry.khronos.org/OpenGL-Refpages/gl4/html/glTextureView.xhtml
+     *
+     * The view reinterprets a range of the levels and layers of @p original, with a format of the same view class
+     * (see isViewCompatible()), e.g. rgba8 data as srgb8_alpha8 or rgba8ui, or a single layer of an array texture as
+     * a 2D texture. No data is copied, and the storage lives until the original and all of its views are deleted.
+     * @p original must have immutable storage (setStorage*()). The view is a new texture object, which can be owned
+     * like any other:
+     * @code
+     * Texture srgb{TextureHandle::createView(Type::_2d, texture, SizedInternalFormat::srgb8_alpha8, 0, levels)};
+     * @endcode
+     *
+     * @param type Target of the view, which must be compatible with the target of @p original.
+     * @param min_level, num_levels Range of levels of @p original, relative to its own first level.
+     * @param min_layer, num_layers Range of layers (or layer-faces) of @p original; 0 and 1 for non-array textures.
+     */
+    [[nodiscard]]
+    static auto createView(Type type, TextureHandle original, SizedInternalFormat format, GLuint min_level,
+                           GLuint num_levels, GLuint min_layer = 0, GLuint num_layers = 1) -> TextureHandle;
+
+    /// Block dimensions and size of a compressed format.
+    struct CompressedBlock
+    {
+        GLsizei width{0};
+        GLsizei height{0};
+        GLsizei size{0};
+
+        [[nodiscard]] explicit operator bool() const
+        { return size != 0; }
+    };
+
+    /// Get the block size of a compressed format. Returns an empty CompressedBlock for uncompressed formats.
+    [[nodiscard]]
+    static auto getCompressedBlock(SizedInternalFormat internal_format) -> CompressedBlock;
+
+    /// Size in bytes of a compressed image of the given dimensions.
+    [[nodiscard]]
+    static auto getCompressedImageSize(SizedInternalFormat internal_format, GLsizei width, GLsizei height,
+                                       GLsizei depth = 1) -> GLsizei;
+
+    /// Size in bytes of a texel of an uncompressed format, as implementations typically store it.
+    /**
+     * Formats with components smaller than a byte are rounded up to the size of the whole texel (e.g. 2 bytes for
+     * rgb5_a1), and three component formats are not padded. Returns 0 for compressed formats.
+     */
+    [[nodiscard]]
+    static auto getTexelSize(SizedInternalFormat internal_format) -> GLsizei;
+
+    /// Size in bytes of an image of the given dimensions in any format, compressed or not.
+    [[nodiscard]]
+    static auto getImageSize(SizedInternalFormat internal_format, GLsizei width, GLsizei height = 1,
+                             GLsizei depth = 1) -> GLsizeiptr;
+
+    /// Check whether a view of a texture with format @p a may have format @p b, i.e. both are in the same view class.
+    [[nodiscard]]
+    static bool isViewCompatible(SizedInternalFormat a, SizedInternalFormat b);
+
+    /// glGetInternalformativ(GL_INTERNALFORMAT_SUPPORTED) — check whether the implementation supports a format.
+    /**
+     * Use this to check for compressed formats that depend on extensions, such as S3TC and ASTC.
+     */
+    [[nodiscard]]
+    static bool isFormatSupported(Type type, SizedInternalFormat internal_format);
+
+    /// glTextureStorage1D — simultaneously specify storage for all levels of a one-dimensional texture
+    void setStorage1D(GLsizei levels, SizedInternalFormat internal_format, GLsizei width) const;
+
     /// glTextureStorage2D — simultaneously specify storage for all levels of a two-dimensional or one-dimensional array texture
+    /**
+     * Also used for rectangle and cube map textures. For one-dimensional arrays, @p height is the number of layers.
+     */
     void setStorage2D(GLsizei levels, SizedInternalFormat internal_format, GLsizei width, GLsizei height) const;
 
+    /// glTextureStorage3D — simultaneously specify storage for all levels of a three-dimensional, two-dimensional array or cube-map array texture
+    /**
+     * For array textures, @p depth is the number of layers. For cube map arrays it is the number of layer-faces, and
+     * must be a multiple of six.
+     */
+    void setStorage3D(GLsizei levels, SizedInternalFormat internal_format, GLsizei width, GLsizei height,
+                      GLsizei depth) const;
+
+    /// glTextureStorage2DMultisample — specify storage for a two-dimensional multisample texture
+    void setStorage2DMultisample(GLsizei samples, SizedInternalFormat internal_format, GLsizei width, GLsizei height,
+                                 bool fixed_sample_locations = true) const;
+
+    /// glTextureStorage3DMultisample — specify storage for a two-dimensional multisample array texture
+    void setStorage3DMultisample(GLsizei samples, SizedInternalFormat internal_format, GLsizei width, GLsizei height,
+                                 GLsizei depth, bool fixed_sample_locations = true) const;
+
     enum class BaseInternalFormat : GLenum
     {
         red = 0x1903,
@@ -112,6 +267,12 @@ public:
         bgr = 0x80E0,
         rgba = GLenum(BaseInternalFormat::rgba),
         bgra = 0x80E1,
+        red_integer = 0x8D94,
+        rg_integer = 0x8228,
+        rgb_integer = 0x8D98,
+        bgr_integer = 0x8D9A,
+        rgba_integer = 0x8D99,
+        bgra_integer = 0x8D9B,
         depth_component = 0x1902,
         stencil_index = 0x1901
     };
@@ -137,15 +298,130 @@ public:
         uint_8_8_8_8 = 0x8035,
         uint_8_8_8_8_rev = 0x8367,
         uint_10_10_10_2 = 0x8036,
-        uint_2_10_10_10_rev = 0x8368
+        uint_2_10_10_10_rev = 0x8368,
+        uint_10f_11f_11f_rev = 0x8C3B,
+        uint_5_9_9_9_rev = 0x8C3E
     };
 
+    /// Size in bytes of a single pixel of client data with the given format and type.
+    [[nodiscard]]
+    static auto getPixelSize(DataFormat format, DataType type) -> GLsizei;
+
+    /// glTextureSubImage1D — specify a one-dimensional texture subimage.
+    /**
+     * Like the other uploads without a layout, reads client memory with the GL_UNPACK_* parameters currently set in
+     * the context. Use the overloads taking a PixelUnpackLayout to upload with a known layout.
+     */
+    void updateImage1D(GLint level, GLint xoffset, GLsizei width, DataFormat format, DataType type,
+                       const void *pixel_data) const;
+
     /// glTextureSubImage2D — specify a two-dimensional texture subimage.
     void updateImage2D(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, DataFormat format,
                        DataType type, const void *pixel_data) const;
 
+    /// glTextureSubImage3D — specify a three-dimensional texture subimage.
+    /**
+     * For array and cube map textures, @p zoffset and @p depth select a range of layers (or faces). For cube map
+     * arrays, the layer-face index is layer * 6 + face.
+     */
+    void updateImage3D(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height,
+                       GLsizei depth, DataFormat format, DataType type, const void *pixel_data) const;
+
+    /// glTextureSubImage1D with explicit client memory layout.
+    void updateImage1D(GLint level, GLint xoffset, GLsizei width, DataFormat format, DataType type,
+                       const void *pixel_data, const PixelUnpackLayout &layout) const;
+
+    /// glTextureSubImage2D with explicit client memory layout.
+    /**
+     * Sets the GL_UNPACK_* parameters from @p layout (see setPixelUnpackLayout()) before uploading, which allows
+     * uploading a sub-rectangle of a larger image without repacking it first.
+     */
+    void updateImage2D(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, DataFormat format,
+                       DataType type, const void *pixel_data, const PixelUnpackLayout &layout) const;
+
+    /// glTextureSubImage3D with explicit client memory layout.
+    void updateImage3D(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height,
+                       GLsizei depth, DataFormat format, DataType type, const void *pixel_data,
+                       const PixelUnpackLayout &layout) const;
+
+    /// glCompressedTextureSubImage2D — specify a two-dimensional texture subimage in a compressed format.
+    /**
+     * https://registry.khronos.org/OpenGL-Refpages/gl4/html/glCompressedTexSubImage2D.xhtml
+     * @param format Compressed format of the data; must match the format of the texture.
+     * @param image_size Size of @p data in bytes.
+     */
+    void updateCompressedImage2D(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                 SizedInternalFormat format, GLsizei image_size, const void *data) const;
+
+    /// glCompressedTextureSubImage3D — specify a three-dimensional texture subimage in a compressed format.
+    /**
+     * Also used to update layers of array and cube map textures.
+     */
+    void updateCompressedImage3D(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+                                 GLsizei height, GLsizei depth, SizedInternalFormat format, GLsizei image_size,
+                                 const void *data) const;
+
+    /// Update a subimage of a single layer of a one-dimensional array texture.
+    void updateLayer1D(GLint level, GLint layer, GLint xoffset, GLsizei width, DataFormat format, DataType type,
+                       const void *pixel_data) const
+    {
+        updateImage2D(level, xoffset, layer, width, 1, format, type, pixel_data);
+    }
+
+    /// Update a subimage of a single layer of a two-dimensional array, cube map or cube map array texture.
+    void updateLayer2D(GLint level, GLint layer, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                       DataFormat format, DataType type, const void *pixel_data) const
+    {
+        updateImage3D(level, xoffset, yoffset, layer, width, height, 1, format, type, pixel_data);
+    }
+
+    /// Layer indices of the faces of a cube map.
+    enum class CubeMapFace : GLint
+    {
+        positive_x = 0,
+        negative_x = 1,
+        positive_y = 2,
+        negative_y = 3,
+        positive_z = 4,
+        negative_z = 5
+    };
+
+    /// Update a subimage of a single face of a cube map texture.
+    void updateCubeMapFace(GLint level, CubeMapFace face, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                           DataFormat format, DataType type, const void *pixel_data) const
+    {
+        updateLayer2D(level, GLint(face), xoffset, yoffset, width, height, format, type, pixel_data);
+    }
+
     void generateMipmap() const;
 
+    enum class ImageAccess : GLenum
+    {
+        read_only = 0x88B8,
+        write_only = 0x88B9,
+        read_write = 0x88BA
+    };
+
+    /// glBindImageTexture — bind a level of a texture to an image unit.
+    /**
+     * https://registry.khronos.org/OpenGL-Refpages/gl4/html/glBindImageTexture.xhtml
+     * @param unit Index of the image unit.
+     * @param level Level of the texture to bind.
+     * @param layered Bind all layers of an array, cube map or 3D texture, instead of only @p layer.
+     * @param layer Layer to bind if @p layered is false.
+     * @param access Type of access the shader will perform.
+     * @param format Format the shader will interpret the image data as.
+     */
+    void bindImage(GLuint unit, GLint level, bool layered, GLint layer, ImageAccess access,
+                   SizedInternalFormat format) const;
+
+    /// glBindImageTextures — bind level 0 of each texture, layered and read-write with its own format, to consecutive
+    /// image units. Empty handles unbind their unit.
+    static void bindImages(GLuint first_unit, GLsizei count, const TextureHandle *textures);
+
+    /// Break the binding of an image unit.
+    static void unbindImage(GLuint unit);
+
     static void bindTextureUnit(GLuint texture_unit_index, TextureHandle texture);
 };
 
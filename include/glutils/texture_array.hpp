@@ -0,0 +1,76 @@
+#ifndef GLUTILS_TEXTURE_ARRAY_HPP
+#define GLUTILS_TEXTURE_ARRAY_HPP
+
+#include "texture.hpp"
+
+#include <vector>
+
+namespace GL {
+
+/// Shares the layers of a single two-dimensional array texture between many users.
+/**
+ * All layers have the same size and format, so anything that would otherwise be a separate texture of that size can
+ * instead be stored in a layer of the array and sampled through one texture binding.
+ */
+class TextureArrayAllocator
+{
+public:
+    using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+
+    /**
+     * @brief Create a 2D array texture and allocate immutable storage for it.
+     * @param levels Number of mipmap levels of each layer.
+     * @param internal_format Format of the texture.
+     * @param width Width of each layer.
+     * @param height Height of each layer.
+     * @param layers Number of layers, i.e. the maximum number of simultaneous allocations.
+     */
+    TextureArrayAllocator(GLsizei levels, SizedInternalFormat internal_format, GLsizei width, GLsizei height,
+                          GLsizei layers);
+
+    /// Reserve a layer. Throws GL::Error if there are no free layers left.
+    [[nodiscard]]
+    auto allocate() -> GLint;
+
+    /// Return a layer obtained from allocate() to the free list. Its contents are left unchanged.
+    void free(GLint layer);
+
+    /// Update a subimage of an allocated layer. Equivalent to TextureHandle::updateLayer2D().
+    void update(GLint layer, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                TextureHandle::DataFormat format, TextureHandle::DataType type, const void *pixel_data) const;
+
+    [[nodiscard]]
+    auto getTexture() const -> TextureHandle
+    { return m_texture; }
+
+    [[nodiscard]]
+    auto getWidth() const -> GLsizei
+    { return m_width; }
+
+    [[nodiscard]]
+    auto getHeight() const -> GLsizei
+    { return m_height; }
+
+    [[nodiscard]]
+    auto getLayerCount() const -> GLsizei
+    { return m_layer_count; }
+
+    [[nodiscard]]
+    auto getFreeLayerCount() const -> GLsizei
+    { return static_cast<GLsizei>(m_free_layers.size()); }
+
+    [[nodiscard]]
+    bool isFull() const
+    { return m_free_layers.empty(); }
+
+private:
+    Texture m_texture;
+    GLsizei m_width;
+    GLsizei m_height;
+    GLsizei m_layer_count;
+    std::vector<GLint> m_free_layers;
+};
+
+} // GL
+
+#endif //GLUTILS_TEXTURE_ARRAY_HPP
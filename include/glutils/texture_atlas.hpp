@@ -0,0 +1,146 @@
+#ifndef GLUTILS_TEXTURE_ATLAS_HPP
+#define GLUTILS_TEXTURE_ATLAS_HPP
+
+#include "texture.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace GL {
+
+/// Packs many small images (glyphs, icons, decals) into the layers of a single 2D array texture.
+/**
+ * Rectangles are placed with a skyline bottom-left packer, one skyline per layer, so they can be added one at a time
+ * as they're needed. Freed rectangles are only reclaimed by compact(), which repacks every live region from the
+ * tallest down and moves them into a new texture with glCopyImageSubData, without a round trip through the CPU.
+ *
+ * Since compaction moves regions and replaces the texture, region positions and UV rectangles should be looked up
+ * with getRegion() when drawing rather than stored, and the texture with getTexture().
+ */
+class TextureAtlas
+{
+public:
+    using RegionId = GLuint;
+
+    struct Options
+    {
+        /// Any uncompressed format; the constructor throws GL::Error for compressed ones.
+        TextureHandle::SizedInternalFormat format{TextureHandle::SizedInternalFormat::rgba8};
+        GLsizei width{2048};
+        GLsizei height{2048};
+        GLsizei layers{1};
+        /// Empty texels kept to the right of and below every region, so that linear filtering doesn't bleed.
+        GLsizei padding{1};
+    };
+
+    /// Location of a region in the atlas.
+    struct Region
+    {
+        GLint layer{0};
+        GLint x{0};
+        GLint y{0};
+        GLsizei width{0};
+        GLsizei height{0};
+        /// Normalized texture coordinates of the region's corners.
+        float u0{0.f};
+        float v0{0.f};
+        float u1{0.f};
+        float v1{0.f};
+    };
+
+    explicit TextureAtlas(const Options &options);
+
+    /// Reserve a @p width x @p height region, or return an empty optional if no layer has room for it.
+    [[nodiscard]]
+    auto tryAllocate(GLsizei width, GLsizei height) -> std::optional<RegionId>;
+
+    /// Reserve a region, compacting the atlas if it doesn't fit otherwise. Throws GL::Error if it still doesn't fit.
+    [[nodiscard]]
+    auto allocate(GLsizei width, GLsizei height) -> RegionId;
+
+    /// Release a region. Its area is reused after the next compaction.
+    void free(RegionId id);
+
+    /// Upload the whole contents of a region. Equivalent to TextureHandle::updateLayer2D().
+    void upload(RegionId id, TextureHandle::DataFormat format, TextureHandle::DataType type,
+                const void *pixel_data) const;
+
+    /// Upload a sub-rectangle of a region, with offsets relative to the region.
+    void update(RegionId id, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                TextureHandle::DataFormat format, TextureHandle::DataType type, const void *pixel_data) const;
+
+    /// Repack the live regions and move them into a new texture on the GPU.
+    /**
+     * @return false, leaving the atlas unchanged, if the regions could not be repacked (which can happen because
+     * the new packing order differs from the one they were allocated in).
+     */
+    bool compact();
+
+    [[nodiscard]]
+    auto getRegion(RegionId id) const -> const Region &;
+
+    [[nodiscard]]
+    auto getTexture() const -> TextureHandle
+    { return m_texture; }
+
+    [[nodiscard]]
+    auto getRegionCount() const -> std::size_t
+    { return m_live_count; }
+
+    /// Fraction of the atlas area covered by live regions, including their padding.
+    [[nodiscard]]
+    auto getOccupancy() const -> float;
+
+    /// Fraction of the atlas area held by freed regions, which compact() would reclaim.
+    [[nodiscard]]
+    auto getFragmentation() const -> float;
+
+    [[nodiscard]]
+    auto getOptions() const -> const Options &
+    { return m_options; }
+
+private:
+    // A horizontal segment of a layer's skyline: everything below y is taken, from x to x + width.
+    struct SkylineNode
+    {
+        GLint x;
+        GLint y;
+        GLsizei width;
+    };
+
+    struct Entry
+    {
+        Region region;
+        bool live;
+    };
+
+    struct Placement
+    {
+        GLint layer;
+        GLint x;
+        GLint y;
+    };
+
+    auto findPlacement(GLsizei width, GLsizei height) const -> std::optional<Placement>;
+
+    void place(const Placement &placement, GLsizei width, GLsizei height);
+
+    void resetSkylines();
+
+    auto getEntry(RegionId id) const -> const Entry &;
+
+    void setRegion(Region &region, const Placement &placement) const;
+
+    Options m_options;
+    Texture m_texture;
+    std::vector<std::vector<SkylineNode>> m_skylines;
+    std::vector<Entry> m_entries;
+    std::vector<RegionId> m_free_ids;
+    std::size_t m_live_count{0};
+    std::size_t m_live_area{0};
+    std::size_t m_dead_area{0};
+};
+
+} // GL
+
+#endif //GLUTILS_TEXTURE_ATLAS_HPP
@@ -0,0 +1,172 @@
+#ifndef GLUTILS_TEXTURE_BUDGET_HPP
+#define GLUTILS_TEXTURE_BUDGET_HPP
+
+#include "texture.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace GL {
+
+/// Owns a set of textures and keeps the memory they use within a budget.
+/**
+ * The size of every texture is computed from its format, dimensions and levels. When the total goes over budget,
+ * update() frees memory without waiting for the GPU:
+ * - Textures that haven't been used for Options::evict_after_frames frames are evicted entirely, least recently used
+ *   first.
+ * - The top mip levels of the remaining textures are dropped, one level at a time from the least recently used
+ *   texture onwards. A texture is reallocated with fewer levels and the levels it keeps are copied on the GPU with
+ *   glCopyImageSubData.
+ * - If that isn't enough, textures already at Options::min_size that weren't used this frame are evicted.
+ *
+ * Textures used during a frame that are missing levels are restored as far as the budget allows. The texture is
+ * reallocated with the levels it's missing, and a LevelLoader supplies their contents a few levels per frame, coarse
+ * to fine. GL_TEXTURE_BASE_LEVEL is raised until then, so that sampling only sees loaded levels.
+ *
+ * Textures are reallocated when their levels change, so the texture object should be fetched with use() when
+ * drawing rather than stored, and sampling state should come from sampler objects rather than texture parameters.
+ */
+class TextureBudget
+{
+public:
+    using TextureId = GLuint;
+
+    /// Storage of a texture with all of its levels, as passed to TextureHandle::setStorage*D().
+    /**
+     * For one-dimensional array textures, height is the number of layers. For two-dimensional and cube map array
+     * textures, depth is the number of layers (layer-faces for cube map arrays). Other types ignore the dimensions
+     * they don't have.
+     */
+    struct Description
+    {
+        TextureHandle::Type type{TextureHandle::Type::_2d};
+        TextureHandle::SizedInternalFormat format{TextureHandle::SizedInternalFormat::rgba8};
+        GLsizei width{1};
+        GLsizei height{1};
+        GLsizei depth{1};
+        GLsizei levels{1};
+    };
+
+    /// Upload level @p level of the full texture into level @p texture_level of @p texture.
+    /**
+     * The two differ when top levels have been dropped. Called from update(), on the GL thread.
+     */
+    using LevelLoader = std::function<void(TextureHandle texture, GLint level, GLint texture_level)>;
+
+    struct Options
+    {
+        /// Bytes of texture storage the textures may use.
+        std::size_t budget{std::size_t(512) << 20};
+        /// Top levels aren't dropped from a texture once its width and height are both at most this.
+        GLsizei min_size{32};
+        /// Textures unused for this many frames are evicted entirely before dropping levels from the others.
+        std::uint64_t evict_after_frames{600};
+        /// Bytes of levels loaded per update(). At least one level is loaded if any is missing.
+        std::size_t max_load_bytes_per_frame{std::size_t(16) << 20};
+    };
+
+    struct Stats
+    {
+        /// Bytes of storage currently allocated.
+        std::size_t resident_bytes{0};
+        std::size_t texture_count{0};
+        /// Textures that currently have no storage.
+        std::size_t evicted_textures{0};
+        /// Textures that currently lack some of their levels, because they were dropped or aren't loaded yet.
+        std::size_t reduced_textures{0};
+        /// Textures evicted during the last update().
+        std::size_t evictions{0};
+        /// Levels dropped during the last update().
+        std::size_t dropped_levels{0};
+        /// Levels loaded during the last update().
+        std::size_t loaded_levels{0};
+    };
+
+    explicit TextureBudget(const Options &options);
+
+    /// Add a texture. It has no storage until the next update() loads it.
+    /**
+     * Throws GL::Error for buffer and multisample textures, which can't be reloaded level by level.
+     */
+    [[nodiscard]]
+    auto add(const Description &description, LevelLoader loader) -> TextureId;
+
+    /// Delete a texture and release its storage.
+    void remove(TextureId id);
+
+    /// Mark a texture as used this frame, and get its texture object.
+    /**
+     * Returns an empty handle while the texture is evicted. The next update() restores it if the budget allows.
+     */
+    [[nodiscard]]
+    auto use(TextureId id) -> TextureHandle;
+
+    /// Get the texture object, without marking it as used.
+    [[nodiscard]]
+    auto getTexture(TextureId id) const -> TextureHandle;
+
+    /// Number of top levels the texture currently lacks, dropped or not loaded yet; all of them if evicted.
+    [[nodiscard]]
+    auto getMissingLevels(TextureId id) const -> GLsizei;
+
+    /// Bytes of storage a texture uses with all of its levels.
+    [[nodiscard]]
+    static auto getStorageSize(const Description &description) -> std::size_t;
+
+    /// Enforce the budget, restore used textures and load missing levels. Call once per frame, after drawing.
+    void update();
+
+    void setBudget(std::size_t budget)
+    { m_options.budget = budget; }
+
+    [[nodiscard]]
+    auto getBudget() const -> std::size_t
+    { return m_options.budget; }
+
+    [[nodiscard]]
+    auto getResidentBytes() const -> std::size_t
+    { return m_resident_bytes; }
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+private:
+    struct Entry
+    {
+        Description description;
+        LevelLoader loader;
+        Texture texture{TextureHandle()};
+        // top levels that have no storage
+        GLsizei dropped{0};
+        // levels of the texture, from the top, that have storage but haven't been loaded yet
+        GLsizei unloaded{0};
+        std::size_t bytes{0};
+        std::uint64_t last_used{0};
+        bool live{false};
+    };
+
+    auto getEntry(TextureId id) const -> const Entry &;
+
+    auto getEntriesByLastUse() -> std::vector<Entry *>;
+
+    auto getMaxDropped(const Entry &entry) const -> GLsizei;
+
+    void reallocate(Entry &entry, GLsizei dropped);
+
+    void evict(Entry &entry);
+
+    void loadLevel(Entry &entry);
+
+    Options m_options;
+    std::vector<Entry> m_entries;
+    std::vector<TextureId> m_free_ids;
+    std::size_t m_resident_bytes{0};
+    std::uint64_t m_frame{1};
+    Stats m_stats;
+};
+
+} // GL
+
+#endif //GLUTILS_TEXTURE_BUDGET_HPP
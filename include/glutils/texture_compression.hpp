@@ -0,0 +1,78 @@
+#ifndef GLUTILS_TEXTURE_COMPRESSION_HPP
+#define GLUTILS_TEXTURE_COMPRESSION_HPP
+
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GL {
+
+/// Options for compressImage().
+struct CompressionOptions
+{
+    enum class Quality
+    {
+        /// Bounding box endpoints. Several times faster than high, for content that is compressed at load time.
+        fast,
+        /// Principal axis endpoints refined by least squares, keeping the better of this and the fast result.
+        high
+    };
+
+    Quality quality{Quality::fast};
+
+    /// Number of threads to compress with. Zero uses std::thread::hardware_concurrency().
+    unsigned int thread_count{0};
+};
+
+/// Throughput and quality of a compressImage() call.
+struct CompressionStats
+{
+    /// Wall clock time spent compressing.
+    double seconds{0.0};
+    double megapixels_per_second{0.0};
+    /// Peak signal-to-noise ratio of the decompressed result against the source, in dB, over the components the
+    /// format stores. Infinite for a lossless result.
+    double psnr{0.0};
+};
+
+/// Compress RGBA8 pixels into one of the BC formats, laid out for TextureHandle::updateCompressedImage2D().
+/**
+ * Supported formats and the components they are encoded from:
+ * - BC1 (compressed_rgb(a)_s3tc_dxt1 and sRGB variants): RGB; alpha is ignored.
+ * - BC3 (compressed_rgba_s3tc_dxt5 and sRGB variant): RGBA.
+ * - BC4 (compressed_red_rgtc1): R.
+ * - BC5 (compressed_rg_rgtc2): RG.
+ * - BC7 (compressed_rgba_bptc_unorm and sRGB variant): RGBA, encoded using mode 6 only.
+ *
+ * sRGB formats are encoded exactly like their linear counterparts. Blocks are compressed in parallel, a block row at
+ * a time. Blocks overlapping the right or bottom edge replicate the edge pixels.
+ *
+ * @param rgba Source pixels, tightly packed, four bytes per pixel.
+ * @param stats If not null, receives the time taken and the PSNR of the result. Computing the PSNR decompresses
+ * the result, which is not included in the reported time.
+ * @return the compressed blocks, in row-major block order.
+ */
+[[nodiscard]]
+auto compressImage(const std::uint8_t *rgba, GLsizei width, GLsizei height,
+                   TextureHandle::SizedInternalFormat format, const CompressionOptions &options = {},
+                   CompressionStats *stats = nullptr) -> std::vector<std::byte>;
+
+/// Decompress blocks produced by compressImage() back to RGBA8.
+/**
+ * Components not stored by the format are set to 0 (and alpha to 255). For BC7, only mode 6 blocks can be decoded,
+ * which is what compressImage() produces; other blocks throw GL::Error.
+ */
+[[nodiscard]]
+auto decompressImage(const std::byte *blocks, GLsizei width, GLsizei height,
+                     TextureHandle::SizedInternalFormat format) -> std::vector<std::uint8_t>;
+
+/// PSNR in dB between two RGBA8 images, over the first @p component_count components of each pixel.
+[[nodiscard]]
+auto computePSNR(const std::uint8_t *a, const std::uint8_t *b, GLsizei width, GLsizei height,
+                 int component_count = 4) -> double;
+
+} // GL
+
+#endif //GLUTILS_TEXTURE_COMPRESSION_HPP
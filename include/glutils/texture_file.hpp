@@ -0,0 +1,108 @@
+#ifndef GLUTILS_TEXTURE_FILE_HPP
+#define GLUTILS_TEXTURE_FILE_HPP
+
+#include "mapped_file.hpp"
+#include "texture.hpp"
+
+#include <string>
+#include <vector>
+
+namespace GL {
+
+/// A KTX2 or DDS texture file, memory mapped and parsed.
+/**
+ * Image data is not copied: each Image points into the mapping, and upload() passes those pointers straight to
+ * glCompressedTextureSubImage* (or glTextureSubImage* for uncompressed formats).
+ *
+ * Supported are block-compressed formats (BC1-BC7, ETC2/EAC, ASTC) and the common 8 bit, half and float
+ * uncompressed formats, for 1D, 2D, 3D, array and cube map textures. KTX2 supercompression (Basis Universal, zstd)
+ * is not supported.
+ */
+class TextureFile
+{
+public:
+    /// A contiguous range of texels of one mip level, covering @p depth slices, layers or faces from @p zoffset.
+    struct Image
+    {
+        GLint level{0};
+        GLint zoffset{0};
+        GLsizei width{0};
+        GLsizei height{0};
+        GLsizei depth{1};
+        const std::byte *data{nullptr};
+        std::size_t size{0};
+    };
+
+    /// Map and parse @p path. The file type is detected from its contents. Throws GL::Error on failure.
+    explicit TextureFile(const std::string &path);
+
+    /// Create a texture, allocate storage for it and upload every image.
+    [[nodiscard]]
+    auto createTexture() const -> Texture;
+
+    /// Allocate storage of the right type, format and size on @p texture.
+    void allocateStorage(TextureHandle texture) const;
+
+    /// Upload every image into @p texture, which must have storage as allocated by allocateStorage().
+    void upload(TextureHandle texture) const;
+
+    [[nodiscard]]
+    auto getType() const -> TextureHandle::Type
+    { return m_type; }
+
+    [[nodiscard]]
+    auto getFormat() const -> TextureHandle::SizedInternalFormat
+    { return m_format; }
+
+    [[nodiscard]]
+    bool isCompressed() const
+    { return bool(TextureHandle::getCompressedBlock(m_format)); }
+
+    [[nodiscard]]
+    auto getWidth() const -> GLsizei
+    { return m_width; }
+
+    [[nodiscard]]
+    auto getHeight() const -> GLsizei
+    { return m_height; }
+
+    /// Depth of 3D textures, 1 otherwise.
+    [[nodiscard]]
+    auto getDepth() const -> GLsizei
+    { return m_depth; }
+
+    /// Array layers, not counting cube map faces. 1 for non-array textures.
+    [[nodiscard]]
+    auto getLayerCount() const -> GLsizei
+    { return m_layers; }
+
+    [[nodiscard]]
+    auto getLevelCount() const -> GLsizei
+    { return m_levels; }
+
+    [[nodiscard]]
+    auto getImages() const -> const std::vector<Image> &
+    { return m_images; }
+
+private:
+    void parseKTX2();
+
+    void parseDDS();
+
+    MappedFile m_file;
+    TextureHandle::Type m_type{TextureHandle::Type::_2d};
+    TextureHandle::SizedInternalFormat m_format{TextureHandle::SizedInternalFormat::rgba8};
+    TextureHandle::DataFormat m_data_format{TextureHandle::DataFormat::rgba};
+    TextureHandle::DataType m_data_type{TextureHandle::DataType::ubyte};
+    GLsizei m_width{0};
+    GLsizei m_height{0};
+    GLsizei m_depth{1};
+    GLsizei m_layers{1};
+    GLsizei m_levels{1};
+    bool m_generate_mipmaps{false};
+    std::vector<Image> m_images;
+};
+
+} // GL
+
+#endif //GLUTILS_TEXTURE_FILE_HPP
@@ -0,0 +1,181 @@
+#ifndef GLUTILS_TEXTURE_STREAM_HPP
+#define GLUTILS_TEXTURE_STREAM_HPP
+
+#include "buffer.hpp"
+#include "sync.hpp"
+#include "texture.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace GL {
+
+/// Streams texture data to the GPU through a persistently mapped pixel unpack buffer.
+/**
+ * The staging buffer is used as a ring. Any thread may acquire() a region of it, write (e.g. decode) pixel data
+ * straight into the mapped memory and then submit() an upload from that region. The thread that owns the GL context
+ * calls process() once per frame, which issues the pending glTextureSubImage* calls with buffer offsets instead of
+ * host pointers, and fences them. Staging regions are recycled once their fence has signaled, so the render thread
+ * never waits for a transfer to finish.
+ *
+ * Only process() issues GL commands. All other member functions are thread-safe.
+ */
+class TextureStreamer
+{
+public:
+    /// A region of the staging ring, returned by acquire().
+    struct Staging
+    {
+        void *data{nullptr};
+        GLintptr offset{0};
+        GLsizeiptr size{0};
+        std::uint64_t serial{0};
+
+        [[nodiscard]] explicit operator bool() const
+        { return data; }
+    };
+
+    /// Destination of an upload.
+    struct Upload
+    {
+        TextureHandle texture;
+        /// 1, 2 or 3; selects glTextureSubImage1D, 2D or 3D. Use 3 for array layers and cube map faces.
+        GLuint dimensions{2};
+        GLint level{0};
+        GLint xoffset{0};
+        GLint yoffset{0};
+        GLint zoffset{0};
+        GLsizei width{1};
+        GLsizei height{1};
+        GLsizei depth{1};
+        TextureHandle::DataFormat format{TextureHandle::DataFormat::rgba};
+        TextureHandle::DataType type{TextureHandle::DataType::ubyte};
+    };
+
+    /// Create and persistently map a staging ring of @p staging_size bytes.
+    explicit TextureStreamer(GLsizeiptr staging_size);
+
+    /// Unmaps the staging buffer. Must be called on the GL thread, with no thread waiting in acquire().
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer &) = delete;
+
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    /// Reserve @p size bytes of staging memory, blocking until enough of the ring has been recycled.
+    /**
+     * Throws GL::Error if @p size is larger than the ring. Blocks until process() has been called enough times to
+     * free the necessary space, so it must not be called from the GL thread while the ring is full.
+     */
+    [[nodiscard]]
+    auto acquire(GLsizeiptr size) -> Staging;
+
+    /// Like acquire(), but returns an empty Staging instead of blocking if the ring is full.
+    [[nodiscard]]
+    auto tryAcquire(GLsizeiptr size) -> Staging;
+
+    /// Queue an upload of the pixel data written to @p staging. The staging region must not be touched afterwards.
+    void submit(const Staging &staging, const Upload &upload);
+
+    /// Give back a staging region without uploading it, e.g. because decoding failed.
+    void cancel(const Staging &staging);
+
+    /// Copy a 2D image (or a single array layer) into the ring tile by tile and submit one upload per tile.
+    /**
+     * This is meant to be called from a worker thread, and it blocks while the ring is full. Tiles are at most
+     * @p tile_size pixels wide and high, so uploading a very large image is spread over several calls to process()
+     * when a byte budget is given.
+     *
+     * @param upload Destination region; the whole region is filled from @p pixels.
+     * @param pixels Source data for the region.
+     * @param row_stride Distance in bytes between the start of consecutive rows in @p pixels.
+     * @param tile_size Maximum tile width and height, in pixels.
+     */
+    void streamImage2D(const Upload &upload, const void *pixels, GLsizeiptr row_stride, GLsizei tile_size = 1024);
+
+    /// Issue pending uploads and recycle staging memory whose uploads have completed. GL thread only.
+    /**
+     * @param byte_budget Stop after issuing uploads totalling at least this many bytes; the remaining uploads are
+     * issued by subsequent calls.
+     * @return the number of bytes issued.
+     */
+    auto process(GLsizeiptr byte_budget = std::numeric_limits<GLsizeiptr>::max()) -> GLsizeiptr;
+
+    /// Number of submitted uploads that have not been issued yet.
+    [[nodiscard]]
+    auto getPendingCount() const -> std::size_t;
+
+    /// Number of staging bytes that are currently reserved, queued or in flight.
+    [[nodiscard]]
+    auto getBytesInUse() const -> GLsizeiptr;
+
+    [[nodiscard]]
+    auto getStagingBuffer() const -> BufferHandle
+    { return m_buffer; }
+
+    [[nodiscard]]
+    auto getStagingSize() const -> GLsizeiptr
+    { return m_size; }
+
+private:
+    enum class AllocationState
+    {
+        reserved,
+        queued,
+        in_flight,
+        retired
+    };
+
+    struct Allocation
+    {
+        std::uint64_t serial;
+        GLintptr begin; // includes padding skipped at the end of the ring
+        GLintptr end;
+        AllocationState state;
+        std::uint64_t batch;
+    };
+
+    struct Pending
+    {
+        std::uint64_t serial;
+        GLintptr offset;
+        GLsizeiptr size;
+        Upload upload;
+    };
+
+    struct Batch
+    {
+        std::uint64_t id;
+        Sync fence;
+    };
+
+    auto tryAllocate(GLsizeiptr size) -> Staging;
+
+    auto findAllocation(std::uint64_t serial) -> Allocation &;
+
+    void reclaim();
+
+    Buffer m_buffer;
+    GLsizeiptr m_size;
+    std::byte *m_mapping{nullptr};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_space_available;
+
+    GLintptr m_head{0};
+    GLsizeiptr m_used{0};
+    std::uint64_t m_next_serial{1};
+    std::uint64_t m_next_batch{1};
+    std::deque<Allocation> m_allocations;
+    std::deque<Pending> m_pending;
+    std::deque<Batch> m_batches;
+};
+
+} // GL
+
+#endif //GLUTILS_TEXTURE_STREAM_HPP
@@ -0,0 +1,209 @@
+#ifndef GLUTILS_TILE_RESIDENCY_HPP
+#define GLUTILS_TILE_RESIDENCY_HPP
+
+#include "texture.hpp"
+#include "texture_stream.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace GL {
+
+/// Keeps the tiles of a mipmapped texture resident in a fixed pool of slots, streaming them in from worker threads.
+/**
+ * The common part of VirtualTexture and BrickCache:
+ * - The pool is a texture divided in pool_x x pool_y x pool_z slots, each holding a tile plus a border. Slots along
+ *   z are either layers of a 2D array texture or slices of a 3D texture.
+ * - The tile table has one rgba8ui texel per tile and one level per level of tiles. Each texel holds the slot of its
+ *   tile, packed as x | y << 8 | z << 16 | mapped level << 24, or that of the closest resident ancestor. Texels
+ *   with no resident ancestor have a mapped level of 255.
+ * - request() claims a free or least recently used slot and queues the tile for the loader threads, which fill
+ *   staging memory through the TileLoader and submit the upload. update() issues the uploads, marks their tiles
+ *   resident and uploads the changed parts of the table.
+ *
+ * Tiles of the coarsest level may be pinned, so that every other tile always has something to fall back to.
+ */
+class TileResidency
+{
+public:
+    /// A tile: level and position in tiles within that level. z is zero for 2D textures.
+    struct TileId
+    {
+        GLint level{0};
+        GLint x{0};
+        GLint y{0};
+        GLint z{0};
+    };
+
+    /// Write the texels of a tile, including its border, to @p destination, rows @p row_stride bytes apart and
+    /// slices a row stride times the slot size apart. Called from the loader threads.
+    /**
+     * @return false if the tile could not be loaded. Its slot is freed, and it may be requested again.
+     */
+    using TileLoader = std::function<bool(const TileId &tile, void *destination, GLsizeiptr row_stride)>;
+
+    struct Options
+    {
+        /// Texels per side of a tile, excluding the border.
+        GLsizei tile_size{128};
+        /// Texels duplicated from the neighbouring tiles on each side.
+        GLsizei border{0};
+        /// Slots per row, column and layer or slice of the pool. At most 256 each.
+        GLsizei pool_x{1};
+        GLsizei pool_y{1};
+        GLsizei pool_z{1};
+        /// Whether the pool is a 2D array texture with a 2D tile table, rather than a 3D texture with a 3D table.
+        bool layered{true};
+        /// Layout of the data written by the TileLoader.
+        TextureHandle::DataFormat data_format{TextureHandle::DataFormat::rgba};
+        TextureHandle::DataType data_type{TextureHandle::DataType::ubyte};
+        GLsizeiptr staging_size{16 << 20};
+        unsigned int loader_threads{2};
+        /// Whether tiles of the coarsest level are never evicted.
+        bool pin_top_level{true};
+    };
+
+    /// Tiles covering a level, and size of the table level, which may be larger than the tile grid.
+    struct LevelSize
+    {
+        GLsizei tiles_x{1};
+        GLsizei tiles_y{1};
+        GLsizei tiles_z{1};
+        GLsizei table_x{1};
+        GLsizei table_y{1};
+        GLsizei table_z{1};
+    };
+
+    enum class State
+    {
+        /// Not in the pool, or in a free slot.
+        free,
+        loading,
+        resident
+    };
+
+    struct Stats
+    {
+        std::size_t resident_tiles{0};
+        std::size_t loading_tiles{0};
+        /// Tiles that finished uploading, tiles evicted and bytes uploaded since the previous update().
+        std::size_t uploaded_tiles{0};
+        std::size_t evicted_tiles{0};
+        GLsizeiptr bytes_streamed{0};
+    };
+
+    /// Start the loader threads. @p pool and @p table must have the storage described by @p options and @p levels,
+    /// and outlive the TileResidency.
+    TileResidency(TextureHandle pool, TextureHandle table, const Options &options, std::vector<LevelSize> levels,
+                  TileLoader loader);
+
+    /// Stops the loader threads. Must be called on the GL thread.
+    ~TileResidency();
+
+    TileResidency(const TileResidency &) = delete;
+
+    TileResidency &operator=(const TileResidency &) = delete;
+
+    /// Bytes between the rows of a tile in staging memory; rows are aligned to 4 bytes, the default unpack alignment.
+    [[nodiscard]]
+    static auto getRowStride(const Options &options) -> GLsizeiptr;
+
+    /// Bytes of staging memory a tile takes, border included. The staging ring must hold at least one.
+    [[nodiscard]]
+    static auto getTileBytes(const Options &options) -> GLsizeiptr;
+
+    /// Mark @p tile as used this frame, if it's in the pool, so that it isn't evicted before the next update().
+    /**
+     * @return whether the tile is resident, loading, or missing.
+     */
+    auto touch(const TileId &tile) -> State;
+
+    /// Claim a slot for @p tile, evicting the least recently used tile if there are no free slots, and queue it for
+    /// loading.
+    /**
+     * @return false if every slot is pinned, loading or used this frame.
+     */
+    auto request(const TileId &tile) -> bool;
+
+    /// Issue the uploads the loaders submitted, update the table, and start the next frame.
+    /**
+     * @return the stats of the frame that ended.
+     */
+    auto update() -> Stats;
+
+    [[nodiscard]]
+    auto getLevelCount() const -> GLsizei
+    { return GLsizei(m_levels.size()); }
+
+private:
+    struct Slot
+    {
+        State state{State::free};
+        TileId tile;
+        std::uint64_t last_used{0};
+        bool pinned{false};
+    };
+
+    struct Level
+    {
+        LevelSize size;
+        // CPU copy of the table level
+        std::vector<std::uint32_t> entries;
+        // bounding box of the entries changed since the last upload
+        GLint dirty_min[3], dirty_max[3];
+    };
+
+    struct Job
+    {
+        TileId tile;
+        std::size_t slot;
+    };
+
+    struct Completion
+    {
+        std::size_t slot;
+        bool loaded;
+    };
+
+    static auto s_key(const TileId &tile) -> std::uint64_t;
+
+    auto findSlot() -> std::optional<std::size_t>;
+
+    void finishUploads();
+
+    void updateEntries(const TileId &tile);
+
+    void uploadTable();
+
+    void runLoader();
+
+    TextureHandle m_pool;
+    TextureHandle m_table;
+    Options m_options;
+    TileLoader m_loader;
+    std::vector<Level> m_levels;
+    TextureStreamer m_streamer;
+
+    std::vector<Slot> m_slots;
+    std::unordered_map<std::uint64_t, std::size_t> m_tile_slots;
+    std::uint64_t m_frame{1};
+    Stats m_stats;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobs_available;
+    std::deque<Job> m_jobs;
+    std::vector<Completion> m_completions;
+    bool m_stopping{false};
+    std::vector<std::thread> m_threads;
+};
+
+} // GL
+
+#endif //GLUTILS_TILE_RESIDENCY_HPP
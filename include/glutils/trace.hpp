@@ -0,0 +1,145 @@
+#ifndef GLUTILS_TRACE_HPP
+#define GLUTILS_TRACE_HPP
+
+#include "gl.hpp"
+#include "mapped_file.hpp"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GL {
+
+#if GLUTILS_CALL_STATS
+
+/// Records the GL calls made on the calling thread into a binary trace file that TraceReplayer re-executes.
+/**
+ * Calls are captured from the post-call callback loadContext() installs in builds with GLUTILS_CALL_STATS. Every
+ * call to a supported entry point, which includes every entry point glutils calls and the common draw, state and
+ * uniform calls, is written with its arguments, the CPU time since the previous call, and the client memory it reads:
+ * uploads, sized from their arguments and the pixel store state, name arrays and shader sources. Object names and
+ * sync objects are written as they were and remapped on replay. Writes through mapped buffers are captured when the
+ * range is flushed or unmapped. The pixel store parameters and pixel buffer bindings current when recording starts are
+ * written first, so the replay context starts from the same layout.
+ *
+ * Not captured: writes through persistent mappings that are never flushed or unmapped, calls to entry points the
+ * recorder doesn't know, which are counted in getSkippedCalls(), and objects created before recording started, so
+ * start recording before creating the objects the captured frames use.
+ *
+ * The trace is a header followed by records, with integers as LEB128 varints: function definitions, calls and frame
+ * ends.
+ */
+class TraceRecorder
+{
+public:
+    struct Stats
+    {
+        std::size_t calls{0};
+        /// Calls to unsupported entry points, which weren't recorded.
+        std::size_t skipped_calls{0};
+        std::size_t frames{0};
+        /// Bytes written to the trace so far.
+        std::size_t bytes{0};
+    };
+
+    /// Start recording the calls made on the calling thread to the file at @p path.
+    /**
+     * Throws GL::Error if the file can't be opened or another recorder is active on the thread.
+     */
+    explicit TraceRecorder(const std::string &path);
+
+    /// Stop recording and write out the rest of the trace.
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder &) = delete;
+
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+    /// Mark the end of a frame. The replayer times each frame separately.
+    void endFrame();
+
+    /// Write the buffered part of the trace to the file.
+    void flush();
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+    /// Unsupported entry points called while recording, with their call count.
+    [[nodiscard]]
+    auto getSkippedCalls() const -> const std::unordered_map<std::string, std::size_t> &
+    { return m_skipped_calls; }
+
+    /// Called by the callbacks loadContext() installs, before and after every GL call.
+    void recordBefore(const char *name, std::va_list args);
+
+    void record(void *ret, const char *name, std::va_list args);
+
+private:
+    struct State;
+
+    std::unique_ptr<State> m_state;
+    Stats m_stats;
+    std::unordered_map<std::string, std::size_t> m_skipped_calls;
+};
+
+/// Forward a call to the recorder active on the calling thread, if any.
+void recordTraceBeforeCall(const char *name, std::va_list args);
+
+void recordTraceCall(void *ret, const char *name, std::va_list args);
+
+#endif // GLUTILS_CALL_STATS
+
+/// Re-executes a trace written by TraceRecorder against the current context, and times it frame by frame.
+/**
+ * Any context providing the entry points the trace uses will do, including a headless or software one. Calls to entry
+ * points the context didn't load are skipped and counted. Objects the trace creates and doesn't delete are deleted at
+ * the end of each loop, so loops start from the same state.
+ *
+ * Replay goes straight to the loaded function pointers, bypassing the call callbacks, so it's neither recorded nor
+ * counted by call stats.
+ */
+class TraceReplayer
+{
+public:
+    struct Options
+    {
+        /// Times the trace is replayed.
+        std::size_t loops{1};
+        /// Call glFinish() at the end of each frame, so frame times include the GPU work.
+        bool finish_frames{true};
+    };
+
+    struct Stats
+    {
+        std::size_t frames{0};
+        std::size_t calls{0};
+        /// Calls to entry points the current context didn't load.
+        std::size_t skipped_calls{0};
+        std::chrono::nanoseconds total_time{0};
+        /// Time each replayed frame took, over all loops.
+        std::vector<std::chrono::nanoseconds> frame_times;
+        /// CPU time each frame took when it was recorded, for comparison.
+        std::vector<std::chrono::nanoseconds> recorded_frame_times;
+    };
+
+    /// Map the trace at @p path. Throws GL::Error if it isn't a trace of a supported version.
+    explicit TraceReplayer(const std::string &path);
+
+    /// Replay the trace once, finishing each frame.
+    auto replay() -> Stats;
+
+    auto replay(const Options &options) -> Stats;
+
+private:
+    MappedFile m_file;
+};
+
+} // GL
+
+#endif //GLUTILS_TRACE_HPP
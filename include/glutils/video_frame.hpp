@@ -0,0 +1,137 @@
+#ifndef GLUTILS_VIDEO_FRAME_HPP
+#define GLUTILS_VIDEO_FRAME_HPP
+
+#include "program.hpp"
+#include "texture.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace GL {
+
+/// A ring of decoded video frames kept in their planar YUV form, converted to RGB on the GPU.
+/**
+ * The luma plane of each frame is uploaded into a layer of an r8 2D array texture, and the chroma planes, at half
+ * resolution in both directions, into an rg8 array (NV12) or two r8 arrays (I420). That is 1.5 bytes per pixel instead
+ * of the 4 of converting to RGBA on the CPU. Frames are written to the layers in turn, so a frame can be uploaded
+ * while the previous ones are still being sampled.
+ *
+ * Conversion to RGB is either done while sampling, by including getSamplingSource() in a shader, or by convert(),
+ * which writes a frame into an RGBA texture with a compute shader.
+ */
+class VideoFrameRing
+{
+public:
+    enum class PlaneLayout
+    {
+        /// A Y plane followed by a plane of interleaved U and V samples.
+        nv12,
+        /// Separate Y, U and V planes.
+        i420
+    };
+
+    enum class ColorMatrix
+    {
+        /// ITU-R BT.601, used by standard definition video.
+        bt601,
+        /// ITU-R BT.709, used by high definition video.
+        bt709
+    };
+
+    enum class ColorRange
+    {
+        /// Y in [16, 235] and U, V in [16, 240], as used by most video.
+        limited,
+        /// Every component in [0, 255], as used by JPEG.
+        full
+    };
+
+    struct Options
+    {
+        GLsizei width{0};
+        GLsizei height{0};
+        PlaneLayout layout{PlaneLayout::nv12};
+        ColorMatrix matrix{ColorMatrix::bt709};
+        ColorRange range{ColorRange::limited};
+        /// Number of frames in the ring.
+        GLsizei frame_count{3};
+        /// Format of the textures written by convert(): rgba8, rgba16f or rgba32f.
+        TextureHandle::SizedInternalFormat output_format{TextureHandle::SizedInternalFormat::rgba8};
+    };
+
+    explicit VideoFrameRing(const Options &options);
+
+    /// Upload an NV12 frame into the next layer of the ring.
+    /**
+     * @param luma Y plane, width x height bytes.
+     * @param luma_stride Distance in bytes between rows of the Y plane.
+     * @param chroma Interleaved UV plane, with (width + 1) / 2 pairs per row and (height + 1) / 2 rows.
+     * @param chroma_stride Distance in bytes between rows of the UV plane. Must be even.
+     * @return the layer the frame was written to.
+     */
+    auto uploadNV12(const std::uint8_t *luma, GLsizei luma_stride, const std::uint8_t *chroma,
+                    GLsizei chroma_stride) -> GLint;
+
+    /// Upload an I420 frame into the next layer of the ring. Strides are in bytes.
+    auto uploadI420(const std::uint8_t *y, GLsizei y_stride, const std::uint8_t *u, GLsizei u_stride,
+                    const std::uint8_t *v, GLsizei v_stride) -> GLint;
+
+    /// Bind the plane textures to consecutive texture units: luma, chroma and, for I420, the V plane.
+    void bindTextures(GLuint first_unit = 0) const;
+
+    /// Convert a layer of the ring into @p destination with a compute shader.
+    /**
+     * Binds the plane textures to units 0 and up, and @p destination to image unit 0. Inserts a barrier so that the
+     * result can be sampled afterwards.
+     *
+     * @param layer Layer to convert, as returned by the upload functions.
+     * @param destination 2D texture of Options::output_format and the size of the frames.
+     */
+    void convert(GLint layer, TextureHandle destination) const;
+
+    /// GLSL defining "vec4 sampleVideoFrame(vec2 uv, float layer)" for the given options.
+    /**
+     * The samplers are declared with explicit bindings, starting at @p first_unit, so the source can be pasted into
+     * any shader (after the #version line) and used after bindTextures() with the same unit.
+     */
+    [[nodiscard]]
+    static auto getSamplingSource(const Options &options, GLuint first_unit = 0) -> std::string;
+
+    /// Size in bytes of a single frame's planes.
+    [[nodiscard]]
+    auto getFrameSize() const -> std::size_t;
+
+    /// Layer of the most recently uploaded frame, or -1 if none has been uploaded.
+    [[nodiscard]]
+    auto getLatestLayer() const -> GLint
+    { return m_latest_layer; }
+
+    [[nodiscard]]
+    auto getLumaTexture() const -> TextureHandle
+    { return m_luma; }
+
+    /// The UV texture for NV12; the U (@p index 0) or V (@p index 1) texture for I420.
+    [[nodiscard]]
+    auto getChromaTexture(int index = 0) const -> TextureHandle
+    { return m_chroma[index]; }
+
+    [[nodiscard]]
+    auto getOptions() const -> const Options &
+    { return m_options; }
+
+private:
+    auto nextLayer() -> GLint;
+
+    Options m_options;
+    GLsizei m_chroma_width;
+    GLsizei m_chroma_height;
+    Texture m_luma;
+    Texture m_chroma[2];
+    Program m_convert_program;
+    GLint m_next_layer{0};
+    GLint m_latest_layer{-1};
+};
+
+} // GL
+
+#endif //GLUTILS_VIDEO_FRAME_HPP
@@ -0,0 +1,198 @@
+#ifndef GLUTILS_VIRTUAL_TEXTURE_HPP
+#define GLUTILS_VIRTUAL_TEXTURE_HPP
+
+#include "buffer.hpp"
+#include "sync.hpp"
+#include "texture.hpp"
+#include "tile_residency.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GL {
+
+/// A texture far larger than GPU memory, of which only the visible pages are resident.
+/**
+ * Software virtual texturing, without sparse texture support:
+ * - The virtual texture and each of its mip levels is split into square pages.
+ * - Resident pages are kept in the slots of a physical page cache, a 2D array texture.
+ * - An rgba8ui page table texture, with one texel per page and one level per virtual mip level, holds the cache slot
+ *   of every page. Pages that aren't resident map to their closest resident ancestor, so sampling always finds
+ *   something, at a lower resolution while the page is loading.
+ * - Shaders that sample the texture (see getShaderSource()) also append the pages they needed to a feedback buffer,
+ *   from a subset of pixels.
+ * - update() copies the feedback into a readback buffer and reads it a few frames later, once the copy has completed,
+ *   so the GPU is never waited on. Missing pages are loaded by worker threads with a user supplied PageLoader, coarse
+ *   levels and frequently requested pages first, and uploaded through a TileResidency. Least recently used pages
+ *   are evicted to make room.
+ *
+ * The pages of the coarsest level are loaded first and never evicted.
+ */
+class VirtualTexture
+{
+public:
+    /// A page of the virtual texture: level and position in pages within that level.
+    struct PageId
+    {
+        GLint level{0};
+        GLint x{0};
+        GLint y{0};
+    };
+
+    /// Write the texels of a page, including its border, to @p destination.
+    /**
+     * Called from worker threads. A page has (page_size + 2 * border)^2 texels of Options::data_format and
+     * Options::data_type, covering the page and @p border texels of its neighbours (clamped at the edges of the
+     * texture), so that filtering is seamless across pages.
+     *
+     * @param destination Staging memory for the page, rows @p row_stride bytes apart.
+     * @return false if the page could not be loaded. It will be requested again when it is next seen.
+     */
+    using PageLoader = std::function<bool(const PageId &page, void *destination, GLsizeiptr row_stride)>;
+
+    struct Options
+    {
+        /// Size of level 0 of the virtual texture. Must be a power of two.
+        GLsizei virtual_width{65536};
+        GLsizei virtual_height{65536};
+        /// Texels per side of a page, excluding the border. Must be a power of two.
+        GLsizei page_size{128};
+        /// Texels duplicated from the neighbouring pages on each side.
+        GLsizei border{4};
+
+        /// Slots per row, column and layer of the page cache. At most 256 each.
+        GLsizei cache_pages_x{32};
+        GLsizei cache_pages_y{32};
+        GLsizei cache_layers{1};
+
+        TextureHandle::SizedInternalFormat format{TextureHandle::SizedInternalFormat::rgba8};
+        /// Layout of the data written by the PageLoader.
+        TextureHandle::DataFormat data_format{TextureHandle::DataFormat::rgba};
+        TextureHandle::DataType data_type{TextureHandle::DataType::ubyte};
+
+        /// Size of the staging ring pages are uploaded through. Must hold at least one page with its border.
+        GLsizeiptr staging_size{16 << 20};
+        /// Maximum number of pages started loading per update().
+        GLsizei max_requests_per_frame{32};
+        unsigned int loader_threads{2};
+
+        /// Maximum number of feedback entries per frame.
+        GLuint feedback_capacity{16384};
+        /// One pixel in feedback_rate x feedback_rate writes feedback, at a position that changes every frame.
+        GLuint feedback_rate{8};
+
+        /// Bindings used by bind() and by the shader source.
+        GLuint page_table_unit{0};
+        GLuint cache_unit{1};
+        GLuint feedback_binding{0};
+    };
+
+    struct Stats
+    {
+        /// Pages currently in the cache.
+        std::size_t resident_pages{0};
+        /// Pages being loaded or uploaded.
+        std::size_t loading_pages{0};
+        /// Distinct pages in the last feedback read back.
+        std::size_t requested_pages{0};
+        /// Pages that finished uploading during the last update().
+        std::size_t uploaded_pages{0};
+        /// Pages evicted during the last update().
+        std::size_t evicted_pages{0};
+    };
+
+    VirtualTexture(const Options &options, PageLoader loader);
+
+    /// Stops the loader threads. Must be called on the GL thread.
+    ~VirtualTexture();
+
+    VirtualTexture(const VirtualTexture &) = delete;
+
+    VirtualTexture &operator=(const VirtualTexture &) = delete;
+
+    /// Bind the page table, the page cache and the feedback buffer to the units given in the options.
+    void bind() const;
+
+    /// Read back feedback, schedule page loads, issue finished uploads and update the page table.
+    /**
+     * Call once per frame, after the draws that sample the texture. Never waits for the GPU.
+     */
+    void update();
+
+    /// GLSL defining "vec4 sampleVirtualTexture(vec2 uv)", for fragment shaders.
+    /**
+     * Paste after the #version line (4.50). The function selects the mip level from screen space derivatives, writes
+     * feedback and samples the cache bilinearly from the best resident page.
+     */
+    [[nodiscard]]
+    static auto getShaderSource(const Options &options) -> std::string;
+
+    /// Number of mip levels of the virtual texture, down to a single page.
+    [[nodiscard]]
+    auto getLevelCount() const -> GLsizei
+    { return GLsizei(m_levels.size()); }
+
+    [[nodiscard]]
+    auto getPageTable() const -> TextureHandle
+    { return m_page_table; }
+
+    [[nodiscard]]
+    auto getCacheTexture() const -> TextureHandle
+    { return m_cache; }
+
+    [[nodiscard]]
+    auto getFeedbackBuffer() const -> BufferHandle
+    { return m_feedback; }
+
+    [[nodiscard]]
+    auto getStats() const -> const Stats &
+    { return m_stats; }
+
+    [[nodiscard]]
+    auto getOptions() const -> const Options &
+    { return m_options; }
+
+private:
+    struct Level
+    {
+        GLsizei pages_x;
+        GLsizei pages_y;
+    };
+
+    struct Readback
+    {
+        std::optional<Sync> fence;
+    };
+
+    static auto s_key(const PageId &page) -> std::uint64_t;
+
+    void readFeedback(std::unordered_map<std::uint64_t, std::uint32_t> &requests);
+
+    void requestPages(const std::unordered_map<std::uint64_t, std::uint32_t> &requests);
+
+    Options m_options;
+    PageLoader m_loader;
+    std::vector<Level> m_levels;
+
+    Texture m_cache;
+    Texture m_page_table;
+    Buffer m_feedback;
+    Buffer m_readback;
+    const std::byte *m_readback_mapping{nullptr};
+    std::vector<Readback> m_readbacks;
+    std::size_t m_next_readback{0};
+
+    std::uint64_t m_frame{1};
+    Stats m_stats;
+
+    // last, so that the loader threads stop before the loader is destroyed
+    std::optional<TileResidency> m_residency;
+};
+
+} // GL
+
+#endif //GLUTILS_VIRTUAL_TEXTURE_HPP
@@ -0,0 +1,400 @@
+#include "glutils/brick_cache.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+
+#include "glm/gtc/type_ptr.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace GL {
+
+namespace {
+
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+
+constexpr std::size_t max_levels = 16;
+
+bool isPowerOfTwo(GLsizei value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+auto nextPowerOfTwo(GLsizei value) -> GLsizei
+{
+    GLsizei power = 1;
+    while (power < value)
+        power *= 2;
+    return power;
+}
+
+auto getLevelSize(GLsizei size, GLsizei level) -> GLsizei
+{
+    return std::max(1, size >> level);
+}
+
+auto getResidencyOptions(const BrickCache::Options &options) -> TileResidency::Options
+{
+    TileResidency::Options residency;
+    residency.tile_size = options.brick_size;
+    residency.border = options.border;
+    residency.pool_x = options.pool_bricks_x;
+    residency.pool_y = options.pool_bricks_y;
+    residency.pool_z = options.pool_bricks_z;
+    residency.layered = false;
+    residency.data_format = options.data_format;
+    residency.data_type = options.data_type;
+    residency.staging_size = options.staging_size;
+    residency.loader_threads = options.loader_threads;
+    return residency;
+}
+
+auto validate(const BrickCache::Options &options) -> const BrickCache::Options &
+{
+    if (options.width <= 0 || options.height <= 0 || options.depth <= 0 || options.levels <= 0)
+        throw Error("brick cache volume must have a positive size and level count");
+    if (!isPowerOfTwo(options.brick_size))
+        throw Error("brick size must be a power of two");
+    if (options.border < 0 || options.border > options.brick_size)
+        throw Error("brick border must be between zero and the brick size");
+    if (options.pool_bricks_x <= 0 || options.pool_bricks_x > 256 || options.pool_bricks_y <= 0
+        || options.pool_bricks_y > 256 || options.pool_bricks_z <= 0 || options.pool_bricks_z > 256)
+        throw Error("brick pool dimensions must be between 1 and 256");
+    if (!(options.lod_distance > 0.f))
+        throw Error("brick cache level of detail distance must be positive");
+
+    // the loaders would wait forever for room for a brick
+    if (options.staging_size < TileResidency::getTileBytes(getResidencyOptions(options)))
+        throw Error("brick cache staging size is smaller than a brick");
+    return options;
+}
+
+// Whether any part of the box between lo and hi may be inside the view frustum.
+bool isVisible(const float *matrix, const float *lo, const float *hi)
+{
+    // count the corners outside each of the six clip planes
+    int outside[6]{};
+
+    for (int corner = 0; corner < 8; corner++)
+    {
+        const float x = corner & 1 ? hi[0] : lo[0];
+        const float y = corner & 2 ? hi[1] : lo[1];
+        const float z = corner & 4 ? hi[2] : lo[2];
+
+        float clip[4];
+        for (int row = 0; row < 4; row++)
+            clip[row] = matrix[row] * x + matrix[4 + row] * y + matrix[8 + row] * z + matrix[12 + row];
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            outside[2 * axis] += clip[axis] < -clip[3];
+            outside[2 * axis + 1] += clip[axis] > clip[3];
+        }
+    }
+
+    return std::none_of(std::begin(outside), std::end(outside), [](int count) { return count == 8; });
+}
+
+} // namespace
+
+BrickCache::BrickCache(MappedFile file, const Options &options) :
+        m_options(validate(options)),
+        m_file(std::move(file)),
+        m_voxel_size(TextureHandle::getPixelSize(options.data_format, options.data_type)),
+        m_pool(TextureHandle::Type::_3d),
+        m_indirection(TextureHandle::Type::_3d)
+{
+    const GLsizei brick_size = options.brick_size;
+
+    // the indirection volume is a power of two, so that each of its levels covers the brick grid of that level
+    const GLsizei table_x = nextPowerOfTwo((options.width + brick_size - 1) / brick_size);
+    const GLsizei table_y = nextPowerOfTwo((options.height + brick_size - 1) / brick_size);
+    const GLsizei table_z = nextPowerOfTwo((options.depth + brick_size - 1) / brick_size);
+
+    std::vector<TileResidency::LevelSize> level_sizes;
+    std::size_t offset = options.file_offset;
+    for (GLsizei l = 0; l < options.levels && m_levels.size() < max_levels; l++)
+    {
+        Level level;
+        level.width = getLevelSize(options.width, l);
+        level.height = getLevelSize(options.height, l);
+        level.depth = getLevelSize(options.depth, l);
+        level.bricks_x = (level.width + brick_size - 1) / brick_size;
+        level.bricks_y = (level.height + brick_size - 1) / brick_size;
+        level.bricks_z = (level.depth + brick_size - 1) / brick_size;
+
+        const std::size_t size = std::size_t(level.width) * level.height * level.depth * m_voxel_size;
+        if (offset + size > m_file.getSize())
+            throw Error("volume file is smaller than the levels it should contain");
+        level.data = m_file.getData() + offset;
+        offset += size;
+
+        level_sizes.push_back({level.bricks_x, level.bricks_y, level.bricks_z, getLevelSize(table_x, l),
+                               getLevelSize(table_y, l), getLevelSize(table_z, l)});
+
+        const bool single_brick = level.bricks_x == 1 && level.bricks_y == 1 && level.bricks_z == 1;
+        m_levels.emplace_back(level);
+        if (single_brick)
+            break;
+    }
+
+    const GLsizei slot_size = brick_size + 2 * options.border;
+    m_pool.setStorage3D(1, options.format, options.pool_bricks_x * slot_size, options.pool_bricks_y * slot_size,
+                        options.pool_bricks_z * slot_size);
+    glTextureParameteri(m_pool.getName(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_pool.getName(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_pool.getName(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_pool.getName(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_pool.getName(), GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    m_indirection.setStorage3D(GLsizei(m_levels.size()), SizedInternalFormat::rgba8ui, table_x, table_y, table_z);
+    glTextureParameteri(m_indirection.getName(), GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(m_indirection.getName(), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    const Level &top = m_levels.back();
+    TileResidency::Options residency = getResidencyOptions(options);
+    residency.pin_top_level = std::size_t(top.bricks_x) * top.bricks_y * top.bricks_z * 2
+                              <= std::size_t(options.pool_bricks_x) * options.pool_bricks_y * options.pool_bricks_z;
+
+    m_residency.emplace(m_pool, m_indirection, residency, std::move(level_sizes),
+                        [this](const TileResidency::TileId &tile, void *destination, GLsizeiptr row_stride)
+                        {
+                            copyBrick({tile.level, tile.x, tile.y, tile.z}, static_cast<std::byte *>(destination),
+                                      row_stride);
+                            return true;
+                        });
+
+    // the coarsest level is the fallback for every other brick
+    const GLint top_level = GLint(m_levels.size()) - 1;
+    for (GLint z = 0; z < top.bricks_z; z++)
+        for (GLint y = 0; y < top.bricks_y; y++)
+            for (GLint x = 0; x < top.bricks_x; x++)
+                m_residency->request({top_level, x, y, z});
+}
+
+auto BrickCache::s_key(const BrickId &brick) -> std::uint64_t
+{
+    return std::uint64_t(brick.level) << 60 | std::uint64_t(brick.z) << 40 | std::uint64_t(brick.y) << 20
+           | std::uint64_t(brick.x);
+}
+
+auto BrickCache::getFileSize(const Options &options) -> std::size_t
+{
+    const GLsizeiptr voxel_size = TextureHandle::getPixelSize(options.data_format, options.data_type);
+
+    std::size_t size = options.file_offset;
+    for (GLsizei level = 0; level < options.levels; level++)
+        size += std::size_t(getLevelSize(options.width, level)) * getLevelSize(options.height, level)
+                * getLevelSize(options.depth, level) * voxel_size;
+    return size;
+}
+
+void BrickCache::bind() const
+{
+    TextureHandle::bindTextureUnit(m_options.indirection_unit, m_indirection);
+    TextureHandle::bindTextureUnit(m_options.pool_unit, m_pool);
+}
+
+void BrickCache::update(const glm::mat4 &volume_to_clip, const glm::vec3 &eye)
+{
+    m_stats.requested_bricks = 0;
+    m_visible_hits = 0;
+
+    std::unordered_map<std::uint64_t, Candidate> missing;
+
+    const float eye_position[3]{eye.x, eye.y, eye.z};
+    const GLint top_level = GLint(m_levels.size()) - 1;
+    const Level &top = m_levels.back();
+    for (GLint z = 0; z < top.bricks_z; z++)
+        for (GLint y = 0; y < top.bricks_y; y++)
+            for (GLint x = 0; x < top.bricks_x; x++)
+                selectBricks({top_level, x, y, z}, glm::value_ptr(volume_to_clip), eye_position, missing);
+
+    std::vector<Candidate> sorted;
+    sorted.reserve(missing.size());
+    for (const auto &[key, candidate]: missing)
+        sorted.emplace_back(candidate);
+
+    // coarse bricks first, since they stand in for more of the volume, then the nearest
+    std::sort(sorted.begin(), sorted.end(), [](const Candidate &l, const Candidate &r)
+    {
+        return l.brick.level != r.brick.level ? l.brick.level > r.brick.level : l.distance < r.distance;
+    });
+
+    const std::size_t request_count = std::min(sorted.size(), std::size_t(m_options.max_requests_per_frame));
+    for (std::size_t i = 0; i < request_count; i++)
+    {
+        const BrickId &brick = sorted[i].brick;
+        if (!m_residency->request({brick.level, brick.x, brick.y, brick.z}))
+            break;
+    }
+
+    const TileResidency::Stats residency = m_residency->update();
+
+    m_stats.hit_rate = m_stats.requested_bricks
+                       ? float(m_visible_hits) / float(m_stats.requested_bricks)
+                       : 1.f;
+    m_stats.resident_bricks = residency.resident_tiles;
+    m_stats.loading_bricks = residency.loading_tiles;
+    m_stats.uploaded_bricks = residency.uploaded_tiles;
+    m_stats.evicted_bricks = residency.evicted_tiles;
+    m_stats.bytes_streamed = residency.bytes_streamed;
+}
+
+void BrickCache::selectBricks(const BrickId &brick, const float *volume_to_clip, const float *eye,
+                              std::unordered_map<std::uint64_t, Candidate> &missing)
+{
+    const Level &level = m_levels[brick.level];
+    const GLint position[3]{brick.x, brick.y, brick.z};
+    const GLsizei level_size[3]{level.width, level.height, level.depth};
+    const GLsizei volume_size[3]{m_options.width, m_options.height, m_options.depth};
+
+    float lo[3];
+    float hi[3];
+    float distance_squared = 0.f;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        lo[axis] = float(position[axis] * m_options.brick_size) / float(level_size[axis]);
+        hi[axis] = std::min(float((position[axis] + 1) * m_options.brick_size) / float(level_size[axis]), 1.f);
+
+        // to the closest point of the brick, in level 0 voxels
+        const float offset = (eye[axis] - std::clamp(eye[axis], lo[axis], hi[axis])) * float(volume_size[axis]);
+        distance_squared += offset * offset;
+    }
+
+    if (!isVisible(volume_to_clip, lo, hi))
+        return;
+
+    const float distance = std::sqrt(distance_squared);
+    const GLint wanted_level = distance < m_options.lod_distance
+                               ? 0 : GLint(std::floor(std::log2(distance / m_options.lod_distance))) + 1;
+
+    const std::uint64_t key = s_key(brick);
+    const TileResidency::State state = m_residency->touch({brick.level, brick.x, brick.y, brick.z});
+
+    if (brick.level > wanted_level && brick.level > 0)
+    {
+        // a missing brick is sampled through its closest resident ancestor, so load those on the way down too
+        if (state == TileResidency::State::free)
+            missing.try_emplace(key, Candidate{brick, distance});
+
+        const Level &finer = m_levels[brick.level - 1];
+        for (GLint z = 2 * brick.z; z < std::min(2 * brick.z + 2, finer.bricks_z); z++)
+            for (GLint y = 2 * brick.y; y < std::min(2 * brick.y + 2, finer.bricks_y); y++)
+                for (GLint x = 2 * brick.x; x < std::min(2 * brick.x + 2, finer.bricks_x); x++)
+                    selectBricks({brick.level - 1, x, y, z}, volume_to_clip, eye, missing);
+        return;
+    }
+
+    m_stats.requested_bricks++;
+    if (state == TileResidency::State::free)
+        missing.try_emplace(key, Candidate{brick, distance});
+    else if (state == TileResidency::State::resident)
+        m_visible_hits++;
+}
+
+void BrickCache::copyBrick(const BrickId &brick, std::byte *destination, GLsizeiptr row_stride) const
+{
+    const Level &level = m_levels[brick.level];
+    const GLsizei slot_size = m_options.brick_size + 2 * m_options.border;
+    const auto voxel_size = std::size_t(m_voxel_size);
+
+    const GLint x0 = brick.x * m_options.brick_size - m_options.border;
+    const GLint y0 = brick.y * m_options.brick_size - m_options.border;
+    const GLint z0 = brick.z * m_options.brick_size - m_options.border;
+
+    // voxels past the edges of the level repeat the outermost ones
+    const GLint begin = std::max(x0, 0);
+    const GLint end = std::min(x0 + slot_size, level.width);
+
+    for (GLint z = 0; z < slot_size; z++)
+    {
+        const GLint source_z = std::clamp(z0 + z, 0, level.depth - 1);
+
+        for (GLint y = 0; y < slot_size; y++)
+        {
+            const GLint source_y = std::clamp(y0 + y, 0, level.height - 1);
+            const std::byte *row = level.data
+                                   + (std::size_t(source_z) * level.height + source_y) * level.width * voxel_size;
+            std::byte *out = destination + (std::size_t(z) * slot_size + y) * row_stride;
+
+            for (GLint x = x0; x < begin; x++, out += voxel_size)
+                std::memcpy(out, row, voxel_size);
+
+            std::memcpy(out, row + std::size_t(begin) * voxel_size, std::size_t(end - begin) * voxel_size);
+            out += std::size_t(end - begin) * voxel_size;
+
+            for (GLint x = end; x < x0 + slot_size; x++, out += voxel_size)
+                std::memcpy(out, row + std::size_t(level.width - 1) * voxel_size, voxel_size);
+        }
+    }
+}
+
+auto BrickCache::getShaderSource(const Options &options) -> std::string
+{
+    const GLsizei slot_size = options.brick_size + 2 * options.border;
+
+    // the same levels the constructor streams from
+    std::vector<GLsizei> level_sizes;
+    for (GLsizei level = 0; level < options.levels && level_sizes.size() < 3 * max_levels; level++)
+    {
+        const GLsizei width = getLevelSize(options.width, level);
+        const GLsizei height = getLevelSize(options.height, level);
+        const GLsizei depth = getLevelSize(options.depth, level);
+        level_sizes.insert(level_sizes.end(), {width, height, depth});
+        if (width <= options.brick_size && height <= options.brick_size && depth <= options.brick_size)
+            break;
+    }
+    const std::size_t level_count = level_sizes.size() / 3;
+
+    std::ostringstream src;
+
+    src << "layout(binding = " << options.indirection_unit << ") uniform usampler3D u_bv_indirection;\n"
+           "layout(binding = " << options.pool_unit << ") uniform sampler3D u_bv_pool;\n"
+           "const float bv_brick_size = " << options.brick_size << ".0;\n"
+           "const float bv_border = " << options.border << ".0;\n"
+           "const vec3 bv_pool_size = vec3(" << options.pool_bricks_x * slot_size << ", "
+        << options.pool_bricks_y * slot_size << ", " << options.pool_bricks_z * slot_size << ");\n"
+           "const float bv_lod_distance = " << std::showpoint << options.lod_distance << ";\n"
+           "const int bv_max_level = " << level_count - 1 << ";\n"
+           "const vec3 bv_level_sizes[" << level_count << "] = vec3[](";
+    for (std::size_t level = 0; level < level_count; level++)
+        src << (level ? ", " : "") << "vec3(" << level_sizes[3 * level] << ", " << level_sizes[3 * level + 1] << ", "
+            << level_sizes[3 * level + 2] << ")";
+    src << ");\n"
+        << R"glsl(
+int getBrickVolumeLevel(vec3 uvw, vec3 eye)
+{
+    float distance = length((uvw - eye) * bv_level_sizes[0]);
+    if (distance < bv_lod_distance)
+        return 0;
+    return min(int(floor(log2(distance / bv_lod_distance))) + 1, bv_max_level);
+}
+
+vec4 sampleBrickVolume(vec3 uvw, int level)
+{
+    uvw = clamp(uvw, vec3(0.0), vec3(1.0));
+    level = clamp(level, 0, bv_max_level);
+
+    vec3 bricks = ceil(bv_level_sizes[level] / bv_brick_size);
+    ivec3 brick = ivec3(min(floor(uvw * bv_level_sizes[level] / bv_brick_size), bricks - 1.0));
+    uvec4 entry = texelFetch(u_bv_indirection, brick, level);
+    if (entry.a == 255u)
+        return vec4(0.0);
+
+    // the entry may belong to an ancestor of the brick
+    int mapped = int(entry.a);
+    vec3 in_brick = uvw * bv_level_sizes[mapped] - vec3(brick >> (mapped - level)) * bv_brick_size;
+    in_brick = clamp(in_brick, vec3(0.0), vec3(bv_brick_size));
+
+    vec3 pool_voxel = vec3(entry.xyz) * (bv_brick_size + 2.0 * bv_border) + bv_border + in_brick;
+    return textureLod(u_bv_pool, pool_voxel / bv_pool_size, 0.0);
+}
+)glsl";
+
+    return src.str();
+}
+
+} // GL
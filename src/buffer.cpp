@@ -111,6 +111,16 @@ void BufferHandle::destroy(BufferHandle buffer)
     glDeleteBuffers(1, &buffer.m_name);
 }
 
+void BufferHandle::bind(BufferHandle::Target target) const
+{
+    glBindBuffer(static_cast<GLenum>(target), m_name);
+}
+
+void BufferHandle::unbind(BufferHandle::Target target)
+{
+    glBindBuffer(static_cast<GLenum>(target), 0);
+}
+
 void BufferHandle::bindBase(BufferHandle::IndexedTarget target, GLuint index) const
 {
     glBindBufferBase(static_cast<GLenum>(target), index, m_name);
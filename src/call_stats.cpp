@@ -0,0 +1,168 @@
+#include "glutils/call_stats.hpp"
+
+#if GLUTILS_CALL_STATS
+
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+
+namespace GL {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct CallStatsState
+{
+    bool enabled{false};
+    Clock::time_point call_begin;
+    // keyed by the address of glad's name strings, which are unique per entry point
+    std::unordered_map<const char *, CallStats> frame;
+    std::unordered_map<const char *, CallStats> total;
+    std::vector<CallStats> last_frame;
+};
+
+thread_local CallStatsState t_call_stats;
+
+auto getBucket(std::chrono::nanoseconds duration) -> std::size_t
+{
+    std::size_t bucket = 0;
+    for (auto ns = std::uint64_t(std::max(duration.count(), std::chrono::nanoseconds::rep(0))) >> 7;
+         ns && bucket < call_histogram_buckets - 1; ns >>= 1)
+        bucket++;
+    return bucket;
+}
+
+void add(CallStats &to, const CallStats &from)
+{
+    to.calls += from.calls;
+    to.time += from.time;
+    to.max_time = std::max(to.max_time, from.max_time);
+    for (std::size_t i = 0; i < call_histogram_buckets; i++)
+        to.histogram[i] += from.histogram[i];
+}
+
+void sortByTime(std::vector<CallStats> &stats)
+{
+    std::sort(stats.begin(), stats.end(), [](const CallStats &l, const CallStats &r) { return l.time > r.time; });
+}
+
+} // namespace
+
+void enableCallStats(bool enabled)
+{
+    t_call_stats.enabled = enabled;
+}
+
+auto isCallStatsEnabled() -> bool
+{
+    return t_call_stats.enabled;
+}
+
+void beginCallStats()
+{
+    if (t_call_stats.enabled)
+        t_call_stats.call_begin = Clock::now();
+}
+
+void endCallStats(const char *name)
+{
+    if (!t_call_stats.enabled)
+        return;
+
+    const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now()
+                                                                               - t_call_stats.call_begin);
+    CallStats &stats = t_call_stats.frame.try_emplace(name, CallStats{name}).first->second;
+    stats.calls++;
+    stats.time += duration;
+    stats.max_time = std::max(stats.max_time, duration);
+    stats.histogram[getBucket(duration)]++;
+}
+
+void endCallStatsFrame()
+{
+    t_call_stats.last_frame.clear();
+
+    // entries are zeroed rather than erased, so steady frames don't allocate
+    for (auto &[name, stats]: t_call_stats.frame)
+    {
+        if (!stats.calls)
+            continue;
+
+        t_call_stats.last_frame.push_back(stats);
+        add(t_call_stats.total.try_emplace(name, CallStats{name}).first->second, stats);
+        stats = CallStats{name};
+    }
+
+    sortByTime(t_call_stats.last_frame);
+}
+
+auto getFrameCallStats() -> std::vector<CallStats>
+{
+    return t_call_stats.last_frame;
+}
+
+auto getTotalCallStats() -> std::vector<CallStats>
+{
+    std::vector<CallStats> stats;
+    stats.reserve(t_call_stats.total.size());
+    for (const auto &[name, entry]: t_call_stats.total)
+        stats.push_back(entry);
+
+    sortByTime(stats);
+    return stats;
+}
+
+void resetCallStats()
+{
+    t_call_stats.frame.clear();
+    t_call_stats.total.clear();
+    t_call_stats.last_frame.clear();
+}
+
+void writeCallStats(std::ostream &out, const std::vector<CallStats> &stats, std::size_t max_rows)
+{
+    std::chrono::nanoseconds total_time{0};
+    std::uint64_t total_calls = 0;
+    for (const CallStats &entry: stats)
+    {
+        total_time += entry.time;
+        total_calls += entry.calls;
+    }
+
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+
+    out << std::left << std::setw(36) << "function" << std::right << std::setw(10) << "calls" << std::setw(12)
+        << "total us" << std::setw(8) << "%" << std::setw(10) << "avg ns" << std::setw(10) << "max ns"
+        << "  histogram (<128ns, x2 per bucket)\n";
+
+    for (std::size_t row = 0; row < stats.size() && row < max_rows; row++)
+    {
+        const CallStats &entry = stats[row];
+        out << std::left << std::setw(36) << entry.name << std::right << std::setw(10) << entry.calls
+            << std::setw(12) << double(entry.time.count()) / 1000. << std::setw(8)
+            << (total_time.count() ? 100. * double(entry.time.count()) / double(total_time.count()) : 0.)
+            << std::setw(10) << double(entry.time.count()) / double(entry.calls) << std::setw(10)
+            << entry.max_time.count() << " ";
+
+        // trailing empty buckets aren't printed
+        std::size_t last = call_histogram_buckets;
+        while (last > 0 && !entry.histogram[last - 1])
+            last--;
+        for (std::size_t i = 0; i < last; i++)
+            out << ' ' << entry.histogram[i];
+        out << '\n';
+    }
+
+    out << std::left << std::setw(36) << "total" << std::right << std::setw(10) << total_calls << std::setw(12)
+        << double(total_time.count()) / 1000. << '\n';
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // GL
+
+#endif // GLUTILS_CALL_STATS
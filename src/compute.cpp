@@ -0,0 +1,16 @@
+#include "glutils/compute.hpp"
+#include "glutils/gl.hpp"
+
+namespace GL {
+
+void dispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z)
+{
+    glDispatchCompute(num_groups_x, num_groups_y, num_groups_z);
+}
+
+void dispatchComputeIndirect(GLintptr indirect)
+{
+    glDispatchComputeIndirect(indirect);
+}
+
+} // GL
@@ -0,0 +1,429 @@
+#include "glutils/compute_downsample.hpp"
+#include "glutils/compute.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+#include "glutils/memory_barrier.hpp"
+#include "glutils/mipmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace GL {
+
+namespace {
+
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+using Reduction = ComputeDownsampler::Reduction;
+
+constexpr GLuint group_size = 8;
+constexpr GLsizei max_levels_per_dispatch = 4;
+
+enum class ComponentKind
+{
+    floating,
+    signed_integer,
+    unsigned_integer
+};
+
+struct ImageFormatInfo
+{
+    const char *qualifier;
+    ComponentKind kind;
+};
+
+auto getImageFormatInfo(SizedInternalFormat format) -> ImageFormatInfo
+{
+    using K = ComponentKind;
+
+    switch (format)
+    {
+#define FORMAT_CASE(FORMAT, KIND) case SizedInternalFormat::FORMAT: return {#FORMAT, KIND};
+        FORMAT_CASE(rgba32f, K::floating)
+        FORMAT_CASE(rgba16f, K::floating)
+        FORMAT_CASE(rg32f, K::floating)
+        FORMAT_CASE(rg16f, K::floating)
+        FORMAT_CASE(r11f_g11f_b10f, K::floating)
+        FORMAT_CASE(r32f, K::floating)
+        FORMAT_CASE(r16f, K::floating)
+        FORMAT_CASE(rgba16, K::floating)
+        FORMAT_CASE(rgb10_a2, K::floating)
+        FORMAT_CASE(rgba8, K::floating)
+        FORMAT_CASE(rg16, K::floating)
+        FORMAT_CASE(rg8, K::floating)
+        FORMAT_CASE(r16, K::floating)
+        FORMAT_CASE(r8, K::floating)
+        FORMAT_CASE(rgba8_snorm, K::floating)
+        FORMAT_CASE(rg16_snorm, K::floating)
+        FORMAT_CASE(rg8_snorm, K::floating)
+        FORMAT_CASE(r16_snorm, K::floating)
+        FORMAT_CASE(r8_snorm, K::floating)
+        FORMAT_CASE(rgba32i, K::signed_integer)
+        FORMAT_CASE(rgba16i, K::signed_integer)
+        FORMAT_CASE(rgba8i, K::signed_integer)
+        FORMAT_CASE(rg32i, K::signed_integer)
+        FORMAT_CASE(rg16i, K::signed_integer)
+        FORMAT_CASE(rg8i, K::signed_integer)
+        FORMAT_CASE(r32i, K::signed_integer)
+        FORMAT_CASE(r16i, K::signed_integer)
+        FORMAT_CASE(r8i, K::signed_integer)
+        FORMAT_CASE(rgba32ui, K::unsigned_integer)
+        FORMAT_CASE(rgba16ui, K::unsigned_integer)
+        FORMAT_CASE(rgb10_a2ui, K::unsigned_integer)
+        FORMAT_CASE(rgba8ui, K::unsigned_integer)
+        FORMAT_CASE(rg32ui, K::unsigned_integer)
+        FORMAT_CASE(rg16ui, K::unsigned_integer)
+        FORMAT_CASE(rg8ui, K::unsigned_integer)
+        FORMAT_CASE(r32ui, K::unsigned_integer)
+        FORMAT_CASE(r16ui, K::unsigned_integer)
+        FORMAT_CASE(r8ui, K::unsigned_integer)
+#undef FORMAT_CASE
+        default:
+            throw Error("texture format can't be used for image load/store");
+    }
+}
+
+// Calls fn(first_level_offset, level_count, source_width, source_height) for each dispatch.
+template<typename Fn>
+void forEachDispatch(GLsizei width, GLsizei height, GLsizei level_count, Fn &&fn)
+{
+    if (level_count <= 0)
+        level_count = getMipLevelCount(width, height);
+
+    GLsizei remaining = level_count - 1;
+    GLint level = 0;
+
+    while (remaining > 0)
+    {
+        GLsizei count = 1;
+        GLsizei last_width = std::max(1, width / 2);
+        GLsizei last_height = std::max(1, height / 2);
+
+        // further levels can be reduced in shared memory only while they halve exactly
+        while (count < max_levels_per_dispatch && count < remaining && last_width % 2 == 0 && last_height % 2 == 0)
+        {
+            last_width /= 2;
+            last_height /= 2;
+            count++;
+        }
+
+        fn(level, count, width, height);
+
+        level += count;
+        remaining -= count;
+        width = last_width;
+        height = last_height;
+    }
+}
+
+template<typename T>
+auto reduceLevel(const std::vector<T> &source, GLsizei width, GLsizei height,
+                 Reduction reduction) -> std::vector<T>
+{
+    if (reduction == Reduction::custom)
+        throw Error("custom reductions have no CPU reference");
+
+    const GLsizei out_width = std::max(1, width / 2);
+    const GLsizei out_height = std::max(1, height / 2);
+    std::vector<T> result(std::size_t(out_width) * out_height * 4);
+
+    for (GLsizei y = 0; y < out_height; y++)
+    {
+        for (GLsizei x = 0; x < out_width; x++)
+        {
+            // same footprint and evaluation order as the shader
+            const GLsizei extent_x = (width % 2 && x == width / 2 - 1) ? 3 : 2;
+            const GLsizei extent_y = (height % 2 && y == height / 2 - 1) ? 3 : 2;
+
+            for (int c = 0; c < 4; c++)
+            {
+                T value{};
+                int count = 0;
+
+                for (GLsizei j = 0; j < extent_y; j++)
+                {
+                    for (GLsizei i = 0; i < extent_x; i++)
+                    {
+                        const GLsizei sx = std::min(2 * x + i, width - 1);
+                        const GLsizei sy = std::min(2 * y + j, height - 1);
+                        const T texel = source[(std::size_t(sy) * width + sx) * 4 + c];
+
+                        if (count++ == 0)
+                            value = texel;
+                        else if (reduction == Reduction::average)
+                            value = value + texel;
+                        else if (reduction == Reduction::minimum)
+                            value = std::min(value, texel);
+                        else
+                            value = std::max(value, texel);
+                    }
+                }
+
+                if (reduction == Reduction::average)
+                    value = value / T(count);
+
+                result[(std::size_t(y) * out_width + x) * 4 + c] = value;
+            }
+        }
+    }
+
+    return result;
+}
+
+// Read a level back as four components per texel, as the reference functions take them.
+template<typename T>
+auto readLevel(TextureHandle texture, GLint level, GLsizei width, GLsizei height, GLenum format, GLenum type)
+        -> std::vector<T>
+{
+    std::vector<T> texels(std::size_t(width) * height * 4);
+    glGetTextureImage(texture.getName(), level, format, type, GLsizei(texels.size() * sizeof(T)), texels.data());
+    return texels;
+}
+
+// Compare every level generate() wrote with the reduction of the level above it.
+template<typename T>
+void verifyLevels(TextureHandle texture, GLsizei width, GLsizei height, GLint base_level, GLsizei level_count,
+                  Reduction reduction, GLenum format, GLenum type, ComputeDownsampler::Verification &result)
+{
+    std::vector<T> source = readLevel<T>(texture, base_level, width, height, format, type);
+
+    for (GLsizei level = 1; level < level_count; level++)
+    {
+        const std::vector<T> expected = ComputeDownsampler::reduceReference(source, width, height, reduction);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        source = readLevel<T>(texture, base_level + level, width, height, format, type);
+
+        for (std::size_t i = 0; i < expected.size(); i++)
+        {
+            const double error = std::abs(double(source[i]) - double(expected[i]));
+            if (error > result.max_error)
+            {
+                result.max_error = error;
+                result.worst_level = base_level + level;
+            }
+        }
+    }
+}
+
+} // namespace
+
+ComputeDownsampler::ComputeDownsampler(const Options &options) :
+        m_options(options),
+        m_program(buildProgram({{ShaderHandle::Type::compute, getShaderSource(options)}}))
+{}
+
+auto ComputeDownsampler::getShaderSource(const Options &options) -> std::string
+{
+    const ImageFormatInfo format = getImageFormatInfo(options.format);
+    const char *vec_type = "vec4";
+    const char *image_type = "image2D";
+
+    if (format.kind == ComponentKind::signed_integer)
+    {
+        vec_type = "ivec4";
+        image_type = "iimage2D";
+    }
+    else if (format.kind == ComponentKind::unsigned_integer)
+    {
+        vec_type = "uvec4";
+        image_type = "uimage2D";
+    }
+
+    std::ostringstream src;
+
+    src << "#version 450\n"
+           "#define VEC " << vec_type << "\n"
+           "layout(local_size_x = " << group_size << ", local_size_y = " << group_size << ") in;\n"
+           "layout(binding = 0, " << format.qualifier << ") uniform restrict readonly " << image_type
+        << " u_source;\n";
+
+    for (int level = 1; level <= max_levels_per_dispatch; level++)
+        src << "layout(binding = " << level << ", " << format.qualifier << ") uniform restrict writeonly "
+            << image_type << " u_level" << level << ";\n";
+
+    src << "layout(location = 0) uniform ivec2 u_source_size;\n"
+           "layout(location = 1) uniform int u_level_count;\n"
+           "shared VEC s_values[" << group_size << "][" << group_size << "];\n";
+
+    switch (options.reduction)
+    {
+        case Reduction::average:
+            src << "VEC combine(VEC a, VEC b) { return a + b; }\n"
+                   "VEC finalize(VEC v, int n) { return v / VEC(n); }\n";
+            break;
+        case Reduction::minimum:
+            src << "VEC combine(VEC a, VEC b) { return min(a, b); }\n"
+                   "VEC finalize(VEC v, int n) { return v; }\n";
+            break;
+        case Reduction::maximum:
+            src << "VEC combine(VEC a, VEC b) { return max(a, b); }\n"
+                   "VEC finalize(VEC v, int n) { return v; }\n";
+            break;
+        case Reduction::custom:
+            src << options.custom_combine << "\n"
+                   "VEC finalize(VEC v, int n) { return v; }\n";
+            break;
+    }
+
+    src << R"glsl(
+VEC reduceSource(ivec2 p)
+{
+    // texels at the edge of an odd sized source also take in its last row/column
+    ivec2 extent = ivec2(2);
+    if ((u_source_size.x & 1) != 0 && p.x == u_source_size.x / 2 - 1) extent.x = 3;
+    if ((u_source_size.y & 1) != 0 && p.y == u_source_size.y / 2 - 1) extent.y = 3;
+
+    ivec2 last = u_source_size - 1;
+    VEC value = imageLoad(u_source, min(p * 2, last));
+    int count = 1;
+
+    for (int j = 0; j < extent.y; j++)
+        for (int i = 0; i < extent.x; i++)
+            if (i != 0 || j != 0)
+            {
+                value = combine(value, imageLoad(u_source, min(p * 2 + ivec2(i, j), last)));
+                count++;
+            }
+
+    return finalize(value, count);
+}
+
+void storeLevel(int level, ivec2 p, VEC value)
+{
+    if (level == 2) imageStore(u_level2, p, value);
+    else if (level == 3) imageStore(u_level3, p, value);
+    else if (level == 4) imageStore(u_level4, p, value);
+}
+
+void main()
+{
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    ivec2 group = ivec2(gl_WorkGroupID.xy);
+    ivec2 size = max(u_source_size / 2, ivec2(1));
+    ivec2 p = group * int(gl_WorkGroupSize.x) + local;
+
+    VEC value = reduceSource(p);
+    if (all(lessThan(p, size)))
+        imageStore(u_level1, p, value);
+    s_values[local.y][local.x] = value;
+
+    int tile = int(gl_WorkGroupSize.x);
+    for (int level = 2; level <= u_level_count; level++)
+    {
+        tile /= 2;
+        size /= 2;
+        bool active = all(lessThan(local, ivec2(tile)));
+        ivec2 s = local * 2;
+
+        barrier();
+        if (active)
+            value = finalize(combine(combine(combine(s_values[s.y][s.x], s_values[s.y][s.x + 1]),
+                                             s_values[s.y + 1][s.x]), s_values[s.y + 1][s.x + 1]), 4);
+        barrier();
+
+        if (active)
+        {
+            s_values[local.y][local.x] = value;
+            ivec2 q = group * tile + local;
+            if (all(lessThan(q, size)))
+                storeLevel(level, q, value);
+        }
+    }
+}
+)glsl";
+
+    return src.str();
+}
+
+void ComputeDownsampler::generate(TextureHandle texture, GLsizei width, GLsizei height, GLint base_level,
+                                  GLsizei level_count) const
+{
+    using Access = TextureHandle::ImageAccess;
+
+    m_program.use();
+
+    forEachDispatch(width, height, level_count,
+                    [&](GLint level, GLsizei count, GLsizei source_width, GLsizei source_height)
+                    {
+                        if (level > 0)
+                            memoryBarrier(MemoryBarrierBits::shader_image_access);
+
+                        const GLint source_level = base_level + level;
+                        texture.bindImage(0, source_level, false, 0, Access::read_only, m_options.format);
+
+                        // unused units are bound to the last level; the shader never writes to them
+                        for (GLsizei i = 1; i <= max_levels_per_dispatch; i++)
+                            texture.bindImage(i, source_level + std::min(i, count), false, 0, Access::write_only,
+                                              m_options.format);
+
+                        glProgramUniform2i(m_program.getName(), 0, source_width, source_height);
+                        glProgramUniform1i(m_program.getName(), 1, count);
+
+                        const GLsizei first_width = std::max(1, source_width / 2);
+                        const GLsizei first_height = std::max(1, source_height / 2);
+                        dispatchCompute((first_width + group_size - 1) / group_size,
+                                        (first_height + group_size - 1) / group_size);
+                    });
+
+    memoryBarrier(MemoryBarrierBits::texture_fetch | MemoryBarrierBits::shader_image_access);
+}
+
+auto ComputeDownsampler::getDispatchCount(GLsizei width, GLsizei height, GLsizei level_count) -> GLsizei
+{
+    GLsizei dispatches = 0;
+    forEachDispatch(width, height, level_count, [&](GLint, GLsizei, GLsizei, GLsizei) { dispatches++; });
+    return dispatches;
+}
+
+auto ComputeDownsampler::verify(TextureHandle texture, GLsizei width, GLsizei height, GLint base_level,
+                                GLsizei level_count, double tolerance) const -> Verification
+{
+    if (m_options.reduction == Reduction::custom)
+        throw Error("custom reductions have no CPU reference");
+    if (level_count <= 0)
+        level_count = getMipLevelCount(width, height);
+
+    generate(texture, width, height, base_level, level_count);
+    memoryBarrier(MemoryBarrierBits::texture_update);
+
+    Verification result;
+    switch (getImageFormatInfo(m_options.format).kind)
+    {
+        case ComponentKind::floating:
+            verifyLevels<float>(texture, width, height, base_level, level_count, m_options.reduction, GL_RGBA,
+                                GL_FLOAT, result);
+            break;
+        case ComponentKind::signed_integer:
+            verifyLevels<std::int32_t>(texture, width, height, base_level, level_count, m_options.reduction,
+                                       GL_RGBA_INTEGER, GL_INT, result);
+            break;
+        case ComponentKind::unsigned_integer:
+            verifyLevels<std::uint32_t>(texture, width, height, base_level, level_count, m_options.reduction,
+                                        GL_RGBA_INTEGER, GL_UNSIGNED_INT, result);
+            break;
+    }
+
+    result.passed = result.max_error <= tolerance;
+    return result;
+}
+
+auto ComputeDownsampler::reduceReference(const std::vector<float> &source, GLsizei width, GLsizei height,
+                                         Reduction reduction) -> std::vector<float>
+{
+    return reduceLevel(source, width, height, reduction);
+}
+
+auto ComputeDownsampler::reduceReference(const std::vector<std::int32_t> &source, GLsizei width, GLsizei height,
+                                         Reduction reduction) -> std::vector<std::int32_t>
+{
+    return reduceLevel(source, width, height, reduction);
+}
+
+auto ComputeDownsampler::reduceReference(const std::vector<std::uint32_t> &source, GLsizei width, GLsizei height,
+                                         Reduction reduction) -> std::vector<std::uint32_t>
+{
+    return reduceLevel(source, width, height, reduction);
+}
+
+} // GL
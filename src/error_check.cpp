@@ -0,0 +1,349 @@
+#include "glutils/error_check.hpp"
+#include "glutils/error.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace GL {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// glGetError() can keep returning GL_CONTEXT_LOST; stop after this many codes
+constexpr int max_errors_per_check = 8;
+// calls timed to measure the per-call bookkeeping
+constexpr int calibration_calls = 4096;
+
+struct ErrorCheckState
+{
+    bool enabled{false};
+    ErrorCheckOptions options;
+    ErrorCheckStats stats;
+    std::uint64_t next_check{0};
+    std::uint64_t last_check{0};
+    std::uint64_t checked_until{0};
+    // calls and time as of the last sampled check
+    std::uint64_t last_sample{0};
+    Clock::time_point last_check_time;
+    // seconds of bookkeeping per call
+    double call_cost{0.};
+    std::vector<const char *> history;
+};
+
+thread_local ErrorCheckState t_error_check;
+
+auto getErrorString(GLenum error) -> const char *
+{
+    switch (error)
+    {
+#define ERROR_CASE(CASE) case GL_##CASE: return "GL_" #CASE;
+        ERROR_CASE(INVALID_ENUM)
+        ERROR_CASE(INVALID_VALUE)
+        ERROR_CASE(INVALID_OPERATION)
+        ERROR_CASE(STACK_OVERFLOW)
+        ERROR_CASE(STACK_UNDERFLOW)
+        ERROR_CASE(OUT_OF_MEMORY)
+        ERROR_CASE(INVALID_FRAMEBUFFER_OPERATION)
+        ERROR_CASE(CONTEXT_LOST)
+#undef ERROR_CASE
+        default:
+            return "unknown GL error";
+    }
+}
+
+auto getRecentCalls() -> std::vector<const char *>
+{
+    const ErrorCheckState &state = t_error_check;
+    const std::size_t size = state.history.size();
+    const std::uint64_t count = std::min<std::uint64_t>(state.stats.calls - state.last_check, size);
+
+    std::vector<const char *> calls;
+    calls.reserve(count);
+    for (std::uint64_t i = state.stats.calls - count; i < state.stats.calls; i++)
+        calls.push_back(state.history[i % size]);
+    return calls;
+}
+
+void report(const ErrorReport &error_report)
+{
+    t_error_check.stats.errors++;
+
+    if (t_error_check.options.handler)
+    {
+        t_error_check.options.handler(error_report);
+        return;
+    }
+
+    std::string message = getErrorString(error_report.error);
+    if (error_report.call)
+        message += std::string(" in ") + error_report.call;
+    if (error_report.checkpoint)
+        message += std::string(" before checkpoint ") + error_report.checkpoint;
+    if (!error_report.call && !error_report.recent_calls.empty())
+    {
+        message += ", raised by one of:";
+        for (const char *call: error_report.recent_calls)
+            message += std::string(" ") + call;
+    }
+    throw Error(message);
+}
+
+// Report every error pending; true if there was any.
+auto check(const char *call, const char *checkpoint) -> bool
+{
+    ErrorCheckState &state = t_error_check;
+    state.stats.checks++;
+
+    // the raw pointer, so that the check doesn't go through the call callbacks itself
+    GLenum error = glad_glGetError();
+    if (error == GL_NO_ERROR)
+    {
+        state.last_check = state.stats.calls;
+        return false;
+    }
+
+    ErrorReport error_report{error, call, checkpoint, getRecentCalls()};
+    state.last_check = state.stats.calls;
+
+    // a report may throw; errors left pending are reported by the next check
+    for (int i = 0; i < max_errors_per_check && error != GL_NO_ERROR; i++)
+    {
+        error_report.error = error;
+        report(error_report);
+        error = glad_glGetError();
+    }
+    return true;
+}
+
+// Count a call, and check for errors if it's time to sample or the call is being bisected.
+void countCall(const char *name)
+{
+    ErrorCheckState &state = t_error_check;
+    if (!state.enabled)
+        return;
+
+    state.history[state.stats.calls % state.history.size()] = name;
+    state.stats.calls++;
+
+    if (state.stats.calls <= state.checked_until)
+    {
+        check(name, nullptr);
+        return;
+    }
+
+    if (state.stats.calls < state.next_check)
+        return;
+
+    const auto begin = Clock::now();
+    const bool found = check(nullptr, nullptr);
+    const auto end = Clock::now();
+
+    if (found)
+        state.checked_until = state.stats.calls + state.options.bisect_calls;
+
+    // the bookkeeping of the calls since the last sample is paid whatever the interval; glGetError() gets the rest
+    const double check_cost = std::chrono::duration<double>(end - begin).count();
+    const double calls_cost = double(state.stats.calls - state.last_sample) * state.call_cost;
+    const double period = std::chrono::duration<double>(end - state.last_check_time).count();
+    const double budget = state.options.overhead_budget * period - calls_cost;
+    if (check_cost > budget)
+        state.stats.interval = std::uint32_t(std::min<std::uint64_t>(std::uint64_t(state.stats.interval) * 2,
+                                                                       state.options.max_interval));
+    else if (4 * check_cost < budget)
+        state.stats.interval = std::max(state.stats.interval / 2, state.options.min_interval);
+
+    state.stats.overhead = period > 0. ? (check_cost + calls_cost) / period : 0.;
+    state.last_sample = state.stats.calls;
+    state.last_check_time = end;
+    state.next_check = state.stats.calls + state.stats.interval;
+}
+
+#if !GLUTILS_CALL_STATS
+
+// Release builds see calls through wrappers swapped in for glad's function pointers.
+template<auto *pointer>
+struct Hook;
+
+template<typename R, typename... Args, R (GLAD_API_PTR **pointer)(Args...)>
+struct Hook<pointer>
+{
+    static inline R (GLAD_API_PTR *original)(Args...) = nullptr;
+    static inline const char *name = nullptr;
+
+    static auto GLAD_API_PTR call(Args... args) -> R
+    {
+        if constexpr (std::is_void_v<R>)
+        {
+            original(args...);
+            countCall(name);
+        }
+        else
+        {
+            const R ret = original(args...);
+            countCall(name);
+            return ret;
+        }
+    }
+
+    static void install(const char *call_name)
+    {
+        // after a context load the pointer holds the new entry point; entry points that didn't load stay null
+        if (*pointer != call)
+            original = *pointer;
+        name = call_name;
+        if (original)
+            *pointer = call;
+    }
+};
+
+#define HOOKED_CALLS(X) \
+    X(glDrawArrays) X(glDrawArraysInstanced) X(glDrawArraysInstancedBaseInstance) X(glDrawElements) \
+    X(glDrawElementsInstanced) X(glDrawElementsBaseVertex) X(glDrawElementsInstancedBaseVertexBaseInstance) \
+    X(glDrawArraysIndirect) X(glDrawElementsIndirect) X(glMultiDrawArraysIndirect) X(glMultiDrawElementsIndirect) \
+    X(glDispatchCompute) X(glDispatchComputeIndirect) X(glMemoryBarrier) \
+    X(glClear) X(glClearNamedFramebufferfv) X(glClearNamedBufferSubData) X(glClearTexImage) \
+    X(glBlitNamedFramebuffer) X(glCopyImageSubData) X(glCopyNamedBufferSubData) X(glReadPixels) \
+    X(glCreateBuffers) X(glDeleteBuffers) X(glNamedBufferStorage) X(glNamedBufferData) X(glNamedBufferSubData) \
+    X(glMapNamedBufferRange) X(glUnmapNamedBuffer) X(glFlushMappedNamedBufferRange) \
+    X(glBindBuffer) X(glBindBufferBase) X(glBindBufferRange) \
+    X(glCreateTextures) X(glDeleteTextures) X(glTextureStorage1D) X(glTextureStorage2D) X(glTextureStorage3D) \
+    X(glTextureSubImage1D) X(glTextureSubImage2D) X(glTextureSubImage3D) X(glCompressedTextureSubImage2D) \
+    X(glCompressedTextureSubImage3D) X(glGetTextureImage) X(glTextureParameteri) X(glGenerateTextureMipmap) \
+    X(glBindTextureUnit) X(glBindImageTexture) X(glPixelStorei) \
+    X(glCreateSamplers) X(glDeleteSamplers) X(glSamplerParameteri) X(glBindSampler) \
+    X(glUseProgram) X(glLinkProgram) X(glProgramUniform1i) X(glProgramUniform1f) X(glProgramUniform4fv) \
+    X(glProgramUniformMatrix4fv) \
+    X(glCreateVertexArrays) X(glDeleteVertexArrays) X(glBindVertexArray) X(glVertexArrayVertexBuffer) \
+    X(glVertexArrayElementBuffer) X(glVertexArrayAttribFormat) X(glVertexArrayAttribBinding) \
+    X(glEnableVertexArrayAttrib) \
+    X(glCreateFramebuffers) X(glDeleteFramebuffers) X(glBindFramebuffer) X(glNamedFramebufferTexture) \
+    X(glNamedFramebufferDrawBuffers) \
+    X(glEnable) X(glDisable) X(glViewport) X(glFenceSync) X(glClientWaitSync)
+
+void GLAD_API_PTR doNothing()
+{}
+
+// measured through a hook like any other call
+void (GLAD_API_PTR *g_calibration_call)() = doNothing;
+
+bool g_hooks_installed = false;
+
+void installHooks()
+{
+#define INSTALL_HOOK(NAME) Hook<&glad_##NAME>::install(#NAME);
+    HOOKED_CALLS(INSTALL_HOOK)
+#undef INSTALL_HOOK
+    Hook<&g_calibration_call>::install("calibration");
+    g_hooks_installed = true;
+}
+
+void makeCalibrationCall()
+{
+    g_calibration_call();
+}
+
+#else
+
+void makeCalibrationCall()
+{
+    checkErrorsAfterCall("calibration");
+}
+
+#endif // !GLUTILS_CALL_STATS
+
+// Time the bookkeeping of calibration_calls calls that never reach a check, and leave the counters as they were.
+auto measureCallCost() -> double
+{
+    ErrorCheckState &state = t_error_check;
+    const std::uint64_t calls = state.stats.calls;
+    const std::uint64_t next_check = state.next_check;
+    const std::uint64_t checked_until = state.checked_until;
+    state.next_check = std::numeric_limits<std::uint64_t>::max();
+    state.checked_until = 0;
+
+    const auto begin = Clock::now();
+    for (int i = 0; i < calibration_calls; i++)
+        makeCalibrationCall();
+    const auto end = Clock::now();
+
+    state.stats.calls = calls;
+    state.next_check = next_check;
+    state.checked_until = checked_until;
+    std::fill(state.history.begin(), state.history.end(), "");
+
+    return std::chrono::duration<double>(end - begin).count() / calibration_calls;
+}
+
+} // namespace
+
+void enableErrorChecks()
+{
+    enableErrorChecks(ErrorCheckOptions{});
+}
+
+void enableErrorChecks(const ErrorCheckOptions &options)
+{
+    if (options.min_interval == 0 || options.max_interval < options.min_interval || options.history_size == 0)
+        throw Error("error check intervals and history size must be positive");
+
+    ErrorCheckState &state = t_error_check;
+    state.enabled = true;
+    state.options = options;
+    state.stats.interval = options.min_interval;
+    state.next_check = state.stats.calls + options.min_interval;
+    state.last_check = state.stats.calls;
+    state.checked_until = 0;
+    state.history.assign(options.history_size, "");
+
+#if !GLUTILS_CALL_STATS
+    if (!g_hooks_installed)
+        installHooks();
+#endif // !GLUTILS_CALL_STATS
+
+    state.call_cost = measureCallCost();
+    state.last_sample = state.stats.calls;
+    state.last_check_time = Clock::now();
+}
+
+void disableErrorChecks()
+{
+    t_error_check.enabled = false;
+}
+
+auto areErrorChecksEnabled() -> bool
+{
+    return t_error_check.enabled;
+}
+
+void checkErrors(const char *checkpoint)
+{
+    check(nullptr, checkpoint);
+}
+
+auto getErrorCheckStats() -> ErrorCheckStats
+{
+    return t_error_check.stats;
+}
+
+#if GLUTILS_CALL_STATS
+
+void checkErrorsAfterCall(const char *name)
+{
+    countCall(name);
+}
+
+#else
+
+void hookErrorCheckCalls()
+{
+    if (g_hooks_installed)
+        installHooks();
+}
+
+#endif // GLUTILS_CALL_STATS
+
+} // GL
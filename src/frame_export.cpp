@@ -0,0 +1,271 @@
+#include "glutils/frame_export.hpp"
+
+#if defined(__linux__)
+
+#include "glutils/error.hpp"
+
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace GL {
+
+namespace {
+
+using Conversion = ReadbackRing::Conversion;
+using Options = FrameExporter::Options;
+
+constexpr std::size_t slot_alignment = 64;
+
+constexpr auto alignUp(std::size_t value, std::size_t alignment) -> std::size_t
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+auto getTime() -> std::int64_t
+{
+    timespec time{};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return std::int64_t(time.tv_sec) * 1'000'000'000 + time.tv_nsec;
+}
+
+// Largest readback of a frame; matches the layouts ReadbackRing produces.
+auto getFrameSize(const Options &options) -> std::size_t
+{
+    const std::size_t width = options.width;
+    const std::size_t height = options.height;
+
+    switch (options.conversion)
+    {
+        case Conversion::rgba8:
+            return width * height * 4;
+        case Conversion::nv12:
+            return alignUp(width, 4) * height + alignUp((width + 1) / 2 * 2, 4) * ((height + 1) / 2);
+        default:
+            return alignUp(width * TextureHandle::getPixelSize(options.format, options.type), 4) * height;
+    }
+}
+
+auto getSlots(std::byte *shared) -> SharedFrameRing::Slot *
+{
+    return reinterpret_cast<SharedFrameRing::Slot *>(shared + sizeof(SharedFrameRing::Header));
+}
+
+auto futex(std::atomic<std::uint32_t> &word, int operation, std::uint32_t value, const timespec *timeout) -> long
+{
+    // the futex word is shared between processes, so the operations must not be the private variants
+    return syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), operation, value, timeout, nullptr, 0);
+}
+
+auto validate(const Options &options) -> const Options &
+{
+    if (options.width <= 0 || options.height <= 0 || options.slot_count == 0 || options.readback_frames == 0)
+        throw Error("frame exporter must have a positive size, slot count and readback frame count");
+    return options;
+}
+
+} // namespace
+
+FrameExporter::FrameExporter(const Options &options) :
+        m_options(validate(options)),
+        m_readback(GLsizeiptr(alignUp(getFrameSize(options), 16) * options.readback_frames))
+{
+    using namespace SharedFrameRing;
+
+    const std::size_t slot_size = alignUp(getFrameSize(options), slot_alignment);
+    const std::size_t data_offset = alignUp(sizeof(Header) + sizeof(Slot) * options.slot_count, slot_alignment);
+    m_shared_size = data_offset + slot_size * options.slot_count;
+
+    m_fd = memfd_create("glutils-frame-export", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (m_fd < 0)
+        throw Error("failed to create shared memory for frame export");
+
+    if (ftruncate(m_fd, off_t(m_shared_size)) != 0)
+    {
+        close(m_fd);
+        throw Error("failed to size shared memory for frame export");
+    }
+    // the consumer must not be able to resize the ring under the exporter
+    fcntl(m_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+
+    void *address = mmap(nullptr, m_shared_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (address == MAP_FAILED)
+    {
+        close(m_fd);
+        throw Error("failed to map shared memory for frame export");
+    }
+
+    m_shared = static_cast<std::byte *>(address);
+    m_header = new(m_shared) Header{magic, version, options.slot_count, 0, slot_size, data_offset, {0}, {0}};
+}
+
+FrameExporter::~FrameExporter()
+{
+    munmap(m_shared, m_shared_size);
+    close(m_fd);
+}
+
+auto FrameExporter::hasFreeSlot() -> bool
+{
+    const std::uint32_t reserved = m_next_sequence + std::uint32_t(m_readback.getPendingCount());
+    return reserved - m_header->consumed.load(std::memory_order_acquire) < m_options.slot_count;
+}
+
+auto FrameExporter::exportTexture(TextureHandle texture) -> bool
+{
+    if (!hasFreeSlot())
+    {
+        m_stats.dropped++;
+        return false;
+    }
+
+    const std::int64_t request_time = getTime();
+    const auto callback = [this, request_time](const ReadbackRing::Result &result)
+    { publish(result, request_time); };
+
+    const std::uint64_t id = m_options.conversion == Conversion::none
+                             ? m_readback.readTexture(texture, 0, 0, 0, 0, m_options.width, m_options.height,
+                                                      m_options.format, m_options.type, callback)
+                             : m_readback.readConverted(texture, 0, 0, 0, m_options.width, m_options.height,
+                                                        m_options.conversion, callback);
+    if (!id)
+        m_stats.dropped++;
+    return id;
+}
+
+auto FrameExporter::exportFramebuffer(FramebufferHandle framebuffer) -> bool
+{
+    if (m_options.conversion != Conversion::none)
+        throw Error("framebuffers can only be exported without conversion");
+
+    if (!hasFreeSlot())
+    {
+        m_stats.dropped++;
+        return false;
+    }
+
+    const std::int64_t request_time = getTime();
+    const std::uint64_t id = m_readback.readFramebuffer(framebuffer, 0, 0, m_options.width, m_options.height,
+                                                        m_options.format, m_options.type,
+                                                        [this, request_time](const ReadbackRing::Result &result)
+                                                        { publish(result, request_time); });
+    if (!id)
+        m_stats.dropped++;
+    return id;
+}
+
+void FrameExporter::poll()
+{
+    m_readback.poll();
+}
+
+void FrameExporter::publish(const ReadbackRing::Result &result, std::int64_t request_time)
+{
+    using namespace SharedFrameRing;
+
+    // a slot was reserved for this frame when it was requested
+    const std::uint32_t sequence = m_next_sequence++;
+    const std::uint32_t index = sequence % m_options.slot_count;
+
+    std::memcpy(m_shared + m_header->data_offset + m_header->slot_size * index, result.data,
+                std::size_t(result.size));
+
+    const std::int64_t publish_time = getTime();
+    Slot &slot = getSlots(m_shared)[index];
+    slot = Slot{sequence, request_time, publish_time, result.width, result.height,
+                std::uint32_t(m_options.conversion), std::uint32_t(m_options.format), std::uint32_t(m_options.type), 0,
+                std::uint64_t(result.size), std::uint64_t(result.row_stride), std::uint64_t(result.chroma_offset),
+                std::uint64_t(result.chroma_row_stride)};
+
+    m_header->published.store(sequence + 1, std::memory_order_release);
+    futex(m_header->published, FUTEX_WAKE, INT_MAX, nullptr);
+
+    m_stats.exported++;
+    m_stats.bytes_copied += std::size_t(result.size);
+    m_stats.last_latency = std::chrono::nanoseconds(publish_time - request_time);
+    m_total_latency += m_stats.last_latency;
+    m_stats.average_latency = m_total_latency / m_stats.exported;
+}
+
+SharedFrameReader::SharedFrameReader(int fd)
+{
+    using namespace SharedFrameRing;
+
+    struct stat status{};
+    if (fstat(fd, &status) != 0 || std::size_t(status.st_size) < sizeof(Header))
+        throw Error("invalid frame export shared memory");
+    m_size = std::size_t(status.st_size);
+
+    void *address = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+        throw Error("failed to map frame export shared memory");
+
+    m_shared = static_cast<std::byte *>(address);
+    m_header = reinterpret_cast<Header *>(m_shared);
+
+    // an empty ring would divide by zero when picking a slot; the size checks are written so they can't overflow
+    if (m_header->magic != magic || m_header->version != version || m_header->slot_count == 0
+        || m_header->slot_size == 0 || m_header->data_offset > m_size
+        || m_header->slot_size > (m_size - m_header->data_offset) / m_header->slot_count)
+    {
+        munmap(m_shared, m_size);
+        throw Error("shared memory doesn't hold a compatible frame export ring");
+    }
+}
+
+SharedFrameReader::~SharedFrameReader()
+{
+    munmap(m_shared, m_size);
+}
+
+auto SharedFrameReader::acquire(std::chrono::nanoseconds timeout) -> Frame
+{
+    if (m_acquired)
+        throw Error("release() the previous frame before acquiring the next");
+
+    const std::uint32_t sequence = m_header->consumed.load(std::memory_order_relaxed);
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (m_header->published.load(std::memory_order_acquire) == sequence)
+    {
+        const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                deadline - std::chrono::steady_clock::now());
+        if (remaining <= std::chrono::nanoseconds::zero())
+            return {};
+
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(remaining);
+        const timespec wait_time{time_t(seconds.count()), long((remaining - seconds).count())};
+        // returns immediately if a frame was published since the load above
+        futex(m_header->published, FUTEX_WAIT, sequence, &wait_time);
+    }
+
+    const std::uint32_t index = sequence % m_header->slot_count;
+    m_acquired = true;
+    return {getSlots(m_shared) + index, m_shared + m_header->data_offset + m_header->slot_size * index};
+}
+
+void SharedFrameReader::release()
+{
+    if (!m_acquired)
+        return;
+
+    m_header->consumed.fetch_add(1, std::memory_order_release);
+    m_acquired = false;
+}
+
+auto SharedFrameReader::getLatency(const Frame &frame) -> std::chrono::nanoseconds
+{
+    return std::chrono::nanoseconds(getTime() - frame.slot->request_time);
+}
+
+} // GL
+
+#endif
@@ -0,0 +1,120 @@
+#include "glutils/framebuffer.hpp"
+
+#include "glutils/gl.hpp"
+
+namespace GL {
+
+auto RenderbufferHandle::create() -> RenderbufferHandle
+{
+    RenderbufferHandle new_handle;
+    glCreateRenderbuffers(1, &new_handle.m_name);
+    return new_handle;
+}
+
+void RenderbufferHandle::destroy(RenderbufferHandle renderbuffer)
+{
+    glDeleteRenderbuffers(1, &renderbuffer.m_name);
+}
+
+void RenderbufferHandle::setStorage(TextureHandle::SizedInternalFormat internal_format, GLsizei width,
+                                    GLsizei height) const
+{
+    glNamedRenderbufferStorage(m_name, GLenum(internal_format), width, height);
+}
+
+void RenderbufferHandle::setStorageMultisample(GLsizei samples, TextureHandle::SizedInternalFormat internal_format,
+                                               GLsizei width, GLsizei height) const
+{
+    glNamedRenderbufferStorageMultisample(m_name, samples, GLenum(internal_format), width, height);
+}
+
+auto FramebufferHandle::create() -> FramebufferHandle
+{
+    FramebufferHandle new_handle;
+    glCreateFramebuffers(1, &new_handle.m_name);
+    return new_handle;
+}
+
+void FramebufferHandle::destroy(FramebufferHandle framebuffer)
+{
+    glDeleteFramebuffers(1, &framebuffer.m_name);
+}
+
+void FramebufferHandle::bind(Target target) const
+{
+    glBindFramebuffer(GLenum(target), m_name);
+}
+
+void FramebufferHandle::unbind(Target target)
+{
+    glBindFramebuffer(GLenum(target), 0);
+}
+
+void FramebufferHandle::attachTexture(Attachment attachment, TextureHandle texture, GLint level) const
+{
+    glNamedFramebufferTexture(m_name, GLenum(attachment), texture.getName(), level);
+}
+
+void FramebufferHandle::attachTextureLayer(Attachment attachment, TextureHandle texture, GLint level,
+                                           GLint layer) const
+{
+    glNamedFramebufferTextureLayer(m_name, GLenum(attachment), texture.getName(), level, layer);
+}
+
+void FramebufferHandle::attachRenderbuffer(Attachment attachment, RenderbufferHandle renderbuffer) const
+{
+    glNamedFramebufferRenderbuffer(m_name, GLenum(attachment), GL_RENDERBUFFER, renderbuffer.getName());
+}
+
+void FramebufferHandle::detach(Attachment attachment) const
+{
+    glNamedFramebufferTexture(m_name, GLenum(attachment), 0, 0);
+}
+
+void FramebufferHandle::setDrawBuffers(GLsizei count, const Attachment *attachments) const
+{
+    static_assert(sizeof(Attachment) == sizeof(GLenum));
+    glNamedFramebufferDrawBuffers(m_name, count, reinterpret_cast<const GLenum *>(attachments));
+}
+
+void FramebufferHandle::setDrawBuffer(Attachment attachment) const
+{
+    glNamedFramebufferDrawBuffer(m_name, GLenum(attachment));
+}
+
+void FramebufferHandle::setReadBuffer(Attachment attachment) const
+{
+    glNamedFramebufferReadBuffer(m_name, GLenum(attachment));
+}
+
+auto FramebufferHandle::checkStatus(Target target) const -> Status
+{
+    return Status(glCheckNamedFramebufferStatus(m_name, GLenum(target)));
+}
+
+void FramebufferHandle::invalidate(GLsizei count, const Attachment *attachments) const
+{
+    glInvalidateNamedFramebufferData(m_name, count, reinterpret_cast<const GLenum *>(attachments));
+}
+
+void FramebufferHandle::invalidate(GLsizei count, const Attachment *attachments, GLint x, GLint y, GLsizei width,
+                                   GLsizei height) const
+{
+    glInvalidateNamedFramebufferSubData(m_name, count, reinterpret_cast<const GLenum *>(attachments), x, y, width,
+                                        height);
+}
+
+void FramebufferHandle::blit(FramebufferHandle source, FramebufferHandle destination, GLint src_x0, GLint src_y0,
+                             GLint src_x1, GLint src_y1, GLint dst_x0, GLint dst_y0, GLint dst_x1, GLint dst_y1,
+                             BufferBits mask, bool linear)
+{
+    glBlitNamedFramebuffer(source.getName(), destination.getName(), src_x0, src_y0, src_x1, src_y1, dst_x0, dst_y0,
+                           dst_x1, dst_y1, GLbitfield(mask), linear ? GL_LINEAR : GL_NEAREST);
+}
+
+auto operator|(FramebufferHandle::BufferBits l, FramebufferHandle::BufferBits r) -> FramebufferHandle::BufferBits
+{
+    return FramebufferHandle::BufferBits(GLbitfield(l) | GLbitfield(r));
+}
+
+} // GL
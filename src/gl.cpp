@@ -1,9 +1,24 @@
 #include "glutils/gl.hpp"
+#include "glutils/call_stats.hpp"
 #include "glutils/error.hpp"
+#include "glutils/error_check.hpp"
+#include "glutils/pixel_store.hpp"
+#include "glutils/sampler.hpp"
+#include "glutils/trace.hpp"
+
+#include <cstdio>
 
 #if GLUTILS_DEBUG
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
 
 #endif
 
@@ -13,8 +28,14 @@ namespace GL {
 namespace {
 
 std::exception_ptr g_debug_exception;
-std::ostream *g_debug_out{nullptr};
-std::ostream *g_debug_err{nullptr};
+// errors reported in asynchronous mode, possibly from a driver thread; kept until a GL call or flush rethrows them
+std::mutex g_async_error_mutex;
+std::exception_ptr g_async_error;
+std::atomic<bool> g_async_error_pending{false};
+// read by the writer thread of asynchronous mode
+std::atomic<std::ostream *> g_debug_out{nullptr};
+std::atomic<std::ostream *> g_debug_err{nullptr};
+std::atomic<DebugOutputMode> g_debug_mode{DebugOutputMode::asynchronous};
 
 const char *getDebugMessageSourceString(unsigned int source_enum)
 {
@@ -65,39 +86,322 @@ const char *getDebugMessageSeverityString(unsigned int severity_enum)
     }
 }
 
+void writeDebugMessage(std::ostream &out, GLenum source, GLenum type, unsigned int id, GLenum severity,
+                       const char *message)
+{
+    out << "[OpenGL Debug Message] (" << id << ")"
+        << "\nSource:   " << getDebugMessageSourceString(source)
+        << "\nType:     " << getDebugMessageTypeString(type)
+        << "\nSeverity: " << getDebugMessageSeverityString(severity)
+        << "\nMessage:  " << message
+        << "\n";
+}
+
+auto getDebugStream(GLenum type) -> std::ostream *
+{
+    std::ostream *const err = g_debug_err.load(std::memory_order_relaxed);
+    return err && type == GL_DEBUG_TYPE_ERROR ? err : g_debug_out.load(std::memory_order_relaxed);
+}
+
+/// Debug messages queued by the callback in asynchronous mode, and the thread that writes them out.
+/**
+ * The driver may call the callback from several threads at once, so the ring is a bounded multi-producer queue:
+ * producers claim a slot by advancing m_tail, and publish it through the slot's sequence number. Slots are allocated
+ * up front, so queueing a message never allocates or locks. Messages are dropped when the ring is full.
+ */
+class DebugMessageQueue
+{
+public:
+    DebugMessageQueue()
+    {
+        for (std::size_t i = 0; i < slot_count; i++)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        m_thread = std::thread([this] { run(); });
+    }
+
+    ~DebugMessageQueue()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    void push(GLenum source, GLenum type, unsigned int id, GLenum severity, GLsizei length, const char *message)
+    {
+        std::size_t position = m_tail.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true)
+        {
+            slot = &m_slots[position % slot_count];
+            const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+
+            if (sequence == position)
+            {
+                if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (sequence < position)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else
+                position = m_tail.load(std::memory_order_relaxed);
+        }
+
+        if (length < 0)
+            length = GLsizei(std::strlen(message));
+        slot->length = std::min(std::size_t(length), max_message_length);
+        std::memcpy(slot->text, message, slot->length);
+        slot->text[slot->length] = '\0';
+        slot->source = source;
+        slot->type = type;
+        slot->id = id;
+        slot->severity = severity;
+        slot->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    /// Wait until every message queued before the call has been written.
+    void flush()
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_acquire);
+        std::unique_lock lock(m_mutex);
+        m_flush_target = std::max(m_flush_target, tail);
+        m_wake.notify_one();
+        m_flushed.wait(lock, [&] { return m_flushed_head >= tail; });
+    }
+
+    /// Lock out the writer thread, e.g. while the output streams are changed.
+    auto lock() -> std::unique_lock<std::mutex>
+    { return std::unique_lock(m_mutex); }
+
+private:
+    static constexpr std::size_t slot_count = 256;
+    static constexpr std::size_t max_message_length = 1023;
+    static constexpr auto poll_interval = std::chrono::milliseconds(5);
+    static constexpr auto repeat_report_interval = std::chrono::seconds(1);
+
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        GLenum source;
+        GLenum type;
+        unsigned int id;
+        GLenum severity;
+        std::size_t length;
+        char text[max_message_length + 1];
+    };
+
+    void run()
+    {
+        std::unique_lock lock(m_mutex);
+        while (true)
+        {
+            drain();
+
+            // a producer may have claimed a slot below the target without filling it yet; keep polling until it has
+            if (m_flushed_head < m_flush_target || m_stop)
+            {
+                reportRepeats();
+                m_flushed_head = m_head;
+                m_flushed.notify_all();
+            }
+            else if (m_repeats && std::chrono::steady_clock::now() - m_last_report >= repeat_report_interval)
+                reportRepeats();
+
+            if (m_stop)
+                return;
+
+            // producers never notify, so that queueing stays lock-free; poll instead
+            m_wake.wait_for(lock, poll_interval);
+        }
+    }
+
+    void drain()
+    {
+        while (true)
+        {
+            Slot &slot = m_slots[m_head % slot_count];
+            if (slot.sequence.load(std::memory_order_acquire) != m_head + 1)
+                break;
+
+            write(slot);
+            slot.sequence.store(m_head + slot_count, std::memory_order_release);
+            m_head++;
+        }
+
+        if (const std::size_t dropped = m_dropped.exchange(0, std::memory_order_relaxed))
+            if (std::ostream *out = g_debug_out.load(std::memory_order_relaxed))
+                *out << "[OpenGL Debug Message] " << dropped << " messages dropped; the queue was full\n";
+    }
+
+    void write(const Slot &slot)
+    {
+        const bool repeated = m_head && slot.source == m_last_source && slot.type == m_last_type
+                              && slot.id == m_last_id && slot.severity == m_last_severity
+                              && m_last_text.compare(0, std::string::npos, slot.text, slot.length) == 0;
+        if (repeated)
+        {
+            m_repeats++;
+            return;
+        }
+
+        reportRepeats();
+        m_last_source = slot.source;
+        m_last_type = slot.type;
+        m_last_id = slot.id;
+        m_last_severity = slot.severity;
+        m_last_text.assign(slot.text, slot.length);
+
+        if (std::ostream *out = getDebugStream(slot.type))
+            writeDebugMessage(*out, slot.source, slot.type, slot.id, slot.severity, slot.text);
+    }
+
+    void reportRepeats()
+    {
+        m_last_report = std::chrono::steady_clock::now();
+        if (!m_repeats)
+            return;
+
+        if (std::ostream *out = getDebugStream(m_last_type))
+            *out << "[OpenGL Debug Message] (" << m_last_id << ") repeated " << m_repeats << " more times\n";
+        m_repeats = 0;
+    }
+
+    Slot m_slots[slot_count]{};
+    std::atomic<std::size_t> m_tail{0};
+    std::atomic<std::size_t> m_dropped{0};
+
+    // owned by the writer thread
+    std::size_t m_head{0};
+    GLenum m_last_source{0};
+    GLenum m_last_type{0};
+    unsigned int m_last_id{0};
+    GLenum m_last_severity{0};
+    std::string m_last_text;
+    std::size_t m_repeats{0};
+    std::chrono::steady_clock::time_point m_last_report;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+    // sequence flush() waits for, and the head as of the last time the repeats were reported
+    std::size_t m_flush_target{0};
+    std::size_t m_flushed_head{0};
+    bool m_stop{false};
+    std::thread m_thread;
+};
+
+std::atomic<bool> g_debug_queue_created{false};
+
+// Created on first use and kept until exit, since the driver may call the callback late.
+auto getDebugMessageQueue() -> DebugMessageQueue &
+{
+    static DebugMessageQueue queue;
+    g_debug_queue_created = true;
+    return queue;
+}
+
 void
-debugCallback(GLenum source, GLenum type, unsigned int id, GLenum severity, GLsizei, const char *message, const void *)
+debugCallback(GLenum source, GLenum type, unsigned int id, GLenum severity, GLsizei length, const char *message,
+              const void *)
 {
-    const bool is_error = type == GL_DEBUG_TYPE_ERROR;
+    if (g_debug_mode.load(std::memory_order_relaxed) == DebugOutputMode::asynchronous)
+    {
+        // errors are rare, so they can afford the lock; keep the first until it's thrown
+        if (type == GL_DEBUG_TYPE_ERROR)
+        {
+            std::lock_guard lock(g_async_error_mutex);
+            if (!g_async_error)
+                g_async_error = std::make_exception_ptr(Error(message));
+            g_async_error_pending.store(true, std::memory_order_release);
+        }
+
+        if (g_debug_out.load(std::memory_order_relaxed))
+            getDebugMessageQueue().push(source, type, id, severity, length, message);
+        return;
+    }
 
-    if (is_error)
+    if (type == GL_DEBUG_TYPE_ERROR)
         g_debug_exception = std::make_exception_ptr(Error(message));
 
-    if (!g_debug_out)
+    if (std::ostream *out = getDebugStream(type))
+        writeDebugMessage(*out, source, type, id, severity, message);
+}
+
+void rethrowAsyncError()
+{
+    if (!g_async_error_pending.load(std::memory_order_acquire))
         return;
 
-    std::ostream &out = (g_debug_err && is_error) ? *g_debug_err : *g_debug_out;
+    std::exception_ptr ptr;
+    {
+        std::lock_guard lock(g_async_error_mutex);
+        g_async_error.swap(ptr);
+        g_async_error_pending.store(false, std::memory_order_relaxed);
+    }
+    if (ptr)
+        std::rethrow_exception(ptr);
+}
+
+}
+#endif // GLUTILS_DEBUG
 
-    out << "[OpenGL Debug Message] (" << id << ")"
-        << "\nSource:   " << getDebugMessageSourceString(source)
-        << "\nType:     " << getDebugMessageTypeString(type)
-        << "\nSeverity: " << getDebugMessageSeverityString(severity)
-        << "\nMessage:  " << message
-        << "\n";
+#if GLUTILS_DEBUG || GLUTILS_CALL_STATS
+namespace {
+
+void preCall(const char *name, GLADapiproc apiproc, int len_args, ...)
+{
+    // the check glad's default callback made; the call that follows will crash
+    if (!apiproc)
+        std::fprintf(stderr, "GLAD: ERROR %s is NULL!\n", name);
+
+#if GLUTILS_CALL_STATS
+    std::va_list args;
+    va_start(args, len_args);
+    recordTraceBeforeCall(name, args);
+    va_end(args);
+
+    beginCallStats();
+#else
+    (void) len_args;
+#endif // GLUTILS_CALL_STATS
 }
 
-void postCall(void *, const char *, GLADapiproc, int, ...)
+void postCall(void *ret, const char *name, GLADapiproc, int len_args, ...)
 {
+#if GLUTILS_CALL_STATS
+    endCallStats(name);
+
+    // record before checking, which may throw
+    std::va_list args;
+    va_start(args, len_args);
+    recordTraceCall(ret, name, args);
+    va_end(args);
+
+    checkErrorsAfterCall(name);
+#else
+    (void) ret;
+    (void) name;
+    (void) len_args;
+#endif // GLUTILS_CALL_STATS
+
+#if GLUTILS_DEBUG
     if (g_debug_exception)
     {
         std::exception_ptr ptr;
         g_debug_exception.swap(ptr);
         std::rethrow_exception(ptr);
     }
+    rethrowAsyncError();
+#endif // GLUTILS_DEBUG
 }
 
 }
-#endif // GLUTILS_DEBUG
+#endif // GLUTILS_DEBUG || GLUTILS_CALL_STATS
 
 int loadContext(GLADloadfunc loader)
 {
@@ -106,6 +410,13 @@ int loadContext(GLADloadfunc loader)
     if (version == 0)
         throw Error("failed to load functions for OpenGL context");
 
+#if !GLUTILS_CALL_STATS
+    hookErrorCheckCalls();
+#endif // !GLUTILS_CALL_STATS
+
+    resetPixelUnpackCache();
+    resetSamplerBindingCache();
+
 #if GLUTILS_DEBUG
     {
         GLint flags = 0;
@@ -115,11 +426,19 @@ int loadContext(GLADloadfunc loader)
             throw Error("glutils was built in debug mode but current OpenGL context is not a debug context");
     }
     glEnable(GL_DEBUG_OUTPUT);
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    if (g_debug_mode == DebugOutputMode::synchronous)
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    else
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
     glDebugMessageCallback(debugCallback, nullptr);
-    gladSetGLPostCallback(postCall);
 #endif // GLUTILS_DEBUG
 
+#if GLUTILS_DEBUG || GLUTILS_CALL_STATS
+    // replaces glad's default callbacks, which call glGetError around every call
+    gladSetGLPreCallback(preCall);
+    gladSetGLPostCallback(postCall);
+#endif // GLUTILS_DEBUG || GLUTILS_CALL_STATS
+
     return version;
 }
 
@@ -127,10 +446,49 @@ int loadContext(GLADloadfunc loader)
 
 void enableDebugMessages(std::ostream *out, std::ostream *err)
 {
+    if (g_debug_mode == DebugOutputMode::asynchronous)
+    {
+        // let the writer finish with the old streams; a pending error is left for the next call to throw
+        getDebugMessageQueue().flush();
+        const auto lock = getDebugMessageQueue().lock();
+        g_debug_out = out;
+        g_debug_err = err;
+        return;
+    }
+
     g_debug_out = out;
     g_debug_err = err;
 }
 
+void setDebugOutputMode(DebugOutputMode mode)
+{
+    if (mode == DebugOutputMode::asynchronous)
+    {
+        getDebugMessageQueue();
+        g_debug_mode = mode;
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+    else
+    {
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        g_debug_mode = mode;
+        if (g_debug_queue_created)
+            getDebugMessageQueue().flush();
+    }
+}
+
+auto getDebugOutputMode() -> DebugOutputMode
+{
+    return g_debug_mode;
+}
+
+void flushDebugMessages()
+{
+    if (g_debug_queue_created)
+        getDebugMessageQueue().flush();
+    rethrowAsyncError();
+}
+
 #endif // GLUTILS_DEBUG
 
 } // GL
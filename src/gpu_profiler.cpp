@@ -0,0 +1,285 @@
+#include "glutils/gpu_profiler.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+
+#include <algorithm>
+#include <ios>
+#include <iomanip>
+
+namespace GL {
+
+namespace {
+
+using Options = GpuProfiler::Options;
+
+constexpr std::size_t no_zone = ~std::size_t(0);
+
+auto validate(const Options &options) -> const Options &
+{
+    if (options.max_frames_in_flight == 0 || options.max_zones_per_frame == 0)
+        throw Error("gpu profiler must have a positive frame and zone count");
+    return options;
+}
+
+// bytes of m_results used by each frame: a begin and an end timestamp per zone
+auto getSlotSize(const Options &options) -> GLsizeiptr
+{
+    return GLsizeiptr(options.max_zones_per_frame) * 2 * GLsizeiptr(sizeof(GLuint64));
+}
+
+void writeJsonString(std::ostream &out, const char *string)
+{
+    out << '"';
+    for (; *string; string++)
+    {
+        if (*string == '"' || *string == '\\')
+            out << '\\' << *string;
+        else if (static_cast<unsigned char>(*string) < 0x20)
+            out << ' ';
+        else
+            out << *string;
+    }
+    out << '"';
+}
+
+void writeEvent(std::ostream &out, const GpuProfiler::ZoneRecord &zone, bool gpu)
+{
+    const auto begin = gpu ? zone.gpu_begin : zone.cpu_begin;
+    const auto end = gpu ? zone.gpu_end : zone.cpu_end;
+
+    out << ",\n{\"name\":";
+    writeJsonString(out, zone.name);
+    // Chrome traces are in microseconds
+    out << ",\"cat\":\"" << (gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (gpu ? 2 : 1)
+        << ",\"ts\":" << double(begin.count()) / 1000. << ",\"dur\":" << double((end - begin).count()) / 1000.
+        << ",\"args\":{\"frame\":" << zone.frame << "}}";
+}
+
+} // namespace
+
+GpuProfiler::Zone::Zone(GpuProfiler &profiler, const char *name) :
+        m_profiler(profiler), m_frame(profiler.m_frame.number), m_index(profiler.beginZone(name))
+{}
+
+GpuProfiler::Zone::~Zone()
+{
+    m_profiler.endZone(m_frame, m_index);
+}
+
+GpuProfiler::GpuProfiler() : GpuProfiler(Options{})
+{}
+
+GpuProfiler::GpuProfiler(const Options &options) :
+        m_options(validate(options)), m_epoch(std::chrono::steady_clock::now())
+{
+    if (m_options.collection == Collection::query_buffer)
+    {
+        using StorageFlags = BufferHandle::StorageFlags;
+        using AccessFlags = BufferHandle::AccessFlags;
+
+        const GLsizeiptr size = getSlotSize(m_options) * m_options.max_frames_in_flight;
+        m_results = Buffer();
+        m_results.allocateImmutable(size, StorageFlags::map_read | StorageFlags::map_persistent
+                                          | StorageFlags::map_coherent);
+        m_results_mapping = static_cast<const GLuint64 *>(
+                m_results.mapRange(0, size, AccessFlags::read | AccessFlags::persistent | AccessFlags::coherent));
+        if (!m_results_mapping)
+            throw Error("failed to map gpu profiler result buffer");
+        m_free_slots.assign(m_options.max_frames_in_flight, true);
+    }
+
+    startFrame();
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (m_results_mapping)
+        m_results.unmap();
+}
+
+auto GpuProfiler::getCpuTime() const -> std::chrono::nanoseconds
+{
+    return std::chrono::steady_clock::now() - m_epoch;
+}
+
+auto GpuProfiler::acquireQuery() -> std::uint32_t
+{
+    if (m_free_queries.empty())
+    {
+        m_queries.emplace_back(QueryHandle::Target::timestamp);
+        m_stats.queries = m_queries.size();
+        return std::uint32_t(m_queries.size() - 1);
+    }
+
+    const std::uint32_t query = m_free_queries.back();
+    m_free_queries.pop_back();
+    return query;
+}
+
+auto GpuProfiler::beginZone(const char *name) -> std::size_t
+{
+    if (m_options.debug_groups)
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+
+    const std::uint32_t depth = m_depth++;
+    if (!m_frame.recording)
+        return no_zone;
+
+    if (m_frame.zones.size() == m_options.max_zones_per_frame)
+    {
+        m_stats.dropped_zones++;
+        return no_zone;
+    }
+
+    const std::size_t index = m_frame.zones.size();
+    const std::uint32_t query = acquireQuery();
+    m_queries[query].queryCounter();
+    if (m_results_mapping)
+        m_queries[query].writeResult(m_results, getSlotSize(m_options) * GLintptr(m_frame.slot)
+                                                + GLintptr(2 * index * sizeof(GLuint64)));
+
+    m_frame.zones.push_back({name, depth, query, query, getCpuTime(), {}});
+    return index;
+}
+
+void GpuProfiler::endZone(std::uint64_t frame, std::size_t index)
+{
+    m_depth--;
+
+    if (index != no_zone && frame == m_frame.number)
+    {
+        PendingZone &zone = m_frame.zones[index];
+        zone.cpu_end = getCpuTime();
+        zone.end_query = acquireQuery();
+        m_queries[zone.end_query].queryCounter();
+        if (m_results_mapping)
+            m_queries[zone.end_query].writeResult(m_results, getSlotSize(m_options) * GLintptr(m_frame.slot)
+                                                             + GLintptr((2 * index + 1) * sizeof(GLuint64)));
+    }
+
+    if (m_options.debug_groups)
+        glPopDebugGroup();
+}
+
+void GpuProfiler::startFrame()
+{
+    m_frame.recording = m_pending.size() < m_options.max_frames_in_flight;
+    if (!m_frame.recording)
+    {
+        m_stats.dropped_frames++;
+        return;
+    }
+
+    if (m_results_mapping)
+    {
+        // a slot is free for every frame that can be pending
+        m_frame.slot = std::size_t(std::find(m_free_slots.begin(), m_free_slots.end(), true) - m_free_slots.begin());
+        m_free_slots[m_frame.slot] = false;
+    }
+
+    // the GPU timestamp is taken once the commands before it reach the server, which is close enough to now
+    m_frame.cpu_calibration = getCpuTime();
+    m_frame.gpu_calibration = QueryHandle::getTimestamp();
+}
+
+void GpuProfiler::endFrame()
+{
+    if (m_depth)
+        throw Error("gpu profiler frame ended inside a zone");
+
+    const std::uint64_t number = m_frame.number + 1;
+    if (m_frame.recording)
+    {
+        if (m_results_mapping)
+            m_frame.fence = createFenceSync();
+        m_pending.push_back(std::move(m_frame));
+    }
+
+    m_frame = Frame();
+    m_frame.number = number;
+    startFrame();
+
+    while (!m_pending.empty() && isReady(m_pending.front()))
+    {
+        collect(m_pending.front());
+        m_pending.pop_front();
+    }
+}
+
+auto GpuProfiler::isReady(const Frame &frame) const -> bool
+{
+    if (frame.fence)
+    {
+        const auto status = frame.fence->clientWait(false);
+        return status == Sync::Status::already_signaled || status == Sync::Status::condition_satisfied;
+    }
+
+    // the last query issued is the likeliest to be pending, so check it first
+    if (!frame.zones.empty() && !m_queries[frame.zones.back().end_query].isResultAvailable())
+        return false;
+
+    return std::all_of(frame.zones.begin(), frame.zones.end(), [this](const PendingZone &zone)
+    {
+        return m_queries[zone.begin_query].isResultAvailable() && m_queries[zone.end_query].isResultAvailable();
+    });
+}
+
+void GpuProfiler::collect(const Frame &frame)
+{
+    const auto toCpuTime = [&frame](GLuint64 timestamp)
+    {
+        return frame.cpu_calibration + std::chrono::nanoseconds(GLint64(timestamp) - frame.gpu_calibration);
+    };
+
+    const GLuint64 *results = m_results_mapping
+                              ? m_results_mapping + std::size_t(m_options.max_zones_per_frame) * 2 * frame.slot
+                              : nullptr;
+
+    std::chrono::nanoseconds first{0}, last{0};
+    for (std::size_t i = 0; i < frame.zones.size(); i++)
+    {
+        const PendingZone &zone = frame.zones[i];
+        const GLuint64 begin = results ? results[2 * i] : m_queries[zone.begin_query].getResult();
+        const GLuint64 end = results ? results[2 * i + 1] : m_queries[zone.end_query].getResult();
+
+        m_zones.push_back({zone.name, frame.number, zone.depth, zone.cpu_begin, zone.cpu_end, toCpuTime(begin),
+                           toCpuTime(end)});
+        m_free_queries.push_back(zone.begin_query);
+        m_free_queries.push_back(zone.end_query);
+
+        first = i == 0 ? m_zones.back().gpu_begin : std::min(first, m_zones.back().gpu_begin);
+        last = i == 0 ? m_zones.back().gpu_end : std::max(last, m_zones.back().gpu_end);
+    }
+
+    if (results)
+        m_free_slots[frame.slot] = true;
+
+    m_stats.frames++;
+    m_stats.zones += frame.zones.size();
+    m_stats.last_frame_gpu_time = last - first;
+
+    while (!m_zones.empty() && m_zones.front().frame + m_options.history_frames <= frame.number)
+        m_zones.pop_front();
+}
+
+void GpuProfiler::writeChromeTrace(std::ostream &out) const
+{
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+           "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+           "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    for (const ZoneRecord &zone: m_zones)
+    {
+        writeEvent(out, zone, false);
+        writeEvent(out, zone, true);
+    }
+    out << "\n]}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // GL
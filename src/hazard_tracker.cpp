@@ -0,0 +1,198 @@
+#include "glutils/hazard_tracker.hpp"
+#include "glutils/compute.hpp"
+
+#include <algorithm>
+
+namespace GL {
+
+namespace {
+
+// the bits of GL_ALL_BARRIER_BITS that name a way of consuming data
+constexpr GLbitfield all_barrier_bits = 0xFFEF;
+
+auto countBits(GLbitfield bits) -> std::size_t
+{
+    std::size_t count = 0;
+    for (; bits; bits &= bits - 1)
+        count++;
+    return count;
+}
+
+} // namespace
+
+auto HazardTracker::s_key(BufferHandle buffer) -> std::uint64_t
+{
+    return buffer.getName();
+}
+
+auto HazardTracker::s_key(TextureHandle texture) -> std::uint64_t
+{
+    // textures and buffers have separate name spaces
+    return std::uint64_t(1) << 32 | texture.getName();
+}
+
+void HazardTracker::setBinding(BindingPoint point, GLuint index, std::uint64_t resource, MemoryBarrierBits usage,
+                               bool writes)
+{
+    const std::uint64_t key = std::uint64_t(point) << 32 | index;
+
+    if (resource & 0xFFFFFFFFu)
+        m_bindings[key] = Binding{resource, usage, writes};
+    else
+        m_bindings.erase(key);
+}
+
+void HazardTracker::bindImage(GLuint unit, TextureHandle texture, GLint level, bool layered, GLint layer,
+                              TextureHandle::ImageAccess access, TextureHandle::SizedInternalFormat format)
+{
+    texture.bindImage(unit, level, layered, layer, access, format);
+
+    // write-only images still need their earlier stores to land first
+    setBinding(BindingPoint::image, unit, s_key(texture), MemoryBarrierBits::shader_image_access,
+               access != TextureHandle::ImageAccess::read_only);
+}
+
+void HazardTracker::unbindImage(GLuint unit)
+{
+    TextureHandle::unbindImage(unit);
+    setBinding(BindingPoint::image, unit, s_key(TextureHandle()), MemoryBarrierBits::none, false);
+}
+
+void HazardTracker::bindTexture(GLuint unit, TextureHandle texture)
+{
+    TextureHandle::bindTextureUnit(unit, texture);
+    setBinding(BindingPoint::texture, unit, s_key(texture), MemoryBarrierBits::texture_fetch, false);
+}
+
+void HazardTracker::setBufferBinding(BufferHandle buffer, BufferHandle::IndexedTarget target, GLuint index,
+                                     bool shader_writes)
+{
+    using IndexedTarget = BufferHandle::IndexedTarget;
+
+    switch (target)
+    {
+        case IndexedTarget::uniform:
+            setBinding(BindingPoint::uniform_buffer, index, s_key(buffer), MemoryBarrierBits::uniform, false);
+            break;
+        case IndexedTarget::shader_storage:
+            setBinding(BindingPoint::storage_buffer, index, s_key(buffer), MemoryBarrierBits::shader_storage,
+                       shader_writes);
+            break;
+        case IndexedTarget::atomic_counter:
+            setBinding(BindingPoint::atomic_counter_buffer, index, s_key(buffer), MemoryBarrierBits::atomic_counter,
+                       shader_writes);
+            break;
+        case IndexedTarget::transform_feedback:
+            setBinding(BindingPoint::transform_feedback_buffer, index, s_key(buffer),
+                       MemoryBarrierBits::transform_feedback, false);
+            break;
+    }
+}
+
+void HazardTracker::bindBase(BufferHandle buffer, BufferHandle::IndexedTarget target, GLuint index,
+                             bool shader_writes)
+{
+    buffer.bindBase(target, index);
+    setBufferBinding(buffer, target, index, shader_writes);
+}
+
+void HazardTracker::bindRange(BufferHandle buffer, BufferHandle::IndexedTarget target, GLuint index,
+                              GLintptr offset, GLsizeiptr size, bool shader_writes)
+{
+    buffer.bindRange(target, index, offset, size);
+    setBufferBinding(buffer, target, index, shader_writes);
+}
+
+void HazardTracker::use(BufferHandle buffer, MemoryBarrierBits usage)
+{
+    m_uses.emplace_back(s_key(buffer), usage);
+}
+
+void HazardTracker::use(TextureHandle texture, MemoryBarrierBits usage)
+{
+    m_uses.emplace_back(s_key(texture), usage);
+}
+
+auto HazardTracker::barrier() -> MemoryBarrierBits
+{
+    m_stats.passes++;
+
+    GLbitfield required = 0;
+    if (!m_pending.empty())
+    {
+        const auto consume = [&](std::uint64_t resource, MemoryBarrierBits usage)
+        {
+            const auto it = m_pending.find(resource);
+            if (it != m_pending.end())
+                required |= it->second & GLbitfield(usage);
+        };
+
+        for (const auto &[key, binding]: m_bindings)
+            consume(binding.resource, binding.usage);
+        for (const auto &[resource, usage]: m_uses)
+            consume(resource, usage);
+    }
+
+    // the previous pass, if it wrote, would have been followed by a full barrier here
+    if (m_last_pass_writes)
+        m_stats.avoided_bits += countBits(all_barrier_bits);
+
+    if (required)
+    {
+        memoryBarrier(MemoryBarrierBits(required));
+        m_stats.barriers++;
+        m_stats.issued_bits += countBits(required);
+        // bits issued late for an earlier pass were already counted as avoided when that pass was resolved
+        m_stats.avoided_bits -= std::min(m_stats.avoided_bits, countBits(required));
+
+        // a barrier makes every earlier write visible to the consumers it names, not just those of this pass
+        for (auto it = m_pending.begin(); it != m_pending.end();)
+        {
+            it->second &= ~required;
+            if (it->second)
+                ++it;
+            else
+                it = m_pending.erase(it);
+        }
+    }
+
+    m_last_pass_writes = false;
+    for (const auto &[key, binding]: m_bindings)
+        if (binding.writes)
+        {
+            m_pending[binding.resource] = all_barrier_bits;
+            m_last_pass_writes = true;
+        }
+
+    m_uses.clear();
+
+    return MemoryBarrierBits(required);
+}
+
+void HazardTracker::dispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z)
+{
+    barrier();
+    GL::dispatchCompute(num_groups_x, num_groups_y, num_groups_z);
+}
+
+void HazardTracker::dispatchComputeIndirect(BufferHandle indirect_buffer, GLintptr indirect)
+{
+    use(indirect_buffer, MemoryBarrierBits::command);
+    barrier();
+    indirect_buffer.bind(BufferHandle::Target::dispatch_indirect);
+    GL::dispatchComputeIndirect(indirect);
+}
+
+void HazardTracker::reset()
+{
+    m_bindings.clear();
+    m_uses.clear();
+    m_pending.clear();
+
+    // the caller's full barrier retires the last pass
+    if (m_last_pass_writes)
+        m_stats.avoided_bits += countBits(all_barrier_bits);
+    m_last_pass_writes = false;
+}
+
+} // GL
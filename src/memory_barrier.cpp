@@ -0,0 +1,26 @@
+#include "glutils/memory_barrier.hpp"
+#include "glutils/gl.hpp"
+
+namespace GL {
+
+auto operator|(MemoryBarrierBits l, MemoryBarrierBits r) -> MemoryBarrierBits
+{
+    return static_cast<MemoryBarrierBits>(static_cast<GLbitfield>(l) | static_cast<GLbitfield>(r));
+}
+
+auto operator&(MemoryBarrierBits l, MemoryBarrierBits r) -> MemoryBarrierBits
+{
+    return static_cast<MemoryBarrierBits>(static_cast<GLbitfield>(l) & static_cast<GLbitfield>(r));
+}
+
+void memoryBarrier(MemoryBarrierBits barriers)
+{
+    glMemoryBarrier(static_cast<GLbitfield>(barriers));
+}
+
+void memoryBarrierByRegion(MemoryBarrierBits barriers)
+{
+    glMemoryBarrierByRegion(static_cast<GLbitfield>(barriers));
+}
+
+} // GL
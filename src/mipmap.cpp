@@ -0,0 +1,430 @@
+#include "glutils/mipmap.hpp"
+#include "glutils/error.hpp"
+#include "glutils/pixel_convert.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#endif
+
+namespace GL {
+
+namespace {
+
+using DataFormat = TextureHandle::DataFormat;
+using DataType = TextureHandle::DataType;
+using Filter = MipmapOptions::Filter;
+
+constexpr float pi = 3.14159265358979f;
+
+auto srgbToLinear(float v) -> float
+{
+    return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+struct SrgbTables
+{
+    std::array<float, 256> to_linear;
+    // linear values halfway between consecutive 8 bit sRGB values; encoding is a binary search
+    std::array<float, 255> thresholds;
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; i++)
+            to_linear[i] = srgbToLinear(float(i) / 255.f);
+        for (int i = 0; i < 255; i++)
+            thresholds[i] = srgbToLinear((float(i) + 0.5f) / 255.f);
+    }
+
+    [[nodiscard]] auto encode(float linear) const -> std::uint8_t
+    {
+        return std::uint8_t(std::upper_bound(thresholds.begin(), thresholds.end(), linear) - thresholds.begin());
+    }
+};
+
+auto getSrgbTables() -> const SrgbTables &
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+auto sinc(float x) -> float
+{
+    if (x == 0.f)
+        return 1.f;
+    x *= pi;
+    return std::sin(x) / x;
+}
+
+// zeroth order modified Bessel function of the first kind
+auto besselI0(float x) -> float
+{
+    float sum = 1.f;
+    float term = 1.f;
+    const float half_x_squared = x * x / 4.f;
+
+    for (int k = 1; k < 32 && term > sum * 1e-8f; k++)
+    {
+        term *= half_x_squared / float(k * k);
+        sum += term;
+    }
+
+    return sum;
+}
+
+constexpr float sinc_filter_radius = 3.f;
+constexpr float kaiser_alpha = 4.f;
+
+auto evaluateFilter(Filter filter, float x) -> float
+{
+    x = std::fabs(x);
+    if (x >= sinc_filter_radius)
+        return 0.f;
+
+    if (filter == Filter::lanczos)
+        return sinc(x) * sinc(x / sinc_filter_radius);
+
+    const float r = x / sinc_filter_radius;
+    return sinc(x) * besselI0(kaiser_alpha * std::sqrt(1.f - r * r)) / besselI0(kaiser_alpha);
+}
+
+struct Tap
+{
+    int index;
+    float weight;
+};
+
+// taps for each destination texel along one axis
+auto computeTaps(Filter filter, GLsizei source_size, GLsizei destination_size) -> std::vector<std::vector<Tap>>
+{
+    const float scale = float(source_size) / float(destination_size);
+    std::vector<std::vector<Tap>> taps(destination_size);
+
+    for (GLsizei d = 0; d < destination_size; d++)
+    {
+        const float center = (float(d) + 0.5f) * scale;
+        const float support = filter == Filter::box ? 0.5f * scale : sinc_filter_radius * scale;
+        const int first = int(std::floor(center - support));
+        const int last = int(std::ceil(center + support));
+
+        std::vector<Tap> &axis_taps = taps[d];
+        float total = 0.f;
+
+        for (int i = first; i <= last; i++)
+        {
+            float weight;
+            if (filter == Filter::box)
+                // exact overlap between the source texel and the footprint of the destination texel
+                weight = std::max(0.f, std::min(float(i + 1), center + support) - std::max(float(i), center - support));
+            else
+                weight = evaluateFilter(filter, (float(i) + 0.5f - center) / scale);
+
+            if (weight == 0.f)
+                continue;
+
+            const int index = std::clamp(i, 0, source_size - 1);
+            total += weight;
+
+            if (!axis_taps.empty() && axis_taps.back().index == index)
+                axis_taps.back().weight += weight;
+            else
+                axis_taps.push_back({index, weight});
+        }
+
+        for (Tap &tap: axis_taps)
+            tap.weight /= total;
+    }
+
+    return taps;
+}
+
+// acc[i] += weight * source[i]
+void accumulateRow(float *acc, const float *source, float weight, std::size_t count)
+{
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 w = _mm_set1_ps(weight);
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(source + i), w)));
+#endif
+    for (; i < count; i++)
+        acc[i] += weight * source[i];
+}
+
+void filterRow(float *destination, const float *row, const std::vector<std::vector<Tap>> &taps, int components)
+{
+    const std::size_t width = taps.size();
+
+#if defined(__SSE2__)
+    if (components == 4)
+    {
+        for (std::size_t x = 0; x < width; x++)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (const Tap &tap: taps[x])
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + tap.index * 4), _mm_set1_ps(tap.weight)));
+            _mm_storeu_ps(destination + x * 4, sum);
+        }
+        return;
+    }
+#endif
+
+    for (std::size_t x = 0; x < width; x++)
+    {
+        float *out = destination + x * components;
+        std::fill(out, out + components, 0.f);
+
+        for (const Tap &tap: taps[x])
+            for (int c = 0; c < components; c++)
+                out[c] += tap.weight * row[tap.index * components + c];
+    }
+}
+
+// Run fn(begin, end) over [0, count) split between threads.
+template<typename Fn>
+void parallelFor(GLsizei count, unsigned int thread_count, Fn &&fn)
+{
+    // not worth spawning threads for small levels
+    constexpr GLsizei min_rows_per_thread = 16;
+
+    thread_count = std::min<unsigned int>(thread_count, std::max<GLsizei>(1, count / min_rows_per_thread));
+
+    if (thread_count <= 1)
+    {
+        fn(0, count);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+
+    const GLsizei chunk = (count + GLsizei(thread_count) - 1) / GLsizei(thread_count);
+
+    for (unsigned int t = 1; t < thread_count; t++)
+    {
+        const GLsizei begin = std::min(count, GLsizei(t) * chunk);
+        const GLsizei end = std::min(count, begin + chunk);
+        threads.emplace_back([&fn, begin, end] { fn(begin, end); });
+    }
+
+    fn(0, std::min(count, chunk));
+
+    for (std::thread &thread: threads)
+        thread.join();
+}
+
+auto getComponentCount(DataFormat format) -> int
+{
+    switch (format)
+    {
+        case DataFormat::red:
+            return 1;
+        case DataFormat::rg:
+            return 2;
+        case DataFormat::rgb:
+        case DataFormat::bgr:
+            return 3;
+        case DataFormat::rgba:
+        case DataFormat::bgra:
+            return 4;
+        default:
+            throw Error("unsupported pixel format for mipmap generation");
+    }
+}
+
+struct ImageCodec
+{
+    DataType type;
+    int components;
+    bool srgb;
+    bool has_alpha;
+
+    [[nodiscard]] bool isSrgbComponent(int c) const
+    {
+        return srgb && !(has_alpha && c == 3);
+    }
+
+    void decode(const void *source, float *destination, std::size_t pixel_count) const
+    {
+        const std::size_t count = pixel_count * components;
+
+        switch (type)
+        {
+            case DataType::ubyte:
+            {
+                const auto *in = static_cast<const std::uint8_t *>(source);
+                const auto &tables = getSrgbTables();
+                for (std::size_t i = 0; i < count; i++)
+                    destination[i] = isSrgbComponent(int(i % components)) ? tables.to_linear[in[i]]
+                                                                          : float(in[i]) * (1.f / 255.f);
+                break;
+            }
+            case DataType::ushort:
+            {
+                const auto *in = static_cast<const std::uint16_t *>(source);
+                for (std::size_t i = 0; i < count; i++)
+                    destination[i] = float(in[i]) * (1.f / 65535.f);
+                break;
+            }
+            case DataType::half_float:
+            {
+                const auto *in = static_cast<const std::uint16_t *>(source);
+                for (std::size_t i = 0; i < count; i++)
+                    destination[i] = halfToFloat(in[i]);
+                break;
+            }
+            default:
+                std::memcpy(destination, source, count * sizeof(float));
+                break;
+        }
+    }
+
+    void encode(const float *source, void *destination, std::size_t pixel_count) const
+    {
+        const std::size_t count = pixel_count * components;
+
+        switch (type)
+        {
+            case DataType::ubyte:
+            {
+                auto *out = static_cast<std::uint8_t *>(destination);
+                const auto &tables = getSrgbTables();
+                for (std::size_t i = 0; i < count; i++)
+                    out[i] = isSrgbComponent(int(i % components))
+                             ? tables.encode(source[i])
+                             : std::uint8_t(std::clamp(source[i], 0.f, 1.f) * 255.f + 0.5f);
+                break;
+            }
+            case DataType::ushort:
+            {
+                auto *out = static_cast<std::uint16_t *>(destination);
+                for (std::size_t i = 0; i < count; i++)
+                    out[i] = std::uint16_t(std::clamp(source[i], 0.f, 1.f) * 65535.f + 0.5f);
+                break;
+            }
+            case DataType::half_float:
+            {
+                auto *out = static_cast<std::uint16_t *>(destination);
+                for (std::size_t i = 0; i < count; i++)
+                    out[i] = floatToHalf(source[i]);
+                break;
+            }
+            default:
+                std::memcpy(destination, source, count * sizeof(float));
+                break;
+        }
+    }
+};
+
+} // namespace
+
+auto getMipLevelCount(GLsizei width, GLsizei height) -> GLsizei
+{
+    GLsizei levels = 1;
+    for (GLsizei size = std::max(width, height); size > 1; size /= 2)
+        levels++;
+    return levels;
+}
+
+auto buildMipChain(const void *pixels, GLsizei width, GLsizei height, DataFormat format, DataType type,
+                   const MipmapOptions &options) -> std::vector<MipLevel>
+{
+    if (type != DataType::ubyte && type != DataType::ushort && type != DataType::half_float
+        && type != DataType::_float)
+        throw Error("unsupported pixel type for mipmap generation");
+
+    const int components = getComponentCount(format);
+    const ImageCodec codec{type, components, options.srgb && type == DataType::ubyte,
+                           format == DataFormat::rgba || format == DataFormat::bgra};
+    const GLsizei pixel_size = TextureHandle::getPixelSize(format, type);
+
+    const GLsizei full_chain = getMipLevelCount(width, height);
+    const GLsizei level_count = options.levels > 0 ? std::min(options.levels, full_chain) : full_chain;
+    const unsigned int thread_count = options.thread_count ? options.thread_count
+                                                           : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<float> current(std::size_t(width) * height * components);
+    parallelFor(height, thread_count, [&](GLsizei begin, GLsizei end)
+    {
+        const std::size_t row_size = std::size_t(width) * pixel_size;
+        for (GLsizei y = begin; y < end; y++)
+            codec.decode(static_cast<const std::byte *>(pixels) + y * row_size,
+                         current.data() + std::size_t(y) * width * components, width);
+    });
+
+    std::vector<MipLevel> levels;
+    levels.reserve(level_count > 1 ? level_count - 1 : 0);
+
+    GLsizei source_width = width;
+    GLsizei source_height = height;
+
+    for (GLsizei level = 1; level < level_count; level++)
+    {
+        const GLsizei level_width = std::max(1, source_width / 2);
+        const GLsizei level_height = std::max(1, source_height / 2);
+
+        const auto x_taps = computeTaps(options.filter, source_width, level_width);
+        const auto y_taps = computeTaps(options.filter, source_height, level_height);
+
+        std::vector<float> next(std::size_t(level_width) * level_height * components);
+        MipLevel &output = levels.emplace_back();
+        output.width = level_width;
+        output.height = level_height;
+        output.data.resize(std::size_t(level_width) * level_height * pixel_size);
+
+        const std::size_t source_row_length = std::size_t(source_width) * components;
+        const std::size_t row_length = std::size_t(level_width) * components;
+
+        parallelFor(level_height, thread_count, [&](GLsizei begin, GLsizei end)
+        {
+            // vertical pass into a full width row, then horizontal pass
+            std::vector<float> row(source_row_length);
+
+            for (GLsizei y = begin; y < end; y++)
+            {
+                std::fill(row.begin(), row.end(), 0.f);
+                for (const Tap &tap: y_taps[y])
+                    accumulateRow(row.data(), current.data() + tap.index * source_row_length, tap.weight,
+                                  source_row_length);
+
+                float *destination = next.data() + y * row_length;
+                filterRow(destination, row.data(), x_taps, components);
+                codec.encode(destination, output.data.data() + std::size_t(y) * level_width * pixel_size,
+                             level_width);
+            }
+        });
+
+        current = std::move(next);
+        source_width = level_width;
+        source_height = level_height;
+    }
+
+    return levels;
+}
+
+auto buildMipChainAsync(const void *pixels, GLsizei width, GLsizei height, DataFormat format, DataType type,
+                        const MipmapOptions &options) -> std::future<std::vector<MipLevel>>
+{
+    return std::async(std::launch::async, [=] { return buildMipChain(pixels, width, height, format, type, options); });
+}
+
+void uploadMipChain(TextureHandle texture, const std::vector<MipLevel> &levels, DataFormat format, DataType type,
+                    GLint first_level)
+{
+    PixelUnpackLayout layout;
+    layout.alignment = 1;
+
+    for (std::size_t i = 0; i < levels.size(); i++)
+        texture.updateImage2D(first_level + GLint(i), 0, 0, levels[i].width, levels[i].height, format, type,
+                              levels[i].data.data(), layout);
+}
+
+} // GL
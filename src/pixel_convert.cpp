@@ -0,0 +1,571 @@
+#include "glutils/pixel_convert.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#endif
+
+#if defined(__SSSE3__)
+
+#include <tmmintrin.h>
+
+#endif
+
+namespace GL {
+
+namespace {
+
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+using DataFormat = TextureHandle::DataFormat;
+using DataType = TextureHandle::DataType;
+
+auto toBits(float f) -> std::uint32_t
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+auto fromBits(std::uint32_t bits) -> float
+{
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Largest finite values of the unsigned 11 and 10 bit floats, and of rgb9_e5.
+constexpr float max_float11 = 65024.f;
+constexpr float max_float10 = 64512.f;
+constexpr float max_rgb9e5 = 65408.f;
+
+// Convert a non-negative, finite float no larger than the largest value of the format to an unsigned float with a
+// five bit exponent and the given number of mantissa bits, rounding to nearest even.
+auto packUnsignedFloat(float value, int mantissa_bits) -> std::uint32_t
+{
+    const int shift = 23 - mantissa_bits;
+    const std::uint32_t bits = toBits(value);
+
+    if (bits < 113u << 23) // subnormal result; adding this constant lines the mantissa up and rounds it
+    {
+        const std::uint32_t magic = std::uint32_t(127 - 15 + shift + 1) << 23;
+        return toBits(value + fromBits(magic)) - magic;
+    }
+
+    const std::uint32_t odd = bits >> shift & 1u;
+    return (bits + (std::uint32_t(15 - 127) << 23) + (1u << (shift - 1)) - 1u + odd) >> shift;
+}
+
+auto clampUnsignedFloat(float value, float max) -> float
+{
+    // written so that NaN becomes zero
+    return value > 0.f ? std::min(value, max) : 0.f;
+}
+
+auto packPixelR11G11B10F(const float *rgb) -> std::uint32_t
+{
+    return packUnsignedFloat(clampUnsignedFloat(rgb[0], max_float11), 6)
+           | packUnsignedFloat(clampUnsignedFloat(rgb[1], max_float11), 6) << 11
+           | packUnsignedFloat(clampUnsignedFloat(rgb[2], max_float10), 5) << 22;
+}
+
+auto packPixelRGB9E5(const float *rgb) -> std::uint32_t
+{
+    float c[3];
+    for (int i = 0; i < 3; i++)
+        c[i] = clampUnsignedFloat(rgb[i], max_rgb9e5);
+    const float max = std::max({c[0], c[1], c[2]});
+
+    // shared exponent per the GL spec: floor(log2(max)) + 1 + bias, with a minimum of -bias - 1 for the logarithm
+    int exponent = std::max(-16, int(toBits(max) >> 23) - 127) + 16;
+    if (std::uint32_t(max * fromBits(std::uint32_t(24 - exponent + 127) << 23) + .5f) == 512)
+        exponent++;
+
+    const float scale = fromBits(std::uint32_t(24 - exponent + 127) << 23);
+    std::uint32_t packed = std::uint32_t(exponent) << 27;
+    for (int i = 0; i < 3; i++)
+        packed |= std::uint32_t(c[i] * scale + .5f) << (9 * i);
+    return packed;
+}
+
+auto linearToSrgb(float v) -> float
+{
+    return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.f / 2.4f) - 0.055f;
+}
+
+// 8 bit sRGB values of linear values sampled at 1/65535 steps; the slope of the curve is at most 12.92 * 255 / 65535
+// codes per step, so this is exact but for values within a twentieth of a code of a rounding boundary.
+constexpr std::size_t srgb_table_size = 65536;
+
+auto getSrgbTable() -> const std::vector<std::uint8_t> &
+{
+    static const std::vector<std::uint8_t> table = []
+    {
+        std::vector<std::uint8_t> values(srgb_table_size);
+        for (std::size_t i = 0; i < srgb_table_size; i++)
+            values[i] = std::uint8_t(std::lround(linearToSrgb(float(i) / float(srgb_table_size - 1)) * 255.f));
+        return values;
+    }();
+    return table;
+}
+
+#if defined(__SSE2__)
+
+auto select(__m128i mask, __m128i a, __m128i b) -> __m128i
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Vector version of packUnsignedFloat(). Takes and returns bit patterns.
+auto packUnsignedFloat(__m128i bits, int mantissa_bits) -> __m128i
+{
+    const int shift = 23 - mantissa_bits;
+
+    const __m128i magic = _mm_set1_epi32((127 - 15 + shift + 1) << 23);
+    const __m128i subnormal = _mm_sub_epi32(
+            _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(magic))), magic);
+
+    const __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, shift), _mm_set1_epi32(1));
+    const __m128i rounding = _mm_set1_epi32(int((std::uint32_t(15 - 127) << 23) + (1u << (shift - 1)) - 1u));
+    __m128i normal = _mm_add_epi32(_mm_add_epi32(bits, rounding), odd);
+    normal = _mm_srl_epi32(normal, _mm_cvtsi32_si128(shift));
+
+    return select(_mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23)), subnormal, normal);
+}
+
+auto clampUnsignedFloat(__m128 value, float max) -> __m128
+{
+    // _mm_max_ps returns the second operand if either is NaN
+    return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(max));
+}
+
+// Load four pixels of RGB(A) floats as one vector per component.
+void loadRGB(const float *source, int stride, __m128 &r, __m128 &g, __m128 &b)
+{
+    r = _mm_setr_ps(source[0], source[stride], source[2 * stride], source[3 * stride]);
+    g = _mm_setr_ps(source[1], source[stride + 1], source[2 * stride + 1], source[3 * stride + 1]);
+    b = _mm_setr_ps(source[2], source[stride + 2], source[2 * stride + 2], source[3 * stride + 2]);
+}
+
+#endif
+
+/* Upload conversions */
+
+enum class Conversion
+{
+    none,
+    expand_rgb,
+    swizzle_bgra,
+    half,
+    srgb,
+    r11g11b10f,
+    rgb9e5
+};
+
+auto getComponentCount(DataFormat format) -> int
+{
+    switch (format)
+    {
+        case DataFormat::rg:
+            return 2;
+        case DataFormat::rgb:
+        case DataFormat::bgr:
+            return 3;
+        case DataFormat::rgba:
+        case DataFormat::bgra:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+auto getConversion(SizedInternalFormat internal_format, DataFormat format, DataType type, bool encode_srgb)
+        -> Conversion
+{
+    const bool rgb_or_rgba = format == DataFormat::rgb || format == DataFormat::rgba;
+    const bool srgb = encode_srgb && type == DataType::_float && rgb_or_rgba;
+
+    switch (internal_format)
+    {
+        case SizedInternalFormat::rgba8:
+        case SizedInternalFormat::srgb8_alpha8:
+            if (type == DataType::ubyte && format == DataFormat::rgb)
+                return Conversion::expand_rgb;
+            if (type == DataType::ubyte && format == DataFormat::bgra)
+                return Conversion::swizzle_bgra;
+            if (srgb && internal_format == SizedInternalFormat::srgb8_alpha8)
+                return Conversion::srgb;
+            return Conversion::none;
+        case SizedInternalFormat::srgb8:
+            return srgb ? Conversion::srgb : Conversion::none;
+        case SizedInternalFormat::r16f:
+        case SizedInternalFormat::rg16f:
+        case SizedInternalFormat::rgb16f:
+        case SizedInternalFormat::rgba16f:
+            return type == DataType::_float ? Conversion::half : Conversion::none;
+        case SizedInternalFormat::r11f_g11f_b10f:
+            return type == DataType::_float && rgb_or_rgba ? Conversion::r11g11b10f : Conversion::none;
+        case SizedInternalFormat::rgb9_e5:
+            return type == DataType::_float && rgb_or_rgba ? Conversion::rgb9e5 : Conversion::none;
+        default:
+            return Conversion::none;
+    }
+}
+
+// Bytes per converted pixel.
+auto getConvertedPixelSize(Conversion conversion, int component_count) -> GLsizei
+{
+    switch (conversion)
+    {
+        case Conversion::half:
+            return 2 * component_count;
+        case Conversion::srgb:
+            return component_count;
+        default:
+            return 4;
+    }
+}
+
+void convert(Conversion conversion, int component_count, const void *source, void *destination,
+             std::size_t pixel_count)
+{
+    switch (conversion)
+    {
+        case Conversion::none:
+            break;
+        case Conversion::expand_rgb:
+            expandRGBToRGBA(static_cast<const std::uint8_t *>(source), static_cast<std::uint8_t *>(destination),
+                            pixel_count);
+            break;
+        case Conversion::swizzle_bgra:
+            swizzleBGRA(static_cast<const std::uint8_t *>(source), static_cast<std::uint8_t *>(destination),
+                        pixel_count);
+            break;
+        case Conversion::half:
+            convertFloatToHalf(static_cast<const float *>(source), static_cast<std::uint16_t *>(destination),
+                               pixel_count * component_count);
+            break;
+        case Conversion::srgb:
+            convertLinearToSRGB(static_cast<const float *>(source), static_cast<std::uint8_t *>(destination),
+                                pixel_count, component_count);
+            break;
+        case Conversion::r11g11b10f:
+            packR11G11B10F(static_cast<const float *>(source), static_cast<std::uint32_t *>(destination),
+                           pixel_count, component_count);
+            break;
+        case Conversion::rgb9e5:
+            packRGB9E5(static_cast<const float *>(source), static_cast<std::uint32_t *>(destination), pixel_count,
+                       component_count);
+            break;
+    }
+}
+
+} // namespace
+
+auto floatToHalf(float f) -> std::uint16_t
+{
+    std::uint32_t x = toBits(f);
+
+    const auto sign = std::uint16_t((x >> 16) & 0x8000u);
+    x &= 0x7FFFFFFFu;
+
+    if (x >= 0x7F800000u) // inf or nan
+        return sign | 0x7C00u | (x > 0x7F800000u ? 0x200u : 0u);
+    if (x >= 0x477FF000u) // rounds to a value larger than the largest half
+        return sign | 0x7C00u;
+    if (x < 0x38800000u) // subnormal half
+        return sign | std::uint16_t(std::nearbyint(std::fabs(f) * 16777216.f));
+
+    // round to nearest even
+    x += 0x0FFFu + ((x >> 13) & 1u);
+    return sign | std::uint16_t((x - 0x38000000u) >> 13);
+}
+
+auto halfToFloat(std::uint16_t h) -> float
+{
+    const std::uint32_t sign = std::uint32_t(h & 0x8000u) << 16;
+    const std::uint32_t exponent = (h >> 10) & 0x1Fu;
+    const std::uint32_t mantissa = h & 0x3FFu;
+
+    if (exponent == 0)
+    {
+        const float value = std::ldexp(float(mantissa), -24);
+        return sign ? -value : value;
+    }
+    else if (exponent == 31)
+        return fromBits(sign | 0x7F800000u | (mantissa << 13));
+    else
+        return fromBits(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+void expandRGBToRGBA(const std::uint8_t *source, std::uint8_t *destination, std::size_t pixel_count,
+                     std::uint8_t alpha)
+{
+    std::size_t i = 0;
+
+#if defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha_mask = _mm_set1_epi32(int(std::uint32_t(alpha) << 24));
+
+    // each load reads 16 bytes to use 12, so stop while a full load still fits
+    for (; i + 6 <= pixel_count; i += 4)
+    {
+        const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i * 4),
+                         _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha_mask));
+    }
+#endif
+
+    for (; i < pixel_count; i++)
+    {
+        destination[i * 4] = source[i * 3];
+        destination[i * 4 + 1] = source[i * 3 + 1];
+        destination[i * 4 + 2] = source[i * 3 + 2];
+        destination[i * 4 + 3] = alpha;
+    }
+}
+
+void swizzleBGRA(const std::uint8_t *source, std::uint8_t *destination, std::size_t pixel_count)
+{
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i keep = _mm_set1_epi32(int(0xFF00FF00u));
+    const __m128i low = _mm_set1_epi32(0x000000FF);
+
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i * 4));
+        const __m128i swapped = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pixels, low), 16),
+                                             _mm_and_si128(_mm_srli_epi32(pixels, 16), low));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i * 4),
+                         _mm_or_si128(_mm_and_si128(pixels, keep), swapped));
+    }
+#endif
+
+    for (; i < pixel_count; i++)
+    {
+        const std::uint8_t first = source[i * 4];
+        destination[i * 4] = source[i * 4 + 2];
+        destination[i * 4 + 1] = source[i * 4 + 1];
+        destination[i * 4 + 2] = first;
+        destination[i * 4 + 3] = source[i * 4 + 3];
+    }
+}
+
+void convertFloatToHalf(const float *source, std::uint16_t *destination, std::size_t count)
+{
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i sign_mask = _mm_set1_epi32(int(0x80000000u));
+    const __m128i infinity = _mm_set1_epi32(0x7F800000);
+    const __m128i too_large = _mm_set1_epi32(0x477FFFFF);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i halves[2];
+        for (int j = 0; j < 2; j++)
+        {
+            const __m128i bits = _mm_castps_si128(_mm_loadu_ps(source + i + j * 4));
+            const __m128i sign = _mm_and_si128(bits, sign_mask);
+            const __m128i magnitude = _mm_xor_si128(bits, sign);
+
+            // values from 65520 up to 65536 round to infinity in the normal path, larger ones are set explicitly
+            __m128i half = packUnsignedFloat(magnitude, 10);
+            const __m128i special = _mm_cmpgt_epi32(magnitude, too_large);
+            const __m128i nan = _mm_cmpgt_epi32(magnitude, infinity);
+            half = select(special, select(nan, _mm_set1_epi32(0x7E00), _mm_set1_epi32(0x7C00)), half);
+
+            // move into signed range for the saturating pack, then back
+            halves[j] = _mm_sub_epi32(_mm_or_si128(half, _mm_srli_epi32(sign, 16)), _mm_set1_epi32(0x8000));
+        }
+
+        const __m128i packed = _mm_xor_si128(_mm_packs_epi32(halves[0], halves[1]), _mm_set1_epi16(-0x8000));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), packed);
+    }
+#endif
+
+    for (; i < count; i++)
+        destination[i] = floatToHalf(source[i]);
+}
+
+void convertLinearToSRGB(const float *source, std::uint8_t *destination, std::size_t pixel_count,
+                         int component_count)
+{
+    const std::vector<std::uint8_t> &table = getSrgbTable();
+    const bool has_alpha = component_count == 2 || component_count == 4;
+    const std::size_t count = pixel_count * component_count;
+
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    // table indices for color components, 255 * value for alpha
+    alignas(16) float scales[4];
+    for (int j = 0; j < 4; j++)
+        scales[j] = has_alpha && j % component_count == component_count - 1 ? 255.f : float(srgb_table_size - 1);
+
+    // with 4 components every vector has the same layout; otherwise go through the scalar loop. Both round by adding
+    // one half and truncating, so ties go the same way whichever path a component takes.
+    if (component_count == 4 || !has_alpha)
+    {
+        const __m128 scale = _mm_load_ps(scales);
+        alignas(16) std::int32_t values[4];
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + i), _mm_setzero_ps()), _mm_set1_ps(1.f));
+            _mm_store_si128(reinterpret_cast<__m128i *>(values),
+                            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), _mm_set1_ps(.5f))));
+
+            for (int j = 0; j < 4; j++)
+                destination[i + j] = has_alpha && j == 3 ? std::uint8_t(values[j])
+                                                         : table[std::size_t(values[j])];
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        const float v = std::clamp(source[i], 0.f, 1.f);
+        if (v != v)
+            destination[i] = 0;
+        else if (has_alpha && i % component_count == std::size_t(component_count - 1))
+            destination[i] = std::uint8_t(v * 255.f + .5f);
+        else
+            destination[i] = table[std::size_t(v * float(srgb_table_size - 1) + .5f)];
+    }
+}
+
+void packR11G11B10F(const float *source, std::uint32_t *destination, std::size_t pixel_count, int component_count)
+{
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        __m128 r, g, b;
+        loadRGB(source + i * component_count, component_count, r, g, b);
+
+        const __m128i packed = _mm_or_si128(
+                _mm_or_si128(packUnsignedFloat(_mm_castps_si128(clampUnsignedFloat(r, max_float11)), 6),
+                             _mm_slli_epi32(packUnsignedFloat(_mm_castps_si128(clampUnsignedFloat(g, max_float11)),
+                                                              6), 11)),
+                _mm_slli_epi32(packUnsignedFloat(_mm_castps_si128(clampUnsignedFloat(b, max_float10)), 5), 22));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), packed);
+    }
+#endif
+
+    for (; i < pixel_count; i++)
+        destination[i] = packPixelR11G11B10F(source + i * component_count);
+}
+
+void packRGB9E5(const float *source, std::uint32_t *destination, std::size_t pixel_count, int component_count)
+{
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i one = _mm_set1_epi32(1);
+
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        __m128 c[3];
+        loadRGB(source + i * component_count, component_count, c[0], c[1], c[2]);
+        for (__m128 &v: c)
+            v = clampUnsignedFloat(v, max_rgb9e5);
+        const __m128 max = _mm_max_ps(_mm_max_ps(c[0], c[1]), c[2]);
+
+        // exponent = max(-16, floor(log2(max))) + 16
+        __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(max), 23), _mm_set1_epi32(127));
+        const __m128i minimum = _mm_set1_epi32(-16);
+        exponent = _mm_add_epi32(select(_mm_cmplt_epi32(exponent, minimum), minimum, exponent),
+                                 _mm_set1_epi32(16));
+
+        // 2^(24 - exponent), the scale that maps the shared exponent's range onto the 9 bit mantissas
+        auto getScale = [](__m128i e)
+        { return _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(24 + 127), e), 23)); };
+
+        const __m128i max_mantissa = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(max, getScale(exponent)),
+                                                                 _mm_set1_ps(.5f)));
+        exponent = _mm_add_epi32(exponent, _mm_and_si128(_mm_cmpeq_epi32(max_mantissa, _mm_set1_epi32(512)), one));
+
+        const __m128 scale = getScale(exponent);
+        __m128i packed = _mm_slli_epi32(exponent, 27);
+        for (int j = 0; j < 3; j++)
+            packed = _mm_or_si128(packed, _mm_slli_epi32(
+                    _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c[j], scale), _mm_set1_ps(.5f))), 9 * j));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i), packed);
+    }
+#endif
+
+    for (; i < pixel_count; i++)
+        destination[i] = packPixelRGB9E5(source + i * component_count);
+}
+
+void uploadImage2D(TextureHandle texture, SizedInternalFormat internal_format, GLint level, GLint xoffset,
+                   GLint yoffset, GLsizei width, GLsizei height, DataFormat format, DataType type,
+                   const void *pixels, bool encode_srgb)
+{
+    PixelUnpackLayout layout;
+    layout.alignment = 1;
+
+    const Conversion conversion = getConversion(internal_format, format, type, encode_srgb);
+    if (conversion == Conversion::none)
+    {
+        texture.updateImage2D(level, xoffset, yoffset, width, height, format, type, pixels, layout);
+        return;
+    }
+
+    const int component_count = getComponentCount(format);
+    const std::size_t source_row_size = std::size_t(width) * TextureHandle::getPixelSize(format, type);
+    const std::size_t converted_row_size = std::size_t(width) * getConvertedPixelSize(conversion, component_count);
+
+    DataFormat upload_format = format;
+    DataType upload_type = DataType::ubyte;
+    switch (conversion)
+    {
+        case Conversion::expand_rgb:
+        case Conversion::swizzle_bgra:
+            upload_format = DataFormat::rgba;
+            break;
+        case Conversion::half:
+            upload_type = DataType::half_float;
+            break;
+        case Conversion::r11g11b10f:
+            upload_format = DataFormat::rgb;
+            upload_type = DataType::uint_10f_11f_11f_rev;
+            break;
+        case Conversion::rgb9e5:
+            upload_format = DataFormat::rgb;
+            upload_type = DataType::uint_5_9_9_9_rev;
+            break;
+        default:
+            break;
+    }
+
+    // convert about 256 KiB at a time so the converted rows are still in cache when the driver copies them
+    constexpr std::size_t band_size = 256 * 1024;
+    const GLsizei band_rows = std::clamp<GLsizei>(GLsizei(band_size / std::max<std::size_t>(1, converted_row_size)),
+                                                  1, std::max<GLsizei>(1, height));
+
+    thread_local std::vector<std::byte> scratch;
+    scratch.resize(converted_row_size * band_rows);
+
+    for (GLsizei row = 0; row < height; row += band_rows)
+    {
+        const GLsizei rows = std::min(band_rows, height - row);
+        convert(conversion, component_count, static_cast<const std::byte *>(pixels) + row * source_row_size,
+                scratch.data(), std::size_t(width) * rows);
+        texture.updateImage2D(level, xoffset, yoffset + row, width, rows, upload_format, upload_type,
+                              scratch.data(), layout);
+    }
+}
+
+} // GL
@@ -0,0 +1,53 @@
+#include "glutils/pixel_store.hpp"
+#include "glutils/gl.hpp"
+
+namespace GL {
+
+namespace {
+
+struct UnpackCache
+{
+    PixelUnpackLayout layout;
+    bool valid{false};
+};
+
+thread_local UnpackCache t_unpack_cache;
+
+void setParameter(GLenum pname, GLint value, GLint cached_value, bool force)
+{
+    if (force || value != cached_value)
+        glPixelStorei(pname, value);
+}
+
+} // namespace
+
+void setPixelUnpackLayout(const PixelUnpackLayout &layout)
+{
+    UnpackCache &cache = t_unpack_cache;
+    const bool force = !cache.valid;
+
+    if (!force && cache.layout == layout)
+        return;
+
+    setParameter(GL_UNPACK_ROW_LENGTH, layout.row_length, cache.layout.row_length, force);
+    setParameter(GL_UNPACK_IMAGE_HEIGHT, layout.image_height, cache.layout.image_height, force);
+    setParameter(GL_UNPACK_SKIP_PIXELS, layout.skip_pixels, cache.layout.skip_pixels, force);
+    setParameter(GL_UNPACK_SKIP_ROWS, layout.skip_rows, cache.layout.skip_rows, force);
+    setParameter(GL_UNPACK_SKIP_IMAGES, layout.skip_images, cache.layout.skip_images, force);
+    setParameter(GL_UNPACK_ALIGNMENT, layout.alignment, cache.layout.alignment, force);
+
+    cache.layout = layout;
+    cache.valid = true;
+}
+
+auto getPixelUnpackLayout() -> PixelUnpackLayout
+{
+    return t_unpack_cache.layout;
+}
+
+void resetPixelUnpackCache()
+{
+    t_unpack_cache.valid = false;
+}
+
+} // GL
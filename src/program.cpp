@@ -1,8 +1,11 @@
 #include "glutils/program.hpp"
 #include "glutils/gl.hpp"
+#include "glutils/error.hpp"
 
 #include "glm/gtc/type_ptr.hpp"
 
+#include <vector>
+
 namespace GL {
 
 auto ProgramHandle::create() -> ProgramHandle
@@ -110,6 +113,35 @@ void ProgramHandle::bindAttribLocation(GLuint index, const char *name) const
     glBindAttribLocation(m_name, index, name);
 }
 
+auto buildProgram(std::initializer_list<std::pair<ShaderHandle::Type, std::string>> sources) -> Program
+{
+    Program program;
+    std::vector<Shader> shaders;
+    shaders.reserve(sources.size());
+
+    for (const auto &[type, source]: sources)
+    {
+        Shader &shader = shaders.emplace_back(type);
+        shader.setSource(source);
+        shader.compile();
+
+        if (!shader.getParameter(ShaderHandle::Parameter::compile_status))
+            throw Error("shader compilation failed: " + shader.getInfoLog());
+
+        program.attachShader(shader);
+    }
+
+    program.link();
+
+    for (const Shader &shader: shaders)
+        program.detachShader(shader);
+
+    if (!program.getParameter(ProgramHandle::Parameter::link_status))
+        throw Error("program linking failed: " + program.getInfoLog());
+
+    return program;
+}
+
 #define GLUTILS_PROGRAM_UNIFORM(N, SUFFIX) glProgramUniform##N##SUFFIX
 #define GLUTILS_PROGRAM_UNIFORM_FUNCTIONS_DEFINITION(TYPE, TYPE_SUFFIX) \
     template<> const Program::GLProgramUniformFunctions<TYPE> ProgramHandle::s_program_uniform_functions<TYPE> \
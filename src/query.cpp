@@ -0,0 +1,60 @@
+#include "glutils/query.hpp"
+
+#include "glutils/gl.hpp"
+
+namespace GL {
+
+auto QueryHandle::create(Target target) -> QueryHandle
+{
+    QueryHandle new_handle;
+    glCreateQueries(GLenum(target), 1, &new_handle.m_name);
+    return new_handle;
+}
+
+void QueryHandle::destroy(QueryHandle query)
+{
+    glDeleteQueries(1, &query.m_name);
+}
+
+void QueryHandle::begin(Target target) const
+{
+    glBeginQuery(GLenum(target), m_name);
+}
+
+void QueryHandle::end(Target target)
+{
+    glEndQuery(GLenum(target));
+}
+
+void QueryHandle::queryCounter() const
+{
+    glQueryCounter(m_name, GL_TIMESTAMP);
+}
+
+auto QueryHandle::isResultAvailable() const -> bool
+{
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(m_name, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available;
+}
+
+auto QueryHandle::getResult() const -> GLuint64
+{
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(m_name, GL_QUERY_RESULT, &result);
+    return result;
+}
+
+void QueryHandle::writeResult(BufferHandle buffer, GLintptr offset) const
+{
+    glGetQueryBufferObjectui64v(m_name, buffer.getName(), GL_QUERY_RESULT, offset);
+}
+
+auto QueryHandle::getTimestamp() -> GLint64
+{
+    GLint64 timestamp = 0;
+    glGetInteger64v(GL_TIMESTAMP, &timestamp);
+    return timestamp;
+}
+
+} // GL
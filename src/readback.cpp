@@ -0,0 +1,318 @@
+#include "glutils/readback.hpp"
+#include "glutils/compute.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+#include "glutils/memory_barrier.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace GL {
+
+namespace {
+
+// glGetTextureSubImage and glReadPixels require buffer offsets to be a multiple of the size of the pixel data type.
+constexpr GLsizeiptr request_alignment = 16;
+
+// GL_PACK_ALIGNMENT defaults to 4
+constexpr GLsizeiptr row_alignment = 4;
+
+constexpr GLuint group_size = 8;
+
+constexpr auto alignUp(GLsizeiptr value, GLsizeiptr alignment) -> GLsizeiptr
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+auto getConvertSource(ReadbackRing::Conversion conversion) -> std::string
+{
+    std::ostringstream src;
+
+    src << "#version 450\n"
+           "layout(local_size_x = " << group_size << ", local_size_y = " << group_size << ") in;\n"
+        << R"glsl(
+layout(binding = 0) uniform sampler2D u_source;
+layout(std430, binding = 0) restrict writeonly buffer Destination { uint u_data[]; };
+layout(location = 0) uniform ivec2 u_origin;
+layout(location = 1) uniform ivec2 u_size;
+layout(location = 2) uniform int u_level;
+// in words, not bytes
+layout(location = 3) uniform uint u_offset;
+
+vec4 fetch(int x, int y)
+{
+    return texelFetch(u_source, u_origin + min(ivec2(x, y), u_size - 1), u_level);
+}
+)glsl";
+
+    if (conversion == ReadbackRing::Conversion::rgba8)
+        src << R"glsl(
+void main()
+{
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(p, u_size)))
+        return;
+
+    u_data[u_offset + p.y * u_size.x + p.x] = packUnorm4x8(fetch(p.x, p.y));
+}
+)glsl";
+    else
+        src << R"glsl(
+const vec3 luma_weights = vec3(0.2126, 0.7152, 0.0722);
+
+// four luma samples per word
+void storeLuma(ivec2 p, int row_words)
+{
+    vec4 y;
+    for (int i = 0; i < 4; i++)
+        y[i] = (16.0 + 219.0 * dot(fetch(4 * p.x + i, p.y).rgb, luma_weights)) / 255.0;
+    u_data[u_offset + p.y * row_words + p.x] = packUnorm4x8(y);
+}
+
+// two UV pairs per word, each from the average of a 2x2 block
+void storeChroma(ivec2 p, int row_words, uint plane_offset)
+{
+    vec4 uv;
+    for (int i = 0; i < 2; i++)
+    {
+        ivec2 q = 2 * ivec2(2 * p.x + i, p.y);
+        vec3 rgb = 0.25 * (fetch(q.x, q.y).rgb + fetch(q.x + 1, q.y).rgb + fetch(q.x, q.y + 1).rgb
+                           + fetch(q.x + 1, q.y + 1).rgb);
+        float y = dot(rgb, luma_weights);
+        uv[2 * i] = (128.0 + 224.0 * (rgb.b - y) / 1.8556) / 255.0;
+        uv[2 * i + 1] = (128.0 + 224.0 * (rgb.r - y) / 1.5748) / 255.0;
+    }
+    u_data[plane_offset + p.y * row_words + p.x] = packUnorm4x8(uv);
+}
+
+void main()
+{
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    int luma_words = (u_size.x + 3) / 4;
+    ivec2 chroma_size = (u_size + 1) / 2;
+    int chroma_words = (2 * chroma_size.x + 3) / 4;
+
+    if (p.x < luma_words && p.y < u_size.y)
+        storeLuma(p, luma_words);
+    if (p.x < chroma_words && p.y < chroma_size.y)
+        storeChroma(p, chroma_words, u_offset + uint(luma_words * u_size.y));
+}
+)glsl";
+
+    return src.str();
+}
+
+} // namespace
+
+ReadbackRing::ReadbackRing(GLsizeiptr size) : m_size(alignUp(size, request_alignment))
+{
+    using StorageFlags = BufferHandle::StorageFlags;
+    using AccessFlags = BufferHandle::AccessFlags;
+
+    m_buffer.allocateImmutable(m_size, StorageFlags::map_read | StorageFlags::map_persistent
+                                       | StorageFlags::map_coherent);
+    m_mapping = static_cast<std::byte *>(m_buffer.mapRange(0, m_size, AccessFlags::read | AccessFlags::persistent
+                                                                      | AccessFlags::coherent));
+    if (!m_mapping)
+        throw Error("failed to map readback buffer");
+}
+
+ReadbackRing::~ReadbackRing()
+{
+    if (m_mapping)
+        m_buffer.unmap();
+}
+
+auto ReadbackRing::readTexture(TextureHandle texture, GLint level, GLint x, GLint y, GLint z, GLsizei width,
+                               GLsizei height, TextureHandle::DataFormat format, TextureHandle::DataType type,
+                               Callback callback) -> std::uint64_t
+{
+    const GLsizeiptr row_stride = alignUp(GLsizeiptr(width) * TextureHandle::getPixelSize(format, type),
+                                          row_alignment);
+    const GLsizeiptr size = row_stride * height;
+
+    GLintptr offset;
+    if (!allocate(size, offset))
+        return 0;
+
+    m_buffer.bind(BufferHandle::Target::pixel_pack);
+    glGetTextureSubImage(texture.getName(), level, x, y, z, width, height, 1, GLenum(format), GLenum(type),
+                         GLsizei(size), reinterpret_cast<void *>(offset));
+    BufferHandle::unbind(BufferHandle::Target::pixel_pack);
+
+    return submit(offset, {0, nullptr, size, width, height, row_stride, 0, 0}, std::move(callback));
+}
+
+auto ReadbackRing::readFramebuffer(FramebufferHandle framebuffer, GLint x, GLint y, GLsizei width,
+                                   GLsizei height, TextureHandle::DataFormat format, TextureHandle::DataType type,
+                                   Callback callback) -> std::uint64_t
+{
+    const GLsizeiptr row_stride = alignUp(GLsizeiptr(width) * TextureHandle::getPixelSize(format, type),
+                                          row_alignment);
+    const GLsizeiptr size = row_stride * height;
+
+    GLintptr offset;
+    if (!allocate(size, offset))
+        return 0;
+
+    framebuffer.bind(FramebufferHandle::Target::read);
+    m_buffer.bind(BufferHandle::Target::pixel_pack);
+    glReadPixels(x, y, width, height, GLenum(format), GLenum(type), reinterpret_cast<void *>(offset));
+    BufferHandle::unbind(BufferHandle::Target::pixel_pack);
+    FramebufferHandle::unbind(FramebufferHandle::Target::read);
+
+    return submit(offset, {0, nullptr, size, width, height, row_stride, 0, 0}, std::move(callback));
+}
+
+auto ReadbackRing::readConverted(TextureHandle texture, GLint level, GLint x, GLint y, GLsizei width,
+                                 GLsizei height, Conversion conversion, Callback callback) -> std::uint64_t
+{
+    Result result{0, nullptr, 0, width, height, 0, 0, 0};
+    GLuint groups_x;
+
+    switch (conversion)
+    {
+        case Conversion::rgba8:
+            result.row_stride = GLsizeiptr(width) * 4;
+            result.size = result.row_stride * height;
+            groups_x = (width + group_size - 1) / group_size;
+            break;
+        case Conversion::nv12:
+            result.row_stride = alignUp(width, row_alignment);
+            result.chroma_offset = result.row_stride * height;
+            result.chroma_row_stride = alignUp(GLsizeiptr((width + 1) / 2) * 2, row_alignment);
+            result.size = result.chroma_offset + result.chroma_row_stride * ((height + 1) / 2);
+            // each invocation writes a word of both planes
+            groups_x = GLuint((std::max(result.row_stride, result.chroma_row_stride) / 4 + group_size - 1)
+                              / group_size);
+            break;
+        default:
+            throw Error("readConverted() requires a conversion");
+    }
+
+    GLintptr offset;
+    if (!allocate(result.size, offset))
+        return 0;
+
+    const ProgramHandle program = getConvertProgram(conversion);
+    TextureHandle::bindTextureUnit(0, texture);
+    m_buffer.bindBase(BufferHandle::IndexedTarget::shader_storage, 0);
+    program.use();
+    glProgramUniform2i(program.getName(), 0, x, y);
+    glProgramUniform2i(program.getName(), 1, width, height);
+    glProgramUniform1i(program.getName(), 2, level);
+    glProgramUniform1ui(program.getName(), 3, GLuint(offset / 4));
+
+    dispatchCompute(groups_x, (height + group_size - 1) / group_size);
+
+    // shader writes to a persistent mapping aren't covered by the fence alone
+    memoryBarrier(MemoryBarrierBits::client_mapped_buffer);
+
+    return submit(offset, result, std::move(callback));
+}
+
+void ReadbackRing::poll()
+{
+    while (!m_requests.empty())
+    {
+        const auto status = m_requests.front().fence.clientWait(false);
+
+        if (status != Sync::Status::already_signaled && status != Sync::Status::condition_satisfied)
+            break;
+
+        complete();
+    }
+}
+
+void ReadbackRing::finish()
+{
+    while (!m_requests.empty())
+    {
+        const auto status = m_requests.front().fence.clientWait(true, std::chrono::seconds(1));
+
+        if (status == Sync::Status::wait_failed)
+            throw Error("failed to wait for a readback");
+        if (status != Sync::Status::timeout_expired)
+            complete();
+    }
+}
+
+auto ReadbackRing::allocate(GLsizeiptr size, GLintptr &offset) -> bool
+{
+    m_stats.requested++;
+
+    const GLsizeiptr aligned_size = alignUp(size, request_alignment);
+    GLintptr begin = m_head;
+    bool fits;
+
+    if (m_requests.empty())
+    {
+        begin = offset = 0;
+        fits = aligned_size <= m_size;
+    }
+    else
+    {
+        const GLintptr tail = m_requests.front().begin;
+
+        if (m_head > tail)
+        {
+            if (m_size - m_head >= aligned_size)
+                offset = m_head;
+            else
+                // skip the end of the ring; the padding is released together with this request
+                offset = 0;
+            fits = offset == m_head || tail >= aligned_size;
+        }
+        else
+        {
+            offset = m_head;
+            fits = tail - m_head >= aligned_size;
+        }
+    }
+
+    if (!fits)
+    {
+        m_stats.dropped++;
+        return false;
+    }
+
+    m_head = offset + aligned_size;
+    m_requests.push_back({{}, begin, m_head, nullptr, Sync(nullptr)});
+
+    return true;
+}
+
+auto ReadbackRing::submit(GLintptr offset, Result result, Callback callback) -> std::uint64_t
+{
+    Request &request = m_requests.back();
+    result.id = m_next_id++;
+    result.data = m_mapping + offset;
+    request.result = result;
+    request.callback = std::move(callback);
+    request.fence = createFenceSync();
+
+    return result.id;
+}
+
+void ReadbackRing::complete()
+{
+    // the request keeps its memory while the callback runs, so the callback may make new requests
+    const Request &request = m_requests.front();
+    if (request.callback)
+        request.callback(request.result);
+
+    m_stats.completed++;
+    m_stats.bytes_read += std::size_t(request.result.size);
+    m_requests.pop_front();
+}
+
+auto ReadbackRing::getConvertProgram(Conversion conversion) -> ProgramHandle
+{
+    Program &program = m_convert_programs[conversion == Conversion::rgba8 ? 0 : 1];
+    if (!program)
+        program = buildProgram({{ShaderHandle::Type::compute, getConvertSource(conversion)}});
+    return program;
+}
+
+} // GL
@@ -0,0 +1,436 @@
+#include "glutils/render_graph.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace GL {
+
+namespace {
+
+using Type = TextureHandle::Type;
+using TextureDescription = RenderGraph::TextureDescription;
+
+// the bits of GL_ALL_BARRIER_BITS that name a way of consuming data
+constexpr GLbitfield all_barrier_bits = 0xFFEF;
+
+// writes through these paths aren't visible to later commands without a barrier
+constexpr GLbitfield incoherent_writes = GLbitfield(MemoryBarrierBits::shader_image_access)
+                                         | GLbitfield(MemoryBarrierBits::shader_storage)
+                                         | GLbitfield(MemoryBarrierBits::atomic_counter);
+
+auto countBits(GLbitfield bits) -> std::size_t
+{
+    std::size_t count = 0;
+    for (; bits; bits &= bits - 1)
+        count++;
+    return count;
+}
+
+bool operator==(const TextureDescription &l, const TextureDescription &r)
+{
+    return l.type == r.type && l.format == r.format && l.width == r.width && l.height == r.height
+           && l.depth == r.depth && l.levels == r.levels && l.samples == r.samples;
+}
+
+auto getTextureBytes(const TextureDescription &description) -> std::size_t
+{
+    std::size_t bytes = 0;
+    for (GLint level = 0; level < description.levels; level++)
+    {
+        const GLsizei width = std::max(1, description.width >> level);
+        const GLsizei height = std::max(1, description.height >> level);
+        const GLsizei depth = description.type == Type::_3d ? std::max(1, description.depth >> level)
+                                                            : description.type == Type::cube_map ? 6
+                                                                                                 : description.depth;
+        bytes += std::size_t(TextureHandle::getImageSize(description.format, width, height, depth));
+    }
+    return bytes * std::max(1, description.samples);
+}
+
+auto makeTexture(const TextureDescription &description) -> Texture
+{
+    Texture texture{description.type};
+
+    switch (description.type)
+    {
+        case Type::_2d:
+        case Type::cube_map:
+            texture.setStorage2D(description.levels, description.format, description.width, description.height);
+            break;
+        case Type::_2d_array:
+        case Type::_3d:
+            texture.setStorage3D(description.levels, description.format, description.width, description.height,
+                                 description.depth);
+            break;
+        case Type::_2d_multisample:
+            texture.setStorage2DMultisample(description.samples, description.format, description.width,
+                                            description.height);
+            break;
+        default:
+            throw Error("unsupported render graph texture type");
+    }
+
+    return texture;
+}
+
+} // namespace
+
+auto RenderGraph::PassBuilder::read(ResourceId resource, MemoryBarrierBits usage) -> PassBuilder &
+{
+    m_graph.getResource(resource);
+    m_graph.m_passes[m_pass].accesses.push_back({resource, usage, false});
+    return *this;
+}
+
+auto RenderGraph::PassBuilder::write(ResourceId resource, MemoryBarrierBits usage) -> PassBuilder &
+{
+    m_graph.getResource(resource);
+    m_graph.m_passes[m_pass].accesses.push_back({resource, usage, true});
+    return *this;
+}
+
+auto RenderGraph::PassBuilder::setSideEffects() -> PassBuilder &
+{
+    m_graph.m_passes[m_pass].side_effects = true;
+    return *this;
+}
+
+RenderGraph::RenderGraph() : RenderGraph(Options{})
+{}
+
+RenderGraph::RenderGraph(const Options &options) : m_options(options)
+{}
+
+auto RenderGraph::addResource(Resource resource) -> ResourceId
+{
+    if (m_compiled)
+        throw Error("resources can't be added to a compiled render graph");
+
+    m_resources.emplace_back(std::move(resource));
+    return ResourceId(m_resources.size() - 1);
+}
+
+auto RenderGraph::createTexture(std::string name, const TextureDescription &description) -> ResourceId
+{
+    if (description.width <= 0 || description.height <= 0 || description.depth <= 0 || description.levels <= 0)
+        throw Error("render graph texture must have a positive size and level count");
+
+    return addResource({std::move(name), true, false, description, 0, 0, {}, {}});
+}
+
+auto RenderGraph::createBuffer(std::string name, const BufferDescription &description) -> ResourceId
+{
+    if (description.size <= 0)
+        throw Error("render graph buffer must have a positive size");
+
+    return addResource({std::move(name), false, false, {}, description.size, 0, {}, {}});
+}
+
+auto RenderGraph::importTexture(std::string name, TextureHandle texture) -> ResourceId
+{
+    return addResource({std::move(name), true, true, {}, 0, 0, texture, {}});
+}
+
+auto RenderGraph::importBuffer(std::string name, BufferHandle buffer) -> ResourceId
+{
+    return addResource({std::move(name), false, true, {}, 0, 0, {}, buffer});
+}
+
+auto RenderGraph::addPass(std::string name, Execute execute) -> PassBuilder
+{
+    if (m_compiled)
+        throw Error("passes can't be added to a compiled render graph");
+
+    Pass &pass = m_passes.emplace_back();
+    pass.name = std::move(name);
+    pass.execute = std::move(execute);
+    return {*this, m_passes.size() - 1};
+}
+
+auto RenderGraph::getResource(ResourceId resource) const -> const Resource &
+{
+    if (resource >= m_resources.size())
+        throw Error("invalid render graph resource id");
+    return m_resources[resource];
+}
+
+void RenderGraph::cull()
+{
+    // walk backwards, keeping the writers of whatever a kept pass reads
+    std::vector<bool> needed(m_resources.size(), false);
+
+    for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass)
+    {
+        bool keep = pass->side_effects;
+        for (const Access &access: pass->accesses)
+            if (access.write && (m_resources[access.resource].imported || needed[access.resource]))
+                keep = true;
+
+        pass->culled = !keep;
+        if (keep)
+            for (const Access &access: pass->accesses)
+                if (!access.write)
+                    needed[access.resource] = true;
+    }
+}
+
+void RenderGraph::compile()
+{
+    if (m_compiled)
+        throw Error("render graph is already compiled");
+
+    cull();
+
+    // lifetimes of the transients, in pass indices
+    constexpr std::size_t unused = ~std::size_t(0);
+    std::vector<std::size_t> first(m_resources.size(), unused);
+    std::vector<std::size_t> last(m_resources.size(), unused);
+
+    for (std::size_t i = 0; i < m_passes.size(); i++)
+    {
+        if (m_passes[i].culled)
+            continue;
+        for (const Access &access: m_passes[i].accesses)
+        {
+            if (first[access.resource] == unused)
+                first[access.resource] = i;
+            last[access.resource] = i;
+        }
+    }
+
+    m_stats = {};
+    m_stats.passes = m_passes.size();
+    for (const Pass &pass: m_passes)
+        m_stats.culled_passes += pass.culled;
+
+    std::vector<bool> used_textures(m_textures.size(), false);
+    std::vector<bool> used_buffers(m_buffers.size(), false);
+    std::size_t live_bytes = 0;
+
+    for (std::size_t i = 0; i < m_passes.size(); i++)
+    {
+        if (m_passes[i].culled)
+            continue;
+
+        for (const Access &access: m_passes[i].accesses)
+        {
+            Resource &resource = m_resources[access.resource];
+            if (resource.imported || first[access.resource] != i || resource.texture || resource.buffer)
+                continue;
+
+            if (resource.is_texture)
+            {
+                resource.physical = acquireTexture(resource.texture_description);
+                resource.texture = m_textures[resource.physical].texture;
+                live_bytes += m_textures[resource.physical].bytes;
+                m_stats.transient_textures++;
+                m_stats.unaliased_bytes += getTextureBytes(resource.texture_description);
+                used_textures.resize(m_textures.size(), false);
+                used_textures[resource.physical] = true;
+            }
+            else
+            {
+                resource.physical = acquireBuffer(resource.buffer_size);
+                resource.buffer = m_buffers[resource.physical].buffer;
+                live_bytes += std::size_t(m_buffers[resource.physical].size);
+                m_stats.transient_buffers++;
+                m_stats.unaliased_bytes += std::size_t(resource.buffer_size);
+                used_buffers.resize(m_buffers.size(), false);
+                used_buffers[resource.physical] = true;
+            }
+        }
+
+        m_stats.peak_bytes = std::max(m_stats.peak_bytes, live_bytes);
+
+        // release the storage of transients whose last pass this is, for the following passes
+        for (ResourceId id = 0; id < m_resources.size(); id++)
+        {
+            const Resource &resource = m_resources[id];
+            if (resource.imported || last[id] != i)
+                continue;
+
+            m_passes[i].released.emplace_back(id);
+            if (resource.is_texture)
+            {
+                m_textures[resource.physical].in_use = false;
+                live_bytes -= m_textures[resource.physical].bytes;
+            }
+            else
+            {
+                m_buffers[resource.physical].in_use = false;
+                live_bytes -= std::size_t(m_buffers[resource.physical].size);
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < used_textures.size(); i++)
+        if (used_textures[i])
+        {
+            m_stats.physical_textures++;
+            m_stats.aliased_bytes += m_textures[i].bytes;
+        }
+    for (std::size_t i = 0; i < used_buffers.size(); i++)
+        if (used_buffers[i])
+        {
+            m_stats.physical_buffers++;
+            m_stats.aliased_bytes += std::size_t(m_buffers[i].size);
+        }
+
+    m_compiled = true;
+}
+
+void RenderGraph::execute()
+{
+    if (!m_compiled)
+        throw Error("render graph must be compiled before it's executed");
+
+    // barrier bits each object still needs before it can be consumed that way, by object name and kind
+    std::unordered_map<std::uint64_t, GLbitfield> pending;
+    const auto getKey = [this](ResourceId id)
+    {
+        const Resource &resource = m_resources[id];
+        return resource.is_texture ? std::uint64_t(1) << 32 | resource.texture.getName()
+                                   : std::uint64_t(resource.buffer.getName());
+    };
+
+    for (Pass &pass: m_passes)
+    {
+        if (pass.culled)
+            continue;
+
+        GLbitfield required = 0;
+        for (const Access &access: pass.accesses)
+        {
+            const auto it = pending.find(getKey(access.resource));
+            if (it != pending.end())
+                required |= it->second & GLbitfield(access.usage);
+        }
+
+        if (required)
+        {
+            memoryBarrier(MemoryBarrierBits(required));
+            m_stats.barriers++;
+            m_stats.barrier_bits += countBits(required);
+
+            for (auto &[key, bits]: pending)
+                bits &= ~required;
+        }
+
+        if (pass.execute)
+            pass.execute(*this);
+
+        for (const Access &access: pass.accesses)
+            if (access.write && (GLbitfield(access.usage) & incoherent_writes))
+                pending[getKey(access.resource)] = all_barrier_bits;
+
+        // nothing reads these again this frame, so their content needn't be kept
+        for (ResourceId id: pass.released)
+        {
+            const Resource &resource = m_resources[id];
+            if (resource.is_texture)
+            {
+                for (GLint level = 0; level < resource.texture_description.levels; level++)
+                    glInvalidateTexImage(resource.texture.getName(), level);
+            }
+            else
+                glInvalidateBufferData(resource.buffer.getName());
+        }
+    }
+}
+
+void RenderGraph::reset()
+{
+    m_resources.clear();
+    m_passes.clear();
+    m_compiled = false;
+
+    evictUnused();
+    m_frame++;
+}
+
+auto RenderGraph::getTexture(ResourceId resource) const -> TextureHandle
+{
+    const Resource &r = getResource(resource);
+    if (!r.is_texture)
+        throw Error("render graph resource " + r.name + " is not a texture");
+    if (!r.texture)
+        throw Error("render graph texture " + r.name + " has no storage; it's unused or the graph isn't compiled");
+    return r.texture;
+}
+
+auto RenderGraph::getBuffer(ResourceId resource) const -> BufferHandle
+{
+    const Resource &r = getResource(resource);
+    if (r.is_texture)
+        throw Error("render graph resource " + r.name + " is not a buffer");
+    if (!r.buffer)
+        throw Error("render graph buffer " + r.name + " has no storage; it's unused or the graph isn't compiled");
+    return r.buffer;
+}
+
+auto RenderGraph::isPassCulled(std::size_t index) const -> bool
+{
+    if (index >= m_passes.size())
+        throw Error("invalid render graph pass index");
+    return m_passes[index].culled;
+}
+
+auto RenderGraph::acquireTexture(const TextureDescription &description) -> std::size_t
+{
+    for (std::size_t i = 0; i < m_textures.size(); i++)
+    {
+        PhysicalTexture &physical = m_textures[i];
+        if (!physical.in_use && physical.description == description)
+        {
+            physical.in_use = true;
+            physical.last_used = m_frame;
+            return i;
+        }
+    }
+
+    m_textures.push_back({makeTexture(description), description, getTextureBytes(description), m_frame, true});
+    return m_textures.size() - 1;
+}
+
+auto RenderGraph::acquireBuffer(GLsizeiptr size) -> std::size_t
+{
+    // the smallest free buffer that's large enough
+    std::size_t best = m_buffers.size();
+    for (std::size_t i = 0; i < m_buffers.size(); i++)
+        if (!m_buffers[i].in_use && m_buffers[i].size >= size
+            && (best == m_buffers.size() || m_buffers[i].size < m_buffers[best].size))
+            best = i;
+
+    if (best == m_buffers.size())
+    {
+        Buffer buffer;
+        buffer.allocateImmutable(size, BufferHandle::StorageFlags::dynamic_storage);
+        m_buffers.push_back({std::move(buffer), size, m_frame, false});
+    }
+
+    m_buffers[best].in_use = true;
+    m_buffers[best].last_used = m_frame;
+    return best;
+}
+
+void RenderGraph::evictUnused()
+{
+    const auto stale = [this](std::uint64_t last_used) { return last_used + m_options.evict_after_frames <= m_frame; };
+
+    m_textures.erase(std::remove_if(m_textures.begin(), m_textures.end(),
+                                    [&](const PhysicalTexture &texture) { return stale(texture.last_used); }),
+                     m_textures.end());
+    m_buffers.erase(std::remove_if(m_buffers.begin(), m_buffers.end(),
+                                   [&](const PhysicalBuffer &buffer) { return stale(buffer.last_used); }),
+                    m_buffers.end());
+
+    // a frame left uncompiled or unexecuted may have left storage marked as in use
+    for (PhysicalTexture &texture: m_textures)
+        texture.in_use = false;
+    for (PhysicalBuffer &buffer: m_buffers)
+        buffer.in_use = false;
+}
+
+} // GL
@@ -0,0 +1,234 @@
+#include "glutils/render_target_pool.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+
+#include <algorithm>
+
+namespace GL {
+
+namespace {
+
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+using Attachment = FramebufferHandle::Attachment;
+using Description = RenderTargetPool::Description;
+
+auto getDepthAttachment(SizedInternalFormat format) -> Attachment
+{
+    switch (format)
+    {
+        case SizedInternalFormat::depth24_stencil8:
+        case SizedInternalFormat::depth32f_stencil8:
+            return Attachment::depth_stencil;
+        case SizedInternalFormat::stencil_index8:
+            return Attachment::stencil;
+        default:
+            return Attachment::depth;
+    }
+}
+
+auto getBytes(const Description &description) -> std::size_t
+{
+    return std::size_t(TextureHandle::getImageSize(description.format, description.width, description.height))
+           * std::max(1, description.samples);
+}
+
+} // namespace
+
+bool operator==(const Description &l, const Description &r)
+{
+    return l.width == r.width && l.height == r.height && l.format == r.format && l.samples == r.samples;
+}
+
+auto RenderTargetPool::DescriptionHash::operator()(const Description &description) const noexcept -> std::size_t
+{
+    std::size_t seed = std::size_t(description.width) << 32 ^ std::size_t(description.height);
+    seed ^= (std::size_t(description.format) << 8 | std::size_t(description.samples)) * 0x9E3779B97F4A7C15ull;
+    return seed;
+}
+
+RenderTargetPool::RenderTargetPool() : RenderTargetPool(Options{})
+{}
+
+RenderTargetPool::RenderTargetPool(const Options &options) : m_options(options)
+{}
+
+auto RenderTargetPool::acquire(const Description &description) -> TextureHandle
+{
+    if (description.width <= 0 || description.height <= 0 || description.samples < 0)
+        throw Error("render target must have a positive size");
+
+    const auto free_targets = m_free.find(description);
+    const bool reuse = free_targets != m_free.end() && !free_targets->second.empty();
+    Target target = reuse ? std::move(free_targets->second.back()) : createTarget(description);
+    if (reuse)
+    {
+        free_targets->second.pop_back();
+        m_stats.reused++;
+    }
+
+    const TextureHandle texture = target.texture;
+    target.last_used = m_frame;
+    m_in_use.emplace(texture.getName(), std::move(target));
+    return texture;
+}
+
+void RenderTargetPool::release(TextureHandle texture)
+{
+    const auto it = m_in_use.find(texture.getName());
+    if (it == m_in_use.end())
+        throw Error("texture was not acquired from this render target pool");
+
+    // the content is dead; invalidating it through one framebuffer it's attached to covers the others
+    bool invalidated = false;
+    for (const auto &[attachments, cached]: m_framebuffers)
+    {
+        const auto position = std::find(attachments.begin(), attachments.end(), texture.getName());
+        if (position == attachments.end())
+            continue;
+
+        const Attachment attachment = position == attachments.begin()
+                                      ? cached.depth_attachment
+                                      : FramebufferHandle::color(GLuint(position - attachments.begin() - 1));
+        cached.framebuffer.invalidate(1, &attachment);
+        m_stats.invalidations++;
+        invalidated = true;
+        break;
+    }
+    if (!invalidated)
+    {
+        glInvalidateTexImage(texture.getName(), 0);
+        m_stats.invalidations++;
+    }
+
+    Target &target = it->second;
+    target.last_used = m_frame;
+    m_free[target.description].emplace_back(std::move(target));
+    m_in_use.erase(it);
+}
+
+auto RenderTargetPool::getFramebuffer(std::initializer_list<TextureHandle> colors,
+                                      TextureHandle depth) -> FramebufferHandle
+{
+    std::vector<GLuint> key;
+    key.reserve(colors.size() + 1);
+    key.emplace_back(depth.getName());
+    for (TextureHandle color: colors)
+        key.emplace_back(color.getName());
+
+    const auto cached = m_framebuffers.find(key);
+    if (cached != m_framebuffers.end())
+        return cached->second.framebuffer;
+
+    Framebuffer framebuffer;
+    m_stats.framebuffers_created++;
+
+    std::vector<Attachment> draw_buffers;
+    for (TextureHandle color: colors)
+    {
+        draw_buffers.emplace_back(FramebufferHandle::color(GLuint(draw_buffers.size())));
+        framebuffer.attachTexture(draw_buffers.back(), color);
+    }
+    if (draw_buffers.empty())
+        framebuffer.setDrawBuffer(Attachment::none);
+    else
+        framebuffer.setDrawBuffers(GLsizei(draw_buffers.size()), draw_buffers.data());
+
+    Attachment depth_attachment = Attachment::depth;
+    if (depth)
+    {
+        const auto in_use = m_in_use.find(depth.getName());
+        if (in_use != m_in_use.end())
+            depth_attachment = getDepthAttachment(in_use->second.description.format);
+        else
+        {
+            GLint format = 0;
+            glGetTextureLevelParameteriv(depth.getName(), 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+            depth_attachment = getDepthAttachment(SizedInternalFormat(format));
+        }
+        framebuffer.attachTexture(depth_attachment, depth);
+    }
+
+#if GLUTILS_DEBUG
+    if (framebuffer.checkStatus() != FramebufferHandle::Status::complete)
+        throw Error("render target framebuffer is incomplete");
+#endif
+
+    const FramebufferHandle handle = framebuffer;
+    m_framebuffers.emplace(std::move(key), CachedFramebuffer{std::move(framebuffer), depth_attachment});
+    return handle;
+}
+
+void RenderTargetPool::endFrame()
+{
+    for (auto &[description, targets]: m_free)
+    {
+        // the least recently released come first
+        const auto stale_end = std::find_if(targets.begin(), targets.end(), [&](const Target &target)
+        { return target.last_used + m_options.evict_after_frames > m_frame; });
+
+        for (auto it = targets.begin(); it != stale_end; ++it)
+            destroyTarget(*it);
+        targets.erase(targets.begin(), stale_end);
+    }
+
+    m_frame++;
+}
+
+void RenderTargetPool::trim()
+{
+    for (auto &[description, targets]: m_free)
+        for (Target &target: targets)
+            destroyTarget(target);
+    m_free.clear();
+}
+
+auto RenderTargetPool::getStats() const -> Stats
+{
+    Stats stats = m_stats;
+    stats.in_use = m_in_use.size();
+    stats.free = 0;
+    for (const auto &[description, targets]: m_free)
+        stats.free += targets.size();
+    stats.bytes = m_bytes;
+    return stats;
+}
+
+void RenderTargetPool::resetStats()
+{
+    m_stats = {};
+}
+
+auto RenderTargetPool::createTarget(const Description &description) -> Target
+{
+    Target target{Texture(description.samples > 0 ? TextureHandle::Type::_2d_multisample
+                                                  : TextureHandle::Type::_2d),
+                  description, m_frame};
+
+    if (description.samples > 0)
+        target.texture.setStorage2DMultisample(description.samples, description.format, description.width,
+                                               description.height);
+    else
+        target.texture.setStorage2D(1, description.format, description.width, description.height);
+
+    m_bytes += getBytes(description);
+    m_stats.created++;
+    return target;
+}
+
+void RenderTargetPool::destroyTarget(Target &target)
+{
+    const GLuint name = target.texture.getName();
+    for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();)
+    {
+        if (std::find(it->first.begin(), it->first.end(), name) != it->first.end())
+            it = m_framebuffers.erase(it);
+        else
+            ++it;
+    }
+
+    m_bytes -= getBytes(target.description);
+    m_stats.deleted++;
+    target.texture = Texture(TextureHandle());
+}
+
+} // GL
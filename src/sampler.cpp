@@ -0,0 +1,189 @@
+#include "glutils/sampler.hpp"
+
+#include "glutils/gl.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace GL {
+
+namespace {
+
+// Samplers bound to each texture unit by bindSamplers(), by name. Units past the end have unknown bindings.
+thread_local std::vector<GLuint> t_bound_samplers;
+
+void hashCombine(std::size_t &seed, std::size_t value)
+{
+    seed ^= value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2);
+}
+
+auto hashFloat(float value) -> std::size_t
+{
+    // -0 compares equal to +0, so it must hash the same
+    value += 0.f;
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+auto SamplerHandle::create() -> SamplerHandle
+{
+    SamplerHandle new_handle;
+    glCreateSamplers(1, &new_handle.m_name);
+    return new_handle;
+}
+
+void SamplerHandle::destroy(SamplerHandle sampler)
+{
+    glDeleteSamplers(1, &sampler.m_name);
+
+    // GL unbinds a deleted sampler from every unit, and may hand its name out again
+    for (GLuint &bound: t_bound_samplers)
+        if (bound == sampler.m_name)
+            bound = 0;
+}
+
+void SamplerHandle::setMinFilter(Filter filter) const
+{
+    glSamplerParameteri(m_name, GL_TEXTURE_MIN_FILTER, GLint(filter));
+}
+
+void SamplerHandle::setMagFilter(Filter filter) const
+{
+    glSamplerParameteri(m_name, GL_TEXTURE_MAG_FILTER, GLint(filter));
+}
+
+void SamplerHandle::setWrap(Wrap s, Wrap t, Wrap r) const
+{
+    glSamplerParameteri(m_name, GL_TEXTURE_WRAP_S, GLint(s));
+    glSamplerParameteri(m_name, GL_TEXTURE_WRAP_T, GLint(t));
+    glSamplerParameteri(m_name, GL_TEXTURE_WRAP_R, GLint(r));
+}
+
+void SamplerHandle::setMaxAnisotropy(float max_anisotropy) const
+{
+    glSamplerParameterf(m_name, GL_TEXTURE_MAX_ANISOTROPY, max_anisotropy);
+}
+
+void SamplerHandle::setLodBias(float bias) const
+{
+    glSamplerParameterf(m_name, GL_TEXTURE_LOD_BIAS, bias);
+}
+
+void SamplerHandle::setLodRange(float min_lod, float max_lod) const
+{
+    glSamplerParameterf(m_name, GL_TEXTURE_MIN_LOD, min_lod);
+    glSamplerParameterf(m_name, GL_TEXTURE_MAX_LOD, max_lod);
+}
+
+void SamplerHandle::setCompare(bool enabled, CompareFunc func) const
+{
+    glSamplerParameteri(m_name, GL_TEXTURE_COMPARE_MODE, enabled ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+    glSamplerParameteri(m_name, GL_TEXTURE_COMPARE_FUNC, GLint(func));
+}
+
+void SamplerHandle::setBorderColor(const float (&color)[4]) const
+{
+    glSamplerParameterfv(m_name, GL_TEXTURE_BORDER_COLOR, color);
+}
+
+bool operator==(const SamplerDescriptor &l, const SamplerDescriptor &r)
+{
+    return l.min_filter == r.min_filter && l.mag_filter == r.mag_filter && l.wrap_s == r.wrap_s
+           && l.wrap_t == r.wrap_t && l.wrap_r == r.wrap_r && l.max_anisotropy == r.max_anisotropy
+           && l.lod_bias == r.lod_bias && l.min_lod == r.min_lod && l.max_lod == r.max_lod && l.compare == r.compare
+           && l.compare_func == r.compare_func && std::equal(std::begin(l.border_color), std::end(l.border_color),
+                                                             std::begin(r.border_color));
+}
+
+auto SamplerDescriptorHash::operator()(const SamplerDescriptor &descriptor) const noexcept -> std::size_t
+{
+    std::size_t seed = 0;
+    hashCombine(seed, std::size_t(descriptor.min_filter));
+    hashCombine(seed, std::size_t(descriptor.mag_filter));
+    hashCombine(seed, std::size_t(descriptor.wrap_s));
+    hashCombine(seed, std::size_t(descriptor.wrap_t));
+    hashCombine(seed, std::size_t(descriptor.wrap_r));
+    hashCombine(seed, hashFloat(descriptor.max_anisotropy));
+    hashCombine(seed, hashFloat(descriptor.lod_bias));
+    hashCombine(seed, hashFloat(descriptor.min_lod));
+    hashCombine(seed, hashFloat(descriptor.max_lod));
+    hashCombine(seed, std::size_t(descriptor.compare));
+    hashCombine(seed, std::size_t(descriptor.compare_func));
+    for (float component: descriptor.border_color)
+        hashCombine(seed, hashFloat(component));
+    return seed;
+}
+
+auto SamplerCache::get(const SamplerDescriptor &descriptor) -> SamplerHandle
+{
+    const auto it = m_samplers.find(descriptor);
+    if (it != m_samplers.end())
+        return it->second;
+
+    Sampler sampler;
+    sampler.setMinFilter(descriptor.min_filter);
+    sampler.setMagFilter(descriptor.mag_filter);
+    sampler.setWrap(descriptor.wrap_s, descriptor.wrap_t, descriptor.wrap_r);
+    // anisotropy is core only since 4.6, so leave it alone unless it's wanted
+    if (descriptor.max_anisotropy > 1.f)
+        sampler.setMaxAnisotropy(descriptor.max_anisotropy);
+    sampler.setLodBias(descriptor.lod_bias);
+    sampler.setLodRange(descriptor.min_lod, descriptor.max_lod);
+    sampler.setCompare(descriptor.compare, descriptor.compare_func);
+    sampler.setBorderColor(descriptor.border_color);
+
+    return m_samplers.emplace(descriptor, std::move(sampler)).first->second;
+}
+
+void SamplerCache::clear()
+{
+    m_samplers.clear();
+    resetSamplerBindingCache();
+}
+
+void bindSamplers(GLuint first, GLsizei count, const SamplerHandle *samplers)
+{
+    std::vector<GLuint> &bound = t_bound_samplers;
+
+    // the range of units whose binding changes
+    GLsizei begin = count;
+    GLsizei end = 0;
+    for (GLsizei i = 0; i < count; i++)
+    {
+        const std::size_t unit = first + i;
+        if (unit >= bound.size() || bound[unit] != samplers[i].getName())
+        {
+            begin = std::min(begin, i);
+            end = i + 1;
+        }
+    }
+
+    if (begin >= end)
+        return;
+
+    if (bound.size() < first + end)
+        // a name that is never generated, so that the new units don't look bound
+        bound.resize(first + end, ~0u);
+
+    for (GLsizei i = begin; i < end; i++)
+        bound[first + i] = samplers[i].getName();
+
+    glBindSamplers(first + begin, end - begin, bound.data() + first + begin);
+}
+
+void bindSampler(GLuint unit, SamplerHandle sampler)
+{
+    bindSamplers(unit, 1, &sampler);
+}
+
+void resetSamplerBindingCache()
+{
+    t_bound_samplers.clear();
+}
+
+} // GL
@@ -2,8 +2,161 @@
 
 #include "glutils/gl.hpp"
 
+#include <vector>
+
+#if GLUTILS_DEBUG
+
+#include "glutils/error.hpp"
+
+#endif
+
 namespace GL {
 
+namespace {
+
+// Formats with the same view class may alias each other's storage; none means only the format itself.
+enum class ViewClass
+{
+    none,
+    bits_128,
+    bits_96,
+    bits_64,
+    bits_48,
+    bits_32,
+    bits_24,
+    bits_16,
+    bits_8,
+    rgtc1_red,
+    rgtc2_rg,
+    bptc_unorm,
+    bptc_float,
+    s3tc_dxt1_rgb,
+    s3tc_dxt1_rgba,
+    s3tc_dxt3_rgba,
+    s3tc_dxt5_rgba,
+    eac_r11,
+    eac_rg11,
+    etc2_rgb,
+    etc2_rgb_a1,
+    etc2_eac_rgba,
+    astc // ASTC formats alias only the sRGB format with the same block size
+};
+
+auto getViewClass(TextureHandle::SizedInternalFormat format) -> ViewClass
+{
+    using F = TextureHandle::SizedInternalFormat;
+
+    switch (format)
+    {
+        case F::rgba32f:
+        case F::rgba32ui:
+        case F::rgba32i:
+            return ViewClass::bits_128;
+        case F::rgb32f:
+        case F::rgb32ui:
+        case F::rgb32i:
+            return ViewClass::bits_96;
+        case F::rgba16f:
+        case F::rg32f:
+        case F::rgba16ui:
+        case F::rg32ui:
+        case F::rgba16i:
+        case F::rg32i:
+        case F::rgba16:
+            return ViewClass::bits_64;
+        case F::rgb16_snorm:
+        case F::rgb16f:
+        case F::rgb16ui:
+        case F::rgb16i:
+            return ViewClass::bits_48;
+        case F::rg16f:
+        case F::r11f_g11f_b10f:
+        case F::r32f:
+        case F::rgb10_a2ui:
+        case F::rgba8ui:
+        case F::rg16ui:
+        case F::r32ui:
+        case F::rgba8i:
+        case F::rg16i:
+        case F::r32i:
+        case F::rgb10_a2:
+        case F::rgba8:
+        case F::rg16:
+        case F::rgba8_snorm:
+        case F::rg16_snorm:
+        case F::srgb8_alpha8:
+        case F::rgb9_e5:
+            return ViewClass::bits_32;
+        case F::rgb8:
+        case F::rgb8_snorm:
+        case F::srgb8:
+        case F::rgb8ui:
+        case F::rgb8i:
+            return ViewClass::bits_24;
+        case F::r16f:
+        case F::rg8ui:
+        case F::r16ui:
+        case F::rg8i:
+        case F::r16i:
+        case F::rg8:
+        case F::r16:
+        case F::rg8_snorm:
+        case F::r16_snorm:
+            return ViewClass::bits_16;
+        case F::r8ui:
+        case F::r8i:
+        case F::r8:
+        case F::r8_snorm:
+            return ViewClass::bits_8;
+        case F::compressed_red_rgtc1:
+        case F::compressed_signed_red_rgtc1:
+            return ViewClass::rgtc1_red;
+        case F::compressed_rg_rgtc2:
+        case F::compressed_signed_rg_rgtc2:
+            return ViewClass::rgtc2_rg;
+        case F::compressed_rgba_bptc_unorm:
+        case F::compressed_srgb_alpha_bptc_unorm:
+            return ViewClass::bptc_unorm;
+        case F::compressed_rgb_bptc_signed_float:
+        case F::compressed_rgb_bptc_unsigned_float:
+            return ViewClass::bptc_float;
+        case F::compressed_rgb_s3tc_dxt1:
+        case F::compressed_srgb_s3tc_dxt1:
+            return ViewClass::s3tc_dxt1_rgb;
+        case F::compressed_rgba_s3tc_dxt1:
+        case F::compressed_srgb_alpha_s3tc_dxt1:
+            return ViewClass::s3tc_dxt1_rgba;
+        case F::compressed_rgba_s3tc_dxt3:
+        case F::compressed_srgb_alpha_s3tc_dxt3:
+            return ViewClass::s3tc_dxt3_rgba;
+        case F::compressed_rgba_s3tc_dxt5:
+        case F::compressed_srgb_alpha_s3tc_dxt5:
+            return ViewClass::s3tc_dxt5_rgba;
+        case F::compressed_r11_eac:
+        case F::compressed_signed_r11_eac:
+            return ViewClass::eac_r11;
+        case F::compressed_rg11_eac:
+        case F::compressed_signed_rg11_eac:
+            return ViewClass::eac_rg11;
+        case F::compressed_rgb8_etc2:
+        case F::compressed_srgb8_etc2:
+            return ViewClass::etc2_rgb;
+        case F::compressed_rgb8_punchthrough_alpha1_etc2:
+        case F::compressed_srgb8_punchthrough_alpha1_etc2:
+            return ViewClass::etc2_rgb_a1;
+        case F::compressed_rgba8_etc2_eac:
+        case F::compressed_srgb8_alpha8_etc2_eac:
+            return ViewClass::etc2_eac_rgba;
+        default:
+            if (GLenum(format) >= GLenum(F::compressed_rgba_astc_4x4)
+                && GLenum(format) <= GLenum(F::compressed_srgb8_alpha8_astc_12x12))
+                return ViewClass::astc;
+            return ViewClass::none;
+    }
+}
+
+} // namespace
+
 TextureHandle TextureHandle::create(Type type)
 {
     TextureHandle new_handle;
@@ -16,6 +169,218 @@ void TextureHandle::destroy(TextureHandle handle)
     glDeleteTextures(1, &handle.m_name);
 }
 
+auto TextureHandle::createView(Type type, TextureHandle original, SizedInternalFormat format, GLuint min_level,
+                               GLuint num_levels, GLuint min_layer, GLuint num_layers) -> TextureHandle
+{
+#if GLUTILS_DEBUG
+    GLint original_format = 0;
+    glGetTextureLevelParameteriv(original.getName(), 0, GL_TEXTURE_INTERNAL_FORMAT, &original_format);
+    if (!isViewCompatible(SizedInternalFormat(original_format), format))
+        throw Error("texture view format is not in the view class of the original texture's format");
+#endif
+
+    // glTextureView needs a name that has never been bound, which glCreateTextures doesn't give
+    TextureHandle new_handle;
+    glGenTextures(1, &new_handle.m_name);
+    glTextureView(new_handle.m_name, GLenum(type), original.getName(), GLenum(format), min_level, num_levels,
+                  min_layer, num_layers);
+    return new_handle;
+}
+
+bool TextureHandle::isViewCompatible(SizedInternalFormat a, SizedInternalFormat b)
+{
+    if (a == b)
+        return true;
+
+    const ViewClass view_class = getViewClass(a);
+    if (view_class != getViewClass(b) || view_class == ViewClass::none)
+        return false;
+
+    // the sRGB ASTC formats are numbered 0x20 after the linear ones
+    if (view_class == ViewClass::astc)
+        return GLenum(a) + 0x20 == GLenum(b) || GLenum(b) + 0x20 == GLenum(a);
+
+    return true;
+}
+
+auto TextureHandle::getCompressedBlock(SizedInternalFormat internal_format) -> CompressedBlock
+{
+    using F = SizedInternalFormat;
+
+    switch (internal_format)
+    {
+        case F::compressed_rgb_s3tc_dxt1:
+        case F::compressed_rgba_s3tc_dxt1:
+        case F::compressed_srgb_s3tc_dxt1:
+        case F::compressed_srgb_alpha_s3tc_dxt1:
+        case F::compressed_red_rgtc1:
+        case F::compressed_signed_red_rgtc1:
+        case F::compressed_r11_eac:
+        case F::compressed_signed_r11_eac:
+        case F::compressed_rgb8_etc2:
+        case F::compressed_srgb8_etc2:
+        case F::compressed_rgb8_punchthrough_alpha1_etc2:
+        case F::compressed_srgb8_punchthrough_alpha1_etc2:
+            return {4, 4, 8};
+        case F::compressed_rgba_s3tc_dxt3:
+        case F::compressed_rgba_s3tc_dxt5:
+        case F::compressed_srgb_alpha_s3tc_dxt3:
+        case F::compressed_srgb_alpha_s3tc_dxt5:
+        case F::compressed_rg_rgtc2:
+        case F::compressed_signed_rg_rgtc2:
+        case F::compressed_rgba_bptc_unorm:
+        case F::compressed_srgb_alpha_bptc_unorm:
+        case F::compressed_rgb_bptc_signed_float:
+        case F::compressed_rgb_bptc_unsigned_float:
+        case F::compressed_rg11_eac:
+        case F::compressed_signed_rg11_eac:
+        case F::compressed_rgba8_etc2_eac:
+        case F::compressed_srgb8_alpha8_etc2_eac:
+            return {4, 4, 16};
+#define ASTC_CASE(W, H) \
+        case F::compressed_rgba_astc_##W##x##H: \
+        case F::compressed_srgb8_alpha8_astc_##W##x##H: \
+            return {W, H, 16};
+        ASTC_CASE(4, 4)
+        ASTC_CASE(5, 4)
+        ASTC_CASE(5, 5)
+        ASTC_CASE(6, 5)
+        ASTC_CASE(6, 6)
+        ASTC_CASE(8, 5)
+        ASTC_CASE(8, 6)
+        ASTC_CASE(8, 8)
+        ASTC_CASE(10, 5)
+        ASTC_CASE(10, 6)
+        ASTC_CASE(10, 8)
+        ASTC_CASE(10, 10)
+        ASTC_CASE(12, 10)
+        ASTC_CASE(12, 12)
+#undef ASTC_CASE
+        default:
+            return {};
+    }
+}
+
+auto TextureHandle::getCompressedImageSize(SizedInternalFormat internal_format, GLsizei width, GLsizei height,
+                                           GLsizei depth) -> GLsizei
+{
+    const CompressedBlock block = getCompressedBlock(internal_format);
+    if (!block)
+        return 0;
+
+    const GLsizei blocks_x = (width + block.width - 1) / block.width;
+    const GLsizei blocks_y = (height + block.height - 1) / block.height;
+    return blocks_x * blocks_y * depth * block.size;
+}
+
+auto TextureHandle::getTexelSize(SizedInternalFormat internal_format) -> GLsizei
+{
+    using F = SizedInternalFormat;
+
+    switch (internal_format)
+    {
+        case F::r8:
+        case F::r8_snorm:
+        case F::r3_g3_b2:
+        case F::rgba2:
+        case F::r8i:
+        case F::r8ui:
+        case F::stencil_index8:
+            return 1;
+        case F::r16:
+        case F::r16_snorm:
+        case F::rg8:
+        case F::rg8_snorm:
+        case F::rgb4:
+        case F::rgb5:
+        case F::rgba4:
+        case F::rgb5_a1:
+        case F::r16f:
+        case F::r16i:
+        case F::r16ui:
+        case F::rg8i:
+        case F::rg8ui:
+        case F::depth_component16:
+            return 2;
+        case F::rgb8:
+        case F::rgb8_snorm:
+        case F::srgb8:
+        case F::rgb8i:
+        case F::rgb8ui:
+            return 3;
+        case F::rg16:
+        case F::rg16_snorm:
+        case F::rgb0:
+        case F::rgba8:
+        case F::rgba8_snorm:
+        case F::rgb10_a2:
+        case F::rgb10_a2ui:
+        case F::srgb8_alpha8:
+        case F::rg16f:
+        case F::r32f:
+        case F::r11f_g11f_b10f:
+        case F::rgb9_e5:
+        case F::r32i:
+        case F::r32ui:
+        case F::rg16i:
+        case F::rg16ui:
+        case F::rgba8i:
+        case F::rgba8ui:
+        case F::depth_component24:
+        case F::depth_component32f:
+        case F::depth24_stencil8:
+            return 4;
+        case F::rgb12:
+        case F::rgb16_snorm:
+        case F::rgb16f:
+        case F::rgb16i:
+        case F::rgb16ui:
+            return 6;
+        case F::rgba12:
+        case F::rgba16:
+        case F::rgba16f:
+        case F::rg32f:
+        case F::rg32i:
+        case F::rg32ui:
+        case F::rgba16i:
+        case F::rgba16ui:
+        case F::depth32f_stencil8:
+            return 8;
+        case F::rgb32f:
+        case F::rgb32i:
+        case F::rgb32ui:
+            return 12;
+        case F::rgba32f:
+        case F::rgba32i:
+        case F::rgba32ui:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+auto TextureHandle::getImageSize(SizedInternalFormat internal_format, GLsizei width, GLsizei height,
+                                 GLsizei depth) -> GLsizeiptr
+{
+    if (const CompressedBlock block = getCompressedBlock(internal_format))
+        return GLsizeiptr((width + block.width - 1) / block.width) * ((height + block.height - 1) / block.height)
+               * depth * block.size;
+
+    return GLsizeiptr(width) * height * depth * getTexelSize(internal_format);
+}
+
+bool TextureHandle::isFormatSupported(Type type, SizedInternalFormat internal_format)
+{
+    GLint supported = GL_FALSE;
+    glGetInternalformativ(GLenum(type), GLenum(internal_format), GL_INTERNALFORMAT_SUPPORTED, 1, &supported);
+    return supported == GL_TRUE;
+}
+
+void TextureHandle::setStorage1D(GLsizei levels, SizedInternalFormat internal_format, GLsizei width) const
+{
+    glTextureStorage1D(m_name, levels, GLenum(internal_format), width);
+}
+
 void
 TextureHandle::setStorage2D(GLsizei levels, TextureHandle::SizedInternalFormat internal_format, GLsizei width,
                             GLsizei height)
@@ -24,6 +389,96 @@ const
     glTextureStorage2D(m_name, levels, GLenum(internal_format), width, height);
 }
 
+void TextureHandle::setStorage3D(GLsizei levels, SizedInternalFormat internal_format, GLsizei width, GLsizei height,
+                                 GLsizei depth) const
+{
+    glTextureStorage3D(m_name, levels, GLenum(internal_format), width, height, depth);
+}
+
+void TextureHandle::setStorage2DMultisample(GLsizei samples, SizedInternalFormat internal_format, GLsizei width,
+                                            GLsizei height, bool fixed_sample_locations) const
+{
+    glTextureStorage2DMultisample(m_name, samples, GLenum(internal_format), width, height, fixed_sample_locations);
+}
+
+void TextureHandle::setStorage3DMultisample(GLsizei samples, SizedInternalFormat internal_format, GLsizei width,
+                                            GLsizei height, GLsizei depth, bool fixed_sample_locations) const
+{
+    glTextureStorage3DMultisample(m_name, samples, GLenum(internal_format), width, height, depth,
+                                  fixed_sample_locations);
+}
+
+auto TextureHandle::getPixelSize(DataFormat format, DataType type) -> GLsizei
+{
+    GLsizei component_count = 1;
+    switch (format)
+    {
+        case DataFormat::red:
+        case DataFormat::red_integer:
+        case DataFormat::depth_component:
+        case DataFormat::stencil_index:
+            component_count = 1;
+            break;
+        case DataFormat::rg:
+        case DataFormat::rg_integer:
+            component_count = 2;
+            break;
+        case DataFormat::rgb:
+        case DataFormat::bgr:
+        case DataFormat::rgb_integer:
+        case DataFormat::bgr_integer:
+            component_count = 3;
+            break;
+        case DataFormat::rgba:
+        case DataFormat::bgra:
+        case DataFormat::rgba_integer:
+        case DataFormat::bgra_integer:
+            component_count = 4;
+            break;
+    }
+
+    switch (type)
+    {
+        case DataType::ubyte:
+        case DataType::_byte:
+            return component_count;
+        case DataType::ushort:
+        case DataType::_short:
+        case DataType::half_float:
+            return component_count * 2;
+        case DataType::uint:
+        case DataType::_int:
+        case DataType::_float:
+            return component_count * 4;
+        // packed types hold every component in a single value
+        case DataType::ubyte_3_3_2:
+        case DataType::ubyte_2_3_3_rev:
+            return 1;
+        case DataType::ushort_5_6_5:
+        case DataType::ushort_5_6_5_rev:
+        case DataType::ushort_4_4_4_4:
+        case DataType::ushort_4_4_4_4_rev:
+        case DataType::ushort_5_5_5_1:
+        case DataType::ushort_1_5_5_5_rev:
+            return 2;
+        case DataType::uint_8_8_8_8:
+        case DataType::uint_8_8_8_8_rev:
+        case DataType::uint_10_10_10_2:
+        case DataType::uint_2_10_10_10_rev:
+        case DataType::uint_10f_11f_11f_rev:
+        case DataType::uint_5_9_9_9_rev:
+            return 4;
+    }
+
+    return component_count;
+}
+
+void TextureHandle::updateImage1D(GLint level, GLint xoffset, GLsizei width, DataFormat format, DataType type,
+                                  const void *pixel_data) const
+{
+    glTextureSubImage1D(m_name, level, xoffset, width, GLenum(format), GLenum(type), pixel_data);
+}
+
 void
 TextureHandle::updateImage2D(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
                              DataFormat format,
@@ -32,11 +487,78 @@ TextureHandle::updateImage2D(GLint level, GLint xoffset, GLint yoffset, GLsizei
     glTextureSubImage2D(m_name, level, xoffset, yoffset, width, height, GLenum(format), GLenum(type), pixel_data);
 }
 
+void TextureHandle::updateImage3D(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+                                  GLsizei height, GLsizei depth, DataFormat format, DataType type,
+                                  const void *pixel_data) const
+{
+    glTextureSubImage3D(m_name, level, xoffset, yoffset, zoffset, width, height, depth, GLenum(format), GLenum(type),
+                        pixel_data);
+}
+
+void TextureHandle::updateImage1D(GLint level, GLint xoffset, GLsizei width, DataFormat format, DataType type,
+                                  const void *pixel_data, const PixelUnpackLayout &layout) const
+{
+    setPixelUnpackLayout(layout);
+    glTextureSubImage1D(m_name, level, xoffset, width, GLenum(format), GLenum(type), pixel_data);
+}
+
+void TextureHandle::updateImage2D(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                  DataFormat format, DataType type, const void *pixel_data,
+                                  const PixelUnpackLayout &layout) const
+{
+    setPixelUnpackLayout(layout);
+    glTextureSubImage2D(m_name, level, xoffset, yoffset, width, height, GLenum(format), GLenum(type), pixel_data);
+}
+
+void TextureHandle::updateImage3D(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+                                  GLsizei height, GLsizei depth, DataFormat format, DataType type,
+                                  const void *pixel_data, const PixelUnpackLayout &layout) const
+{
+    setPixelUnpackLayout(layout);
+    glTextureSubImage3D(m_name, level, xoffset, yoffset, zoffset, width, height, depth, GLenum(format), GLenum(type),
+                        pixel_data);
+}
+
+void TextureHandle::updateCompressedImage2D(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                            SizedInternalFormat format, GLsizei image_size, const void *data) const
+{
+    glCompressedTextureSubImage2D(m_name, level, xoffset, yoffset, width, height, GLenum(format), image_size, data);
+}
+
+void TextureHandle::updateCompressedImage3D(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+                                            GLsizei height, GLsizei depth, SizedInternalFormat format,
+                                            GLsizei image_size, const void *data) const
+{
+    glCompressedTextureSubImage3D(m_name, level, xoffset, yoffset, zoffset, width, height, depth, GLenum(format),
+                                  image_size, data);
+}
+
 void TextureHandle::generateMipmap() const
 {
     glGenerateTextureMipmap(m_name);
 }
 
+void TextureHandle::bindImage(GLuint unit, GLint level, bool layered, GLint layer, ImageAccess access,
+                              SizedInternalFormat format) const
+{
+    glBindImageTexture(unit, m_name, level, layered, layer, GLenum(access), GLenum(format));
+}
+
+void TextureHandle::bindImages(GLuint first_unit, GLsizei count, const TextureHandle *textures)
+{
+    std::vector<GLuint> names;
+    names.reserve(count);
+    for (GLsizei i = 0; i < count; i++)
+        names.emplace_back(textures[i].m_name);
+
+    glBindImageTextures(first_unit, count, names.data());
+}
+
+void TextureHandle::unbindImage(GLuint unit)
+{
+    glBindImageTexture(unit, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R8);
+}
+
 void TextureHandle::bindTextureUnit(GLuint texture_unit_index, TextureHandle texture)
 {
     glBindTextureUnit(texture_unit_index, texture.m_name);
@@ -0,0 +1,53 @@
+#include "glutils/texture_array.hpp"
+#include "glutils/error.hpp"
+
+#include <algorithm>
+
+namespace GL {
+
+TextureArrayAllocator::TextureArrayAllocator(GLsizei levels, SizedInternalFormat internal_format, GLsizei width,
+                                             GLsizei height, GLsizei layers) :
+        m_texture(TextureHandle::Type::_2d_array),
+        m_width(width),
+        m_height(height),
+        m_layer_count(layers)
+{
+    m_texture.setStorage3D(levels, internal_format, width, height, layers);
+
+    // kept in reverse so that layers are handed out in ascending order
+    m_free_layers.reserve(layers);
+    for (GLint layer = layers - 1; layer >= 0; layer--)
+        m_free_layers.emplace_back(layer);
+}
+
+auto TextureArrayAllocator::allocate() -> GLint
+{
+    if (m_free_layers.empty())
+        throw Error("texture array has no free layers");
+
+    const GLint layer = m_free_layers.back();
+    m_free_layers.pop_back();
+    return layer;
+}
+
+void TextureArrayAllocator::free(GLint layer)
+{
+    if (layer < 0 || layer >= m_layer_count)
+        throw Error("layer index out of range");
+
+#if GLUTILS_DEBUG
+    if (std::find(m_free_layers.begin(), m_free_layers.end(), layer) != m_free_layers.end())
+        throw Error("layer freed twice");
+#endif
+
+    m_free_layers.emplace_back(layer);
+}
+
+void TextureArrayAllocator::update(GLint layer, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                                   GLsizei height, TextureHandle::DataFormat format, TextureHandle::DataType type,
+                                   const void *pixel_data) const
+{
+    m_texture.updateLayer2D(level, layer, xoffset, yoffset, width, height, format, type, pixel_data);
+}
+
+} // GL
@@ -0,0 +1,343 @@
+#include "glutils/texture_atlas.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace GL {
+
+namespace {
+
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+
+// Format and type glClearTexImage accepts for a texture of @p format; the data is null, so only their kind matters.
+auto getClearFormat(SizedInternalFormat format) -> std::pair<GLenum, GLenum>
+{
+    switch (format)
+    {
+        case SizedInternalFormat::rgb10_a2ui:
+        case SizedInternalFormat::r8i:
+        case SizedInternalFormat::r8ui:
+        case SizedInternalFormat::r16i:
+        case SizedInternalFormat::r16ui:
+        case SizedInternalFormat::r32i:
+        case SizedInternalFormat::r32ui:
+        case SizedInternalFormat::rg8i:
+        case SizedInternalFormat::rg8ui:
+        case SizedInternalFormat::rg16i:
+        case SizedInternalFormat::rg16ui:
+        case SizedInternalFormat::rg32i:
+        case SizedInternalFormat::rg32ui:
+        case SizedInternalFormat::rgb8i:
+        case SizedInternalFormat::rgb8ui:
+        case SizedInternalFormat::rgb16i:
+        case SizedInternalFormat::rgb16ui:
+        case SizedInternalFormat::rgb32i:
+        case SizedInternalFormat::rgb32ui:
+        case SizedInternalFormat::rgba8i:
+        case SizedInternalFormat::rgba8ui:
+        case SizedInternalFormat::rgba16i:
+        case SizedInternalFormat::rgba16ui:
+        case SizedInternalFormat::rgba32i:
+        case SizedInternalFormat::rgba32ui:
+            return {GL_RGBA_INTEGER, GL_UNSIGNED_BYTE};
+        case SizedInternalFormat::depth_component16:
+        case SizedInternalFormat::depth_component24:
+        case SizedInternalFormat::depth_component32f:
+            return {GL_DEPTH_COMPONENT, GL_FLOAT};
+        case SizedInternalFormat::depth24_stencil8:
+            return {GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8};
+        case SizedInternalFormat::depth32f_stencil8:
+            return {GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV};
+        case SizedInternalFormat::stencil_index8:
+            return {GL_STENCIL_INDEX, GL_UNSIGNED_BYTE};
+        default:
+            return {GL_RGBA, GL_UNSIGNED_BYTE};
+    }
+}
+
+auto createAtlasTexture(const TextureAtlas::Options &options) -> Texture
+{
+    // regions are uploaded with updateLayer2D, and glClearTexImage rejects compressed textures
+    if (TextureHandle::getCompressedBlock(options.format))
+        throw Error("texture atlases can't have a compressed format");
+
+    Texture texture{TextureHandle::Type::_2d_array};
+    texture.setStorage3D(1, options.format, options.width, options.height, options.layers);
+
+    // padding has to be empty for it to stop filtering from bleeding between regions
+    const auto [clear_format, clear_type] = getClearFormat(options.format);
+    glClearTexImage(texture.getName(), 0, clear_format, clear_type, nullptr);
+
+    return texture;
+}
+
+} // namespace
+
+TextureAtlas::TextureAtlas(const Options &options) :
+        m_options(options),
+        m_texture(createAtlasTexture(options))
+{
+    resetSkylines();
+}
+
+void TextureAtlas::resetSkylines()
+{
+    m_skylines.assign(m_options.layers, {SkylineNode{0, 0, m_options.width}});
+}
+
+auto TextureAtlas::findPlacement(GLsizei width, GLsizei height) const -> std::optional<Placement>
+{
+    std::optional<Placement> best;
+    GLint best_top = m_options.height + 1;
+    GLsizei best_width = 0;
+
+    for (GLint layer = 0; layer < GLint(m_skylines.size()); layer++)
+    {
+        const std::vector<SkylineNode> &nodes = m_skylines[layer];
+
+        for (std::size_t i = 0; i < nodes.size(); i++)
+        {
+            const GLint x = nodes[i].x;
+            if (x + width > m_options.width)
+                break;
+
+            // the region rests on the highest node it spans
+            GLint y = 0;
+            GLsizei remaining = width;
+            for (std::size_t j = i; remaining > 0; j++)
+            {
+                y = std::max(y, nodes[j].y);
+                remaining -= nodes[j].width;
+            }
+
+            // bottom-left: lowest top edge, then the tightest fit against the node it starts on
+            const GLint top = y + height;
+            if (top <= m_options.height && (top < best_top || (top == best_top && nodes[i].width < best_width)))
+            {
+                best = Placement{layer, x, y};
+                best_top = top;
+                best_width = nodes[i].width;
+            }
+        }
+    }
+
+    return best;
+}
+
+void TextureAtlas::place(const Placement &placement, GLsizei width, GLsizei height)
+{
+    std::vector<SkylineNode> &nodes = m_skylines[placement.layer];
+
+    auto it = std::find_if(nodes.begin(), nodes.end(),
+                           [&](const SkylineNode &node) { return node.x == placement.x; });
+    it = nodes.insert(it, SkylineNode{placement.x, placement.y + height, width});
+
+    // trim or remove the nodes now covered by the region
+    const GLint end = placement.x + width;
+    for (auto next = it + 1; next != nodes.end() && next->x < end;)
+    {
+        const GLsizei overlap = end - next->x;
+        if (next->width <= overlap)
+            next = nodes.erase(next);
+        else
+        {
+            next->x += overlap;
+            next->width -= overlap;
+            break;
+        }
+    }
+
+    // merge neighbours at the same height
+    for (std::size_t i = 0; i + 1 < nodes.size();)
+        if (nodes[i].y == nodes[i + 1].y)
+        {
+            nodes[i].width += nodes[i + 1].width;
+            nodes.erase(nodes.begin() + std::ptrdiff_t(i) + 1);
+        }
+        else
+            i++;
+}
+
+void TextureAtlas::setRegion(Region &region, const Placement &placement) const
+{
+    region.layer = placement.layer;
+    region.x = placement.x;
+    region.y = placement.y;
+    region.u0 = float(region.x) / float(m_options.width);
+    region.v0 = float(region.y) / float(m_options.height);
+    region.u1 = float(region.x + region.width) / float(m_options.width);
+    region.v1 = float(region.y + region.height) / float(m_options.height);
+}
+
+auto TextureAtlas::tryAllocate(GLsizei width, GLsizei height) -> std::optional<RegionId>
+{
+    if (width <= 0 || height <= 0)
+        throw Error("atlas regions must have a positive size");
+
+    const GLsizei padded_width = std::min(width + m_options.padding, m_options.width);
+    const GLsizei padded_height = std::min(height + m_options.padding, m_options.height);
+
+    const std::optional<Placement> placement = findPlacement(padded_width, padded_height);
+    if (!placement)
+        return std::nullopt;
+
+    place(*placement, padded_width, padded_height);
+
+    RegionId id;
+    if (m_free_ids.empty())
+    {
+        id = RegionId(m_entries.size());
+        m_entries.emplace_back();
+    }
+    else
+    {
+        id = m_free_ids.back();
+        m_free_ids.pop_back();
+    }
+
+    Entry &entry = m_entries[id];
+    entry.live = true;
+    entry.region.width = width;
+    entry.region.height = height;
+    setRegion(entry.region, *placement);
+
+    m_live_count++;
+    m_live_area += std::size_t(padded_width) * padded_height;
+
+    return id;
+}
+
+auto TextureAtlas::allocate(GLsizei width, GLsizei height) -> RegionId
+{
+    if (const std::optional<RegionId> id = tryAllocate(width, height))
+        return *id;
+
+    if (m_dead_area > 0 && compact())
+        if (const std::optional<RegionId> id = tryAllocate(width, height))
+            return *id;
+
+    throw Error("texture atlas has no room for the region");
+}
+
+void TextureAtlas::free(RegionId id)
+{
+    const Entry &entry = getEntry(id);
+
+    const std::size_t area = std::size_t(std::min(entry.region.width + m_options.padding, m_options.width))
+                             * std::min(entry.region.height + m_options.padding, m_options.height);
+    m_live_area -= area;
+    m_dead_area += area;
+    m_live_count--;
+
+    m_entries[id].live = false;
+    m_free_ids.emplace_back(id);
+}
+
+auto TextureAtlas::getEntry(RegionId id) const -> const Entry &
+{
+    if (id >= m_entries.size() || !m_entries[id].live)
+        throw Error("invalid atlas region id");
+    return m_entries[id];
+}
+
+auto TextureAtlas::getRegion(RegionId id) const -> const Region &
+{
+    return getEntry(id).region;
+}
+
+void TextureAtlas::upload(RegionId id, TextureHandle::DataFormat format, TextureHandle::DataType type,
+                          const void *pixel_data) const
+{
+    const Region &region = getRegion(id);
+    m_texture.updateLayer2D(0, region.layer, region.x, region.y, region.width, region.height, format, type,
+                            pixel_data);
+}
+
+void TextureAtlas::update(RegionId id, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                          TextureHandle::DataFormat format, TextureHandle::DataType type,
+                          const void *pixel_data) const
+{
+    const Region &region = getRegion(id);
+
+#if GLUTILS_DEBUG
+    if (xoffset < 0 || yoffset < 0 || xoffset + width > region.width || yoffset + height > region.height)
+        throw Error("update outside of the atlas region");
+#endif
+
+    m_texture.updateLayer2D(0, region.layer, region.x + xoffset, region.y + yoffset, width, height, format, type,
+                            pixel_data);
+}
+
+bool TextureAtlas::compact()
+{
+    std::vector<RegionId> live;
+    live.reserve(m_live_count);
+    for (RegionId id = 0; id < m_entries.size(); id++)
+        if (m_entries[id].live)
+            live.emplace_back(id);
+
+    // tallest first packs a skyline with the least wasted space
+    std::sort(live.begin(), live.end(), [&](RegionId l, RegionId r)
+    {
+        const Region &a = m_entries[l].region;
+        const Region &b = m_entries[r].region;
+        return a.height != b.height ? a.height > b.height : a.width > b.width;
+    });
+
+    std::vector<std::vector<SkylineNode>> previous_skylines = m_skylines;
+    resetSkylines();
+
+    std::vector<Placement> placements;
+    placements.reserve(live.size());
+
+    for (RegionId id: live)
+    {
+        const Region &region = m_entries[id].region;
+        const GLsizei padded_width = std::min(region.width + m_options.padding, m_options.width);
+        const GLsizei padded_height = std::min(region.height + m_options.padding, m_options.height);
+
+        const std::optional<Placement> placement = findPlacement(padded_width, padded_height);
+        if (!placement)
+        {
+            m_skylines = std::move(previous_skylines);
+            return false;
+        }
+
+        place(*placement, padded_width, padded_height);
+        placements.emplace_back(*placement);
+    }
+
+    // copying within a texture is undefined where source and destination overlap, so move into a new one
+    Texture texture = createAtlasTexture(m_options);
+
+    for (std::size_t i = 0; i < live.size(); i++)
+    {
+        Region &region = m_entries[live[i]].region;
+        const Placement &placement = placements[i];
+
+        glCopyImageSubData(m_texture.getName(), GL_TEXTURE_2D_ARRAY, 0, region.x, region.y, region.layer,
+                           texture.getName(), GL_TEXTURE_2D_ARRAY, 0, placement.x, placement.y, placement.layer,
+                           region.width, region.height, 1);
+
+        setRegion(region, placement);
+    }
+
+    m_texture = std::move(texture);
+    m_dead_area = 0;
+
+    return true;
+}
+
+auto TextureAtlas::getOccupancy() const -> float
+{
+    return float(m_live_area) / (float(m_options.width) * float(m_options.height) * float(m_options.layers));
+}
+
+auto TextureAtlas::getFragmentation() const -> float
+{
+    return float(m_dead_area) / (float(m_options.width) * float(m_options.height) * float(m_options.layers));
+}
+
+} // GL
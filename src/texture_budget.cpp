@@ -0,0 +1,358 @@
+#include "glutils/texture_budget.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+
+#include <algorithm>
+
+namespace GL {
+
+namespace {
+
+using Type = TextureHandle::Type;
+using Description = TextureBudget::Description;
+
+struct Extent
+{
+    GLsizei width;
+    GLsizei height;
+    GLsizei depth;
+};
+
+// Dimensions of a level, with layers and cube map faces as depth, as glCopyImageSubData takes them.
+auto getLevelExtent(const Description &description, GLint level) -> Extent
+{
+    const GLsizei width = std::max(1, description.width >> level);
+    const GLsizei height = std::max(1, description.height >> level);
+
+    switch (description.type)
+    {
+        case Type::_1d:
+            return {width, 1, 1};
+        case Type::_1d_array:
+            return {width, description.height, 1};
+        case Type::cube_map:
+            return {width, height, 6};
+        case Type::_2d_array:
+        case Type::cube_map_array:
+            return {width, height, description.depth};
+        case Type::_3d:
+            return {width, height, std::max(1, description.depth >> level)};
+        default:
+            return {width, height, 1};
+    }
+}
+
+auto getLevelBytes(const Description &description, GLint level) -> std::size_t
+{
+    const Extent extent = getLevelExtent(description, level);
+    return std::size_t(TextureHandle::getImageSize(description.format, extent.width, extent.height, extent.depth));
+}
+
+// Bytes of a texture allocated without its top @p dropped levels.
+auto getBytes(const Description &description, GLsizei dropped) -> std::size_t
+{
+    std::size_t bytes = 0;
+    for (GLint level = dropped; level < description.levels; level++)
+        bytes += getLevelBytes(description, level);
+    return bytes;
+}
+
+auto allocate(const Description &description, GLsizei dropped) -> Texture
+{
+    Texture texture{description.type};
+    const GLsizei levels = description.levels - dropped;
+    const Extent extent = getLevelExtent(description, dropped);
+
+    switch (description.type)
+    {
+        case Type::_1d:
+            texture.setStorage1D(levels, description.format, extent.width);
+            break;
+        case Type::_1d_array:
+        case Type::cube_map:
+            texture.setStorage2D(levels, description.format, extent.width, extent.height);
+            break;
+        case Type::_2d_array:
+        case Type::cube_map_array:
+        case Type::_3d:
+            texture.setStorage3D(levels, description.format, extent.width, extent.height, extent.depth);
+            break;
+        default:
+            texture.setStorage2D(levels, description.format, extent.width, extent.height);
+            break;
+    }
+
+    return texture;
+}
+
+} // namespace
+
+TextureBudget::TextureBudget(const Options &options) : m_options(options)
+{}
+
+auto TextureBudget::getStorageSize(const Description &description) -> std::size_t
+{
+    return getBytes(description, 0);
+}
+
+auto TextureBudget::add(const Description &description, LevelLoader loader) -> TextureId
+{
+    switch (description.type)
+    {
+        case Type::buffer:
+        case Type::_2d_multisample:
+        case Type::_2d_multisample_array:
+            throw Error("buffer and multisample textures can't be managed by a texture budget");
+        case Type::rectangle:
+            if (description.levels != 1)
+                throw Error("rectangle textures have a single level");
+            break;
+        default:
+            break;
+    }
+    if (description.width <= 0 || description.height <= 0 || description.depth <= 0 || description.levels <= 0)
+        throw Error("texture must have a positive size and level count");
+
+    TextureId id;
+    if (m_free_ids.empty())
+    {
+        id = TextureId(m_entries.size());
+        m_entries.emplace_back();
+    }
+    else
+    {
+        id = m_free_ids.back();
+        m_free_ids.pop_back();
+    }
+
+    Entry &entry = m_entries[id];
+    entry.description = description;
+    entry.loader = std::move(loader);
+    entry.dropped = description.levels;
+    entry.unloaded = 0;
+    entry.bytes = 0;
+    entry.last_used = m_frame;
+    entry.live = true;
+
+    return id;
+}
+
+void TextureBudget::remove(TextureId id)
+{
+    getEntry(id);
+
+    Entry &entry = m_entries[id];
+    evict(entry);
+    entry.loader = nullptr;
+    entry.live = false;
+    m_free_ids.emplace_back(id);
+}
+
+auto TextureBudget::getEntry(TextureId id) const -> const Entry &
+{
+    if (id >= m_entries.size() || !m_entries[id].live)
+        throw Error("invalid texture budget id");
+    return m_entries[id];
+}
+
+auto TextureBudget::use(TextureId id) -> TextureHandle
+{
+    getEntry(id);
+
+    Entry &entry = m_entries[id];
+    entry.last_used = m_frame;
+    return entry.texture;
+}
+
+auto TextureBudget::getTexture(TextureId id) const -> TextureHandle
+{
+    return getEntry(id).texture;
+}
+
+auto TextureBudget::getMissingLevels(TextureId id) const -> GLsizei
+{
+    const Entry &entry = getEntry(id);
+    return entry.dropped + entry.unloaded;
+}
+
+auto TextureBudget::getEntriesByLastUse() -> std::vector<Entry *>
+{
+    std::vector<Entry *> entries;
+    for (Entry &entry: m_entries)
+        if (entry.live)
+            entries.emplace_back(&entry);
+
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry *l, const Entry *r) { return l->last_used < r->last_used; });
+    return entries;
+}
+
+auto TextureBudget::getMaxDropped(const Entry &entry) const -> GLsizei
+{
+    // keep at least one level, and the largest level at or above the minimum size
+    GLsizei dropped = 0;
+    while (dropped + 1 < entry.description.levels)
+    {
+        const Extent extent = getLevelExtent(entry.description, dropped);
+        if (extent.width <= m_options.min_size && extent.height <= m_options.min_size)
+            break;
+        dropped++;
+    }
+    return dropped;
+}
+
+void TextureBudget::reallocate(Entry &entry, GLsizei dropped)
+{
+    const Description &description = entry.description;
+    Texture texture = allocate(description, dropped);
+
+    // levels of the full texture that are loaded in the old texture
+    const GLint first_loaded = entry.texture ? entry.dropped + entry.unloaded : description.levels;
+    const GLint first_copied = std::max(first_loaded, dropped);
+
+    for (GLint level = first_copied; level < description.levels; level++)
+    {
+        const Extent extent = getLevelExtent(description, level);
+        glCopyImageSubData(entry.texture.getName(), GLenum(description.type), level - entry.dropped, 0, 0, 0,
+                           texture.getName(), GLenum(description.type), level - dropped, 0, 0, 0,
+                           extent.width, extent.height, extent.depth);
+    }
+
+    m_resident_bytes -= entry.bytes;
+    entry.bytes = getBytes(description, dropped);
+    m_resident_bytes += entry.bytes;
+
+    entry.texture = std::move(texture);
+    entry.dropped = dropped;
+    entry.unloaded = first_copied - dropped;
+    glTextureParameteri(entry.texture.getName(), GL_TEXTURE_BASE_LEVEL,
+                        std::min(entry.unloaded, description.levels - dropped - 1));
+
+    // never leave a texture with nothing to sample
+    if (first_copied == description.levels)
+        loadLevel(entry);
+}
+
+void TextureBudget::evict(Entry &entry)
+{
+    m_resident_bytes -= entry.bytes;
+    entry.texture = Texture(TextureHandle());
+    entry.dropped = entry.description.levels;
+    entry.unloaded = 0;
+    entry.bytes = 0;
+}
+
+void TextureBudget::loadLevel(Entry &entry)
+{
+    entry.unloaded--;
+    entry.loader(entry.texture, entry.dropped + entry.unloaded, entry.unloaded);
+    glTextureParameteri(entry.texture.getName(), GL_TEXTURE_BASE_LEVEL, entry.unloaded);
+
+    m_stats.loaded_levels++;
+}
+
+void TextureBudget::update()
+{
+    m_stats.evictions = 0;
+    m_stats.dropped_levels = 0;
+    m_stats.loaded_levels = 0;
+
+    std::vector<Entry *> entries = getEntriesByLastUse();
+
+    // stale textures go first
+    for (Entry *entry: entries)
+    {
+        if (m_resident_bytes <= m_options.budget || entry->last_used + m_options.evict_after_frames > m_frame)
+            break;
+        if (entry->texture)
+        {
+            evict(*entry);
+            m_stats.evictions++;
+        }
+    }
+
+    // then one top level at a time, least recently used first
+    for (bool dropped = true; m_resident_bytes > m_options.budget && dropped;)
+    {
+        dropped = false;
+        for (Entry *entry: entries)
+        {
+            if (m_resident_bytes <= m_options.budget)
+                break;
+            if (entry->texture && entry->dropped < getMaxDropped(*entry))
+            {
+                reallocate(*entry, entry->dropped + 1);
+                m_stats.dropped_levels++;
+                dropped = true;
+            }
+        }
+    }
+
+    // and then whole textures that weren't needed this frame
+    for (Entry *entry: entries)
+    {
+        if (m_resident_bytes <= m_options.budget || entry->last_used >= m_frame)
+            break;
+        if (entry->texture)
+        {
+            evict(*entry);
+            m_stats.evictions++;
+        }
+    }
+
+    // restore the textures used this frame with as many levels as fit, most recently used first
+    for (auto it = entries.rbegin(); it != entries.rend() && (*it)->last_used >= m_frame; ++it)
+    {
+        Entry &entry = **it;
+        const GLsizei max_dropped = entry.texture ? entry.dropped - 1 : entry.description.levels - 1;
+        if (max_dropped < 0)
+            continue;
+
+        // make room by evicting stale textures
+        const std::size_t full_bytes = getBytes(entry.description, 0);
+        for (Entry *stale: entries)
+        {
+            if (m_resident_bytes - entry.bytes + full_bytes <= m_options.budget
+                || stale->last_used + m_options.evict_after_frames > m_frame)
+                break;
+            if (stale->texture)
+            {
+                evict(*stale);
+                m_stats.evictions++;
+            }
+        }
+
+        for (GLsizei dropped = 0; dropped <= max_dropped; dropped++)
+            if (m_resident_bytes - entry.bytes + getBytes(entry.description, dropped) <= m_options.budget)
+            {
+                reallocate(entry, dropped);
+                break;
+            }
+    }
+
+    // fill in the levels restored textures lack, coarse to fine
+    std::size_t loaded_bytes = 0;
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+        Entry &entry = **it;
+        while (entry.unloaded > 0 && (loaded_bytes < m_options.max_load_bytes_per_frame || loaded_bytes == 0))
+        {
+            loaded_bytes += getLevelBytes(entry.description, entry.dropped + entry.unloaded - 1);
+            loadLevel(entry);
+        }
+    }
+
+    m_stats.resident_bytes = m_resident_bytes;
+    m_stats.texture_count = entries.size();
+    m_stats.evicted_textures = 0;
+    m_stats.reduced_textures = 0;
+    for (const Entry *entry: entries)
+    {
+        m_stats.evicted_textures += !entry->texture;
+        m_stats.reduced_textures += entry->dropped + entry->unloaded > 0;
+    }
+
+    m_frame++;
+}
+
+} // GL
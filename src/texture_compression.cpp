@@ -0,0 +1,920 @@
+#include "glutils/texture_compression.hpp"
+#include "glutils/error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#endif
+
+namespace GL {
+
+namespace {
+
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+
+enum class BlockCodec
+{
+    bc1,
+    bc3,
+    bc4,
+    bc5,
+    bc7
+};
+
+auto getBlockCodec(SizedInternalFormat format) -> BlockCodec
+{
+    switch (format)
+    {
+        case SizedInternalFormat::compressed_rgb_s3tc_dxt1:
+        case SizedInternalFormat::compressed_rgba_s3tc_dxt1:
+        case SizedInternalFormat::compressed_srgb_s3tc_dxt1:
+        case SizedInternalFormat::compressed_srgb_alpha_s3tc_dxt1:
+            return BlockCodec::bc1;
+        case SizedInternalFormat::compressed_rgba_s3tc_dxt5:
+        case SizedInternalFormat::compressed_srgb_alpha_s3tc_dxt5:
+            return BlockCodec::bc3;
+        case SizedInternalFormat::compressed_red_rgtc1:
+            return BlockCodec::bc4;
+        case SizedInternalFormat::compressed_rg_rgtc2:
+            return BlockCodec::bc5;
+        case SizedInternalFormat::compressed_rgba_bptc_unorm:
+        case SizedInternalFormat::compressed_srgb_alpha_bptc_unorm:
+            return BlockCodec::bc7;
+        default:
+            throw Error("format is not supported by the texture compressor");
+    }
+}
+
+auto getBlockSize(BlockCodec codec) -> std::size_t
+{
+    return codec == BlockCodec::bc1 || codec == BlockCodec::bc4 ? 8 : 16;
+}
+
+auto getEncodedComponentCount(BlockCodec codec) -> int
+{
+    switch (codec)
+    {
+        case BlockCodec::bc1:
+            return 3;
+        case BlockCodec::bc4:
+            return 1;
+        case BlockCodec::bc5:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+// A 4x4 block of RGBA pixels, as 16 bit integers so that differences can be squared with _mm_madd_epi16.
+struct alignas(16) Block
+{
+    std::int16_t pixels[16][4];
+};
+
+// Palette entries, in the same layout as Block::pixels.
+struct alignas(16) Palette
+{
+    std::int16_t colors[16][4];
+    int size;
+};
+
+/* Palette matching */
+
+// Write the index of the closest palette entry for every pixel and return the total squared error.
+auto matchPalette(const Block &block, const Palette &palette, std::uint8_t *indices) -> std::uint32_t
+{
+#if defined(__SSE2__)
+    std::uint32_t total = 0;
+
+    for (int group = 0; group < 4; group++)
+    {
+        const __m128i p01 = _mm_load_si128(reinterpret_cast<const __m128i *>(block.pixels[group * 4]));
+        const __m128i p23 = _mm_load_si128(reinterpret_cast<const __m128i *>(block.pixels[group * 4 + 2]));
+
+        __m128i best_error = _mm_set1_epi32(std::numeric_limits<std::int32_t>::max());
+        __m128i best_index = _mm_setzero_si128();
+
+        for (int i = 0; i < palette.size; i++)
+        {
+            const std::int16_t *c = palette.colors[i];
+            const __m128i color = _mm_setr_epi16(c[0], c[1], c[2], c[3], c[0], c[1], c[2], c[3]);
+
+            const __m128i d01 = _mm_sub_epi16(p01, color);
+            const __m128i d23 = _mm_sub_epi16(p23, color);
+            // squared differences summed in pairs: [rg0, ba0, rg1, ba1]
+            const __m128 s01 = _mm_castsi128_ps(_mm_madd_epi16(d01, d01));
+            const __m128 s23 = _mm_castsi128_ps(_mm_madd_epi16(d23, d23));
+            const __m128i error = _mm_add_epi32(
+                    _mm_castps_si128(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(2, 0, 2, 0))),
+                    _mm_castps_si128(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(3, 1, 3, 1))));
+
+            const __m128i better = _mm_cmplt_epi32(error, best_error);
+            best_error = _mm_or_si128(_mm_and_si128(better, error), _mm_andnot_si128(better, best_error));
+            best_index = _mm_or_si128(_mm_and_si128(better, _mm_set1_epi32(i)),
+                                      _mm_andnot_si128(better, best_index));
+        }
+
+        alignas(16) std::int32_t errors[4];
+        alignas(16) std::int32_t group_indices[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(errors), best_error);
+        _mm_store_si128(reinterpret_cast<__m128i *>(group_indices), best_index);
+
+        for (int j = 0; j < 4; j++)
+        {
+            total += std::uint32_t(errors[j]);
+            indices[group * 4 + j] = std::uint8_t(group_indices[j]);
+        }
+    }
+
+    return total;
+#else
+    std::uint32_t total = 0;
+
+    for (int p = 0; p < 16; p++)
+    {
+        std::int32_t best_error = std::numeric_limits<std::int32_t>::max();
+        for (int i = 0; i < palette.size; i++)
+        {
+            std::int32_t error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                const std::int32_t d = block.pixels[p][c] - palette.colors[i][c];
+                error += d * d;
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                indices[p] = std::uint8_t(i);
+            }
+        }
+        total += std::uint32_t(best_error);
+    }
+
+    return total;
+#endif
+}
+
+/* Endpoint fitting */
+
+// Endpoints of a line through the block's pixels, in float, for the first N components.
+template<int N>
+struct Line
+{
+    std::array<float, N> start{};
+    std::array<float, N> end{};
+};
+
+template<int N>
+auto fitBoundingBox(const Block &block) -> Line<N>
+{
+    Line<N> line;
+    line.start.fill(255.f);
+    line.end.fill(0.f);
+
+    for (const auto &pixel: block.pixels)
+        for (int c = 0; c < N; c++)
+        {
+            line.start[c] = std::min(line.start[c], float(pixel[c]));
+            line.end[c] = std::max(line.end[c], float(pixel[c]));
+        }
+
+    return line;
+}
+
+// Line along the principal axis of the pixels, spanning their projections onto it.
+template<int N>
+auto fitPrincipalAxis(const Block &block) -> Line<N>
+{
+    std::array<float, N> mean{};
+    for (const auto &pixel: block.pixels)
+        for (int c = 0; c < N; c++)
+            mean[c] += float(pixel[c]);
+    for (float &m: mean)
+        m /= 16.f;
+
+    float covariance[N][N]{};
+    for (const auto &pixel: block.pixels)
+        for (int i = 0; i < N; i++)
+            for (int j = i; j < N; j++)
+                covariance[i][j] += (float(pixel[i]) - mean[i]) * (float(pixel[j]) - mean[j]);
+    for (int i = 0; i < N; i++)
+        for (int j = 0; j < i; j++)
+            covariance[i][j] = covariance[j][i];
+
+    // power iteration, starting from the bounding box diagonal
+    const Line<N> box = fitBoundingBox<N>(block);
+    std::array<float, N> axis;
+    for (int c = 0; c < N; c++)
+        axis[c] = box.end[c] - box.start[c];
+
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        std::array<float, N> next{};
+        for (int i = 0; i < N; i++)
+            for (int j = 0; j < N; j++)
+                next[i] += covariance[i][j] * axis[j];
+
+        float length = 0.f;
+        for (float v: next)
+            length += v * v;
+        if (length < 1e-12f)
+            return box;
+
+        length = 1.f / std::sqrt(length);
+        for (int c = 0; c < N; c++)
+            axis[c] = next[c] * length;
+    }
+
+    float min_t = std::numeric_limits<float>::max();
+    float max_t = std::numeric_limits<float>::lowest();
+    for (const auto &pixel: block.pixels)
+    {
+        float t = 0.f;
+        for (int c = 0; c < N; c++)
+            t += (float(pixel[c]) - mean[c]) * axis[c];
+        min_t = std::min(min_t, t);
+        max_t = std::max(max_t, t);
+    }
+
+    Line<N> line;
+    for (int c = 0; c < N; c++)
+    {
+        line.start[c] = std::clamp(mean[c] + axis[c] * min_t, 0.f, 255.f);
+        line.end[c] = std::clamp(mean[c] + axis[c] * max_t, 0.f, 255.f);
+    }
+    return line;
+}
+
+// Least squares endpoints for fixed indices, where pixel p is approximated by lerp(start, end, weights[indices[p]]).
+template<int N>
+bool refineLine(const Block &block, const std::uint8_t *indices, const float *weights, Line<N> &line)
+{
+    float aa = 0.f, ab = 0.f, bb = 0.f;
+    std::array<float, N> ax{}, bx{};
+
+    for (int p = 0; p < 16; p++)
+    {
+        const float b = weights[indices[p]];
+        const float a = 1.f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < N; c++)
+        {
+            ax[c] += a * float(block.pixels[p][c]);
+            bx[c] += b * float(block.pixels[p][c]);
+        }
+    }
+
+    const float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+        return false;
+
+    const float inverse = 1.f / determinant;
+    for (int c = 0; c < N; c++)
+    {
+        line.start[c] = std::clamp((ax[c] * bb - bx[c] * ab) * inverse, 0.f, 255.f);
+        line.end[c] = std::clamp((bx[c] * aa - ax[c] * ab) * inverse, 0.f, 255.f);
+    }
+    return true;
+}
+
+/* BC1 */
+
+struct ColorBlock
+{
+    std::uint16_t color0;
+    std::uint16_t color1;
+    std::uint32_t indices;
+};
+
+auto packRGB565(const std::array<float, 3> &rgb) -> std::uint16_t
+{
+    const auto r = std::uint16_t(std::lround(rgb[0] * 31.f / 255.f));
+    const auto g = std::uint16_t(std::lround(rgb[1] * 63.f / 255.f));
+    const auto b = std::uint16_t(std::lround(rgb[2] * 31.f / 255.f));
+    return std::uint16_t(r << 11 | g << 5 | b);
+}
+
+void unpackRGB565(std::uint16_t color, std::int16_t *rgb)
+{
+    const int r = color >> 11 & 31;
+    const int g = color >> 5 & 63;
+    const int b = color & 31;
+    rgb[0] = std::int16_t(r << 3 | r >> 2);
+    rgb[1] = std::int16_t(g << 2 | g >> 4);
+    rgb[2] = std::int16_t(b << 3 | b >> 2);
+}
+
+// The decoded palette, with alpha zeroed so that matching ignores it.
+auto getColorPalette(std::uint16_t color0, std::uint16_t color1, bool four_color) -> Palette
+{
+    Palette palette{};
+    palette.size = 4;
+    unpackRGB565(color0, palette.colors[0]);
+    unpackRGB565(color1, palette.colors[1]);
+
+    for (int c = 0; c < 3; c++)
+    {
+        const int c0 = palette.colors[0][c];
+        const int c1 = palette.colors[1][c];
+        if (four_color)
+        {
+            palette.colors[2][c] = std::int16_t((2 * c0 + c1) / 3);
+            palette.colors[3][c] = std::int16_t((c0 + 2 * c1) / 3);
+        }
+        else
+        {
+            palette.colors[2][c] = std::int16_t((c0 + c1) / 2);
+            palette.colors[3][c] = 0;
+        }
+    }
+
+    return palette;
+}
+
+// Encode the RGB of a block with the given endpoints, always in four color mode. Returns the squared error.
+auto encodeColorLine(const Block &block, const Line<3> &line, ColorBlock &out,
+                     std::uint8_t *indices) -> std::uint32_t
+{
+    std::uint16_t color0 = packRGB565(line.end);
+    std::uint16_t color1 = packRGB565(line.start);
+
+    // four color mode requires color0 > color1; with equal endpoints only index 0 is used
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    const std::uint32_t error = matchPalette(block, getColorPalette(color0, color1, true), indices);
+
+    out.color0 = color0;
+    out.color1 = color1;
+    out.indices = 0;
+    for (int p = 0; p < 16; p++)
+        out.indices |= std::uint32_t(color0 == color1 ? 0 : indices[p]) << (2 * p);
+
+    return error;
+}
+
+void encodeBC1(const Block &rgba, CompressionOptions::Quality quality, std::uint8_t *out)
+{
+    // alpha is not encoded, zero it so palette matching only sees RGB
+    Block block = rgba;
+    for (auto &pixel: block.pixels)
+        pixel[3] = 0;
+
+    // inset the bounding box to account for the interpolated colors
+    Line<3> line = fitBoundingBox<3>(block);
+    for (int c = 0; c < 3; c++)
+    {
+        const float inset = (line.end[c] - line.start[c]) / 16.f;
+        line.start[c] += inset;
+        line.end[c] -= inset;
+    }
+
+    std::uint8_t indices[16];
+    ColorBlock best{};
+    std::uint32_t best_error = encodeColorLine(block, line, best, indices);
+
+    if (quality == CompressionOptions::Quality::high && best_error > 0)
+    {
+        // weight of color0 (the line end) by index
+        static constexpr float weights[4]{1.f, 0.f, 2.f / 3.f, 1.f / 3.f};
+
+        line = fitPrincipalAxis<3>(block);
+        for (int iteration = 0; iteration < 3; iteration++)
+        {
+            ColorBlock candidate{};
+            const std::uint32_t error = encodeColorLine(block, line, candidate, indices);
+            if (error < best_error)
+            {
+                best_error = error;
+                best = candidate;
+            }
+
+            if (error == 0 || candidate.color0 == candidate.color1)
+                break;
+
+            // the indices refer to the encoded endpoints, which may be swapped relative to the line
+            if (!refineLine<3>(block, indices, weights, line))
+                break;
+        }
+    }
+
+    std::memcpy(out, &best.color0, 2);
+    std::memcpy(out + 2, &best.color1, 2);
+    std::memcpy(out + 4, &best.indices, 4);
+}
+
+/* BC4 */
+
+// The eight values decoded from a pair of BC4 endpoints.
+auto getScalarPalette(int value0, int value1) -> std::array<int, 8>
+{
+    std::array<int, 8> palette{value0, value1};
+
+    if (value0 > value1)
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+    else
+    {
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    return palette;
+}
+
+auto encodeScalarEndpoints(const std::uint8_t *values, int value0, int value1,
+                           std::uint64_t &bits) -> std::uint32_t
+{
+    const std::array<int, 8> palette = getScalarPalette(value0, value1);
+
+    std::uint32_t total = 0;
+    bits = std::uint64_t(value0) | std::uint64_t(value1) << 8;
+
+    for (int p = 0; p < 16; p++)
+    {
+        int best_error = std::numeric_limits<int>::max();
+        int best_index = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            const int d = int(values[p]) - palette[i];
+            if (d * d < best_error)
+            {
+                best_error = d * d;
+                best_index = i;
+            }
+        }
+        total += std::uint32_t(best_error);
+        bits |= std::uint64_t(best_index) << (16 + 3 * p);
+    }
+
+    return total;
+}
+
+void encodeBC4(const std::uint8_t *values, CompressionOptions::Quality quality, std::uint8_t *out)
+{
+    const auto [min_it, max_it] = std::minmax_element(values, values + 16);
+    const int min_value = *min_it;
+    const int max_value = *max_it;
+
+    std::uint64_t best_bits;
+    std::uint32_t best_error = encodeScalarEndpoints(values, max_value, min_value, best_bits);
+
+    if (quality == CompressionOptions::Quality::high && best_error > 0)
+    {
+        std::uint64_t bits;
+
+        // eight value mode with the endpoints pulled in
+        for (int high = max_value; high >= std::max(min_value + 1, max_value - 3); high--)
+            for (int low = min_value; low <= std::min(high - 1, min_value + 3); low++)
+            {
+                const std::uint32_t error = encodeScalarEndpoints(values, high, low, bits);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best_bits = bits;
+                }
+            }
+
+        // six value mode, with 0 and 255 represented explicitly
+        int inner_min = 255, inner_max = 0;
+        for (int p = 0; p < 16; p++)
+            if (values[p] != 0 && values[p] != 255)
+            {
+                inner_min = std::min<int>(inner_min, values[p]);
+                inner_max = std::max<int>(inner_max, values[p]);
+            }
+
+        if (inner_min <= inner_max)
+        {
+            const std::uint32_t error = encodeScalarEndpoints(values, inner_min, inner_max, bits);
+            if (error < best_error)
+            {
+                best_error = error;
+                best_bits = bits;
+            }
+        }
+    }
+
+    for (int i = 0; i < 8; i++)
+        out[i] = std::uint8_t(best_bits >> (8 * i));
+}
+
+void encodeBC4Component(const Block &block, int component, CompressionOptions::Quality quality, std::uint8_t *out)
+{
+    std::uint8_t values[16];
+    for (int p = 0; p < 16; p++)
+        values[p] = std::uint8_t(block.pixels[p][component]);
+    encodeBC4(values, quality, out);
+}
+
+/* BC7 mode 6 */
+
+constexpr std::int16_t bc7_weights[16]{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// A mode 6 endpoint: 7 bits per component plus a shared low bit.
+struct Endpoint
+{
+    std::uint8_t components[4];
+    std::uint8_t p_bit;
+
+    [[nodiscard]]
+    auto getValue(int c) const -> int
+    { return components[c] << 1 | p_bit; }
+};
+
+auto quantizeEndpoint(const std::array<float, 4> &value) -> Endpoint
+{
+    Endpoint best{};
+    float best_error = std::numeric_limits<float>::max();
+
+    for (std::uint8_t p_bit = 0; p_bit < 2; p_bit++)
+    {
+        Endpoint endpoint{{}, p_bit};
+        float error = 0.f;
+        for (int c = 0; c < 4; c++)
+        {
+            const long q = std::clamp(std::lround((value[c] - float(p_bit)) / 2.f), 0l, 127l);
+            endpoint.components[c] = std::uint8_t(q);
+            const float d = float(endpoint.getValue(c)) - value[c];
+            error += d * d;
+        }
+        if (error < best_error)
+        {
+            best_error = error;
+            best = endpoint;
+        }
+    }
+
+    return best;
+}
+
+auto getBC7Palette(const Endpoint &e0, const Endpoint &e1) -> Palette
+{
+    Palette palette{};
+    palette.size = 16;
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            palette.colors[i][c] = std::int16_t(((64 - bc7_weights[i]) * e0.getValue(c)
+                                                 + bc7_weights[i] * e1.getValue(c) + 32) >> 6);
+    return palette;
+}
+
+// Little endian bit stream over a 128 bit block.
+class BitWriter
+{
+public:
+    void write(std::uint32_t value, int count)
+    {
+        for (int i = 0; i < count; i++, m_position++)
+            if (value >> i & 1)
+                m_bytes[m_position / 8] |= std::uint8_t(1 << (m_position % 8));
+    }
+
+    [[nodiscard]]
+    auto getBytes() const -> const std::uint8_t *
+    { return m_bytes; }
+
+private:
+    std::uint8_t m_bytes[16]{};
+    int m_position{0};
+};
+
+class BitReader
+{
+public:
+    explicit BitReader(const std::uint8_t *bytes) : m_bytes(bytes)
+    {}
+
+    auto read(int count) -> std::uint32_t
+    {
+        std::uint32_t value = 0;
+        for (int i = 0; i < count; i++, m_position++)
+            value |= std::uint32_t(m_bytes[m_position / 8] >> (m_position % 8) & 1) << i;
+        return value;
+    }
+
+private:
+    const std::uint8_t *m_bytes;
+    int m_position{0};
+};
+
+struct BC7Block
+{
+    Endpoint endpoints[2];
+    std::uint8_t indices[16];
+};
+
+auto encodeBC7Line(const Block &block, const Line<4> &line, BC7Block &out) -> std::uint32_t
+{
+    out.endpoints[0] = quantizeEndpoint(line.start);
+    out.endpoints[1] = quantizeEndpoint(line.end);
+    return matchPalette(block, getBC7Palette(out.endpoints[0], out.endpoints[1]), out.indices);
+}
+
+void encodeBC7(const Block &block, CompressionOptions::Quality quality, std::uint8_t *out)
+{
+    BC7Block best{};
+    std::uint32_t best_error = encodeBC7Line(block, fitBoundingBox<4>(block), best);
+
+    if (quality == CompressionOptions::Quality::high && best_error > 0)
+    {
+        float weights[16];
+        for (int i = 0; i < 16; i++)
+            weights[i] = float(bc7_weights[i]) / 64.f;
+
+        Line<4> line = fitPrincipalAxis<4>(block);
+        for (int iteration = 0; iteration < 3; iteration++)
+        {
+            BC7Block candidate{};
+            const std::uint32_t error = encodeBC7Line(block, line, candidate);
+            if (error < best_error)
+            {
+                best_error = error;
+                best = candidate;
+            }
+
+            if (error == 0 || !refineLine<4>(block, candidate.indices, weights, line))
+                break;
+        }
+    }
+
+    // the most significant index bit of the first pixel is implied to be zero
+    if (best.indices[0] >= 8)
+    {
+        std::swap(best.endpoints[0], best.endpoints[1]);
+        for (std::uint8_t &index: best.indices)
+            index = std::uint8_t(15 - index);
+    }
+
+    BitWriter writer;
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        writer.write(best.endpoints[0].components[c], 7);
+        writer.write(best.endpoints[1].components[c], 7);
+    }
+    writer.write(best.endpoints[0].p_bit, 1);
+    writer.write(best.endpoints[1].p_bit, 1);
+    for (int p = 0; p < 16; p++)
+        writer.write(best.indices[p], p == 0 ? 3 : 4);
+
+    std::memcpy(out, writer.getBytes(), 16);
+}
+
+/* Block access */
+
+void loadBlock(const std::uint8_t *rgba, GLsizei width, GLsizei height, GLsizei block_x, GLsizei block_y,
+               Block &block)
+{
+    for (int y = 0; y < 4; y++)
+    {
+        const GLsizei source_y = std::min(block_y * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            const GLsizei source_x = std::min(block_x * 4 + x, width - 1);
+            const std::uint8_t *pixel = rgba + (std::size_t(source_y) * width + source_x) * 4;
+            for (int c = 0; c < 4; c++)
+                block.pixels[y * 4 + x][c] = pixel[c];
+        }
+    }
+}
+
+void encodeBlock(BlockCodec codec, const Block &block, CompressionOptions::Quality quality, std::uint8_t *out)
+{
+    switch (codec)
+    {
+        case BlockCodec::bc1:
+            encodeBC1(block, quality, out);
+            break;
+        case BlockCodec::bc3:
+            encodeBC4Component(block, 3, quality, out);
+            encodeBC1(block, quality, out + 8);
+            break;
+        case BlockCodec::bc4:
+            encodeBC4Component(block, 0, quality, out);
+            break;
+        case BlockCodec::bc5:
+            encodeBC4Component(block, 0, quality, out);
+            encodeBC4Component(block, 1, quality, out + 8);
+            break;
+        case BlockCodec::bc7:
+            encodeBC7(block, quality, out);
+            break;
+    }
+}
+
+void decodeColorBlock(const std::uint8_t *in, bool force_four_color, std::uint8_t (*out)[4])
+{
+    std::uint16_t color0, color1;
+    std::uint32_t indices;
+    std::memcpy(&color0, in, 2);
+    std::memcpy(&color1, in + 2, 2);
+    std::memcpy(&indices, in + 4, 4);
+
+    const bool four_color = force_four_color || color0 > color1;
+    const Palette palette = getColorPalette(color0, color1, four_color);
+
+    for (int p = 0; p < 16; p++)
+    {
+        const int index = indices >> (2 * p) & 3;
+        for (int c = 0; c < 3; c++)
+            out[p][c] = std::uint8_t(palette.colors[index][c]);
+        out[p][3] = !four_color && index == 3 ? 0 : 255;
+    }
+}
+
+void decodeScalarBlock(const std::uint8_t *in, int component, std::uint8_t (*out)[4])
+{
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 8; i++)
+        bits |= std::uint64_t(in[i]) << (8 * i);
+
+    const std::array<int, 8> palette = getScalarPalette(in[0], in[1]);
+    for (int p = 0; p < 16; p++)
+        out[p][component] = std::uint8_t(palette[bits >> (16 + 3 * p) & 7]);
+}
+
+void decodeBC7Block(const std::uint8_t *in, std::uint8_t (*out)[4])
+{
+    BitReader reader{in};
+    if (reader.read(7) != 1u << 6)
+        throw Error("only BC7 mode 6 blocks can be decoded");
+
+    Endpoint endpoints[2]{};
+    for (int c = 0; c < 4; c++)
+    {
+        endpoints[0].components[c] = std::uint8_t(reader.read(7));
+        endpoints[1].components[c] = std::uint8_t(reader.read(7));
+    }
+    endpoints[0].p_bit = std::uint8_t(reader.read(1));
+    endpoints[1].p_bit = std::uint8_t(reader.read(1));
+
+    const Palette palette = getBC7Palette(endpoints[0], endpoints[1]);
+    for (int p = 0; p < 16; p++)
+    {
+        const std::uint32_t index = reader.read(p == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++)
+            out[p][c] = std::uint8_t(palette.colors[index][c]);
+    }
+}
+
+void decodeBlock(BlockCodec codec, const std::uint8_t *in, std::uint8_t (*out)[4])
+{
+    for (int p = 0; p < 16; p++)
+    {
+        out[p][0] = out[p][1] = out[p][2] = 0;
+        out[p][3] = 255;
+    }
+
+    switch (codec)
+    {
+        case BlockCodec::bc1:
+            decodeColorBlock(in, false, out);
+            break;
+        case BlockCodec::bc3:
+            decodeColorBlock(in + 8, true, out);
+            decodeScalarBlock(in, 3, out);
+            break;
+        case BlockCodec::bc4:
+            decodeScalarBlock(in, 0, out);
+            break;
+        case BlockCodec::bc5:
+            decodeScalarBlock(in, 0, out);
+            decodeScalarBlock(in + 8, 1, out);
+            break;
+        case BlockCodec::bc7:
+            decodeBC7Block(in, out);
+            break;
+    }
+}
+
+// Run fn(block_row) for every block row, with threads claiming rows as they go.
+template<typename Fn>
+void forEachBlockRow(GLsizei block_rows, unsigned int thread_count, Fn &&fn)
+{
+    thread_count = std::min<unsigned int>(thread_count, unsigned(block_rows));
+
+    std::atomic<GLsizei> next_row{0};
+    auto work = [&]
+    {
+        for (GLsizei row = next_row++; row < block_rows; row = next_row++)
+            fn(row);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count > 0 ? thread_count - 1 : 0);
+    for (unsigned int t = 1; t < thread_count; t++)
+        threads.emplace_back(work);
+
+    work();
+
+    for (std::thread &thread: threads)
+        thread.join();
+}
+
+} // namespace
+
+auto compressImage(const std::uint8_t *rgba, GLsizei width, GLsizei height, SizedInternalFormat format,
+                   const CompressionOptions &options, CompressionStats *stats) -> std::vector<std::byte>
+{
+    const BlockCodec codec = getBlockCodec(format);
+    const std::size_t block_size = getBlockSize(codec);
+    const GLsizei blocks_x = (width + 3) / 4;
+    const GLsizei blocks_y = (height + 3) / 4;
+
+    std::vector<std::byte> result(std::size_t(blocks_x) * blocks_y * block_size);
+
+    const unsigned int thread_count = options.thread_count ? options.thread_count
+                                                           : std::max(1u, std::thread::hardware_concurrency());
+
+    const auto start = std::chrono::steady_clock::now();
+
+    forEachBlockRow(blocks_y, thread_count, [&](GLsizei block_y)
+    {
+        auto *out = reinterpret_cast<std::uint8_t *>(result.data()) + std::size_t(block_y) * blocks_x * block_size;
+        Block block;
+        for (GLsizei block_x = 0; block_x < blocks_x; block_x++, out += block_size)
+        {
+            loadBlock(rgba, width, height, block_x, block_y, block);
+            encodeBlock(codec, block, options.quality, out);
+        }
+    });
+
+    if (stats)
+    {
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats->megapixels_per_second = stats->seconds > 0.0
+                                       ? double(width) * double(height) / stats->seconds * 1e-6
+                                       : std::numeric_limits<double>::infinity();
+
+        const std::vector<std::uint8_t> decoded = decompressImage(result.data(), width, height, format);
+        stats->psnr = computePSNR(rgba, decoded.data(), width, height, getEncodedComponentCount(codec));
+    }
+
+    return result;
+}
+
+auto decompressImage(const std::byte *blocks, GLsizei width, GLsizei height,
+                     SizedInternalFormat format) -> std::vector<std::uint8_t>
+{
+    const BlockCodec codec = getBlockCodec(format);
+    const std::size_t block_size = getBlockSize(codec);
+    const GLsizei blocks_x = (width + 3) / 4;
+    const GLsizei blocks_y = (height + 3) / 4;
+
+    std::vector<std::uint8_t> result(std::size_t(width) * height * 4);
+
+    const auto *in = reinterpret_cast<const std::uint8_t *>(blocks);
+    std::uint8_t decoded[16][4];
+
+    for (GLsizei block_y = 0; block_y < blocks_y; block_y++)
+        for (GLsizei block_x = 0; block_x < blocks_x; block_x++, in += block_size)
+        {
+            decodeBlock(codec, in, decoded);
+
+            for (int y = 0; y < 4 && block_y * 4 + y < height; y++)
+                for (int x = 0; x < 4 && block_x * 4 + x < width; x++)
+                    std::memcpy(&result[(std::size_t(block_y * 4 + y) * width + block_x * 4 + x) * 4],
+                                decoded[y * 4 + x], 4);
+        }
+
+    return result;
+}
+
+auto computePSNR(const std::uint8_t *a, const std::uint8_t *b, GLsizei width, GLsizei height,
+                 int component_count) -> double
+{
+    const std::size_t pixel_count = std::size_t(width) * height;
+    if (pixel_count == 0 || component_count <= 0)
+        return std::numeric_limits<double>::infinity();
+
+    std::uint64_t squared_error = 0;
+    for (std::size_t i = 0; i < pixel_count; i++)
+        for (int c = 0; c < component_count; c++)
+        {
+            const int d = int(a[i * 4 + c]) - int(b[i * 4 + c]);
+            squared_error += std::uint64_t(d * d);
+        }
+
+    if (squared_error == 0)
+        return std::numeric_limits<double>::infinity();
+
+    const double mse = double(squared_error) / double(pixel_count * component_count);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+} // GL
@@ -0,0 +1,460 @@
+#include "glutils/texture_file.hpp"
+#include "glutils/error.hpp"
+#include "glutils/mipmap.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace GL {
+
+namespace {
+
+using Type = TextureHandle::Type;
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+using DataFormat = TextureHandle::DataFormat;
+using DataType = TextureHandle::DataType;
+
+struct FormatMapping
+{
+    SizedInternalFormat internal_format;
+    DataFormat format{DataFormat::rgba};
+    DataType type{DataType::ubyte};
+};
+
+class Reader
+{
+public:
+    Reader(const MappedFile &file) : m_data(file.getData()), m_size(file.getSize())
+    {}
+
+    template<typename T>
+    [[nodiscard]] auto read(std::size_t offset) const -> T
+    {
+        check(offset, sizeof(T));
+        T value;
+        std::memcpy(&value, m_data + offset, sizeof(T));
+        return value;
+    }
+
+    [[nodiscard]] auto pointer(std::size_t offset, std::size_t size) const -> const std::byte *
+    {
+        check(offset, size);
+        return m_data + offset;
+    }
+
+    [[nodiscard]] bool matches(std::size_t offset, const void *bytes, std::size_t size) const
+    {
+        return offset + size <= m_size && std::memcmp(m_data + offset, bytes, size) == 0;
+    }
+
+private:
+    void check(std::size_t offset, std::size_t size) const
+    {
+        if (offset > m_size || size > m_size - offset)
+            throw Error("texture file is truncated");
+    }
+
+    const std::byte *m_data;
+    std::size_t m_size;
+};
+
+auto mapVkFormat(std::uint32_t vk_format) -> FormatMapping
+{
+    using F = SizedInternalFormat;
+
+    // ASTC formats alternate between UNORM and SRGB, in the same order as the GL enums
+    if (vk_format >= 157 && vk_format <= 184)
+    {
+        const GLenum index = (vk_format - 157) / 2;
+        const GLenum base = (vk_format - 157) % 2 ? GLenum(F::compressed_srgb8_alpha8_astc_4x4)
+                                                  : GLenum(F::compressed_rgba_astc_4x4);
+        return {SizedInternalFormat(base + index)};
+    }
+
+    switch (vk_format)
+    {
+        case 9: return {F::r8, DataFormat::red};
+        case 16: return {F::rg8, DataFormat::rg};
+        case 23: return {F::rgb8, DataFormat::rgb};
+        case 29: return {F::srgb8, DataFormat::rgb};
+        case 37: return {F::rgba8, DataFormat::rgba};
+        case 43: return {F::srgb8_alpha8, DataFormat::rgba};
+        case 44: return {F::rgba8, DataFormat::bgra};
+        case 50: return {F::srgb8_alpha8, DataFormat::bgra};
+        case 76: return {F::r16f, DataFormat::red, DataType::half_float};
+        case 83: return {F::rg16f, DataFormat::rg, DataType::half_float};
+        case 97: return {F::rgba16f, DataFormat::rgba, DataType::half_float};
+        case 100: return {F::r32f, DataFormat::red, DataType::_float};
+        case 103: return {F::rg32f, DataFormat::rg, DataType::_float};
+        case 109: return {F::rgba32f, DataFormat::rgba, DataType::_float};
+        case 131: return {F::compressed_rgb_s3tc_dxt1};
+        case 132: return {F::compressed_srgb_s3tc_dxt1};
+        case 133: return {F::compressed_rgba_s3tc_dxt1};
+        case 134: return {F::compressed_srgb_alpha_s3tc_dxt1};
+        case 135: return {F::compressed_rgba_s3tc_dxt3};
+        case 136: return {F::compressed_srgb_alpha_s3tc_dxt3};
+        case 137: return {F::compressed_rgba_s3tc_dxt5};
+        case 138: return {F::compressed_srgb_alpha_s3tc_dxt5};
+        case 139: return {F::compressed_red_rgtc1};
+        case 140: return {F::compressed_signed_red_rgtc1};
+        case 141: return {F::compressed_rg_rgtc2};
+        case 142: return {F::compressed_signed_rg_rgtc2};
+        case 143: return {F::compressed_rgb_bptc_unsigned_float};
+        case 144: return {F::compressed_rgb_bptc_signed_float};
+        case 145: return {F::compressed_rgba_bptc_unorm};
+        case 146: return {F::compressed_srgb_alpha_bptc_unorm};
+        case 147: return {F::compressed_rgb8_etc2};
+        case 148: return {F::compressed_srgb8_etc2};
+        case 149: return {F::compressed_rgb8_punchthrough_alpha1_etc2};
+        case 150: return {F::compressed_srgb8_punchthrough_alpha1_etc2};
+        case 151: return {F::compressed_rgba8_etc2_eac};
+        case 152: return {F::compressed_srgb8_alpha8_etc2_eac};
+        case 153: return {F::compressed_r11_eac};
+        case 154: return {F::compressed_signed_r11_eac};
+        case 155: return {F::compressed_rg11_eac};
+        case 156: return {F::compressed_signed_rg11_eac};
+        default:
+            throw Error("unsupported KTX2 vkFormat " + std::to_string(vk_format));
+    }
+}
+
+auto mapDxgiFormat(std::uint32_t dxgi_format) -> FormatMapping
+{
+    using F = SizedInternalFormat;
+
+    switch (dxgi_format)
+    {
+        case 2: return {F::rgba32f, DataFormat::rgba, DataType::_float};
+        case 10: return {F::rgba16f, DataFormat::rgba, DataType::half_float};
+        case 28: return {F::rgba8, DataFormat::rgba};
+        case 29: return {F::srgb8_alpha8, DataFormat::rgba};
+        case 41: return {F::r32f, DataFormat::red, DataType::_float};
+        case 49: return {F::rg8, DataFormat::rg};
+        case 54: return {F::r16f, DataFormat::red, DataType::half_float};
+        case 61: return {F::r8, DataFormat::red};
+        case 71: return {F::compressed_rgba_s3tc_dxt1};
+        case 72: return {F::compressed_srgb_alpha_s3tc_dxt1};
+        case 74: return {F::compressed_rgba_s3tc_dxt3};
+        case 75: return {F::compressed_srgb_alpha_s3tc_dxt3};
+        case 77: return {F::compressed_rgba_s3tc_dxt5};
+        case 78: return {F::compressed_srgb_alpha_s3tc_dxt5};
+        case 80: return {F::compressed_red_rgtc1};
+        case 81: return {F::compressed_signed_red_rgtc1};
+        case 83: return {F::compressed_rg_rgtc2};
+        case 84: return {F::compressed_signed_rg_rgtc2};
+        case 87: return {F::rgba8, DataFormat::bgra};
+        case 91: return {F::srgb8_alpha8, DataFormat::bgra};
+        case 95: return {F::compressed_rgb_bptc_unsigned_float};
+        case 96: return {F::compressed_rgb_bptc_signed_float};
+        case 98: return {F::compressed_rgba_bptc_unorm};
+        case 99: return {F::compressed_srgb_alpha_bptc_unorm};
+        default:
+            throw Error("unsupported DXGI format " + std::to_string(dxgi_format));
+    }
+}
+
+constexpr auto fourCC(char a, char b, char c, char d) -> std::uint32_t
+{
+    return std::uint32_t(std::uint8_t(a)) | std::uint32_t(std::uint8_t(b)) << 8 | std::uint32_t(std::uint8_t(c)) << 16
+           | std::uint32_t(std::uint8_t(d)) << 24;
+}
+
+auto getImageSize(const FormatMapping &format, GLsizei width, GLsizei height, GLsizei depth) -> std::size_t
+{
+    if (TextureHandle::getCompressedBlock(format.internal_format))
+        return TextureHandle::getCompressedImageSize(format.internal_format, width, height, depth);
+
+    return std::size_t(width) * height * depth * TextureHandle::getPixelSize(format.format, format.type);
+}
+
+auto getLevelSize(GLsizei size, GLint level) -> GLsizei
+{
+    return std::max(1, size >> level);
+}
+
+constexpr std::uint8_t ktx2_identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+} // namespace
+
+TextureFile::TextureFile(const std::string &path) : m_file(path)
+{
+    const Reader reader{m_file};
+
+    if (reader.matches(0, ktx2_identifier, sizeof(ktx2_identifier)))
+        parseKTX2();
+    else if (reader.matches(0, "DDS ", 4))
+        parseDDS();
+    else
+        throw Error("unrecognized texture file format: " + path);
+}
+
+void TextureFile::parseKTX2()
+{
+    const Reader reader{m_file};
+
+    const auto vk_format = reader.read<std::uint32_t>(12);
+    const auto pixel_width = reader.read<std::uint32_t>(20);
+    const auto pixel_height = reader.read<std::uint32_t>(24);
+    const auto pixel_depth = reader.read<std::uint32_t>(28);
+    const auto layer_count = reader.read<std::uint32_t>(32);
+    const auto face_count = reader.read<std::uint32_t>(36);
+    const auto level_count = reader.read<std::uint32_t>(40);
+    const auto supercompression = reader.read<std::uint32_t>(44);
+
+    if (supercompression != 0)
+        throw Error("supercompressed KTX2 files are not supported");
+    if (vk_format == 0)
+        throw Error("KTX2 files without a vkFormat are not supported");
+    if (face_count != 1 && face_count != 6)
+        throw Error("invalid KTX2 face count");
+    if (pixel_depth > 0 && (layer_count > 0 || face_count == 6))
+        throw Error("arrays of 3D textures are not supported");
+
+    const FormatMapping format = mapVkFormat(vk_format);
+    m_format = format.internal_format;
+    m_data_format = format.format;
+    m_data_type = format.type;
+
+    m_width = GLsizei(pixel_width);
+    m_height = GLsizei(std::max(1u, pixel_height));
+    m_depth = GLsizei(std::max(1u, pixel_depth));
+    m_layers = GLsizei(std::max(1u, layer_count));
+    m_levels = GLsizei(std::max(1u, level_count));
+    m_generate_mipmaps = level_count == 0;
+
+    if (face_count == 6)
+        m_type = layer_count > 0 ? Type::cube_map_array : Type::cube_map;
+    else if (pixel_depth > 0)
+        m_type = Type::_3d;
+    else if (pixel_height == 0)
+        m_type = layer_count > 0 ? Type::_1d_array : Type::_1d;
+    else
+        m_type = layer_count > 0 ? Type::_2d_array : Type::_2d;
+
+    // the level index follows the 80 byte header; images of a level are ordered by layer, then face, then slice
+    constexpr std::size_t level_index_offset = 80;
+    const GLsizei layer_faces = m_layers * GLsizei(face_count);
+
+    for (GLint level = 0; level < m_levels; level++)
+    {
+        const std::size_t entry = level_index_offset + std::size_t(level) * 24;
+        const auto byte_offset = reader.read<std::uint64_t>(entry);
+        const auto byte_length = reader.read<std::uint64_t>(entry + 8);
+
+        Image image;
+        image.level = level;
+        image.width = getLevelSize(m_width, level);
+        image.height = getLevelSize(m_height, level);
+        image.depth = m_type == Type::_3d ? getLevelSize(m_depth, level) : layer_faces;
+        image.size = getImageSize(format, image.width, image.height, image.depth);
+
+        if (byte_length < image.size)
+            throw Error("KTX2 level is smaller than expected");
+
+        image.data = reader.pointer(byte_offset, image.size);
+        m_images.emplace_back(image);
+    }
+}
+
+void TextureFile::parseDDS()
+{
+    const Reader reader{m_file};
+
+    // DDS_HEADER starts after the magic number
+    constexpr std::size_t header = 4;
+    constexpr std::uint32_t flag_mipmap_count = 0x20000;
+    constexpr std::uint32_t pixel_format_four_cc = 0x4;
+    constexpr std::uint32_t caps2_cubemap = 0x200;
+    constexpr std::uint32_t caps2_volume = 0x200000;
+
+    if (reader.read<std::uint32_t>(header) != 124)
+        throw Error("invalid DDS header");
+
+    const auto flags = reader.read<std::uint32_t>(header + 4);
+    const auto height = reader.read<std::uint32_t>(header + 8);
+    const auto width = reader.read<std::uint32_t>(header + 12);
+    const auto depth = reader.read<std::uint32_t>(header + 20);
+    const auto mipmap_count = reader.read<std::uint32_t>(header + 24);
+    const auto pf_flags = reader.read<std::uint32_t>(header + 76);
+    const auto four_cc = reader.read<std::uint32_t>(header + 80);
+    const auto rgb_bit_count = reader.read<std::uint32_t>(header + 84);
+    const auto r_mask = reader.read<std::uint32_t>(header + 88);
+    const auto b_mask = reader.read<std::uint32_t>(header + 96);
+    const auto caps2 = reader.read<std::uint32_t>(header + 108);
+
+    std::size_t data_offset = header + 124;
+    FormatMapping format{SizedInternalFormat::rgba8};
+    GLsizei faces = 1;
+    bool volume = false;
+    bool one_dimensional = false;
+
+    m_layers = 1;
+
+    if ((pf_flags & pixel_format_four_cc) && four_cc == fourCC('D', 'X', '1', '0'))
+    {
+        const std::size_t dx10 = data_offset;
+        format = mapDxgiFormat(reader.read<std::uint32_t>(dx10));
+        const auto dimension = reader.read<std::uint32_t>(dx10 + 4);
+        const auto misc_flag = reader.read<std::uint32_t>(dx10 + 8);
+        m_layers = GLsizei(std::max(1u, reader.read<std::uint32_t>(dx10 + 12)));
+        data_offset += 20;
+
+        one_dimensional = dimension == 2;
+        volume = dimension == 4;
+        if (misc_flag & 0x4)
+            faces = 6;
+    }
+    else
+    {
+        if (pf_flags & pixel_format_four_cc)
+        {
+            using F = SizedInternalFormat;
+
+            switch (four_cc)
+            {
+                case fourCC('D', 'X', 'T', '1'): format = {F::compressed_rgba_s3tc_dxt1}; break;
+                case fourCC('D', 'X', 'T', '3'): format = {F::compressed_rgba_s3tc_dxt3}; break;
+                case fourCC('D', 'X', 'T', '5'): format = {F::compressed_rgba_s3tc_dxt5}; break;
+                case fourCC('A', 'T', 'I', '1'):
+                case fourCC('B', 'C', '4', 'U'): format = {F::compressed_red_rgtc1}; break;
+                case fourCC('B', 'C', '4', 'S'): format = {F::compressed_signed_red_rgtc1}; break;
+                case fourCC('A', 'T', 'I', '2'):
+                case fourCC('B', 'C', '5', 'U'): format = {F::compressed_rg_rgtc2}; break;
+                case fourCC('B', 'C', '5', 'S'): format = {F::compressed_signed_rg_rgtc2}; break;
+                default:
+                    throw Error("unsupported DDS FourCC");
+            }
+        }
+        else if (rgb_bit_count == 32 && r_mask == 0x000000FF && b_mask == 0x00FF0000)
+            format = {SizedInternalFormat::rgba8, DataFormat::rgba};
+        else if (rgb_bit_count == 32 && r_mask == 0x00FF0000 && b_mask == 0x000000FF)
+            format = {SizedInternalFormat::rgba8, DataFormat::bgra};
+        else
+            throw Error("unsupported DDS pixel format");
+
+        volume = (caps2 & caps2_volume) && depth > 0;
+        if (caps2 & caps2_cubemap)
+            faces = 6;
+    }
+
+    m_format = format.internal_format;
+    m_data_format = format.format;
+    m_data_type = format.type;
+    m_width = GLsizei(width);
+    m_height = GLsizei(std::max(1u, height));
+    m_depth = volume ? GLsizei(std::max(1u, depth)) : 1;
+    m_levels = (flags & flag_mipmap_count) ? GLsizei(std::max(1u, mipmap_count)) : 1;
+
+    if (faces == 6)
+        m_type = m_layers > 1 ? Type::cube_map_array : Type::cube_map;
+    else if (volume)
+        m_type = Type::_3d;
+    else if (one_dimensional)
+        m_type = m_layers > 1 ? Type::_1d_array : Type::_1d;
+    else
+        m_type = m_layers > 1 ? Type::_2d_array : Type::_2d;
+
+    // unlike KTX2, DDS stores the complete mip chain of each layer (or face) before the next one
+    std::size_t offset = data_offset;
+
+    for (GLint layer = 0; layer < m_layers * faces; layer++)
+    {
+        for (GLint level = 0; level < m_levels; level++)
+        {
+            Image image;
+            image.level = level;
+            image.zoffset = layer;
+            image.width = getLevelSize(m_width, level);
+            image.height = getLevelSize(m_height, level);
+            image.depth = volume ? getLevelSize(m_depth, level) : 1;
+            image.size = getImageSize(format, image.width, image.height, image.depth);
+            image.data = reader.pointer(offset, image.size);
+            offset += image.size;
+            m_images.emplace_back(image);
+        }
+    }
+}
+
+auto TextureFile::createTexture() const -> Texture
+{
+    Texture texture{m_type};
+    allocateStorage(texture);
+    upload(texture);
+    return texture;
+}
+
+void TextureFile::allocateStorage(TextureHandle texture) const
+{
+    const GLsizei levels = m_generate_mipmaps ? getMipLevelCount(std::max(m_width, m_depth), m_height) : m_levels;
+
+    switch (m_type)
+    {
+        case Type::_1d:
+            texture.setStorage1D(levels, m_format, m_width);
+            break;
+        case Type::_1d_array:
+            texture.setStorage2D(levels, m_format, m_width, m_layers);
+            break;
+        case Type::_3d:
+            texture.setStorage3D(levels, m_format, m_width, m_height, m_depth);
+            break;
+        case Type::_2d_array:
+            texture.setStorage3D(levels, m_format, m_width, m_height, m_layers);
+            break;
+        case Type::cube_map_array:
+            texture.setStorage3D(levels, m_format, m_width, m_height, m_layers * 6);
+            break;
+        default:
+            texture.setStorage2D(levels, m_format, m_width, m_height);
+            break;
+    }
+}
+
+void TextureFile::upload(TextureHandle texture) const
+{
+    PixelUnpackLayout layout;
+    layout.alignment = 1;
+
+    const bool compressed = isCompressed();
+
+    for (const Image &image: m_images)
+    {
+        const auto size = GLsizei(image.size);
+
+        if (compressed)
+        {
+            if (m_type == Type::_2d)
+                texture.updateCompressedImage2D(image.level, 0, 0, image.width, image.height, m_format, size,
+                                                image.data);
+            else
+                texture.updateCompressedImage3D(image.level, 0, 0, image.zoffset, image.width, image.height,
+                                                image.depth, m_format, size, image.data);
+            continue;
+        }
+
+        switch (m_type)
+        {
+            case Type::_1d:
+                texture.updateImage1D(image.level, 0, image.width, m_data_format, m_data_type, image.data, layout);
+                break;
+            case Type::_1d_array:
+                texture.updateImage2D(image.level, 0, image.zoffset, image.width, image.depth, m_data_format,
+                                      m_data_type, image.data, layout);
+                break;
+            case Type::_2d:
+                texture.updateImage2D(image.level, 0, 0, image.width, image.height, m_data_format, m_data_type,
+                                      image.data, layout);
+                break;
+            default:
+                texture.updateImage3D(image.level, 0, 0, image.zoffset, image.width, image.height, image.depth,
+                                      m_data_format, m_data_type, image.data, layout);
+                break;
+        }
+    }
+
+    if (m_generate_mipmaps)
+        texture.generateMipmap();
+}
+
+} // GL
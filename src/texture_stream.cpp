@@ -0,0 +1,276 @@
+#include "glutils/texture_stream.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+#include "glutils/pixel_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace GL {
+
+namespace {
+
+// glTextureSubImage* requires buffer offsets to be a multiple of the size of the pixel data type.
+constexpr GLsizeiptr staging_alignment = 16;
+
+// GL_UNPACK_ALIGNMENT defaults to 4
+constexpr GLsizeiptr row_alignment = 4;
+
+constexpr auto alignUp(GLsizeiptr value, GLsizeiptr alignment) -> GLsizeiptr
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+TextureStreamer::TextureStreamer(GLsizeiptr staging_size) : m_size(alignUp(staging_size, staging_alignment))
+{
+    using StorageFlags = BufferHandle::StorageFlags;
+    using AccessFlags = BufferHandle::AccessFlags;
+
+    m_buffer.allocateImmutable(m_size, StorageFlags::map_write | StorageFlags::map_persistent
+                                       | StorageFlags::map_coherent);
+    m_mapping = static_cast<std::byte *>(m_buffer.mapRange(0, m_size, AccessFlags::write | AccessFlags::persistent
+                                                                      | AccessFlags::coherent));
+    if (!m_mapping)
+        throw Error("failed to map texture streaming buffer");
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    if (m_mapping)
+        m_buffer.unmap();
+}
+
+auto TextureStreamer::acquire(GLsizeiptr size) -> Staging
+{
+    if (alignUp(size, staging_alignment) > m_size)
+        throw Error("requested staging region is larger than the streaming buffer");
+
+    std::unique_lock lock{m_mutex};
+    Staging staging;
+    m_space_available.wait(lock, [&] { return bool(staging = tryAllocate(size)); });
+
+    return staging;
+}
+
+auto TextureStreamer::tryAcquire(GLsizeiptr size) -> Staging
+{
+    std::lock_guard lock{m_mutex};
+    return tryAllocate(size);
+}
+
+void TextureStreamer::submit(const Staging &staging, const Upload &upload)
+{
+    std::lock_guard lock{m_mutex};
+    findAllocation(staging.serial).state = AllocationState::queued;
+    m_pending.push_back({staging.serial, staging.offset, staging.size, upload});
+}
+
+void TextureStreamer::cancel(const Staging &staging)
+{
+    std::lock_guard lock{m_mutex};
+    findAllocation(staging.serial).state = AllocationState::retired;
+}
+
+void TextureStreamer::streamImage2D(const Upload &upload, const void *pixels, GLsizeiptr row_stride,
+                                    GLsizei tile_size)
+{
+    const GLsizei pixel_size = TextureHandle::getPixelSize(upload.format, upload.type);
+    const auto *source = static_cast<const std::byte *>(pixels);
+
+    for (GLsizei tile_y = 0; tile_y < upload.height; tile_y += tile_size)
+    {
+        const GLsizei tile_height = std::min(tile_size, upload.height - tile_y);
+
+        for (GLsizei tile_x = 0; tile_x < upload.width; tile_x += tile_size)
+        {
+            const GLsizei tile_width = std::min(tile_size, upload.width - tile_x);
+            const GLsizeiptr row_size = GLsizeiptr(tile_width) * pixel_size;
+            const GLsizeiptr staging_row_stride = alignUp(row_size, row_alignment);
+
+            const Staging staging = acquire(staging_row_stride * tile_height);
+            auto *destination = static_cast<std::byte *>(staging.data);
+
+            for (GLsizei row = 0; row < tile_height; row++)
+                std::memcpy(destination + row * staging_row_stride,
+                            source + (tile_y + row) * row_stride + GLsizeiptr(tile_x) * pixel_size,
+                            row_size);
+
+            Upload tile = upload;
+            tile.xoffset += tile_x;
+            tile.yoffset += tile_y;
+            tile.width = tile_width;
+            tile.height = tile_height;
+            tile.depth = 1;
+            submit(staging, tile);
+        }
+    }
+}
+
+auto TextureStreamer::process(GLsizeiptr byte_budget) -> GLsizeiptr
+{
+    std::vector<Pending> issued;
+    GLsizeiptr issued_bytes = 0;
+    {
+        std::lock_guard lock{m_mutex};
+        reclaim();
+
+        while (!m_pending.empty() && issued_bytes < byte_budget)
+        {
+            issued_bytes += m_pending.front().size;
+            issued.emplace_back(m_pending.front());
+            m_pending.pop_front();
+        }
+    }
+
+    if (issued.empty())
+        return 0;
+
+    // staging rows are tightly packed, apart from the default 4 byte alignment
+    setPixelUnpackLayout({});
+    m_buffer.bind(BufferHandle::Target::pixel_unpack);
+
+    for (const Pending &pending: issued)
+    {
+        const Upload &u = pending.upload;
+        const auto *offset = reinterpret_cast<const void *>(pending.offset);
+
+        switch (u.dimensions)
+        {
+            case 1:
+                u.texture.updateImage1D(u.level, u.xoffset, u.width, u.format, u.type, offset);
+                break;
+            case 2:
+                u.texture.updateImage2D(u.level, u.xoffset, u.yoffset, u.width, u.height, u.format, u.type, offset);
+                break;
+            default:
+                u.texture.updateImage3D(u.level, u.xoffset, u.yoffset, u.zoffset, u.width, u.height, u.depth,
+                                        u.format, u.type, offset);
+                break;
+        }
+    }
+
+    BufferHandle::unbind(BufferHandle::Target::pixel_unpack);
+
+    Sync fence = createFenceSync();
+
+    std::lock_guard lock{m_mutex};
+    const std::uint64_t batch = m_next_batch++;
+
+    for (const Pending &pending: issued)
+    {
+        Allocation &allocation = findAllocation(pending.serial);
+        allocation.state = AllocationState::in_flight;
+        allocation.batch = batch;
+    }
+
+    m_batches.push_back({batch, std::move(fence)});
+
+    return issued_bytes;
+}
+
+auto TextureStreamer::getPendingCount() const -> std::size_t
+{
+    std::lock_guard lock{m_mutex};
+    return m_pending.size();
+}
+
+auto TextureStreamer::getBytesInUse() const -> GLsizeiptr
+{
+    std::lock_guard lock{m_mutex};
+    return m_used;
+}
+
+auto TextureStreamer::tryAllocate(GLsizeiptr size) -> Staging
+{
+    const GLsizeiptr aligned_size = alignUp(size, staging_alignment);
+
+    if (aligned_size > m_size)
+        return {};
+
+    GLintptr begin;
+    GLintptr offset;
+
+    if (m_allocations.empty())
+    {
+        begin = offset = 0;
+    }
+    else
+    {
+        const GLintptr tail = m_allocations.front().begin;
+
+        if (m_head > tail)
+        {
+            if (m_size - m_head >= aligned_size)
+                begin = offset = m_head;
+            else if (tail >= aligned_size)
+            {
+                // skip the end of the ring; the padding is released together with this allocation
+                begin = m_head;
+                offset = 0;
+            }
+            else
+                return {};
+        }
+        else if (tail - m_head >= aligned_size)
+            begin = offset = m_head;
+        else
+            return {};
+    }
+
+    const GLintptr end = offset + aligned_size;
+    const std::uint64_t serial = m_next_serial++;
+
+    m_allocations.push_back({serial, begin, end, AllocationState::reserved, 0});
+    m_used += begin <= offset ? end - begin : m_size - begin + end;
+    m_head = end;
+
+    return {m_mapping + offset, offset, size, serial};
+}
+
+auto TextureStreamer::findAllocation(std::uint64_t serial) -> Allocation &
+{
+    const auto iter = std::lower_bound(m_allocations.begin(), m_allocations.end(), serial,
+                                       [](const Allocation &a, std::uint64_t s) { return a.serial < s; });
+
+    if (iter == m_allocations.end() || iter->serial != serial)
+        throw Error("unknown staging region");
+
+    return *iter;
+}
+
+void TextureStreamer::reclaim()
+{
+    while (!m_batches.empty())
+    {
+        const auto status = m_batches.front().fence.clientWait(false);
+
+        if (status != Sync::Status::already_signaled && status != Sync::Status::condition_satisfied)
+            break;
+
+        for (Allocation &allocation: m_allocations)
+            if (allocation.state == AllocationState::in_flight && allocation.batch == m_batches.front().id)
+                allocation.state = AllocationState::retired;
+
+        m_batches.pop_front();
+    }
+
+    bool released = false;
+
+    while (!m_allocations.empty() && m_allocations.front().state == AllocationState::retired)
+    {
+        const Allocation &front = m_allocations.front();
+        m_used -= front.begin < front.end ? front.end - front.begin : m_size - front.begin + front.end;
+        m_allocations.pop_front();
+        released = true;
+    }
+
+    if (m_allocations.empty())
+        m_head = 0;
+
+    if (released)
+        m_space_available.notify_all();
+}
+
+} // GL
@@ -0,0 +1,335 @@
+#include "glutils/tile_residency.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+namespace GL {
+
+namespace {
+
+constexpr std::uint32_t no_tile = 0xFF000000u;
+// TextureStreamer uploads with the default layout, so staging rows are aligned to 4 bytes
+constexpr GLsizeiptr row_alignment = 4;
+
+} // namespace
+
+TileResidency::TileResidency(TextureHandle pool, TextureHandle table, const Options &options,
+                             std::vector<LevelSize> levels, TileLoader loader) :
+        m_pool(pool),
+        m_table(table),
+        m_options(options),
+        m_loader(std::move(loader)),
+        m_streamer(options.staging_size)
+{
+    for (const LevelSize &size: levels)
+    {
+        Level &level = m_levels.emplace_back();
+        level.size = size;
+        level.entries.assign(std::size_t(size.table_x) * size.table_y * size.table_z, no_tile);
+        // the table texture starts out undefined
+        std::fill(std::begin(level.dirty_min), std::end(level.dirty_min), 0);
+        level.dirty_max[0] = size.table_x;
+        level.dirty_max[1] = size.table_y;
+        level.dirty_max[2] = size.table_z;
+    }
+
+    m_slots.resize(std::size_t(options.pool_x) * options.pool_y * options.pool_z);
+
+    for (unsigned int i = 0; i < std::max(1u, options.loader_threads); i++)
+        m_threads.emplace_back([this] { runLoader(); });
+}
+
+TileResidency::~TileResidency()
+{
+    {
+        std::lock_guard lock{m_mutex};
+        m_stopping = true;
+    }
+    m_jobs_available.notify_all();
+
+    for (std::thread &thread: m_threads)
+        thread.join();
+}
+
+auto TileResidency::s_key(const TileId &tile) -> std::uint64_t
+{
+    return std::uint64_t(tile.level) << 60 | std::uint64_t(tile.z) << 40 | std::uint64_t(tile.y) << 20
+           | std::uint64_t(tile.x);
+}
+
+auto TileResidency::getRowStride(const Options &options) -> GLsizeiptr
+{
+    const GLsizeiptr row_size = GLsizeiptr(options.tile_size + 2 * options.border)
+                                * TextureHandle::getPixelSize(options.data_format, options.data_type);
+    return (row_size + row_alignment - 1) / row_alignment * row_alignment;
+}
+
+auto TileResidency::getTileBytes(const Options &options) -> GLsizeiptr
+{
+    const GLsizeiptr slot_size = options.tile_size + 2 * options.border;
+    return getRowStride(options) * slot_size * (options.layered ? 1 : slot_size);
+}
+
+auto TileResidency::touch(const TileId &tile) -> State
+{
+    const auto it = m_tile_slots.find(s_key(tile));
+    if (it == m_tile_slots.end())
+        return State::free;
+
+    Slot &slot = m_slots[it->second];
+    slot.last_used = m_frame;
+    return slot.state;
+}
+
+auto TileResidency::request(const TileId &tile) -> bool
+{
+    const std::optional<std::size_t> slot_index = findSlot();
+    if (!slot_index)
+        return false;
+
+    Slot &slot = m_slots[*slot_index];
+    slot.state = State::loading;
+    slot.tile = tile;
+    slot.last_used = m_frame;
+    slot.pinned = m_options.pin_top_level && tile.level == GLint(m_levels.size()) - 1;
+    m_tile_slots[s_key(tile)] = *slot_index;
+
+    {
+        std::lock_guard lock{m_mutex};
+        m_jobs.push_back({tile, *slot_index});
+    }
+    m_jobs_available.notify_one();
+    return true;
+}
+
+auto TileResidency::update() -> Stats
+{
+    finishUploads();
+    uploadTable();
+
+    m_stats.resident_tiles = 0;
+    m_stats.loading_tiles = 0;
+    for (const Slot &slot: m_slots)
+    {
+        m_stats.resident_tiles += slot.state == State::resident;
+        m_stats.loading_tiles += slot.state == State::loading;
+    }
+
+    const Stats stats = m_stats;
+    m_stats = {};
+    m_frame++;
+    return stats;
+}
+
+auto TileResidency::findSlot() -> std::optional<std::size_t>
+{
+    std::optional<std::size_t> lru;
+
+    for (std::size_t i = 0; i < m_slots.size(); i++)
+    {
+        const Slot &slot = m_slots[i];
+        if (slot.state == State::free)
+            return i;
+
+        // tiles used this frame stay
+        if (slot.state == State::resident && !slot.pinned && slot.last_used < m_frame
+            && (!lru || slot.last_used < m_slots[*lru].last_used))
+            lru = i;
+    }
+
+    if (lru)
+    {
+        Slot &slot = m_slots[*lru];
+        m_tile_slots.erase(s_key(slot.tile));
+        slot.state = State::free;
+        updateEntries(slot.tile);
+        m_stats.evicted_tiles++;
+    }
+
+    return lru;
+}
+
+void TileResidency::runLoader()
+{
+    const GLsizei slot_size = m_options.tile_size + 2 * m_options.border;
+    const GLsizeiptr row_stride = getRowStride(m_options);
+    const GLsizeiptr tile_bytes = getTileBytes(m_options);
+
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock lock{m_mutex};
+            m_jobs_available.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping)
+                return;
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+
+        // don't block in acquire(): the GL thread may be waiting to join this thread
+        TextureStreamer::Staging staging;
+        while (!(staging = m_streamer.tryAcquire(tile_bytes)))
+        {
+            {
+                std::lock_guard lock{m_mutex};
+                if (m_stopping)
+                    return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        bool loaded;
+        try
+        {
+            loaded = m_loader(job.tile, staging.data, row_stride);
+        }
+        catch (...)
+        {
+            loaded = false;
+        }
+
+        if (loaded)
+        {
+            const auto slot = GLsizei(job.slot);
+            const GLsizei slot_depth = m_options.layered ? 1 : slot_size;
+
+            TextureStreamer::Upload upload;
+            upload.texture = m_pool;
+            upload.dimensions = 3;
+            upload.xoffset = slot % m_options.pool_x * slot_size;
+            upload.yoffset = slot / m_options.pool_x % m_options.pool_y * slot_size;
+            upload.zoffset = slot / (m_options.pool_x * m_options.pool_y) * slot_depth;
+            upload.width = slot_size;
+            upload.height = slot_size;
+            upload.depth = slot_depth;
+            upload.format = m_options.data_format;
+            upload.type = m_options.data_type;
+            m_streamer.submit(staging, upload);
+        }
+        else
+            m_streamer.cancel(staging);
+
+        std::lock_guard lock{m_mutex};
+        m_completions.push_back({job.slot, loaded});
+    }
+}
+
+void TileResidency::finishUploads()
+{
+    std::vector<Completion> completions;
+    {
+        std::lock_guard lock{m_mutex};
+        completions.swap(m_completions);
+    }
+
+    // every completion was submitted before this, so its upload is issued ahead of the table update
+    m_stats.bytes_streamed = m_streamer.process();
+
+    for (const Completion &completion: completions)
+    {
+        Slot &slot = m_slots[completion.slot];
+        if (completion.loaded)
+        {
+            slot.state = State::resident;
+            updateEntries(slot.tile);
+            m_stats.uploaded_tiles++;
+        }
+        else
+        {
+            m_tile_slots.erase(s_key(slot.tile));
+            slot.state = State::free;
+            slot.pinned = false;
+        }
+    }
+}
+
+void TileResidency::updateEntries(const TileId &tile)
+{
+    const GLint top_level = GLint(m_levels.size()) - 1;
+
+    // the tile and everything below it that may fall back to it
+    for (GLint l = tile.level; l >= 0; l--)
+    {
+        const int shift = tile.level - l;
+        Level &level = m_levels[l];
+        const LevelSize &size = level.size;
+
+        const GLint x0 = tile.x << shift;
+        const GLint y0 = tile.y << shift;
+        const GLint z0 = tile.z << shift;
+        const GLint x1 = std::min(x0 + (1 << shift), size.tiles_x);
+        const GLint y1 = std::min(y0 + (1 << shift), size.tiles_y);
+        const GLint z1 = std::min(z0 + (1 << shift), size.tiles_z);
+
+        for (GLint z = z0; z < z1; z++)
+            for (GLint y = y0; y < y1; y++)
+                for (GLint x = x0; x < x1; x++)
+                {
+                    std::uint32_t entry;
+
+                    const auto it = m_tile_slots.find(s_key({l, x, y, z}));
+                    if (it != m_tile_slots.end() && m_slots[it->second].state == State::resident)
+                    {
+                        const auto slot = GLsizei(it->second);
+                        entry = std::uint32_t(slot % m_options.pool_x)
+                                | std::uint32_t(slot / m_options.pool_x % m_options.pool_y) << 8
+                                | std::uint32_t(slot / (m_options.pool_x * m_options.pool_y)) << 16
+                                | std::uint32_t(l) << 24;
+                    }
+                    else if (l == top_level)
+                        entry = no_tile;
+                    else
+                    {
+                        const LevelSize &parent = m_levels[l + 1].size;
+                        entry = m_levels[l + 1].entries[(std::size_t(z / 2) * parent.table_y + y / 2)
+                                                        * parent.table_x + x / 2];
+                    }
+
+                    level.entries[(std::size_t(z) * size.table_y + y) * size.table_x + x] = entry;
+                }
+
+        const GLint lo[3]{x0, y0, z0};
+        const GLint hi[3]{x1, y1, z1};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            level.dirty_min[axis] = std::min(level.dirty_min[axis], lo[axis]);
+            level.dirty_max[axis] = std::max(level.dirty_max[axis], hi[axis]);
+        }
+    }
+}
+
+void TileResidency::uploadTable()
+{
+    for (GLint l = 0; l < GLint(m_levels.size()); l++)
+    {
+        Level &level = m_levels[l];
+        if (level.dirty_min[0] >= level.dirty_max[0] || level.dirty_min[1] >= level.dirty_max[1]
+            || level.dirty_min[2] >= level.dirty_max[2])
+            continue;
+
+        PixelUnpackLayout layout;
+        layout.row_length = level.size.table_x;
+        layout.image_height = level.size.table_y;
+        layout.skip_pixels = level.dirty_min[0];
+        layout.skip_rows = level.dirty_min[1];
+        layout.skip_images = level.dirty_min[2];
+
+        const GLsizei width = level.dirty_max[0] - level.dirty_min[0];
+        const GLsizei height = level.dirty_max[1] - level.dirty_min[1];
+        if (m_options.layered)
+            m_table.updateImage2D(l, level.dirty_min[0], level.dirty_min[1], width, height,
+                                  TextureHandle::DataFormat::rgba_integer, TextureHandle::DataType::ubyte,
+                                  level.entries.data(), layout);
+        else
+            m_table.updateImage3D(l, level.dirty_min[0], level.dirty_min[1], level.dirty_min[2], width, height,
+                                  level.dirty_max[2] - level.dirty_min[2], TextureHandle::DataFormat::rgba_integer,
+                                  TextureHandle::DataType::ubyte, level.entries.data(), layout);
+
+        std::fill(std::begin(level.dirty_min), std::end(level.dirty_min), INT_MAX);
+        std::fill(std::begin(level.dirty_max), std::end(level.dirty_max), 0);
+    }
+}
+
+} // GL
@@ -0,0 +1,1281 @@
+#include "glutils/trace.hpp"
+#include "glutils/error.hpp"
+#include "glutils/texture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <utility>
+
+namespace GL {
+
+namespace {
+
+constexpr std::uint32_t trace_magic = 0x52544C47; // "GLTR"
+constexpr std::uint32_t trace_version = 1;
+
+enum RecordTag : std::uint8_t
+{
+    tag_function = 1,
+    tag_call = 2,
+    tag_frame = 3
+};
+
+// Pointer arguments are written as a varint tag: null, an offset into a bound buffer, or a payload of tag - 2 bytes.
+constexpr std::uint64_t pointer_null = 0;
+constexpr std::uint64_t pointer_offset = 1;
+constexpr std::uint64_t pointer_payload = 2;
+
+// Entry point the recorder writes for the data written through a mapping: buffer, offset, data.
+constexpr const char *write_mapped_name = "glutilsWriteMapped";
+
+// Object name kinds, in the order of name_kinds; names of each kind are remapped separately on replay.
+constexpr std::string_view name_kinds = "BTSFRVPHQ";
+
+struct Value
+{
+    std::uint64_t u{0};
+    double f{0.};
+    const void *p{nullptr};
+};
+
+struct PixelStore
+{
+    GLint alignment{4};
+    GLint row_length{0};
+    GLint image_height{0};
+    GLint skip_pixels{0};
+    GLint skip_rows{0};
+    GLint skip_images{0};
+};
+
+// What the size functions need to know about the recording context.
+struct RecordState
+{
+    PixelStore pack;
+    PixelStore unpack;
+    GLuint pack_buffer{0};
+    GLuint unpack_buffer{0};
+};
+
+// Size in bytes of the memory a pointer argument points to, or in elements for name arrays. -1 means the pointer is
+// an offset into a bound buffer.
+using SizeFunction = GLsizeiptr (*)(const RecordState &state, const Value *a, std::size_t index);
+
+using ReplayFunction = void (*)(Value *a, Value &ret);
+
+/**
+ * An entry point the recorder supports.
+ *
+ * The signature is the kind of the return value followed by those of the arguments:
+ *  - '-' nothing, 'e' an ignored value, 'm' a mapping pointer
+ *  - 'e' enum, bitfield, boolean or unsigned; 'i' int or sizei; 'l' intptr or sizeiptr; 'q' 64-bit; 'f' float,
+ *    'd' double
+ *  - one of name_kinds: an object name; 'Y' a sync object
+ *  - '#' client memory read by the call; 'r' memory written by it; 'o' a pointer used as a buffer offset; 'x' a
+ *    pointer that isn't recorded and is replayed as null
+ *  - '*' followed by a name kind: an array of names read; '>' followed by a name kind: an array of names created
+ *  - 's' the strings of glShaderSource, followed by 'x' for their lengths
+ */
+struct TracedFunction
+{
+    const char *name;
+    const char *signature;
+    SizeFunction size;
+    ReplayFunction replay;
+    bool (*isLoaded)();
+};
+
+constexpr auto alignUp(GLsizeiptr value, GLsizeiptr alignment) -> GLsizeiptr
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+auto asInt(const Value &value) -> std::int64_t
+{
+    return std::int64_t(value.u);
+}
+
+auto getPixelBytes(GLenum format, GLenum type) -> GLsizeiptr
+{
+    return TextureHandle::getPixelSize(TextureHandle::DataFormat(format), TextureHandle::DataType(type));
+}
+
+// Bytes spanned by an image of @p dimensions dimensions in client memory, laid out as described by @p store. Like GL,
+// ignores skip_rows for one-dimensional images, and image_height and skip_images for those with fewer than three.
+auto getImageBytes(const PixelStore &store, int dimensions, std::int64_t width, std::int64_t height,
+                   std::int64_t depth, GLenum format, GLenum type) -> GLsizeiptr
+{
+    if (width <= 0 || height <= 0 || depth <= 0)
+        return 0;
+
+    const GLsizeiptr pixel = getPixelBytes(format, type);
+    GLsizeiptr bytes = store.skip_pixels * pixel + width * pixel;
+    if (dimensions < 2)
+        return bytes;
+
+    const GLsizeiptr row = alignUp((store.row_length ? store.row_length : width) * pixel,
+                                   std::max(store.alignment, 1));
+    bytes += store.skip_rows * row + (height - 1) * row;
+    if (dimensions < 3)
+        return bytes;
+
+    const GLsizeiptr image = row * (store.image_height ? store.image_height : height);
+    return bytes + store.skip_images * image + (depth - 1) * image;
+}
+
+template<std::size_t N>
+auto sizeArg(const RecordState &, const Value *a, std::size_t) -> GLsizeiptr
+{
+    return GLsizeiptr(asInt(a[N]));
+}
+
+template<std::size_t N, GLsizeiptr M>
+auto sizeArgTimes(const RecordState &, const Value *a, std::size_t) -> GLsizeiptr
+{
+    return GLsizeiptr(asInt(a[N])) * M;
+}
+
+template<GLsizeiptr M>
+auto sizeFixed(const RecordState &, const Value *, std::size_t) -> GLsizeiptr
+{
+    return M;
+}
+
+// an upload with its size in argument N, which reads from the unpack buffer if one is bound
+template<std::size_t N>
+auto sizeUpload(const RecordState &state, const Value *a, std::size_t) -> GLsizeiptr
+{
+    return state.unpack_buffer ? -1 : GLsizeiptr(asInt(a[N]));
+}
+
+// glTextureSubImage*D of the given dimensions, with the width, height, depth, format and type at the given argument
+// indices; the height and depth indices are ignored past the dimensions
+template<int Dimensions, std::size_t W, std::size_t H, std::size_t D, std::size_t F>
+auto sizeImage(const RecordState &state, const Value *a, std::size_t) -> GLsizeiptr
+{
+    if (state.unpack_buffer)
+        return -1;
+    return getImageBytes(state.unpack, Dimensions, asInt(a[W]), Dimensions > 1 ? asInt(a[H]) : 1,
+                         Dimensions > 2 ? asInt(a[D]) : 1, GLenum(a[F].u), GLenum(a[F + 1].u));
+}
+
+// a single texel of the format and type at F, F + 1
+template<std::size_t F>
+auto sizeTexel(const RecordState &, const Value *a, std::size_t) -> GLsizeiptr
+{
+    return getPixelBytes(GLenum(a[F].u), GLenum(a[F + 1].u));
+}
+
+// readbacks of the given size into client memory, or into the pack buffer if one is bound
+template<std::size_t N>
+auto sizeReadback(const RecordState &state, const Value *a, std::size_t) -> GLsizeiptr
+{
+    return state.pack_buffer ? -1 : GLsizeiptr(asInt(a[N]));
+}
+
+auto sizeReadPixels(const RecordState &state, const Value *a, std::size_t) -> GLsizeiptr
+{
+    return state.pack_buffer ? -1 : getImageBytes(state.pack, 2, asInt(a[2]), asInt(a[3]), 1, GLenum(a[4].u),
+                                                  GLenum(a[5].u));
+}
+
+auto sizeParameterfv(const RecordState &, const Value *a, std::size_t) -> GLsizeiptr
+{
+    return a[1].u == GL_TEXTURE_BORDER_COLOR ? 16 : 4;
+}
+
+auto sizeClearBuffer(const RecordState &, const Value *a, std::size_t) -> GLsizeiptr
+{
+    return a[1].u == GL_COLOR ? 16 : 4;
+}
+
+auto sizeString(const RecordState &, const Value *a, std::size_t index) -> GLsizeiptr
+{
+    return a[index].p ? GLsizeiptr(std::strlen(static_cast<const char *>(a[index].p)) + 1) : 0;
+}
+
+auto sizeDebugMessage(const RecordState &state, const Value *a, std::size_t index) -> GLsizeiptr
+{
+    return asInt(a[2]) < 0 ? sizeString(state, a, index) : GLsizeiptr(asInt(a[2]));
+}
+
+// glBindBuffersRange and glVertexArrayVertexBuffers: a name array followed by arrays of offsets and sizes or strides
+template<std::size_t N, GLsizeiptr LastElementSize>
+auto sizeBufferArrays(const RecordState &, const Value *a, std::size_t index) -> GLsizeiptr
+{
+    const GLsizeiptr count = GLsizeiptr(asInt(a[N]));
+    if (index == N + 1)
+        return count;
+    return count * (index == N + 2 ? GLsizeiptr(sizeof(GLintptr)) : LastElementSize);
+}
+
+#define U(n) GLuint(a[n].u)
+#define I(n) GLint(asInt(a[n]))
+#define L(n) GLintptr(asInt(a[n]))
+#define Q(n) GLuint64(a[n].u)
+#define F(n) GLfloat(a[n].f)
+#define D(n) GLdouble(a[n].f)
+#define P(n) a[n].p
+#define C(n, T) static_cast<const T *>(a[n].p)
+#define W(n, T) static_cast<T *>(const_cast<void *>(a[n].p))
+#define Y(n) static_cast<GLsync>(const_cast<void *>(a[n].p))
+#define ENTRY(NAME, SIGNATURE, SIZE, CALL) \
+    {#NAME, SIGNATURE, SIZE, [](Value *a, Value &ret) { (void) a; (void) ret; CALL; }, \
+     [] { return glad_##NAME != nullptr; }}
+
+const TracedFunction traced_functions[] = {
+        // buffers
+        ENTRY(glCreateBuffers, "-i>B", sizeArg<0>, glad_glCreateBuffers(I(0), W(1, GLuint))),
+        ENTRY(glDeleteBuffers, "-i*B", sizeArg<0>, glad_glDeleteBuffers(I(0), C(1, GLuint))),
+        ENTRY(glNamedBufferStorage, "-Bl#e", sizeArg<1>, glad_glNamedBufferStorage(U(0), L(1), P(2), U(3))),
+        ENTRY(glNamedBufferData, "-Bl#e", sizeArg<1>, glad_glNamedBufferData(U(0), L(1), P(2), U(3))),
+        ENTRY(glNamedBufferSubData, "-Bll#", sizeArg<2>, glad_glNamedBufferSubData(U(0), L(1), L(2), P(3))),
+        ENTRY(glClearNamedBufferSubData, "-Bellee#", sizeTexel<4>,
+              glad_glClearNamedBufferSubData(U(0), U(1), L(2), L(3), U(4), U(5), P(6))),
+        ENTRY(glCopyNamedBufferSubData, "-BBlll", nullptr,
+              glad_glCopyNamedBufferSubData(U(0), U(1), L(2), L(3), L(4))),
+        ENTRY(glBindBuffer, "-eB", nullptr, glad_glBindBuffer(U(0), U(1))),
+        ENTRY(glBindBufferBase, "-eeB", nullptr, glad_glBindBufferBase(U(0), U(1), U(2))),
+        ENTRY(glBindBufferRange, "-eeBll", nullptr, glad_glBindBufferRange(U(0), U(1), U(2), L(3), L(4))),
+        ENTRY(glBindBuffersBase, "-eei*B", sizeArg<2>, glad_glBindBuffersBase(U(0), U(1), I(2), C(3, GLuint))),
+        ENTRY(glBindBuffersRange, "-eei*B##", (sizeBufferArrays<2, sizeof(GLsizeiptr)>),
+              glad_glBindBuffersRange(U(0), U(1), I(2), C(3, GLuint), C(4, GLintptr), C(5, GLsizeiptr))),
+        ENTRY(glMapNamedBufferRange, "mBlle", nullptr, ret.p = glad_glMapNamedBufferRange(U(0), L(1), L(2), U(3))),
+        ENTRY(glMapNamedBuffer, "mBe", nullptr, ret.p = glad_glMapNamedBuffer(U(0), U(1))),
+        ENTRY(glFlushMappedNamedBufferRange, "-Bll", nullptr, glad_glFlushMappedNamedBufferRange(U(0), L(1), L(2))),
+        ENTRY(glUnmapNamedBuffer, "eB", nullptr, glad_glUnmapNamedBuffer(U(0))),
+        ENTRY(glInvalidateBufferData, "-B", nullptr, glad_glInvalidateBufferData(U(0))),
+        ENTRY(glInvalidateBufferSubData, "-Bll", nullptr, glad_glInvalidateBufferSubData(U(0), L(1), L(2))),
+        {write_mapped_name, "-Bl#", nullptr, nullptr, [] { return true; }},
+
+        // textures
+        ENTRY(glCreateTextures, "-ei>T", sizeArg<1>, glad_glCreateTextures(U(0), I(1), W(2, GLuint))),
+        ENTRY(glGenTextures, "-i>T", sizeArg<0>, glad_glGenTextures(I(0), W(1, GLuint))),
+        ENTRY(glDeleteTextures, "-i*T", sizeArg<0>, glad_glDeleteTextures(I(0), C(1, GLuint))),
+        ENTRY(glTextureView, "-TeTeeeee", nullptr,
+              glad_glTextureView(U(0), U(1), U(2), U(3), U(4), U(5), U(6), U(7))),
+        ENTRY(glTextureStorage1D, "-Tiei", nullptr, glad_glTextureStorage1D(U(0), I(1), U(2), I(3))),
+        ENTRY(glTextureStorage2D, "-Tieii", nullptr, glad_glTextureStorage2D(U(0), I(1), U(2), I(3), I(4))),
+        ENTRY(glTextureStorage3D, "-Tieiii", nullptr,
+              glad_glTextureStorage3D(U(0), I(1), U(2), I(3), I(4), I(5))),
+        ENTRY(glTextureStorage2DMultisample, "-Tieiie", nullptr,
+              glad_glTextureStorage2DMultisample(U(0), I(1), U(2), I(3), I(4), GLboolean(U(5)))),
+        ENTRY(glTextureStorage3DMultisample, "-Tieiiie", nullptr,
+              glad_glTextureStorage3DMultisample(U(0), I(1), U(2), I(3), I(4), I(5), GLboolean(U(6)))),
+        ENTRY(glTextureSubImage1D, "-Tiiiee#", (sizeImage<1, 3, 0, 0, 4>),
+              glad_glTextureSubImage1D(U(0), I(1), I(2), I(3), U(4), U(5), P(6))),
+        ENTRY(glTextureSubImage2D, "-Tiiiiiee#", (sizeImage<2, 4, 5, 0, 6>),
+              glad_glTextureSubImage2D(U(0), I(1), I(2), I(3), I(4), I(5), U(6), U(7), P(8))),
+        ENTRY(glTextureSubImage3D, "-Tiiiiiiiee#", (sizeImage<3, 5, 6, 7, 8>),
+              glad_glTextureSubImage3D(U(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7), U(8), U(9), P(10))),
+        ENTRY(glCompressedTextureSubImage2D, "-Tiiiiiei#", sizeUpload<7>,
+              glad_glCompressedTextureSubImage2D(U(0), I(1), I(2), I(3), I(4), I(5), U(6), I(7), P(8))),
+        ENTRY(glCompressedTextureSubImage3D, "-Tiiiiiiiei#", sizeUpload<9>,
+              glad_glCompressedTextureSubImage3D(U(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7), U(8), I(9),
+                                                 P(10))),
+        ENTRY(glTextureParameteri, "-Tei", nullptr, glad_glTextureParameteri(U(0), U(1), I(2))),
+        ENTRY(glTextureParameterf, "-Tef", nullptr, glad_glTextureParameterf(U(0), U(1), F(2))),
+        ENTRY(glTextureParameterfv, "-Te#", sizeParameterfv,
+              glad_glTextureParameterfv(U(0), U(1), C(2, GLfloat))),
+        ENTRY(glGenerateTextureMipmap, "-T", nullptr, glad_glGenerateTextureMipmap(U(0))),
+        ENTRY(glBindTextureUnit, "-eT", nullptr, glad_glBindTextureUnit(U(0), U(1))),
+        ENTRY(glBindTextures, "-ei*T", sizeArg<1>, glad_glBindTextures(U(0), I(1), C(2, GLuint))),
+        ENTRY(glBindImageTexture, "-eTieiee", nullptr,
+              glad_glBindImageTexture(U(0), U(1), I(2), GLboolean(U(3)), I(4), U(5), U(6))),
+        ENTRY(glBindImageTextures, "-ei*T", sizeArg<1>, glad_glBindImageTextures(U(0), I(1), C(2, GLuint))),
+        ENTRY(glInvalidateTexImage, "-Ti", nullptr, glad_glInvalidateTexImage(U(0), I(1))),
+        ENTRY(glInvalidateTexSubImage, "-Tiiiiiii", nullptr,
+              glad_glInvalidateTexSubImage(U(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7))),
+        ENTRY(glClearTexImage, "-Tiee#", sizeTexel<2>, glad_glClearTexImage(U(0), I(1), U(2), U(3), P(4))),
+        ENTRY(glClearTexSubImage, "-Tiiiiiiiee#", sizeTexel<8>,
+              glad_glClearTexSubImage(U(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7), U(8), U(9), P(10))),
+        ENTRY(glCopyImageSubData, "-TeiiiiTeiiiiiii", nullptr,
+              glad_glCopyImageSubData(U(0), U(1), I(2), I(3), I(4), I(5), U(6), U(7), I(8), I(9), I(10), I(11),
+                                      I(12), I(13), I(14))),
+        ENTRY(glGetTextureSubImage, "-Tiiiiiiieeir", sizeReadback<10>,
+              glad_glGetTextureSubImage(U(0), I(1), I(2), I(3), I(4), I(5), I(6), I(7), U(8), U(9), I(10),
+                                        W(11, void))),
+        ENTRY(glGetTextureImage, "-Tieeir", sizeReadback<4>,
+              glad_glGetTextureImage(U(0), I(1), U(2), U(3), I(4), W(5, void))),
+        ENTRY(glReadPixels, "-iiiieer", sizeReadPixels,
+              glad_glReadPixels(I(0), I(1), I(2), I(3), U(4), U(5), W(6, void))),
+        ENTRY(glPixelStorei, "-ei", nullptr, glad_glPixelStorei(U(0), I(1))),
+
+        // samplers
+        ENTRY(glCreateSamplers, "-i>S", sizeArg<0>, glad_glCreateSamplers(I(0), W(1, GLuint))),
+        ENTRY(glDeleteSamplers, "-i*S", sizeArg<0>, glad_glDeleteSamplers(I(0), C(1, GLuint))),
+        ENTRY(glSamplerParameteri, "-Sei", nullptr, glad_glSamplerParameteri(U(0), U(1), I(2))),
+        ENTRY(glSamplerParameterf, "-Sef", nullptr, glad_glSamplerParameterf(U(0), U(1), F(2))),
+        ENTRY(glSamplerParameterfv, "-Se#", sizeParameterfv,
+              glad_glSamplerParameterfv(U(0), U(1), C(2, GLfloat))),
+        ENTRY(glBindSampler, "-eS", nullptr, glad_glBindSampler(U(0), U(1))),
+        ENTRY(glBindSamplers, "-ei*S", sizeArg<1>, glad_glBindSamplers(U(0), I(1), C(2, GLuint))),
+
+        // framebuffers and renderbuffers
+        ENTRY(glCreateFramebuffers, "-i>F", sizeArg<0>, glad_glCreateFramebuffers(I(0), W(1, GLuint))),
+        ENTRY(glDeleteFramebuffers, "-i*F", sizeArg<0>, glad_glDeleteFramebuffers(I(0), C(1, GLuint))),
+        ENTRY(glBindFramebuffer, "-eF", nullptr, glad_glBindFramebuffer(U(0), U(1))),
+        ENTRY(glNamedFramebufferTexture, "-FeTi", nullptr,
+              glad_glNamedFramebufferTexture(U(0), U(1), U(2), I(3))),
+        ENTRY(glNamedFramebufferTextureLayer, "-FeTii", nullptr,
+              glad_glNamedFramebufferTextureLayer(U(0), U(1), U(2), I(3), I(4))),
+        ENTRY(glNamedFramebufferRenderbuffer, "-FeeR", nullptr,
+              glad_glNamedFramebufferRenderbuffer(U(0), U(1), U(2), U(3))),
+        ENTRY(glNamedFramebufferDrawBuffers, "-Fi#", (sizeArgTimes<1, sizeof(GLenum)>),
+              glad_glNamedFramebufferDrawBuffers(U(0), I(1), C(2, GLenum))),
+        ENTRY(glNamedFramebufferDrawBuffer, "-Fe", nullptr, glad_glNamedFramebufferDrawBuffer(U(0), U(1))),
+        ENTRY(glNamedFramebufferReadBuffer, "-Fe", nullptr, glad_glNamedFramebufferReadBuffer(U(0), U(1))),
+        ENTRY(glCheckNamedFramebufferStatus, "eFe", nullptr, glad_glCheckNamedFramebufferStatus(U(0), U(1))),
+        ENTRY(glInvalidateNamedFramebufferData, "-Fi#", (sizeArgTimes<1, sizeof(GLenum)>),
+              glad_glInvalidateNamedFramebufferData(U(0), I(1), C(2, GLenum))),
+        ENTRY(glInvalidateNamedFramebufferSubData, "-Fi#iiii", (sizeArgTimes<1, sizeof(GLenum)>),
+              glad_glInvalidateNamedFramebufferSubData(U(0), I(1), C(2, GLenum), I(3), I(4), I(5), I(6))),
+        ENTRY(glBlitNamedFramebuffer, "-FFiiiiiiiiee", nullptr,
+              glad_glBlitNamedFramebuffer(U(0), U(1), I(2), I(3), I(4), I(5), I(6), I(7), I(8), I(9), U(10),
+                                          U(11))),
+        ENTRY(glClearNamedFramebufferfv, "-Fei#", sizeClearBuffer,
+              glad_glClearNamedFramebufferfv(U(0), U(1), I(2), C(3, GLfloat))),
+        ENTRY(glClearNamedFramebufferiv, "-Fei#", sizeClearBuffer,
+              glad_glClearNamedFramebufferiv(U(0), U(1), I(2), C(3, GLint))),
+        ENTRY(glClearNamedFramebufferuiv, "-Fei#", sizeClearBuffer,
+              glad_glClearNamedFramebufferuiv(U(0), U(1), I(2), C(3, GLuint))),
+        ENTRY(glClearNamedFramebufferfi, "-Feifi", nullptr,
+              glad_glClearNamedFramebufferfi(U(0), U(1), I(2), F(3), I(4))),
+        ENTRY(glCreateRenderbuffers, "-i>R", sizeArg<0>, glad_glCreateRenderbuffers(I(0), W(1, GLuint))),
+        ENTRY(glDeleteRenderbuffers, "-i*R", sizeArg<0>, glad_glDeleteRenderbuffers(I(0), C(1, GLuint))),
+        ENTRY(glNamedRenderbufferStorage, "-Reii", nullptr,
+              glad_glNamedRenderbufferStorage(U(0), U(1), I(2), I(3))),
+        ENTRY(glNamedRenderbufferStorageMultisample, "-Rieii", nullptr,
+              glad_glNamedRenderbufferStorageMultisample(U(0), I(1), U(2), I(3), I(4))),
+
+        // vertex arrays
+        ENTRY(glCreateVertexArrays, "-i>V", sizeArg<0>, glad_glCreateVertexArrays(I(0), W(1, GLuint))),
+        ENTRY(glDeleteVertexArrays, "-i*V", sizeArg<0>, glad_glDeleteVertexArrays(I(0), C(1, GLuint))),
+        ENTRY(glBindVertexArray, "-V", nullptr, glad_glBindVertexArray(U(0))),
+        ENTRY(glVertexArrayVertexBuffer, "-VeBli", nullptr,
+              glad_glVertexArrayVertexBuffer(U(0), U(1), U(2), L(3), I(4))),
+        ENTRY(glVertexArrayVertexBuffers, "-Vei*B##", (sizeBufferArrays<2, sizeof(GLsizei)>),
+              glad_glVertexArrayVertexBuffers(U(0), U(1), I(2), C(3, GLuint), C(4, GLintptr), C(5, GLsizei))),
+        ENTRY(glVertexArrayElementBuffer, "-VB", nullptr, glad_glVertexArrayElementBuffer(U(0), U(1))),
+        ENTRY(glVertexArrayAttribFormat, "-Veieee", nullptr,
+              glad_glVertexArrayAttribFormat(U(0), U(1), I(2), U(3), GLboolean(U(4)), U(5))),
+        ENTRY(glVertexArrayAttribIFormat, "-Veiee", nullptr,
+              glad_glVertexArrayAttribIFormat(U(0), U(1), I(2), U(3), U(4))),
+        ENTRY(glVertexArrayAttribLFormat, "-Veiee", nullptr,
+              glad_glVertexArrayAttribLFormat(U(0), U(1), I(2), U(3), U(4))),
+        ENTRY(glVertexArrayAttribBinding, "-Vee", nullptr, glad_glVertexArrayAttribBinding(U(0), U(1), U(2))),
+        ENTRY(glVertexArrayBindingDivisor, "-Vee", nullptr, glad_glVertexArrayBindingDivisor(U(0), U(1), U(2))),
+        ENTRY(glEnableVertexArrayAttrib, "-Ve", nullptr, glad_glEnableVertexArrayAttrib(U(0), U(1))),
+        ENTRY(glDisableVertexArrayAttrib, "-Ve", nullptr, glad_glDisableVertexArrayAttrib(U(0), U(1))),
+
+        // shaders and programs
+        ENTRY(glCreateShader, "He", nullptr, ret.u = glad_glCreateShader(U(0))),
+        ENTRY(glShaderSource, "-Hisx", nullptr,
+              glad_glShaderSource(U(0), I(1), C(2, GLchar *const), C(3, GLint))),
+        ENTRY(glCompileShader, "-H", nullptr, glad_glCompileShader(U(0))),
+        ENTRY(glDeleteShader, "-H", nullptr, glad_glDeleteShader(U(0))),
+        ENTRY(glCreateProgram, "P", nullptr, ret.u = glad_glCreateProgram()),
+        ENTRY(glAttachShader, "-PH", nullptr, glad_glAttachShader(U(0), U(1))),
+        ENTRY(glDetachShader, "-PH", nullptr, glad_glDetachShader(U(0), U(1))),
+        ENTRY(glBindAttribLocation, "-Pe#", sizeString, glad_glBindAttribLocation(U(0), U(1), C(2, GLchar))),
+        ENTRY(glLinkProgram, "-P", nullptr, glad_glLinkProgram(U(0))),
+        ENTRY(glUseProgram, "-P", nullptr, glad_glUseProgram(U(0))),
+        ENTRY(glDeleteProgram, "-P", nullptr, glad_glDeleteProgram(U(0))),
+        ENTRY(glUniformBlockBinding, "-Pee", nullptr, glad_glUniformBlockBinding(U(0), U(1), U(2))),
+        ENTRY(glShaderStorageBlockBinding, "-Pee", nullptr, glad_glShaderStorageBlockBinding(U(0), U(1), U(2))),
+        ENTRY(glProgramUniform1i, "-Pii", nullptr, glad_glProgramUniform1i(U(0), I(1), I(2))),
+        ENTRY(glProgramUniform2i, "-Piii", nullptr, glad_glProgramUniform2i(U(0), I(1), I(2), I(3))),
+        ENTRY(glProgramUniform3i, "-Piiii", nullptr, glad_glProgramUniform3i(U(0), I(1), I(2), I(3), I(4))),
+        ENTRY(glProgramUniform4i, "-Piiiii", nullptr,
+              glad_glProgramUniform4i(U(0), I(1), I(2), I(3), I(4), I(5))),
+        ENTRY(glProgramUniform1ui, "-Pie", nullptr, glad_glProgramUniform1ui(U(0), I(1), U(2))),
+        ENTRY(glProgramUniform1f, "-Pif", nullptr, glad_glProgramUniform1f(U(0), I(1), F(2))),
+        ENTRY(glProgramUniform2f, "-Piff", nullptr, glad_glProgramUniform2f(U(0), I(1), F(2), F(3))),
+        ENTRY(glProgramUniform3f, "-Pifff", nullptr, glad_glProgramUniform3f(U(0), I(1), F(2), F(3), F(4))),
+        ENTRY(glProgramUniform4f, "-Piffff", nullptr,
+              glad_glProgramUniform4f(U(0), I(1), F(2), F(3), F(4), F(5))),
+        ENTRY(glProgramUniform1iv, "-Pii#", (sizeArgTimes<2, 4>),
+              glad_glProgramUniform1iv(U(0), I(1), I(2), C(3, GLint))),
+        ENTRY(glProgramUniform1fv, "-Pii#", (sizeArgTimes<2, 4>),
+              glad_glProgramUniform1fv(U(0), I(1), I(2), C(3, GLfloat))),
+        ENTRY(glProgramUniform2fv, "-Pii#", (sizeArgTimes<2, 8>),
+              glad_glProgramUniform2fv(U(0), I(1), I(2), C(3, GLfloat))),
+        ENTRY(glProgramUniform3fv, "-Pii#", (sizeArgTimes<2, 12>),
+              glad_glProgramUniform3fv(U(0), I(1), I(2), C(3, GLfloat))),
+        ENTRY(glProgramUniform4fv, "-Pii#", (sizeArgTimes<2, 16>),
+              glad_glProgramUniform4fv(U(0), I(1), I(2), C(3, GLfloat))),
+        ENTRY(glProgramUniformMatrix3fv, "-Piie#", (sizeArgTimes<2, 36>),
+              glad_glProgramUniformMatrix3fv(U(0), I(1), I(2), GLboolean(U(3)), C(4, GLfloat))),
+        ENTRY(glProgramUniformMatrix4fv, "-Piie#", (sizeArgTimes<2, 64>),
+              glad_glProgramUniformMatrix4fv(U(0), I(1), I(2), GLboolean(U(3)), C(4, GLfloat))),
+        ENTRY(glUniform1i, "-ii", nullptr, glad_glUniform1i(I(0), I(1))),
+        ENTRY(glUniform1f, "-if", nullptr, glad_glUniform1f(I(0), F(1))),
+        ENTRY(glUniform4fv, "-ii#", (sizeArgTimes<1, 16>), glad_glUniform4fv(I(0), I(1), C(2, GLfloat))),
+        ENTRY(glUniformMatrix4fv, "-iie#", (sizeArgTimes<1, 64>),
+              glad_glUniformMatrix4fv(I(0), I(1), GLboolean(U(2)), C(3, GLfloat))),
+
+        // synchronization and queries
+        ENTRY(glFenceSync, "Yee", nullptr, ret.p = glad_glFenceSync(U(0), U(1))),
+        ENTRY(glDeleteSync, "-Y", nullptr, glad_glDeleteSync(Y(0))),
+        ENTRY(glClientWaitSync, "eYeq", nullptr, glad_glClientWaitSync(Y(0), U(1), Q(2))),
+        ENTRY(glWaitSync, "-Yeq", nullptr, glad_glWaitSync(Y(0), U(1), Q(2))),
+        ENTRY(glCreateQueries, "-ei>Q", sizeArg<1>, glad_glCreateQueries(U(0), I(1), W(2, GLuint))),
+        ENTRY(glDeleteQueries, "-i*Q", sizeArg<0>, glad_glDeleteQueries(I(0), C(1, GLuint))),
+        ENTRY(glQueryCounter, "-Qe", nullptr, glad_glQueryCounter(U(0), U(1))),
+        ENTRY(glBeginQuery, "-eQ", nullptr, glad_glBeginQuery(U(0), U(1))),
+        ENTRY(glEndQuery, "-e", nullptr, glad_glEndQuery(U(0))),
+        ENTRY(glGetQueryBufferObjectui64v, "-QBel", nullptr,
+              glad_glGetQueryBufferObjectui64v(U(0), U(1), U(2), L(3))),
+        ENTRY(glMemoryBarrier, "-e", nullptr, glad_glMemoryBarrier(U(0))),
+        ENTRY(glMemoryBarrierByRegion, "-e", nullptr, glad_glMemoryBarrierByRegion(U(0))),
+        ENTRY(glFinish, "-", nullptr, glad_glFinish()),
+        ENTRY(glFlush, "-", nullptr, glad_glFlush()),
+        ENTRY(glPushDebugGroup, "-eei#", sizeDebugMessage,
+              glad_glPushDebugGroup(U(0), U(1), I(2), C(3, GLchar))),
+        ENTRY(glPopDebugGroup, "-", nullptr, glad_glPopDebugGroup()),
+
+        // compute and draw
+        ENTRY(glDispatchCompute, "-eee", nullptr, glad_glDispatchCompute(U(0), U(1), U(2))),
+        ENTRY(glDispatchComputeIndirect, "-l", nullptr, glad_glDispatchComputeIndirect(L(0))),
+        ENTRY(glDrawArrays, "-eii", nullptr, glad_glDrawArrays(U(0), I(1), I(2))),
+        ENTRY(glDrawArraysInstanced, "-eiii", nullptr, glad_glDrawArraysInstanced(U(0), I(1), I(2), I(3))),
+        ENTRY(glDrawArraysInstancedBaseInstance, "-eiiie", nullptr,
+              glad_glDrawArraysInstancedBaseInstance(U(0), I(1), I(2), I(3), U(4))),
+        ENTRY(glDrawElements, "-eieo", nullptr, glad_glDrawElements(U(0), I(1), U(2), P(3))),
+        ENTRY(glDrawElementsInstanced, "-eieoi", nullptr,
+              glad_glDrawElementsInstanced(U(0), I(1), U(2), P(3), I(4))),
+        ENTRY(glDrawElementsBaseVertex, "-eieoi", nullptr,
+              glad_glDrawElementsBaseVertex(U(0), I(1), U(2), P(3), I(4))),
+        ENTRY(glDrawElementsInstancedBaseVertexBaseInstance, "-eieoiie", nullptr,
+              glad_glDrawElementsInstancedBaseVertexBaseInstance(U(0), I(1), U(2), P(3), I(4), I(5), U(6))),
+        ENTRY(glDrawArraysIndirect, "-eo", nullptr, glad_glDrawArraysIndirect(U(0), P(1))),
+        ENTRY(glDrawElementsIndirect, "-eeo", nullptr, glad_glDrawElementsIndirect(U(0), U(1), P(2))),
+        ENTRY(glMultiDrawArraysIndirect, "-eoii", nullptr,
+              glad_glMultiDrawArraysIndirect(U(0), P(1), I(2), I(3))),
+        ENTRY(glMultiDrawElementsIndirect, "-eeoii", nullptr,
+              glad_glMultiDrawElementsIndirect(U(0), U(1), P(2), I(3), I(4))),
+
+        // fixed function state
+        ENTRY(glClear, "-e", nullptr, glad_glClear(U(0))),
+        ENTRY(glClearColor, "-ffff", nullptr, glad_glClearColor(F(0), F(1), F(2), F(3))),
+        ENTRY(glClearDepth, "-d", nullptr, glad_glClearDepth(D(0))),
+        ENTRY(glClearStencil, "-i", nullptr, glad_glClearStencil(I(0))),
+        ENTRY(glViewport, "-iiii", nullptr, glad_glViewport(I(0), I(1), I(2), I(3))),
+        ENTRY(glScissor, "-iiii", nullptr, glad_glScissor(I(0), I(1), I(2), I(3))),
+        ENTRY(glEnable, "-e", nullptr, glad_glEnable(U(0))),
+        ENTRY(glDisable, "-e", nullptr, glad_glDisable(U(0))),
+        ENTRY(glEnablei, "-ee", nullptr, glad_glEnablei(U(0), U(1))),
+        ENTRY(glDisablei, "-ee", nullptr, glad_glDisablei(U(0), U(1))),
+        ENTRY(glBlendFunc, "-ee", nullptr, glad_glBlendFunc(U(0), U(1))),
+        ENTRY(glBlendFuncSeparate, "-eeee", nullptr, glad_glBlendFuncSeparate(U(0), U(1), U(2), U(3))),
+        ENTRY(glBlendEquation, "-e", nullptr, glad_glBlendEquation(U(0))),
+        ENTRY(glDepthFunc, "-e", nullptr, glad_glDepthFunc(U(0))),
+        ENTRY(glDepthMask, "-e", nullptr, glad_glDepthMask(GLboolean(U(0)))),
+        ENTRY(glColorMask, "-eeee", nullptr,
+              glad_glColorMask(GLboolean(U(0)), GLboolean(U(1)), GLboolean(U(2)), GLboolean(U(3)))),
+        ENTRY(glCullFace, "-e", nullptr, glad_glCullFace(U(0))),
+        ENTRY(glFrontFace, "-e", nullptr, glad_glFrontFace(U(0))),
+        ENTRY(glPolygonMode, "-ee", nullptr, glad_glPolygonMode(U(0), U(1))),
+        ENTRY(glPolygonOffset, "-ff", nullptr, glad_glPolygonOffset(F(0), F(1))),
+        ENTRY(glLineWidth, "-f", nullptr, glad_glLineWidth(F(0))),
+        ENTRY(glPointSize, "-f", nullptr, glad_glPointSize(F(0))),
+        ENTRY(glStencilFunc, "-eie", nullptr, glad_glStencilFunc(U(0), I(1), U(2))),
+        ENTRY(glStencilOp, "-eee", nullptr, glad_glStencilOp(U(0), U(1), U(2))),
+        ENTRY(glStencilMask, "-e", nullptr, glad_glStencilMask(U(0))),
+};
+
+#undef ENTRY
+#undef Y
+#undef W
+#undef C
+#undef P
+#undef D
+#undef F
+#undef Q
+#undef L
+#undef I
+#undef U
+
+constexpr std::size_t no_function = ~std::size_t(0);
+
+auto findFunction(std::string_view name) -> std::size_t
+{
+    const auto it = std::find_if(std::begin(traced_functions), std::end(traced_functions),
+                                 [name](const TracedFunction &function) { return name == function.name; });
+    return it == std::end(traced_functions) ? no_function : std::size_t(it - std::begin(traced_functions));
+}
+
+auto isNameKind(char code) -> bool
+{
+    return name_kinds.find(code) != std::string_view::npos;
+}
+
+auto isDelete(const char *name) -> bool
+{
+    return std::strncmp(name, "glDelete", 8) == 0;
+}
+
+// Reads the records of a trace; throws on truncated data.
+class TraceReader
+{
+public:
+    TraceReader(const std::byte *begin, const std::byte *end) : m_position(begin), m_end(end)
+    {}
+
+    [[nodiscard]]
+    auto atEnd() const -> bool
+    { return m_position == m_end; }
+
+    auto byte() -> std::uint8_t
+    {
+        require(1);
+        return std::uint8_t(*m_position++);
+    }
+
+    auto varint() -> std::uint64_t
+    {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            const std::uint8_t b = byte();
+            value |= std::uint64_t(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return value;
+        }
+        throw Error("invalid varint in trace");
+    }
+
+    auto zigzag() -> std::int64_t
+    {
+        const std::uint64_t value = varint();
+        return std::int64_t(value >> 1) ^ -std::int64_t(value & 1);
+    }
+
+    template<typename T>
+    auto raw() -> T
+    {
+        T value;
+        std::memcpy(&value, bytes(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    auto bytes(std::size_t size) -> const std::byte *
+    {
+        require(size);
+        const std::byte *data = m_position;
+        m_position += size;
+        return data;
+    }
+
+private:
+    void require(std::size_t size) const
+    {
+        if (std::size_t(m_end - m_position) < size)
+            throw Error("truncated trace");
+    }
+
+    const std::byte *m_position;
+    const std::byte *m_end;
+};
+
+} // namespace
+
+#if GLUTILS_CALL_STATS
+
+namespace {
+
+thread_local TraceRecorder *t_trace_recorder{nullptr};
+
+} // namespace
+
+struct TraceRecorder::State
+{
+    struct Mapping
+    {
+        const std::byte *data;
+        GLintptr offset;
+        GLsizeiptr length;
+        GLbitfield access;
+    };
+
+    std::ofstream file;
+    std::vector<std::byte> buffer;
+    RecordState record_state;
+    // table index of each glad name string seen, by address, and the trace id of each table entry written
+    std::unordered_map<const char *, std::size_t> functions;
+    std::vector<std::uint64_t> function_ids;
+    std::uint64_t next_function_id{0};
+    std::unordered_map<GLuint, Mapping> mappings;
+    std::chrono::steady_clock::time_point last_time;
+    Value args[16];
+
+    void putByte(std::uint8_t value)
+    {
+        buffer.push_back(std::byte(value));
+    }
+
+    void putVarint(std::uint64_t value)
+    {
+        for (; value >= 0x80; value >>= 7)
+            putByte(std::uint8_t(value | 0x80));
+        putByte(std::uint8_t(value));
+    }
+
+    void putZigzag(std::int64_t value)
+    {
+        putVarint((std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63));
+    }
+
+    void putBytes(const void *data, std::size_t size)
+    {
+        const auto *begin = static_cast<const std::byte *>(data);
+        buffer.insert(buffer.end(), begin, begin + size);
+    }
+
+    template<typename T>
+    void putRaw(T value)
+    {
+        putBytes(&value, sizeof(T));
+    }
+
+    // nanoseconds since the previous record
+    auto elapsed() -> std::uint64_t
+    {
+        const auto now = std::chrono::steady_clock::now();
+        const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_time);
+        last_time = now;
+        return std::uint64_t(std::max(time.count(), std::chrono::nanoseconds::rep(0)));
+    }
+
+    auto lookup(const char *name) -> std::size_t
+    {
+        const auto it = functions.find(name);
+        if (it != functions.end())
+            return it->second;
+        return functions[name] = findFunction(name);
+    }
+
+    void beginCall(std::size_t function)
+    {
+        if (function_ids[function] == ~std::uint64_t(0))
+        {
+            function_ids[function] = next_function_id++;
+            const std::string_view name = traced_functions[function].name;
+            putByte(tag_function);
+            putVarint(function_ids[function]);
+            putVarint(name.size());
+            putBytes(name.data(), name.size());
+        }
+
+        putByte(tag_call);
+        putVarint(function_ids[function]);
+        putVarint(elapsed());
+    }
+
+    void putPointer(const void *pointer, GLsizeiptr size, bool payload)
+    {
+        if (!pointer && size >= 0)
+            putVarint(pointer_null);
+        else if (size < 0)
+        {
+            putVarint(pointer_offset);
+            putVarint(reinterpret_cast<std::uintptr_t>(pointer));
+        }
+        else
+        {
+            putVarint(pointer_payload + std::uint64_t(size));
+            if (payload)
+                putBytes(pointer, std::size_t(size));
+        }
+    }
+
+    void writeMapped(GLuint buffer_name, GLintptr offset, const std::byte *data, GLsizeiptr size)
+    {
+        static const std::size_t write_mapped = findFunction(write_mapped_name);
+        beginCall(write_mapped);
+        putVarint(buffer_name);
+        putZigzag(offset);
+        putPointer(data, size, true);
+    }
+
+    // Write the pixel store parameters and pixel buffer bindings of the context, which the size functions depend on,
+    // as calls setting them. glutils' pixel store cache skips parameters that are already set, so a trace started
+    // mid-run may never set them, and the replay context starts from its own state.
+    void writeInitialState()
+    {
+        constexpr GLenum parameters[] = {GL_UNPACK_ALIGNMENT, GL_UNPACK_ROW_LENGTH, GL_UNPACK_IMAGE_HEIGHT,
+                                         GL_UNPACK_SKIP_PIXELS, GL_UNPACK_SKIP_ROWS, GL_UNPACK_SKIP_IMAGES,
+                                         GL_PACK_ALIGNMENT, GL_PACK_ROW_LENGTH, GL_PACK_IMAGE_HEIGHT,
+                                         GL_PACK_SKIP_PIXELS, GL_PACK_SKIP_ROWS, GL_PACK_SKIP_IMAGES};
+        constexpr std::pair<GLenum, GLenum> bindings[] = {{GL_PIXEL_PACK_BUFFER, GL_PIXEL_PACK_BUFFER_BINDING},
+                                                          {GL_PIXEL_UNPACK_BUFFER, GL_PIXEL_UNPACK_BUFFER_BINDING}};
+        static const std::size_t pixel_store = findFunction("glPixelStorei");
+        static const std::size_t bind_buffer = findFunction("glBindBuffer");
+
+        Value a[2];
+        for (const GLenum parameter: parameters)
+        {
+            GLint value = 0;
+            glad_glGetIntegerv(parameter, &value);
+            a[0].u = parameter;
+            a[1].u = std::uint64_t(std::int64_t(value));
+            writeCall(pixel_store, a, nullptr);
+        }
+
+        for (const auto &[target, binding]: bindings)
+        {
+            GLint buffer = 0;
+            glad_glGetIntegerv(binding, &buffer);
+            a[0].u = target;
+            a[1].u = GLuint(buffer);
+            writeCall(bind_buffer, a, nullptr);
+        }
+    }
+
+    // write a call to traced_functions[function] with arguments @p a and return value @p ret
+    void writeCall(std::size_t function, const Value *a, void *ret)
+    {
+        const std::string_view signature = traced_functions[function].signature;
+
+        beginCall(function);
+
+        const SizeFunction size = traced_functions[function].size;
+        for (std::size_t i = 1, index = 0; i < signature.size(); i++, index++)
+        {
+            const Value &value = a[index];
+            const char code = signature[i];
+
+            if (code == 'e' || code == 'q' || isNameKind(code))
+                putVarint(value.u);
+            else if (code == 'i' || code == 'l')
+                putZigzag(asInt(value));
+            else if (code == 'f')
+                putRaw(float(value.f));
+            else if (code == 'd')
+                putRaw(value.f);
+            else if (code == 'o' || code == 'Y')
+                putVarint(reinterpret_cast<std::uintptr_t>(value.p));
+            else if (code == '#' || code == 'r')
+                putPointer(value.p, value.p || code == 'r' ? size(record_state, a, index) : 0, code == '#');
+            else if (code == '*' || code == '>')
+            {
+                i++;
+                const auto *names = static_cast<const GLuint *>(value.p);
+                const GLsizeiptr name_count = names ? size(record_state, a, index) : 0;
+                putVarint(names ? std::uint64_t(name_count) + 1 : 0);
+                for (GLsizeiptr n = 0; n < name_count; n++)
+                    putVarint(names[n]);
+            }
+            else if (code == 's')
+            {
+                const auto *strings = static_cast<const GLchar *const *>(value.p);
+                const auto *lengths = static_cast<const GLint *>(a[index + 1].p);
+                const auto string_count = std::size_t(std::max<std::int64_t>(asInt(a[index - 1]), 0));
+                putVarint(string_count);
+                for (std::size_t s = 0; s < string_count; s++)
+                {
+                    const std::size_t length = lengths && lengths[s] >= 0 ? std::size_t(lengths[s])
+                                                                          : std::strlen(strings[s]);
+                    putVarint(length);
+                    putBytes(strings[s], length);
+                }
+            }
+        }
+
+        switch (signature[0])
+        {
+            case 'H':
+            case 'P':
+                putVarint(*static_cast<const GLuint *>(ret));
+                break;
+            case 'Y':
+                putVarint(reinterpret_cast<std::uintptr_t>(*static_cast<const GLsync *>(ret)));
+                break;
+            default:
+                break;
+        }
+
+        track(traced_functions[function].name, a, ret);
+    }
+
+    void track(std::string_view name, const Value *a, void *ret)
+    {
+        if (name == "glBindBuffer")
+        {
+            if (a[0].u == GL_PIXEL_PACK_BUFFER)
+                record_state.pack_buffer = GLuint(a[1].u);
+            else if (a[0].u == GL_PIXEL_UNPACK_BUFFER)
+                record_state.unpack_buffer = GLuint(a[1].u);
+        }
+        else if (name == "glPixelStorei")
+        {
+            const bool pack = (a[0].u >= GL_PACK_SWAP_BYTES && a[0].u <= GL_PACK_ALIGNMENT)
+                              || a[0].u == GL_PACK_SKIP_IMAGES || a[0].u == GL_PACK_IMAGE_HEIGHT;
+            PixelStore &store = pack ? record_state.pack : record_state.unpack;
+            const auto value = GLint(asInt(a[1]));
+            switch (GLenum(a[0].u))
+            {
+                case GL_PACK_ALIGNMENT:
+                case GL_UNPACK_ALIGNMENT:
+                    store.alignment = value;
+                    break;
+                case GL_PACK_ROW_LENGTH:
+                case GL_UNPACK_ROW_LENGTH:
+                    store.row_length = value;
+                    break;
+                case GL_PACK_IMAGE_HEIGHT:
+                case GL_UNPACK_IMAGE_HEIGHT:
+                    store.image_height = value;
+                    break;
+                case GL_PACK_SKIP_PIXELS:
+                case GL_UNPACK_SKIP_PIXELS:
+                    store.skip_pixels = value;
+                    break;
+                case GL_PACK_SKIP_ROWS:
+                case GL_UNPACK_SKIP_ROWS:
+                    store.skip_rows = value;
+                    break;
+                case GL_PACK_SKIP_IMAGES:
+                case GL_UNPACK_SKIP_IMAGES:
+                    store.skip_images = value;
+                    break;
+                default:
+                    break;
+            }
+        }
+        else if (name == "glMapNamedBufferRange" && ret)
+            mappings[GLuint(a[0].u)] = {*static_cast<std::byte **>(ret), GLintptr(asInt(a[1])),
+                                        GLsizeiptr(asInt(a[2])), GLbitfield(a[3].u)};
+        else if (name == "glMapNamedBuffer" && ret)
+        {
+            GLint64 size = 0;
+            glad_glGetNamedBufferParameteri64v(GLuint(a[0].u), GL_BUFFER_SIZE, &size);
+            const GLbitfield access = a[1].u == GL_READ_ONLY ? GL_MAP_READ_BIT : GL_MAP_WRITE_BIT;
+            mappings[GLuint(a[0].u)] = {*static_cast<std::byte **>(ret), 0, GLsizeiptr(size), access};
+        }
+    }
+};
+
+TraceRecorder::TraceRecorder(const std::string &path) : m_state(std::make_unique<State>())
+{
+    if (t_trace_recorder)
+        throw Error("a trace is already being recorded on this thread");
+
+    m_state->file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_state->file)
+        throw Error("failed to open trace file " + path);
+
+    m_state->function_ids.assign(std::size(traced_functions), ~std::uint64_t(0));
+    m_state->putRaw(trace_magic);
+    m_state->putRaw(trace_version);
+    m_state->last_time = std::chrono::steady_clock::now();
+    m_state->writeInitialState();
+
+    t_trace_recorder = this;
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    t_trace_recorder = nullptr;
+    flush();
+}
+
+void TraceRecorder::endFrame()
+{
+    m_state->putByte(tag_frame);
+    m_state->putVarint(m_state->elapsed());
+    m_stats.frames++;
+
+    // keep the buffer to a few frames
+    if (m_state->buffer.size() >= (std::size_t(1) << 20))
+        flush();
+}
+
+void TraceRecorder::flush()
+{
+    m_stats.bytes += m_state->buffer.size();
+    m_state->file.write(reinterpret_cast<const char *>(m_state->buffer.data()),
+                        std::streamsize(m_state->buffer.size()));
+    m_state->file.flush();
+    m_state->buffer.clear();
+}
+
+void TraceRecorder::recordBefore(const char *name, std::va_list args)
+{
+    // the mapping is gone once the call returns
+    if (std::strcmp(name, "glUnmapNamedBuffer") != 0)
+        return;
+
+    const auto buffer_name = va_arg(args, GLuint);
+    const auto it = m_state->mappings.find(buffer_name);
+    if (it == m_state->mappings.end())
+        return;
+
+    const State::Mapping &mapping = it->second;
+    if ((mapping.access & GL_MAP_WRITE_BIT) && !(mapping.access & GL_MAP_FLUSH_EXPLICIT_BIT))
+        m_state->writeMapped(buffer_name, mapping.offset, mapping.data, mapping.length);
+    m_state->mappings.erase(it);
+}
+
+void TraceRecorder::record(void *ret, const char *name, std::va_list args)
+{
+    State &state = *m_state;
+    const std::size_t function = state.lookup(name);
+    if (function == no_function)
+    {
+        m_stats.skipped_calls++;
+        m_skipped_calls[name]++;
+        return;
+    }
+
+    const std::string_view signature = traced_functions[function].signature;
+    Value *a = state.args;
+
+    // read the arguments as promoted through the ellipsis
+    std::size_t count = 0;
+    for (std::size_t i = 1; i < signature.size(); i++, count++)
+    {
+        Value &value = a[count];
+        const char code = signature[i];
+        if (code == '*' || code == '>')
+            i++;
+
+        if (code == 'e' || isNameKind(code))
+            value.u = va_arg(args, unsigned int);
+        else if (code == 'i')
+            value.u = std::uint64_t(std::int64_t(va_arg(args, int)));
+        else if (code == 'l')
+            value.u = std::uint64_t(std::int64_t(va_arg(args, GLintptr)));
+        else if (code == 'q')
+            value.u = va_arg(args, GLuint64);
+        else if (code == 'f' || code == 'd')
+            value.f = va_arg(args, double);
+        else
+            value.p = va_arg(args, const void *);
+    }
+
+    if (std::string_view(name) == "glFlushMappedNamedBufferRange")
+    {
+        const auto it = state.mappings.find(GLuint(a[0].u));
+        if (it != state.mappings.end())
+            state.writeMapped(GLuint(a[0].u), it->second.offset + GLintptr(asInt(a[1])),
+                              it->second.data + asInt(a[1]), GLsizeiptr(asInt(a[2])));
+    }
+
+    state.writeCall(function, a, ret);
+    m_stats.calls++;
+}
+
+void recordTraceBeforeCall(const char *name, std::va_list args)
+{
+    if (t_trace_recorder)
+        t_trace_recorder->recordBefore(name, args);
+}
+
+void recordTraceCall(void *ret, const char *name, std::va_list args)
+{
+    if (t_trace_recorder)
+        t_trace_recorder->record(ret, name, args);
+}
+
+#endif // GLUTILS_CALL_STATS
+
+namespace {
+
+// Replay state of one loop over a trace.
+class Replay
+{
+public:
+    explicit Replay(const TraceReplayer::Options &options, TraceReplayer::Stats &stats) :
+            m_options(options), m_stats(stats)
+    {}
+
+    void run(TraceReader &reader)
+    {
+        auto frame_begin = std::chrono::steady_clock::now();
+        std::chrono::nanoseconds recorded_time{0};
+        bool frame_has_calls = false;
+
+        while (!reader.atEnd())
+        {
+            const std::uint8_t tag = reader.byte();
+            if (tag == tag_function)
+            {
+                const std::uint64_t id = reader.varint();
+                const std::size_t length = reader.varint();
+                const std::string name(reinterpret_cast<const char *>(reader.bytes(length)), length);
+                const std::size_t function = findFunction(name);
+                if (function == no_function)
+                    throw Error("trace uses unknown entry point " + name);
+                if (m_functions.size() <= id)
+                    m_functions.resize(id + 1, no_function);
+                m_functions[id] = function;
+            }
+            else if (tag == tag_call)
+            {
+                const std::uint64_t id = reader.varint();
+                if (id >= m_functions.size() || m_functions[id] == no_function)
+                    throw Error("trace calls an undefined entry point");
+                recorded_time += std::chrono::nanoseconds(reader.varint());
+                call(reader, traced_functions[m_functions[id]]);
+                frame_has_calls = true;
+            }
+            else if (tag == tag_frame)
+            {
+                recorded_time += std::chrono::nanoseconds(reader.varint());
+                endFrame(frame_begin, recorded_time);
+                frame_has_calls = false;
+            }
+            else
+                throw Error("invalid trace record");
+        }
+
+        if (frame_has_calls)
+            endFrame(frame_begin, recorded_time);
+
+        deleteRemaining();
+    }
+
+private:
+    void endFrame(std::chrono::steady_clock::time_point &frame_begin, std::chrono::nanoseconds &recorded_time)
+    {
+        if (m_options.finish_frames)
+            glad_glFinish();
+
+        const auto now = std::chrono::steady_clock::now();
+        m_stats.frame_times.push_back(now - frame_begin);
+        m_stats.recorded_frame_times.push_back(recorded_time);
+        m_stats.frames++;
+        frame_begin = now;
+        recorded_time = std::chrono::nanoseconds::zero();
+    }
+
+    auto remap(char kind, std::uint64_t name) -> GLuint
+    {
+        if (!name)
+            return 0;
+        const auto &names = m_names[name_kinds.find(kind)];
+        const auto it = names.find(name);
+        return it == names.end() ? 0 : it->second;
+    }
+
+    void call(TraceReader &reader, const TracedFunction &function)
+    {
+        const std::string_view signature = function.signature;
+        Value a[16];
+        Value ret;
+        // names, recorded and remapped, of the name array argument, and the argument it's at
+        std::size_t names_index = no_function;
+        char names_kind = 0;
+        std::vector<std::uint64_t> &recorded_names = m_recorded_names;
+        recorded_names.clear();
+        std::uint64_t recorded_sync = 0;
+
+        for (std::size_t i = 1, index = 0; i < signature.size(); i++, index++)
+        {
+            Value &value = a[index];
+            const char code = signature[i];
+
+            if (code == 'e' || code == 'q')
+                value.u = reader.varint();
+            else if (isNameKind(code))
+            {
+                const std::uint64_t name = reader.varint();
+                value.u = remap(code, name);
+                if (!names_kind)
+                {
+                    names_kind = code;
+                    recorded_names.assign(1, name);
+                }
+            }
+            else if (code == 'i' || code == 'l')
+                value.u = std::uint64_t(reader.zigzag());
+            else if (code == 'f')
+                value.f = reader.raw<float>();
+            else if (code == 'd')
+                value.f = reader.raw<double>();
+            else if (code == 'o')
+                value.p = reinterpret_cast<const void *>(std::uintptr_t(reader.varint()));
+            else if (code == 'Y')
+            {
+                recorded_sync = reader.varint();
+                const auto it = m_syncs.find(recorded_sync);
+                value.p = it == m_syncs.end() ? nullptr : it->second;
+            }
+            else if (code == '#' || code == 'r')
+            {
+                const std::uint64_t tag = reader.varint();
+                if (tag == pointer_offset)
+                    value.p = reinterpret_cast<const void *>(std::uintptr_t(reader.varint()));
+                else if (tag >= pointer_payload && code == '#')
+                {
+                    m_last_payload = std::size_t(tag - pointer_payload);
+                    value.p = reader.bytes(m_last_payload);
+                }
+                else if (tag >= pointer_payload)
+                {
+                    m_readback.resize(std::max(m_readback.size(), std::size_t(tag - pointer_payload)));
+                    value.p = m_readback.data();
+                }
+            }
+            else if (code == '*' || code == '>')
+            {
+                const char kind = signature[++i];
+                const std::uint64_t stored = reader.varint();
+                names_index = index;
+                names_kind = kind;
+                recorded_names.clear();
+                m_replay_names.clear();
+                for (std::uint64_t n = 1; n < stored; n++)
+                {
+                    recorded_names.push_back(reader.varint());
+                    m_replay_names.push_back(code == '*' ? remap(kind, recorded_names.back()) : 0);
+                }
+                value.p = stored ? m_replay_names.data() : nullptr;
+            }
+            else if (code == 's')
+            {
+                const std::size_t count = reader.varint();
+                m_strings.clear();
+                m_lengths.clear();
+                for (std::size_t s = 0; s < count; s++)
+                {
+                    m_lengths.push_back(GLint(reader.varint()));
+                    m_strings.push_back(reinterpret_cast<const GLchar *>(reader.bytes(std::size_t(m_lengths.back()))));
+                }
+                value.p = m_strings.data();
+                a[index + 1].p = m_lengths.data();
+                // the lengths argument isn't recorded
+                i++;
+                index++;
+            }
+        }
+
+        std::uint64_t recorded_ret = 0;
+        if (signature[0] == 'H' || signature[0] == 'P' || signature[0] == 'Y')
+            recorded_ret = reader.varint();
+
+        m_stats.calls++;
+        if (!function.replay)
+        {
+            writeMapped(a);
+            return;
+        }
+        if (!function.isLoaded())
+        {
+            m_stats.skipped_calls++;
+            return;
+        }
+
+        function.replay(a, ret);
+
+        if (signature[0] == 'H' || signature[0] == 'P')
+            m_names[name_kinds.find(signature[0])][recorded_ret] = GLuint(ret.u);
+        else if (signature[0] == 'Y')
+            m_syncs[recorded_ret] = static_cast<GLsync>(const_cast<void *>(ret.p));
+        else if (signature[0] == 'm' && ret.p)
+            m_mappings[GLuint(a[0].u)] = {static_cast<std::byte *>(const_cast<void *>(ret.p)),
+                                         signature == "mBlle" ? GLintptr(asInt(a[1])) : 0};
+
+        if (names_kind && names_index != no_function && signature[names_index + 1] == '>')
+            for (std::size_t n = 0; n < recorded_names.size(); n++)
+                m_names[name_kinds.find(names_kind)][recorded_names[n]] = m_replay_names[n];
+
+        if (isDelete(function.name))
+        {
+            if (signature == "-Y")
+                m_syncs.erase(recorded_sync);
+            for (std::uint64_t name: recorded_names)
+                m_names[name_kinds.find(names_kind)].erase(name);
+        }
+        else if (std::string_view(function.name) == "glUnmapNamedBuffer")
+            m_mappings.erase(GLuint(a[0].u));
+    }
+
+    void writeMapped(const Value *a)
+    {
+        const auto it = m_mappings.find(GLuint(a[0].u));
+        if (it == m_mappings.end() || !a[2].p)
+            return;
+
+        const auto &[data, offset] = it->second;
+        std::memcpy(data + (asInt(a[1]) - offset), a[2].p, m_last_payload);
+    }
+
+    void deleteRemaining()
+    {
+        for (const auto &[buffer, mapping]: m_mappings)
+            glad_glUnmapNamedBuffer(buffer);
+
+        const auto deleteAll = [this](char kind, void (*destroy)(GLsizei, const GLuint *))
+        {
+            std::vector<GLuint> names;
+            for (const auto &[recorded, name]: m_names[name_kinds.find(kind)])
+                names.push_back(name);
+            if (destroy && !names.empty())
+                destroy(GLsizei(names.size()), names.data());
+        };
+
+        deleteAll('B', glad_glDeleteBuffers);
+        deleteAll('T', glad_glDeleteTextures);
+        deleteAll('S', glad_glDeleteSamplers);
+        deleteAll('F', glad_glDeleteFramebuffers);
+        deleteAll('R', glad_glDeleteRenderbuffers);
+        deleteAll('V', glad_glDeleteVertexArrays);
+        deleteAll('Q', glad_glDeleteQueries);
+        for (const auto &[recorded, name]: m_names[name_kinds.find('P')])
+            glad_glDeleteProgram(name);
+        for (const auto &[recorded, name]: m_names[name_kinds.find('H')])
+            glad_glDeleteShader(name);
+        for (const auto &[recorded, sync]: m_syncs)
+            glad_glDeleteSync(sync);
+    }
+
+    const TraceReplayer::Options &m_options;
+    TraceReplayer::Stats &m_stats;
+    std::vector<std::size_t> m_functions;
+    std::unordered_map<std::uint64_t, GLuint> m_names[name_kinds.size()];
+    std::unordered_map<std::uint64_t, GLsync> m_syncs;
+    std::unordered_map<GLuint, std::pair<std::byte *, GLintptr>> m_mappings;
+    std::vector<std::uint64_t> m_recorded_names;
+    std::vector<GLuint> m_replay_names;
+    std::vector<const GLchar *> m_strings;
+    std::vector<GLint> m_lengths;
+    std::vector<std::byte> m_readback;
+    std::size_t m_last_payload{0};
+};
+
+} // namespace
+
+TraceReplayer::TraceReplayer(const std::string &path) : m_file(path)
+{
+    TraceReader reader(m_file.getData(), m_file.getData() + m_file.getSize());
+    if (m_file.getSize() < 8 || reader.raw<std::uint32_t>() != trace_magic)
+        throw Error(path + " is not a glutils trace");
+    if (reader.raw<std::uint32_t>() != trace_version)
+        throw Error(path + " is a trace of an unsupported version");
+}
+
+auto TraceReplayer::replay() -> Stats
+{
+    return replay(Options{});
+}
+
+auto TraceReplayer::replay(const Options &options) -> Stats
+{
+    Stats stats;
+    const auto begin = std::chrono::steady_clock::now();
+
+    for (std::size_t loop = 0; loop < options.loops; loop++)
+    {
+        TraceReader reader(m_file.getData() + 8, m_file.getData() + m_file.getSize());
+        Replay(options, stats).run(reader);
+    }
+
+    stats.total_time = std::chrono::steady_clock::now() - begin;
+    return stats;
+}
+
+} // GL
@@ -0,0 +1,213 @@
+#include "glutils/video_frame.hpp"
+#include "glutils/compute.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+#include "glutils/memory_barrier.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+namespace GL {
+
+namespace {
+
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+using DataFormat = TextureHandle::DataFormat;
+using DataType = TextureHandle::DataType;
+using Options = VideoFrameRing::Options;
+
+constexpr GLuint group_size = 8;
+
+auto getImageQualifier(SizedInternalFormat format) -> const char *
+{
+    switch (format)
+    {
+        case SizedInternalFormat::rgba8:
+            return "rgba8";
+        case SizedInternalFormat::rgba16f:
+            return "rgba16f";
+        case SizedInternalFormat::rgba32f:
+            return "rgba32f";
+        default:
+            throw Error("video frames can only be converted to rgba8, rgba16f or rgba32f");
+    }
+}
+
+auto validate(const Options &options) -> const Options &
+{
+    if (options.width <= 0 || options.height <= 0 || options.frame_count <= 0)
+        throw Error("video frame ring must have a positive size and frame count");
+    return options;
+}
+
+auto createPlaneTexture(SizedInternalFormat format, GLsizei width, GLsizei height, GLsizei layers) -> Texture
+{
+    Texture texture{TextureHandle::Type::_2d_array};
+    texture.setStorage3D(1, format, width, height, layers);
+
+    glTextureParameteri(texture.getName(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(texture.getName(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(texture.getName(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture.getName(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return texture;
+}
+
+// Rows of an 8 bit plane, with one or two components per texel.
+auto getPlaneLayout(GLsizei stride, GLint component_count) -> PixelUnpackLayout
+{
+    PixelUnpackLayout layout;
+    layout.row_length = stride / component_count;
+    layout.alignment = 1;
+    return layout;
+}
+
+auto getComputeSource(const Options &options) -> std::string
+{
+    std::ostringstream src;
+
+    src << "#version 450\n"
+           "layout(local_size_x = " << group_size << ", local_size_y = " << group_size << ") in;\n"
+        << VideoFrameRing::getSamplingSource(options)
+        << "layout(binding = 0, " << getImageQualifier(options.output_format)
+        << ") uniform restrict writeonly image2D u_destination;\n"
+           "layout(location = 0) uniform int u_layer;\n"
+           "const ivec2 frame_size = ivec2(" << options.width << ", " << options.height << ");\n"
+        << R"glsl(
+void main()
+{
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(p, frame_size)))
+        return;
+
+    imageStore(u_destination, p, sampleVideoFrame((vec2(p) + 0.5) / vec2(frame_size), float(u_layer)));
+}
+)glsl";
+
+    return src.str();
+}
+
+} // namespace
+
+VideoFrameRing::VideoFrameRing(const Options &options) :
+        m_options(validate(options)),
+        m_chroma_width((options.width + 1) / 2),
+        m_chroma_height((options.height + 1) / 2),
+        m_luma(createPlaneTexture(SizedInternalFormat::r8, options.width, options.height, options.frame_count)),
+        m_chroma{options.layout == PlaneLayout::nv12
+                 ? createPlaneTexture(SizedInternalFormat::rg8, m_chroma_width, m_chroma_height, options.frame_count)
+                 : createPlaneTexture(SizedInternalFormat::r8, m_chroma_width, m_chroma_height, options.frame_count),
+                 options.layout == PlaneLayout::nv12
+                 ? Texture(TextureHandle())
+                 : createPlaneTexture(SizedInternalFormat::r8, m_chroma_width, m_chroma_height, options.frame_count)},
+        m_convert_program(buildProgram({{ShaderHandle::Type::compute, getComputeSource(options)}}))
+{}
+
+auto VideoFrameRing::nextLayer() -> GLint
+{
+    const GLint layer = m_next_layer;
+    m_next_layer = (m_next_layer + 1) % m_options.frame_count;
+    m_latest_layer = layer;
+    return layer;
+}
+
+auto VideoFrameRing::uploadNV12(const std::uint8_t *luma, GLsizei luma_stride, const std::uint8_t *chroma,
+                                GLsizei chroma_stride) -> GLint
+{
+    if (m_options.layout != PlaneLayout::nv12)
+        throw Error("uploadNV12() called on an I420 video frame ring");
+
+    const GLint layer = nextLayer();
+    m_luma.updateImage3D(0, 0, 0, layer, m_options.width, m_options.height, 1, DataFormat::red, DataType::ubyte, luma,
+                         getPlaneLayout(luma_stride, 1));
+    m_chroma[0].updateImage3D(0, 0, 0, layer, m_chroma_width, m_chroma_height, 1, DataFormat::rg, DataType::ubyte,
+                              chroma, getPlaneLayout(chroma_stride, 2));
+    return layer;
+}
+
+auto VideoFrameRing::uploadI420(const std::uint8_t *y, GLsizei y_stride, const std::uint8_t *u, GLsizei u_stride,
+                                const std::uint8_t *v, GLsizei v_stride) -> GLint
+{
+    if (m_options.layout != PlaneLayout::i420)
+        throw Error("uploadI420() called on an NV12 video frame ring");
+
+    const GLint layer = nextLayer();
+    m_luma.updateImage3D(0, 0, 0, layer, m_options.width, m_options.height, 1, DataFormat::red, DataType::ubyte, y,
+                         getPlaneLayout(y_stride, 1));
+    m_chroma[0].updateImage3D(0, 0, 0, layer, m_chroma_width, m_chroma_height, 1, DataFormat::red, DataType::ubyte, u,
+                              getPlaneLayout(u_stride, 1));
+    m_chroma[1].updateImage3D(0, 0, 0, layer, m_chroma_width, m_chroma_height, 1, DataFormat::red, DataType::ubyte, v,
+                              getPlaneLayout(v_stride, 1));
+    return layer;
+}
+
+void VideoFrameRing::bindTextures(GLuint first_unit) const
+{
+    TextureHandle::bindTextureUnit(first_unit, m_luma);
+    TextureHandle::bindTextureUnit(first_unit + 1, m_chroma[0]);
+    if (m_options.layout == PlaneLayout::i420)
+        TextureHandle::bindTextureUnit(first_unit + 2, m_chroma[1]);
+}
+
+void VideoFrameRing::convert(GLint layer, TextureHandle destination) const
+{
+    bindTextures(0);
+    destination.bindImage(0, 0, false, 0, TextureHandle::ImageAccess::write_only, m_options.output_format);
+
+    m_convert_program.use();
+    glProgramUniform1i(m_convert_program.getName(), 0, layer);
+
+    dispatchCompute((m_options.width + group_size - 1) / group_size, (m_options.height + group_size - 1) / group_size);
+
+    memoryBarrier(MemoryBarrierBits::texture_fetch | MemoryBarrierBits::shader_image_access);
+}
+
+auto VideoFrameRing::getSamplingSource(const Options &options, GLuint first_unit) -> std::string
+{
+    // luma and color difference weights of the red and blue primaries
+    const double kr = options.matrix == ColorMatrix::bt601 ? 0.299 : 0.2126;
+    const double kb = options.matrix == ColorMatrix::bt601 ? 0.114 : 0.0722;
+    const double kg = 1.0 - kr - kb;
+
+    const bool limited = options.range == ColorRange::limited;
+    const double y_offset = limited ? 16.0 / 255.0 : 0.0;
+    const double y_scale = limited ? 255.0 / 219.0 : 1.0;
+    const double c_scale = limited ? 255.0 / 224.0 : 1.0;
+
+    std::ostringstream src;
+    src << std::setprecision(9) << std::fixed;
+
+    src << "layout(binding = " << first_unit << ") uniform sampler2DArray u_video_luma;\n"
+           "layout(binding = " << first_unit + 1 << ") uniform sampler2DArray u_video_chroma;\n";
+    if (options.layout == PlaneLayout::i420)
+        src << "layout(binding = " << first_unit + 2 << ") uniform sampler2DArray u_video_chroma_v;\n";
+
+    src << "vec4 sampleVideoFrame(vec2 uv, float layer)\n"
+           "{\n"
+           "    vec3 yuv;\n"
+           "    yuv.x = texture(u_video_luma, vec3(uv, layer)).r;\n";
+    if (options.layout == PlaneLayout::nv12)
+        src << "    yuv.yz = texture(u_video_chroma, vec3(uv, layer)).rg;\n";
+    else
+        src << "    yuv.y = texture(u_video_chroma, vec3(uv, layer)).r;\n"
+               "    yuv.z = texture(u_video_chroma_v, vec3(uv, layer)).r;\n";
+
+    src << "    yuv = (yuv - vec3(" << y_offset << ", " << 128.0 / 255.0 << ", " << 128.0 / 255.0 << "))"
+           " * vec3(" << y_scale << ", " << c_scale << ", " << c_scale << ");\n"
+           "    vec3 rgb = vec3(yuv.x + " << 2.0 * (1.0 - kr) << " * yuv.z,\n"
+           "                    yuv.x - " << 2.0 * kb * (1.0 - kb) / kg << " * yuv.y - "
+        << 2.0 * kr * (1.0 - kr) / kg << " * yuv.z,\n"
+           "                    yuv.x + " << 2.0 * (1.0 - kb) << " * yuv.y);\n"
+           "    return vec4(clamp(rgb, 0.0, 1.0), 1.0);\n"
+           "}\n";
+
+    return src.str();
+}
+
+auto VideoFrameRing::getFrameSize() const -> std::size_t
+{
+    return std::size_t(m_options.width) * m_options.height
+           + std::size_t(m_chroma_width) * m_chroma_height * 2;
+}
+
+} // GL
@@ -0,0 +1,330 @@
+#include "glutils/virtual_texture.hpp"
+#include "glutils/error.hpp"
+#include "glutils/gl.hpp"
+#include "glutils/memory_barrier.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace GL {
+
+namespace {
+
+using SizedInternalFormat = TextureHandle::SizedInternalFormat;
+
+// count, jitter and two reserved words precede the entries
+constexpr GLsizeiptr feedback_header_size = 4 * sizeof(std::uint32_t);
+constexpr std::size_t readback_count = 3;
+constexpr GLint max_levels = 16;
+constexpr GLsizei max_pages_per_side = 1 << 14;
+
+bool isPowerOfTwo(GLsizei value)
+{
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+auto getResidencyOptions(const VirtualTexture::Options &options) -> TileResidency::Options
+{
+    TileResidency::Options residency;
+    residency.tile_size = options.page_size;
+    residency.border = options.border;
+    residency.pool_x = options.cache_pages_x;
+    residency.pool_y = options.cache_pages_y;
+    residency.pool_z = options.cache_layers;
+    residency.layered = true;
+    residency.data_format = options.data_format;
+    residency.data_type = options.data_type;
+    residency.staging_size = options.staging_size;
+    residency.loader_threads = options.loader_threads;
+    return residency;
+}
+
+auto getFeedbackSize(const VirtualTexture::Options &options) -> GLsizeiptr
+{
+    return feedback_header_size + GLsizeiptr(options.feedback_capacity) * GLsizeiptr(sizeof(std::uint32_t));
+}
+
+auto validate(const VirtualTexture::Options &options) -> const VirtualTexture::Options &
+{
+    if (!isPowerOfTwo(options.virtual_width) || !isPowerOfTwo(options.virtual_height)
+        || !isPowerOfTwo(options.page_size))
+        throw Error("virtual texture and page sizes must be powers of two");
+    if (options.page_size > options.virtual_width || options.page_size > options.virtual_height)
+        throw Error("virtual texture is smaller than a page");
+    if (options.virtual_width / options.page_size > max_pages_per_side
+        || options.virtual_height / options.page_size > max_pages_per_side)
+        throw Error("virtual texture has too many pages per side");
+    if (options.cache_pages_x <= 0 || options.cache_pages_x > 256 || options.cache_pages_y <= 0
+        || options.cache_pages_y > 256 || options.cache_layers <= 0 || options.cache_layers > 256)
+        throw Error("page cache dimensions must be between 1 and 256");
+    if (options.border < 0 || options.feedback_rate == 0)
+        throw Error("invalid virtual texture options");
+    // the loaders would wait forever for room for a page
+    if (options.staging_size < TileResidency::getTileBytes(getResidencyOptions(options)))
+        throw Error("virtual texture staging size is smaller than a page");
+    return options;
+}
+
+} // namespace
+
+VirtualTexture::VirtualTexture(const Options &options, PageLoader loader) :
+        m_options(validate(options)),
+        m_loader(std::move(loader)),
+        m_cache(TextureHandle::Type::_2d_array),
+        m_page_table(TextureHandle::Type::_2d)
+{
+    std::vector<TileResidency::LevelSize> level_sizes;
+    for (GLsizei x = options.virtual_width / options.page_size, y = options.virtual_height / options.page_size;;
+         x = std::max(1, x / 2), y = std::max(1, y / 2))
+    {
+        m_levels.push_back({x, y});
+        level_sizes.push_back({x, y, 1, x, y, 1});
+        if (x == 1 && y == 1)
+            break;
+    }
+    if (m_levels.size() > max_levels)
+        throw Error("virtual texture has too many mip levels");
+
+    const GLsizei slot_size = options.page_size + 2 * options.border;
+    m_cache.setStorage3D(1, options.format, options.cache_pages_x * slot_size, options.cache_pages_y * slot_size,
+                         options.cache_layers);
+    glTextureParameteri(m_cache.getName(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(m_cache.getName(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(m_cache.getName(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_cache.getName(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    m_page_table.setStorage2D(GLsizei(m_levels.size()), SizedInternalFormat::rgba8ui, m_levels[0].pages_x,
+                              m_levels[0].pages_y);
+    glTextureParameteri(m_page_table.getName(), GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(m_page_table.getName(), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    using StorageFlags = BufferHandle::StorageFlags;
+    using AccessFlags = BufferHandle::AccessFlags;
+
+    const GLsizeiptr feedback_size = getFeedbackSize(options);
+    const std::vector<std::byte> zeros(feedback_size);
+    m_feedback.allocateImmutable(feedback_size, StorageFlags::dynamic_storage, zeros.data());
+
+    m_readback.allocateImmutable(feedback_size * readback_count, StorageFlags::map_read | StorageFlags::map_persistent
+                                                                 | StorageFlags::map_coherent
+                                                                 | StorageFlags::client_storage);
+    m_readback_mapping = static_cast<const std::byte *>(
+            m_readback.mapRange(0, feedback_size * readback_count,
+                                AccessFlags::read | AccessFlags::persistent | AccessFlags::coherent));
+    if (!m_readback_mapping)
+        throw Error("failed to map virtual texture feedback readback buffer");
+    m_readbacks.resize(readback_count);
+
+    m_residency.emplace(m_cache, m_page_table, getResidencyOptions(options), std::move(level_sizes),
+                        [this](const TileResidency::TileId &tile, void *destination, GLsizeiptr row_stride)
+                        {
+                            return m_loader({tile.level, tile.x, tile.y}, destination, row_stride);
+                        });
+
+    // the coarsest level is the fallback for every other page
+    const Level &top = m_levels.back();
+    for (GLint y = 0; y < top.pages_y; y++)
+        for (GLint x = 0; x < top.pages_x; x++)
+            m_residency->request({GLint(m_levels.size()) - 1, x, y});
+}
+
+VirtualTexture::~VirtualTexture()
+{
+    // stop the loaders before the readback is unmapped
+    m_residency.reset();
+
+    if (m_readback_mapping)
+        m_readback.unmap();
+}
+
+auto VirtualTexture::s_key(const PageId &page) -> std::uint64_t
+{
+    return std::uint64_t(page.level) << 48 | std::uint64_t(page.y) << 24 | std::uint64_t(page.x);
+}
+
+void VirtualTexture::bind() const
+{
+    TextureHandle::bindTextureUnit(m_options.page_table_unit, m_page_table);
+    TextureHandle::bindTextureUnit(m_options.cache_unit, m_cache);
+    m_feedback.bindBase(BufferHandle::IndexedTarget::shader_storage, m_options.feedback_binding);
+}
+
+void VirtualTexture::update()
+{
+    std::unordered_map<std::uint64_t, std::uint32_t> requests;
+    readFeedback(requests);
+    requestPages(requests);
+
+    const TileResidency::Stats residency = m_residency->update();
+    m_stats.resident_pages = residency.resident_tiles;
+    m_stats.loading_pages = residency.loading_tiles;
+    m_stats.uploaded_pages = residency.uploaded_tiles;
+    m_stats.evicted_pages = residency.evicted_tiles;
+
+    m_frame++;
+}
+
+void VirtualTexture::readFeedback(std::unordered_map<std::uint64_t, std::uint32_t> &requests)
+{
+    const GLsizeiptr feedback_size = getFeedbackSize(m_options);
+
+    for (std::size_t i = 0; i < m_readbacks.size(); i++)
+    {
+        Readback &readback = m_readbacks[i];
+        if (!readback.fence)
+            continue;
+
+        const Sync::Status status = readback.fence->clientWait(false);
+        if (status != Sync::Status::already_signaled && status != Sync::Status::condition_satisfied)
+            continue;
+
+        const auto *words = reinterpret_cast<const std::uint32_t *>(m_readback_mapping + feedback_size * i);
+        const std::uint32_t count = std::min(words[0], m_options.feedback_capacity);
+
+        for (std::uint32_t j = 0; j < count; j++)
+        {
+            const std::uint32_t entry = words[feedback_header_size / sizeof(std::uint32_t) + j];
+            const PageId page{GLint(entry >> 28), GLint(entry & 0x3FFFu), GLint(entry >> 14 & 0x3FFFu)};
+
+            if (page.level < GLint(m_levels.size()) && page.x < m_levels[page.level].pages_x
+                && page.y < m_levels[page.level].pages_y)
+                requests[s_key(page)]++;
+        }
+
+        readback.fence.reset();
+    }
+
+    m_stats.requested_pages = requests.size();
+
+    // copy this frame's feedback unless every readback slot is still waiting on the GPU
+    Readback &next = m_readbacks[m_next_readback];
+    if (!next.fence)
+    {
+        memoryBarrier(MemoryBarrierBits::buffer_update);
+        BufferHandle::copy(m_feedback, m_readback, 0, feedback_size * GLintptr(m_next_readback), feedback_size);
+        next.fence = createFenceSync();
+        m_next_readback = (m_next_readback + 1) % m_readbacks.size();
+    }
+
+    // reset the count, and move the pixels that write feedback
+    const std::uint32_t header[2]{0, std::uint32_t(m_frame)};
+    m_feedback.write(0, sizeof(header), header);
+}
+
+void VirtualTexture::requestPages(const std::unordered_map<std::uint64_t, std::uint32_t> &requests)
+{
+    struct Candidate
+    {
+        PageId page;
+        std::uint32_t count;
+    };
+    std::unordered_map<std::uint64_t, Candidate> candidates;
+
+    const GLint top_level = GLint(m_levels.size()) - 1;
+
+    for (const auto &[key, count]: requests)
+    {
+        PageId page{GLint(key >> 48), GLint(key & 0xFFFFFFu), GLint(key >> 24 & 0xFFFFFFu)};
+
+        // a missing page is sampled through its closest resident ancestor, so load those on the way down too
+        while (true)
+        {
+            if (m_residency->touch({page.level, page.x, page.y}) != TileResidency::State::free)
+                break;
+
+            const std::uint64_t page_key = s_key(page);
+            Candidate &candidate = candidates.try_emplace(page_key, Candidate{page, 0}).first->second;
+            candidate.count += count;
+
+            if (page.level == top_level)
+                break;
+            page = {page.level + 1, page.x / 2, page.y / 2};
+        }
+    }
+
+    std::vector<Candidate> sorted;
+    sorted.reserve(candidates.size());
+    for (const auto &[key, candidate]: candidates)
+        sorted.emplace_back(candidate);
+
+    // coarse pages first, since they stand in for more of the texture
+    std::sort(sorted.begin(), sorted.end(), [](const Candidate &l, const Candidate &r)
+    {
+        return l.page.level != r.page.level ? l.page.level > r.page.level : l.count > r.count;
+    });
+
+    const std::size_t request_count = std::min(sorted.size(), std::size_t(m_options.max_requests_per_frame));
+    for (std::size_t i = 0; i < request_count; i++)
+    {
+        const PageId &page = sorted[i].page;
+        if (!m_residency->request({page.level, page.x, page.y}))
+            break;
+    }
+}
+
+auto VirtualTexture::getShaderSource(const Options &options) -> std::string
+{
+    const GLsizei slot_size = options.page_size + 2 * options.border;
+    GLint max_level = 0;
+    for (GLsizei size = std::max(options.virtual_width, options.virtual_height) / options.page_size; size > 1;
+         size /= 2)
+        max_level++;
+
+    std::ostringstream src;
+
+    src << "layout(binding = " << options.page_table_unit << ") uniform usampler2D u_vt_page_table;\n"
+           "layout(binding = " << options.cache_unit << ") uniform sampler2DArray u_vt_cache;\n"
+           "layout(std430, binding = " << options.feedback_binding << ") buffer VirtualTextureFeedback\n"
+           "{\n"
+           "    uint count;\n"
+           "    uint jitter;\n"
+           "    uint reserved[2];\n"
+           "    uint pages[];\n"
+           "} u_vt_feedback;\n"
+           "const vec2 vt_virtual_size = vec2(" << options.virtual_width << ", " << options.virtual_height << ");\n"
+           "const float vt_page_size = " << options.page_size << ".0;\n"
+           "const float vt_border = " << options.border << ".0;\n"
+           "const vec2 vt_cache_size = vec2(" << options.cache_pages_x * slot_size << ", "
+        << options.cache_pages_y * slot_size << ");\n"
+           "const int vt_max_level = " << max_level << ";\n"
+           "const uint vt_feedback_capacity = " << options.feedback_capacity << "u;\n"
+           "const uint vt_feedback_rate = " << options.feedback_rate << "u;\n"
+        << R"glsl(
+void vtWriteFeedback(vec2 uv, int level)
+{
+    uvec2 pixel = uvec2(gl_FragCoord.xy) + uvec2(u_vt_feedback.jitter, u_vt_feedback.jitter / vt_feedback_rate);
+    if (pixel.x % vt_feedback_rate != 0u || pixel.y % vt_feedback_rate != 0u)
+        return;
+
+    uvec2 page = uvec2(uv * vec2(textureSize(u_vt_page_table, level)));
+    uint index = atomicAdd(u_vt_feedback.count, 1u);
+    if (index < vt_feedback_capacity)
+        u_vt_feedback.pages[index] = uint(level) << 28 | page.y << 14 | page.x;
+}
+
+vec4 sampleVirtualTexture(vec2 uv)
+{
+    uv = clamp(uv, vec2(0.0), vec2(1.0 - 1.0 / vt_virtual_size));
+
+    vec2 texel = uv * vt_virtual_size;
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0));
+    int level = min(int(lod), vt_max_level);
+
+    vtWriteFeedback(uv, level);
+
+    uvec4 entry = texelFetch(u_vt_page_table, ivec2(uv * vec2(textureSize(u_vt_page_table, level))), level);
+    if (entry.a == 255u)
+        return vec4(0.0);
+
+    vec2 in_page = fract(uv * vec2(textureSize(u_vt_page_table, int(entry.a))));
+    vec2 cache_texel = vec2(entry.rg) * (vt_page_size + 2.0 * vt_border) + vt_border + in_page * vt_page_size;
+    return textureLod(u_vt_cache, vec3(cache_texel / vt_cache_size, float(entry.b)), 0.0);
+}
+)glsl";
+
+    return src.str();
+}
+
+} // GL